@@ -132,4 +132,15 @@
 	#define KLAYGE_NEON_SUPPORT
 #endif
 
+// Marks functions using instruction sets beyond the compile options, to be called only after a CpuInfo check
+#if defined(KLAYGE_CPU_X64) || defined(KLAYGE_CPU_X86)
+	#if defined(KLAYGE_COMPILER_MSVC)
+		#define KLAYGE_TARGET_AVX2
+		#define KLAYGE_TARGET_F16C
+	#elif defined(KLAYGE_COMPILER_GCC) || defined(KLAYGE_COMPILER_CLANG) || defined(KLAYGE_COMPILER_CLANGCL)
+		#define KLAYGE_TARGET_AVX2 __attribute__((target("avx2")))
+		#define KLAYGE_TARGET_F16C __attribute__((target("avx,f16c")))
+	#endif
+#endif
+
 #endif		// KFL_ARCHITECTURE_HPP
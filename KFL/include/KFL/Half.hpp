@@ -33,6 +33,8 @@
 
 #pragma once
 
+#include <KFL/CXX20/span.hpp>
+
 #include <boost/operators.hpp>
 #include <limits>
 
@@ -127,6 +129,10 @@ namespace KlayGE
 	private:
 		uint16_t value_{};
 	};
+
+	// Bulk conversions for large arrays, with F16C or NEON when the CPU has it. input and output have the same size.
+	void FloatToHalf(std::span<float const> input, std::span<half> output) noexcept;
+	void HalfToFloat(std::span<half const> input, std::span<float> output) noexcept;
 }
 
 namespace std
@@ -36,6 +36,7 @@
 #include <KFL/PreDeclare.hpp>
 #include <KFL/CXX20/span.hpp>
 
+#include <array>
 #include <string>
 #include <string_view>
 
@@ -135,6 +136,33 @@ namespace KlayGE
 	{
 		return HashRange(str.begin(), str.end());
 	}
+
+	// SHA-256. The hashes above are for hash tables, this one is for content identities that must not collide in practice, such
+	//  as the keys of build caches.
+	class Sha256 final
+	{
+	public:
+		using Digest = std::array<uint8_t, 32>;
+
+	public:
+		Sha256() noexcept;
+
+		void Update(std::span<uint8_t const> data) noexcept;
+		void Update(std::string_view str) noexcept;
+		// The hasher has to be reset before reusing
+		Digest Final() noexcept;
+		void Reset() noexcept;
+
+		static std::string ToString(Digest const& digest);
+
+	private:
+		void Transform(uint8_t const* block) noexcept;
+
+	private:
+		std::array<uint32_t, 8> state_;
+		std::array<uint8_t, 64> buffer_;
+		uint64_t length_;
+	};
 }
 
 #endif		// _KFL_HASH_HPP
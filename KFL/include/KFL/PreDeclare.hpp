@@ -49,6 +49,8 @@ namespace KlayGE
 	class JsonValue;
 
 	class ThreadPool;
+	class TaskScheduler;
+	class TaskGroup;
 
 	class half;
 	template <typename T, int N>
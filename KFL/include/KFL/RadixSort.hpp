@@ -0,0 +1,169 @@
+/**
+ * @file RadixSort.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KFL_RADIX_SORT_HPP
+#define KFL_RADIX_SORT_HPP
+
+#pragma once
+
+#include <KFL/CXX20/span.hpp>
+#include <KFL/Thread.hpp>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+namespace KlayGE
+{
+	// Stable LSD radix sort on 64-bit keys, 8 bits per pass. The passes where all keys have the same digit are skipped, so keys
+	//  that only use some of their bits cost less. With a scheduler, large inputs are counted and scattered in parallel chunks.
+	template <typename T, typename KeyFunc>
+	void RadixSort(std::span<T> items, std::span<T> scratch, KeyFunc const& key_func, TaskScheduler* scheduler = nullptr)
+	{
+		BOOST_ASSERT(scratch.size() >= items.size());
+
+		uint32_t constexpr MIN_CHUNK_SIZE = 16384;
+
+		uint32_t const num_items = static_cast<uint32_t>(items.size());
+		uint32_t const num_chunks = (scheduler != nullptr) ? std::max((num_items + MIN_CHUNK_SIZE - 1) / MIN_CHUNK_SIZE, 1U) : 1;
+		uint32_t const chunk_size = (num_items + num_chunks - 1) / num_chunks;
+
+		auto for_each_chunk = [scheduler, num_chunks](auto const& func) {
+			if (num_chunks > 1)
+			{
+				scheduler->ParallelFor(0, num_chunks, 1, [&func](uint32_t begin, uint32_t end) {
+					for (uint32_t c = begin; c < end; ++ c)
+					{
+						func(c);
+					}
+				});
+			}
+			else
+			{
+				func(0);
+			}
+		};
+
+		// The digit counts of all passes don't depend on the order, one read gives them all
+		std::vector<std::array<std::array<uint32_t, 256>, 8>> chunk_counts(num_chunks);
+		for_each_chunk([&](uint32_t c) {
+			auto& counts = chunk_counts[c];
+			for (auto& pass_counts : counts)
+			{
+				pass_counts.fill(0);
+			}
+			for (uint32_t i = c * chunk_size, end = std::min(i + chunk_size, num_items); i < end; ++ i)
+			{
+				uint64_t const key = key_func(items[i]);
+				for (uint32_t pass = 0; pass < 8; ++ pass)
+				{
+					++ counts[pass][(key >> (pass * 8)) & 0xFF];
+				}
+			}
+		});
+
+		std::vector<std::array<uint32_t, 256>> offsets(num_chunks);
+		T* src = items.data();
+		T* dst = scratch.data();
+		for (uint32_t pass = 0; pass < 8; ++ pass)
+		{
+			uint32_t const shift = pass * 8;
+
+			// Chunks have to be recounted in the current order, except the only one which keeps the total counts
+			if (num_chunks > 1)
+			{
+				bool same_digit = false;
+				for (uint32_t d = 0; (d < 256) && !same_digit; ++ d)
+				{
+					uint32_t total = 0;
+					for (auto const& counts : chunk_counts)
+					{
+						total += counts[pass][d];
+					}
+					same_digit = (total == num_items);
+				}
+				if (same_digit)
+				{
+					continue;
+				}
+
+				for_each_chunk([&](uint32_t c) {
+					auto& counts = offsets[c];
+					counts.fill(0);
+					for (uint32_t i = c * chunk_size, end = std::min(i + chunk_size, num_items); i < end; ++ i)
+					{
+						++ counts[(key_func(src[i]) >> shift) & 0xFF];
+					}
+				});
+			}
+			else
+			{
+				offsets[0] = chunk_counts[0][pass];
+			}
+
+			// Digit-major prefix sum, so every chunk scatters right after the previous chunk's items of the same digit
+			bool same_digit = false;
+			uint32_t offset = 0;
+			for (uint32_t d = 0; d < 256; ++ d)
+			{
+				uint32_t const digit_begin = offset;
+				for (auto& counts : offsets)
+				{
+					uint32_t const count = counts[d];
+					counts[d] = offset;
+					offset += count;
+				}
+				same_digit |= (offset - digit_begin == num_items);
+			}
+			if (same_digit)
+			{
+				continue;
+			}
+
+			for_each_chunk([&](uint32_t c) {
+				auto& chunk_offsets = offsets[c];
+				for (uint32_t i = c * chunk_size, end = std::min(i + chunk_size, num_items); i < end; ++ i)
+				{
+					dst[chunk_offsets[(key_func(src[i]) >> shift) & 0xFF] ++] = std::move(src[i]);
+				}
+			});
+			std::swap(src, dst);
+		}
+
+		if (src != items.data())
+		{
+			std::move(src, src + num_items, items.data());
+		}
+	}
+}
+
+#endif		// KFL_RADIX_SORT_HPP
@@ -46,6 +46,7 @@ namespace KlayGE
 {
 	class SIMDVectorF4;
 	class SIMDMatrixF4;
+	enum class BoundOverlap : uint32_t;
 
 	namespace SIMDMathLib
 	{
@@ -252,6 +253,22 @@ namespace KlayGE
 		void ObliqueClipping(SIMDMatrixF4& proj, SIMDVectorF4 const & clip_plane);
 
 
+		// Bound
+		///////////////////////////////////////////////////////////////////////////////
+
+		// Tests num AABBs, given as separated arrays of min and max components, against a frustum. Gives the same results as
+		// MathLib::intersect_aabb_frustum, but 4 (SSE) or 8 (AVX) boxes at a time.
+		void IntersectAABBsFrustum(BoundOverlap* results, float const * min_x, float const * min_y, float const * min_z,
+			float const * max_x, float const * max_y, float const * max_z, uint32_t num, Frustum const & frustum);
+
+		// Dual quaternion
+		///////////////////////////////////////////////////////////////////////////////
+
+		// Screw linear interpolation of num dual quaternion pairs. out, lhs and rhs each hold 8 streams of stride floats: real x, y, z, w,
+		// then dual x, y, z, w. Follows MathLib::sclerp, 4 pairs at a time with SSE. The trigonometric functions stay scalar.
+		void SclerpDualQuaternions(float* out, float const * lhs, float const * rhs, float const * s, uint32_t num, uint32_t stride);
+
+
 		// Color
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 NegativeColor(SIMDVectorF4 const & rhs);
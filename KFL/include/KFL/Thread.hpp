@@ -33,7 +33,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <exception>
 #include <functional>
 #ifdef KLAYGE_COMPILER_MSVC
 #pragma warning(push)
@@ -43,8 +47,10 @@
 #ifdef KLAYGE_COMPILER_MSVC
 #pragma warning(pop)
 #endif
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
@@ -64,6 +70,125 @@ namespace KlayGE
 		return ret;
 	}
 
+	// A fixed-size work-stealing scheduler for short-lived jobs. Each worker owns a deque. The owner pushes and pops from the back,
+	//  idle workers steal from the front of other deques. Threads that wait on a TaskGroup execute pending tasks instead of
+	//  blocking, so nested parallelism doesn't deadlock.
+	class TaskScheduler final : boost::noncopyable
+	{
+		struct WorkQueue final : boost::noncopyable
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+	public:
+		explicit TaskScheduler(uint32_t num_workers);
+		~TaskScheduler();
+
+		uint32_t NumWorkers() const noexcept
+		{
+			return static_cast<uint32_t>(workers_.size());
+		}
+
+		// Fire-and-forget. Called from a worker, the task goes to the worker's own deque.
+		void Schedule(std::function<void()> task);
+
+		template <typename Threadable>
+		std::future<typename std::invoke_result<Threadable>::type> Submit(Threadable func)
+		{
+			using result_t = typename std::invoke_result<Threadable>::type;
+
+			auto task = MakeSharedPtr<std::packaged_task<result_t()>>(std::move(func));
+			auto ret = task->get_future();
+			this->Schedule([task]() { (*task)(); });
+			return ret;
+		}
+
+		// Executes one pending task on the calling thread. Returns false if nothing could be found.
+		bool RunOne();
+
+		// Calls func(sub_begin, sub_end) on chunks of at most grain_size elements, and returns when all of them are done.
+		template <typename Func>
+		void ParallelFor(uint32_t begin, uint32_t end, uint32_t grain_size, Func const& func);
+
+	private:
+		bool PopTask(std::function<void()>& task);
+		void WorkerFunc(uint32_t index);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> queues_;
+		std::vector<std::thread> workers_;
+
+		std::atomic<uint32_t> next_queue_{0};
+		std::atomic<uint32_t> num_pending_{0};
+		std::atomic<uint32_t> num_sleeping_{0};
+		std::mutex sleep_mutex_;
+		std::condition_variable sleep_cond_;
+		std::atomic<bool> quit_{false};
+	};
+
+	// A set of tasks that can be waited on as a whole. Continuations are scheduled once every task in the group is done.
+	//  The first exception thrown by a task is kept and rethrown from Wait(). Continuations, like anything passed to
+	//  TaskScheduler::Schedule, must not throw.
+	class TaskGroup final : boost::noncopyable
+	{
+		struct State final : boost::noncopyable
+		{
+			explicit State(TaskScheduler& ts) noexcept
+				: scheduler(ts)
+			{
+			}
+
+			void OnTaskDone();
+
+			TaskScheduler& scheduler;
+			std::atomic<uint32_t> num_pending{0};
+			std::mutex mutex;
+			std::vector<std::function<void()>> continuations;
+			std::exception_ptr exception;
+		};
+
+	public:
+		explicit TaskGroup(TaskScheduler& ts);
+		~TaskGroup();
+
+		void Run(std::function<void()> task);
+		void Then(std::function<void()> continuation);
+		void Wait();
+
+	private:
+		void WaitForTasks();
+
+	private:
+		std::shared_ptr<State> state_;
+	};
+
+	template <typename Func>
+	void TaskScheduler::ParallelFor(uint32_t begin, uint32_t end, uint32_t grain_size, Func const& func)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		grain_size = std::max(grain_size, 1U);
+		if (end - begin <= grain_size)
+		{
+			func(begin, end);
+			return;
+		}
+
+		TaskGroup group(*this);
+		uint32_t sub_begin = begin;
+		for (; end - sub_begin > grain_size; sub_begin += grain_size)
+		{
+			uint32_t const sub_end = sub_begin + grain_size;
+			group.Run([&func, sub_begin, sub_end]() { func(sub_begin, sub_end); });
+		}
+		func(sub_begin, end);
+		group.Wait();
+	}
+
 	class ThreadPool final : boost::noncopyable
 	{
 		class CommonData;
@@ -179,8 +304,21 @@ namespace KlayGE
 			data_->NumMaxCachedThreads(num);
 		}
 
+		// Work-stealing scheduler for short jobs. Long-running or blocking functions should keep using QueueThread.
+		//  Created on first use, with one worker per hardware thread.
+		TaskScheduler& Scheduler();
+
+		template <typename Func>
+		void ParallelFor(uint32_t begin, uint32_t end, uint32_t grain_size, Func const& func)
+		{
+			this->Scheduler().ParallelFor(begin, end, grain_size, func);
+		}
+
 	private:
 		std::shared_ptr<CommonData> data_;
+
+		std::once_flag scheduler_once_;
+		std::unique_ptr<TaskScheduler> scheduler_;
 	};
 }
 
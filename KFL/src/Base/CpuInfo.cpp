@@ -245,6 +245,7 @@ namespace
 		void Call(uint32_t fn)
 		{
 			eax_ = fn;
+			ecx_ = 0; // Sub-leaf 0, leaf 7 reports garbage for others
 			get_cpuid(&eax_, &ebx_, &ecx_, &edx_);
 		}
 
@@ -0,0 +1,195 @@
+/**
+ * @file Hash.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KFL/KFL.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KFL/Hash.hpp>
+
+namespace
+{
+	uint32_t constexpr SHA256_K[] = {
+		0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+		0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+		0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+		0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+		0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+		0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+		0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+		0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+	};
+
+	uint32_t RotateRight(uint32_t v, uint32_t n) noexcept
+	{
+		return (v >> n) | (v << (32 - n));
+	}
+}
+
+namespace KlayGE
+{
+	Sha256::Sha256() noexcept
+	{
+		this->Reset();
+	}
+
+	void Sha256::Reset() noexcept
+	{
+		state_ = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+		length_ = 0;
+	}
+
+	void Sha256::Update(std::span<uint8_t const> data) noexcept
+	{
+		uint8_t const* p = data.data();
+		size_t size = data.size();
+
+		uint32_t const buffered = static_cast<uint32_t>(length_ % buffer_.size());
+		length_ += size;
+
+		if (buffered > 0)
+		{
+			size_t const fill = std::min(size, buffer_.size() - buffered);
+			std::memcpy(&buffer_[buffered], p, fill);
+			p += fill;
+			size -= fill;
+			if (buffered + fill < buffer_.size())
+			{
+				return;
+			}
+			this->Transform(buffer_.data());
+		}
+
+		for (; size >= buffer_.size(); p += buffer_.size(), size -= buffer_.size())
+		{
+			this->Transform(p);
+		}
+
+		if (size > 0)
+		{
+			std::memcpy(buffer_.data(), p, size);
+		}
+	}
+
+	void Sha256::Update(std::string_view str) noexcept
+	{
+		this->Update(std::span(reinterpret_cast<uint8_t const*>(str.data()), str.size()));
+	}
+
+	Sha256::Digest Sha256::Final() noexcept
+	{
+		uint64_t const bit_length = length_ * 8;
+
+		uint8_t padding[72] = {0x80};
+		uint32_t const buffered = static_cast<uint32_t>(length_ % buffer_.size());
+		uint32_t const padding_size = (buffered < 56 ? 56 : 120) - buffered;
+		for (uint32_t i = 0; i < 8; ++ i)
+		{
+			padding[padding_size + i] = static_cast<uint8_t>(bit_length >> (56 - i * 8));
+		}
+		this->Update(std::span(padding, padding_size + 8));
+
+		Digest digest;
+		for (uint32_t i = 0; i < 8; ++ i)
+		{
+			for (uint32_t j = 0; j < 4; ++ j)
+			{
+				digest[i * 4 + j] = static_cast<uint8_t>(state_[i] >> (24 - j * 8));
+			}
+		}
+		return digest;
+	}
+
+	std::string Sha256::ToString(Digest const& digest)
+	{
+		static char const hex_digits[] = "0123456789abcdef";
+
+		std::string ret(digest.size() * 2, '0');
+		for (size_t i = 0; i < digest.size(); ++ i)
+		{
+			ret[i * 2 + 0] = hex_digits[digest[i] >> 4];
+			ret[i * 2 + 1] = hex_digits[digest[i] & 0xF];
+		}
+		return ret;
+	}
+
+	void Sha256::Transform(uint8_t const* block) noexcept
+	{
+		uint32_t w[64];
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			w[i] = (static_cast<uint32_t>(block[i * 4 + 0]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16)
+				| (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+		}
+		for (uint32_t i = 16; i < 64; ++ i)
+		{
+			uint32_t const s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t const s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = state_[0];
+		uint32_t b = state_[1];
+		uint32_t c = state_[2];
+		uint32_t d = state_[3];
+		uint32_t e = state_[4];
+		uint32_t f = state_[5];
+		uint32_t g = state_[6];
+		uint32_t h = state_[7];
+		for (uint32_t i = 0; i < 64; ++ i)
+		{
+			uint32_t const s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+			uint32_t const ch = (e & f) ^ (~e & g);
+			uint32_t const t1 = h + s1 + ch + SHA256_K[i] + w[i];
+			uint32_t const s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+			uint32_t const maj = (a & b) ^ (a & c) ^ (b & c);
+			uint32_t const t2 = s0 + maj;
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state_[0] += a;
+		state_[1] += b;
+		state_[2] += c;
+		state_[3] += d;
+		state_[4] += e;
+		state_[5] += f;
+		state_[6] += g;
+		state_[7] += h;
+	}
+}
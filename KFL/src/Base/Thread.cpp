@@ -34,8 +34,260 @@
 
 #include <KFL/Thread.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	thread_local TaskScheduler* tls_scheduler = nullptr;
+	thread_local uint32_t tls_worker_index = 0;
+}
+
 namespace KlayGE
 {
+	TaskScheduler::TaskScheduler(uint32_t num_workers)
+	{
+		num_workers = std::max(num_workers, 1U);
+
+		queues_.resize(num_workers);
+		for (auto& queue : queues_)
+		{
+			queue = MakeUniquePtr<WorkQueue>();
+		}
+
+		workers_.reserve(num_workers);
+		for (uint32_t i = 0; i < num_workers; ++ i)
+		{
+			workers_.emplace_back([this, i]() { this->WorkerFunc(i); });
+		}
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			quit_ = true;
+		}
+		sleep_cond_.notify_all();
+
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+	}
+
+	void TaskScheduler::Schedule(std::function<void()> task)
+	{
+		uint32_t index;
+		if (tls_scheduler == this)
+		{
+			index = tls_worker_index;
+		}
+		else
+		{
+			index = next_queue_.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(queues_.size());
+		}
+
+		// Paired with the increment of num_sleeping_ in WorkerFunc. Both are seq_cst, so either the sleeper sees the new task,
+		//  or we see the sleeper.
+		num_pending_.fetch_add(1);
+		{
+			auto& queue = *queues_[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(std::move(task));
+		}
+
+		if (num_sleeping_.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			sleep_cond_.notify_one();
+		}
+	}
+
+	bool TaskScheduler::RunOne()
+	{
+		std::function<void()> task;
+		if (this->PopTask(task))
+		{
+			task();
+			return true;
+		}
+		return false;
+	}
+
+	bool TaskScheduler::PopTask(std::function<void()>& task)
+	{
+		if (num_pending_.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+
+		uint32_t const num_queues = static_cast<uint32_t>(queues_.size());
+		uint32_t start;
+		if (tls_scheduler == this)
+		{
+			// LIFO on our own deque keeps the working set hot in cache
+			auto& queue = *queues_[tls_worker_index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				num_pending_.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+
+			start = tls_worker_index + 1;
+		}
+		else
+		{
+			start = next_queue_.load(std::memory_order_relaxed);
+		}
+
+		// Steal the oldest task from someone else
+		for (uint32_t i = 0; i < num_queues; ++ i)
+		{
+			auto& queue = *queues_[(start + i) % num_queues];
+			std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+			if (lock.owns_lock() && !queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+				num_pending_.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void TaskScheduler::WorkerFunc(uint32_t index)
+	{
+		tls_scheduler = this;
+		tls_worker_index = index;
+
+		uint32_t const spin_count = 64;
+
+		std::function<void()> task;
+		while (!quit_)
+		{
+			bool found = false;
+			for (uint32_t i = 0; (i < spin_count) && !found; ++ i)
+			{
+				found = this->PopTask(task);
+				if (!found)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			if (found)
+			{
+				task();
+				task = std::function<void()>();
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock(sleep_mutex_);
+				num_sleeping_.fetch_add(1);
+				sleep_cond_.wait(lock, [this] { return quit_ || (num_pending_.load() > 0); });
+				num_sleeping_.fetch_sub(1);
+			}
+		}
+
+		tls_scheduler = nullptr;
+	}
+
+
+	void TaskGroup::State::OnTaskDone()
+	{
+		if (num_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::vector<std::function<void()>> conts;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				conts.swap(continuations);
+			}
+			for (auto& cont : conts)
+			{
+				scheduler.Schedule(std::move(cont));
+			}
+		}
+	}
+
+	TaskGroup::TaskGroup(TaskScheduler& ts)
+		: state_(MakeSharedPtr<State>(ts))
+	{
+	}
+
+	TaskGroup::~TaskGroup()
+	{
+		// Can't throw from here. Whoever cares about the exception should have called Wait().
+		this->WaitForTasks();
+	}
+
+	void TaskGroup::Run(std::function<void()> task)
+	{
+		state_->num_pending.fetch_add(1, std::memory_order_relaxed);
+		state_->scheduler.Schedule([state = state_, task = std::move(task)]() {
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (!state->exception)
+				{
+					state->exception = std::current_exception();
+				}
+			}
+			state->OnTaskDone();
+		});
+	}
+
+	void TaskGroup::Then(std::function<void()> continuation)
+	{
+		{
+			std::lock_guard<std::mutex> lock(state_->mutex);
+			if (state_->num_pending.load(std::memory_order_acquire) > 0)
+			{
+				state_->continuations.push_back(std::move(continuation));
+				return;
+			}
+		}
+
+		state_->scheduler.Schedule(std::move(continuation));
+	}
+
+	void TaskGroup::Wait()
+	{
+		this->WaitForTasks();
+
+		std::exception_ptr exception;
+		{
+			std::lock_guard<std::mutex> lock(state_->mutex);
+			exception = std::move(state_->exception);
+			state_->exception = nullptr;
+		}
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+
+	void TaskGroup::WaitForTasks()
+	{
+		while (state_->num_pending.load(std::memory_order_acquire) > 0)
+		{
+			if (!state_->scheduler.RunOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+
+
 	ThreadPool::ThreadInfo::ThreadInfo(CommonData& data) noexcept
 		: data_(data.shared_from_this())
 	{
@@ -191,4 +443,12 @@ namespace KlayGE
 
 		data_->AddWaitingThreads(num_min_cached_threads);
 	}
+
+	TaskScheduler& ThreadPool::Scheduler()
+	{
+		std::call_once(scheduler_once_, [this] {
+			scheduler_ = MakeUniquePtr<TaskScheduler>(std::max(std::thread::hardware_concurrency(), 1U));
+		});
+		return *scheduler_;
+	}
 }
@@ -30,104 +30,275 @@
 
 #include <KFL/KFL.hpp>
 #include <KFL/CXX20/bit.hpp>
+#include <KFL/CpuInfo.hpp>
+
+#include <boost/assert.hpp>
 
 #include <KFL/Half.hpp>
 
-namespace KlayGE
+#if defined(KLAYGE_SSE2_SUPPORT)
+#include <emmintrin.h>
+#if defined(KLAYGE_TARGET_F16C)
+#include <immintrin.h>
+#endif
+#elif defined(KLAYGE_NEON_SUPPORT) && defined(KLAYGE_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace
 {
-	half::half(float f) noexcept
-	{
-		int32_t i = std::bit_cast<int32_t>(f);
+	using namespace KlayGE;
+
+	static_assert(sizeof(half) == sizeof(uint16_t));
 
-		int32_t s = (i >> 16) & 0x00008000;
-		int32_t e = ((i >> 23) & 0x000000FF) - (127 - 15);
-		int32_t m = i & 0x007FFFFF;
+	typedef void (*FloatToHalfFunc)(float const * input, uint16_t* output, size_t num);
+	typedef void (*HalfToFloatFunc)(uint16_t const * input, float* output, size_t num);
 
-		if (e <= 0)
+	// IEEE round to nearest even, overflow goes to infinity and NaN stays NaN
+	uint16_t FloatToHalfBits(float f) noexcept
+	{
+		uint32_t u = std::bit_cast<uint32_t>(f);
+		uint32_t const sign = u & 0x80000000U;
+		u ^= sign;
+
+		uint16_t ret;
+		if (u >= ((127 + 16) << 23))
 		{
-			if (e < -10)
-			{
-				value_ = 0;
-			}
-			else
-			{
-				m = (m | 0x00800000) >> (1 - e);
+			ret = (u > (255U << 23)) ? 0x7E00 : 0x7C00;
+		}
+		else if (u < (113 << 23))
+		{
+			float const denorm_magic = std::bit_cast<float>(((127 - 15) + (23 - 10) + 1) << 23);
+			ret = static_cast<uint16_t>(std::bit_cast<uint32_t>(std::bit_cast<float>(u) + denorm_magic) - std::bit_cast<uint32_t>(denorm_magic));
+		}
+		else
+		{
+			uint32_t const mant_odd = (u >> 13) & 1;
+			u += ((15U - 127U) << 23) + 0xFFF;
+			u += mant_odd;
+			ret = static_cast<uint16_t>(u >> 13);
+		}
+		return static_cast<uint16_t>(ret | (sign >> 16));
+	}
 
-				if (m &  0x00001000)
-				{
-					m += 0x00002000;
-				}
+	float HalfBitsToFloat(uint16_t bits) noexcept
+	{
+		uint32_t const sign = (bits & 0x8000U) << 16;
+		uint32_t const exponent = (bits >> 10) & 0x1F;
+		uint32_t const mantissa = bits & 0x03FF;
 
-				value_ = static_cast<uint16_t>(s | (m >> 13));
-			}
+		uint32_t ret;
+		if (0 == exponent)
+		{
+			ret = std::bit_cast<uint32_t>(mantissa * std::bit_cast<float>((127U - 24) << 23));
+		}
+		else if (0x1F == exponent)
+		{
+			ret = 0x7F800000U | (mantissa << 13);
 		}
 		else
 		{
-			if (0xFF - (127 - 15) == e)
-			{
-				e = 31;
-			}
-			else
-			{
-				if (m & 0x00001000)
-				{
-					m += 0x00002000;
-
-					if (m & 0x00800000)
-					{
-						m = 0;		// overflow in significand,
-						e += 1;		// adjust exponent
-					}
-				}
-			}
+			ret = ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		return std::bit_cast<float>(ret | sign);
+	}
 
-			value_ = static_cast<uint16_t>(s | (e << 10) | (m >> 13));
+	void FloatToHalfScalar(float const * input, uint16_t* output, size_t num)
+	{
+		for (size_t i = 0; i < num; ++ i)
+		{
+			output[i] = FloatToHalfBits(input[i]);
 		}
 	}
 
-	half::operator float() const noexcept
+	void HalfToFloatScalar(uint16_t const * input, float* output, size_t num)
 	{
-		int32_t ret;
+		for (size_t i = 0; i < num; ++ i)
+		{
+			output[i] = HalfBitsToFloat(input[i]);
+		}
+	}
+
+#if defined(KLAYGE_SSE2_SUPPORT)
+	// Same bits as FloatToHalfBits, in the low 16 bits of each lane
+	__m128i FloatToHalfSSE2(__m128 f) noexcept
+	{
+		__m128i const sign_mask = _mm_set1_epi32(0x80000000U);
+		__m128i const f16max = _mm_set1_epi32((127 + 16) << 23);
+		__m128i const f32infty = _mm_set1_epi32(255 << 23);
+		__m128i const min_normal = _mm_set1_epi32(113 << 23);
+		__m128i const denorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+
+		__m128i u = _mm_castps_si128(f);
+		__m128i const sign = _mm_and_si128(u, sign_mask);
+		u = _mm_xor_si128(u, sign);
 
-		int32_t s = ((value_ & 0x8000) >> 15) << 31;
-		int32_t e = (value_ & 0x7C00) >> 10;
-		int32_t m = value_ & 0x03FF;
+		__m128i const inf_nan = _mm_or_si128(_mm_cmpgt_epi32(u, f16max), _mm_cmpeq_epi32(u, f16max));
+		__m128i const nan = _mm_cmpgt_epi32(u, f32infty);
+		__m128i const inf_nan_bits = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(nan, _mm_set1_epi32(0x0200)));
 
-		if (0 == e)
+		__m128i const is_denorm = _mm_cmplt_epi32(u, min_normal);
+		__m128i const denorm_bits = _mm_sub_epi32(
+			_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(u), _mm_castsi128_ps(denorm_magic))), denorm_magic);
+
+		__m128i const mant_odd = _mm_and_si128(_mm_srli_epi32(u, 13), _mm_set1_epi32(1));
+		__m128i normal_bits = _mm_add_epi32(u, _mm_set1_epi32(((15 - 127) << 23) + 0xFFF));
+		normal_bits = _mm_srli_epi32(_mm_add_epi32(normal_bits, mant_odd), 13);
+
+		__m128i o = _mm_or_si128(_mm_and_si128(is_denorm, denorm_bits), _mm_andnot_si128(is_denorm, normal_bits));
+		o = _mm_or_si128(_mm_and_si128(inf_nan, inf_nan_bits), _mm_andnot_si128(inf_nan, o));
+		return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+	}
+
+	// Same bits as HalfBitsToFloat, including denormals, infinities and NaNs
+	__m128 HalfToFloatSSE2(__m128i h) noexcept
+	{
+		__m128i const mask_nosign = _mm_set1_epi32(0x7FFF);
+		__m128i const exp_mask = _mm_set1_epi32(0x7C00 << 13);
+		__m128i const exp_adjust = _mm_set1_epi32((127 - 15) << 23);
+		__m128 const magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+
+		__m128i const expmant = _mm_and_si128(mask_nosign, h);
+		__m128i const justsign = _mm_xor_si128(h, expmant);
+		__m128i const shifted = _mm_slli_epi32(expmant, 13);
+		__m128i const exp = _mm_and_si128(shifted, exp_mask);
+		__m128i o = _mm_add_epi32(shifted, exp_adjust);
+
+		__m128i const infnan = _mm_cmpeq_epi32(exp, exp_mask);
+		o = _mm_add_epi32(o, _mm_and_si128(infnan, exp_adjust));
+
+		__m128i const denorm = _mm_cmpeq_epi32(exp, _mm_setzero_si128());
+		__m128i const renorm = _mm_castps_si128(
+			_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))), magic));
+		o = _mm_or_si128(_mm_and_si128(denorm, renorm), _mm_andnot_si128(denorm, o));
+
+		return _mm_castsi128_ps(_mm_or_si128(o, _mm_slli_epi32(justsign, 16)));
+	}
+
+	void FloatToHalfSSE2(float const * input, uint16_t* output, size_t num)
+	{
+		size_t i = 0;
+		for (; i + 8 <= num; i += 8)
 		{
-			if (m != 0)
-			{
-				// Denormalized number -- renormalize it
+			__m128i const lo = FloatToHalfSSE2(_mm_loadu_ps(input + i + 0));
+			__m128i const hi = FloatToHalfSSE2(_mm_loadu_ps(input + i + 4));
 
-				while (!(m & 0x00000400))
-				{
-					m <<= 1;
-					e -= 1;
-				}
+			// Sign extends the 16-bit values so that _mm_packs_epi32 keeps them intact
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+				_mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16), _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16)));
+		}
+		FloatToHalfScalar(input + i, output + i, num - i);
+	}
 
-				e += 1;
-				m &= ~0x00000400;
-			}
+	void HalfToFloatSSE2(uint16_t const * input, float* output, size_t num)
+	{
+		__m128i const zero = _mm_setzero_si128();
+
+		size_t i = 0;
+		for (; i + 8 <= num; i += 8)
+		{
+			__m128i const h = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i));
+			_mm_storeu_ps(output + i + 0, HalfToFloatSSE2(_mm_unpacklo_epi16(h, zero)));
+			_mm_storeu_ps(output + i + 4, HalfToFloatSSE2(_mm_unpackhi_epi16(h, zero)));
 		}
-		else
+		HalfToFloatScalar(input + i, output + i, num - i);
+	}
+
+#if defined(KLAYGE_TARGET_F16C)
+	KLAYGE_TARGET_F16C void FloatToHalfF16c(float const * input, uint16_t* output, size_t num)
+	{
+		size_t i = 0;
+		for (; i + 8 <= num; i += 8)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+				_mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT));
+		}
+		FloatToHalfScalar(input + i, output + i, num - i);
+	}
+
+	KLAYGE_TARGET_F16C void HalfToFloatF16c(uint16_t const * input, float* output, size_t num)
+	{
+		size_t i = 0;
+		for (; i + 8 <= num; i += 8)
+		{
+			_mm256_storeu_ps(output + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i))));
+		}
+		HalfToFloatScalar(input + i, output + i, num - i);
+	}
+#endif
+#elif defined(KLAYGE_NEON_SUPPORT) && defined(KLAYGE_CPU_ARM64)
+	// AArch64 always has the half conversion instructions, and rounds to nearest even by default
+	void FloatToHalfNeon(float const * input, uint16_t* output, size_t num)
+	{
+		size_t i = 0;
+		for (; i + 8 <= num; i += 8)
+		{
+			float16x8_t const h = vcvt_high_f16_f32(vcvt_f16_f32(vld1q_f32(input + i + 0)), vld1q_f32(input + i + 4));
+			vst1q_u16(output + i, vreinterpretq_u16_f16(h));
+		}
+		FloatToHalfScalar(input + i, output + i, num - i);
+	}
+
+	void HalfToFloatNeon(uint16_t const * input, float* output, size_t num)
+	{
+		size_t i = 0;
+		for (; i + 8 <= num; i += 8)
 		{
-			if (31 == e)
+			float16x8_t const h = vreinterpretq_f16_u16(vld1q_u16(input + i));
+			vst1q_f32(output + i + 0, vcvt_f32_f16(vget_low_f16(h)));
+			vst1q_f32(output + i + 4, vcvt_high_f32_f16(h));
+		}
+		HalfToFloatScalar(input + i, output + i, num - i);
+	}
+#endif
+
+	class HalfConverters final
+	{
+	public:
+		static HalfConverters const & Instance()
+		{
+			static HalfConverters const converters;
+			return converters;
+		}
+
+		FloatToHalfFunc to_half;
+		HalfToFloatFunc to_float;
+
+	private:
+		HalfConverters()
+		{
+#if defined(KLAYGE_SSE2_SUPPORT)
+			to_half = FloatToHalfSSE2;
+			to_float = HalfToFloatSSE2;
+#if defined(KLAYGE_TARGET_F16C)
+			CpuInfo const cpu;
+			if (cpu.IsFeatureSupport(CpuInfo::CF_AVX) && cpu.IsFeatureSupport(CpuInfo::CF_F16C))
 			{
-				if (m != 0)
-				{
-					// Nan -- preserve sign and significand bits
-					e = 0xFF - (127 - 15);
-				}
+				to_half = FloatToHalfF16c;
+				to_float = HalfToFloatF16c;
 			}
+#endif
+#elif defined(KLAYGE_NEON_SUPPORT) && defined(KLAYGE_CPU_ARM64)
+			to_half = FloatToHalfNeon;
+			to_float = HalfToFloatNeon;
+#else
+			to_half = FloatToHalfScalar;
+			to_float = HalfToFloatScalar;
+#endif
 		}
+	};
+}
 
-		// Normalized number
-		e += 127 - 15;
-		m <<= 13;
-
-		ret = s | (e << 23) | m;
+namespace KlayGE
+{
+	half::half(float f) noexcept
+		: value_(FloatToHalfBits(f))
+	{
+	}
 
-		return std::bit_cast<float>(ret);
+	half::operator float() const noexcept
+	{
+		return HalfBitsToFloat(value_);
 	}
 
 	half half::pos_inf() noexcept
@@ -195,7 +366,7 @@ namespace KlayGE
 	half const half::operator-() const noexcept
 	{
 		half temp(*this);
-		temp.value_ = -temp.value_;
+		temp.value_ ^= 0x8000;
 		return temp;
 	}
 
@@ -203,4 +374,16 @@ namespace KlayGE
 	{
 		return value_ == rhs.value_;
 	}
+
+	void FloatToHalf(std::span<float const> input, std::span<half> output) noexcept
+	{
+		BOOST_ASSERT(input.size() == output.size());
+		HalfConverters::Instance().to_half(input.data(), reinterpret_cast<uint16_t*>(output.data()), input.size());
+	}
+
+	void HalfToFloat(std::span<half const> input, std::span<float> output) noexcept
+	{
+		BOOST_ASSERT(input.size() == output.size());
+		HalfConverters::Instance().to_float(reinterpret_cast<uint16_t const *>(input.data()), output.data(), input.size());
+	}
 }
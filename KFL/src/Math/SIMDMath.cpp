@@ -34,6 +34,96 @@
 #ifdef SIMD_MATH_SSE
 	#include <emmintrin.h>
 #endif
+#if defined(KLAYGE_AVX_SUPPORT)
+	#include <immintrin.h>
+#endif
+
+#include <KFL/Frustum.hpp>
+
+#ifdef SIMD_MATH_SSE
+namespace
+{
+	struct QuaternionX4
+	{
+		__m128 x;
+		__m128 y;
+		__m128 z;
+		__m128 w;
+	};
+
+	QuaternionX4 LoadQuaternionX4(float const * src, uint32_t stride)
+	{
+		return QuaternionX4{_mm_loadu_ps(src), _mm_loadu_ps(src + stride), _mm_loadu_ps(src + stride * 2), _mm_loadu_ps(src + stride * 3)};
+	}
+
+	void StoreQuaternionX4(float* dst, uint32_t stride, QuaternionX4 const & q)
+	{
+		_mm_storeu_ps(dst, q.x);
+		_mm_storeu_ps(dst + stride, q.y);
+		_mm_storeu_ps(dst + stride * 2, q.z);
+		_mm_storeu_ps(dst + stride * 3, q.w);
+	}
+
+	QuaternionX4 Add(QuaternionX4 const & lhs, QuaternionX4 const & rhs)
+	{
+		return QuaternionX4{_mm_add_ps(lhs.x, rhs.x), _mm_add_ps(lhs.y, rhs.y), _mm_add_ps(lhs.z, rhs.z), _mm_add_ps(lhs.w, rhs.w)};
+	}
+
+	QuaternionX4 Scale(QuaternionX4 const & lhs, __m128 rhs)
+	{
+		return QuaternionX4{_mm_mul_ps(lhs.x, rhs), _mm_mul_ps(lhs.y, rhs), _mm_mul_ps(lhs.z, rhs), _mm_mul_ps(lhs.w, rhs)};
+	}
+
+	QuaternionX4 Xor(QuaternionX4 const & lhs, __m128 rhs)
+	{
+		return QuaternionX4{_mm_xor_ps(lhs.x, rhs), _mm_xor_ps(lhs.y, rhs), _mm_xor_ps(lhs.z, rhs), _mm_xor_ps(lhs.w, rhs)};
+	}
+
+	QuaternionX4 Conjugate(QuaternionX4 const & rhs)
+	{
+		__m128 const sign_mask = _mm_set1_ps(-0.0f);
+		return QuaternionX4{_mm_xor_ps(rhs.x, sign_mask), _mm_xor_ps(rhs.y, sign_mask), _mm_xor_ps(rhs.z, sign_mask), rhs.w};
+	}
+
+	// Same operation order as MathLib::dot
+	__m128 Dot(QuaternionX4 const & lhs, QuaternionX4 const & rhs)
+	{
+		return _mm_add_ps(_mm_mul_ps(lhs.x, rhs.x),
+			_mm_add_ps(_mm_mul_ps(lhs.y, rhs.y), _mm_add_ps(_mm_mul_ps(lhs.z, rhs.z), _mm_mul_ps(lhs.w, rhs.w))));
+	}
+
+	// Same operation order as MathLib::mul
+	QuaternionX4 Mul(QuaternionX4 const & lhs, QuaternionX4 const & rhs)
+	{
+		QuaternionX4 ret;
+		ret.x = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(lhs.x, rhs.w), _mm_mul_ps(lhs.y, rhs.z)), _mm_mul_ps(lhs.z, rhs.y)),
+			_mm_mul_ps(lhs.w, rhs.x));
+		ret.y = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(lhs.x, rhs.z), _mm_mul_ps(lhs.y, rhs.w)), _mm_mul_ps(lhs.z, rhs.x)),
+			_mm_mul_ps(lhs.w, rhs.y));
+		ret.z = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(lhs.y, rhs.x), _mm_mul_ps(lhs.x, rhs.y)), _mm_mul_ps(lhs.z, rhs.w)),
+			_mm_mul_ps(lhs.w, rhs.z));
+		ret.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(lhs.w, rhs.w), _mm_mul_ps(lhs.x, rhs.x)), _mm_mul_ps(lhs.y, rhs.y)),
+			_mm_mul_ps(lhs.z, rhs.z));
+		return ret;
+	}
+
+	__m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Same bit trick and iterations as MathLib::recip_sqrt
+	__m128 RecipSqrt(__m128 number)
+	{
+		__m128 const threehalfs = _mm_set1_ps(1.5f);
+		__m128 const x2 = _mm_mul_ps(number, _mm_set1_ps(0.5f));
+		__m128 f = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5f375a86), _mm_srai_epi32(_mm_castps_si128(number), 1)));
+		f = _mm_mul_ps(f, _mm_sub_ps(threehalfs, _mm_mul_ps(_mm_mul_ps(x2, f), f)));
+		f = _mm_mul_ps(f, _mm_sub_ps(threehalfs, _mm_mul_ps(_mm_mul_ps(x2, f), f)));
+		return f;
+	}
+}
+#endif
 
 namespace KlayGE
 {
@@ -2155,6 +2245,234 @@ namespace KlayGE
 			proj.Col(2, clip_plane * SetVector(c));
 		}
 
+
+		// Bound
+		///////////////////////////////////////////////////////////////////////////////
+		void IntersectAABBsFrustum(BoundOverlap* results, float const * min_x, float const * min_y, float const * min_z,
+			float const * max_x, float const * max_y, float const * max_z, uint32_t num, Frustum const & frustum)
+		{
+			// For every plane, v0 is the corner farthest along the normal, and v1 is the diagonally opposed one. Which of min or
+			// max goes to v0 only depends on the plane, so the selection is done once per plane instead of per box.
+			float planes[6][4];
+			float const * v0[6][3];
+			float const * v1[6][3];
+			for (uint32_t p = 0; p < 6; ++ p)
+			{
+				Plane const & plane = frustum.FrustumPlane(p);
+				planes[p][0] = plane.a();
+				planes[p][1] = plane.b();
+				planes[p][2] = plane.c();
+				planes[p][3] = plane.d();
+
+				v0[p][0] = (plane.a() < 0) ? min_x : max_x;
+				v0[p][1] = (plane.b() < 0) ? min_y : max_y;
+				v0[p][2] = (plane.c() < 0) ? min_z : max_z;
+				v1[p][0] = (plane.a() < 0) ? max_x : min_x;
+				v1[p][1] = (plane.b() < 0) ? max_y : min_y;
+				v1[p][2] = (plane.c() < 0) ? max_z : min_z;
+			}
+
+			uint32_t i = 0;
+#if defined(KLAYGE_AVX_SUPPORT)
+			for (; i + 8 <= num; i += 8)
+			{
+				__m256 const zero = _mm256_setzero_ps();
+				__m256 outside = zero;
+				__m256 intersect = zero;
+				for (uint32_t p = 0; p < 6; ++ p)
+				{
+					__m256 const a = _mm256_set1_ps(planes[p][0]);
+					__m256 const b = _mm256_set1_ps(planes[p][1]);
+					__m256 const c = _mm256_set1_ps(planes[p][2]);
+					__m256 const d = _mm256_set1_ps(planes[p][3]);
+
+					// Same operation order as dot_coord, so that the results match the scalar version exactly
+					__m256 d0 = _mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(v0[p][0] + i)), _mm256_mul_ps(b, _mm256_loadu_ps(v0[p][1] + i)));
+					d0 = _mm256_add_ps(_mm256_add_ps(d0, _mm256_mul_ps(c, _mm256_loadu_ps(v0[p][2] + i))), d);
+					__m256 d1 = _mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(v1[p][0] + i)), _mm256_mul_ps(b, _mm256_loadu_ps(v1[p][1] + i)));
+					d1 = _mm256_add_ps(_mm256_add_ps(d1, _mm256_mul_ps(c, _mm256_loadu_ps(v1[p][2] + i))), d);
+
+					outside = _mm256_or_ps(outside, _mm256_cmp_ps(d0, zero, _CMP_LT_OQ));
+					intersect = _mm256_or_ps(intersect, _mm256_cmp_ps(d1, zero, _CMP_LT_OQ));
+				}
+
+				int const outside_mask = _mm256_movemask_ps(outside);
+				int const intersect_mask = _mm256_movemask_ps(intersect);
+				for (uint32_t j = 0; j < 8; ++ j)
+				{
+					results[i + j] = (outside_mask & (1 << j)) ? BoundOverlap::No
+						: ((intersect_mask & (1 << j)) ? BoundOverlap::Partial : BoundOverlap::Yes);
+				}
+			}
+#endif
+#if defined(SIMD_MATH_SSE)
+			for (; i + 4 <= num; i += 4)
+			{
+				__m128 const zero = _mm_setzero_ps();
+				__m128 outside = zero;
+				__m128 intersect = zero;
+				for (uint32_t p = 0; p < 6; ++ p)
+				{
+					__m128 const a = _mm_set1_ps(planes[p][0]);
+					__m128 const b = _mm_set1_ps(planes[p][1]);
+					__m128 const c = _mm_set1_ps(planes[p][2]);
+					__m128 const d = _mm_set1_ps(planes[p][3]);
+
+					__m128 d0 = _mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(v0[p][0] + i)), _mm_mul_ps(b, _mm_loadu_ps(v0[p][1] + i)));
+					d0 = _mm_add_ps(_mm_add_ps(d0, _mm_mul_ps(c, _mm_loadu_ps(v0[p][2] + i))), d);
+					__m128 d1 = _mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(v1[p][0] + i)), _mm_mul_ps(b, _mm_loadu_ps(v1[p][1] + i)));
+					d1 = _mm_add_ps(_mm_add_ps(d1, _mm_mul_ps(c, _mm_loadu_ps(v1[p][2] + i))), d);
+
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(d0, zero));
+					intersect = _mm_or_ps(intersect, _mm_cmplt_ps(d1, zero));
+				}
+
+				int const outside_mask = _mm_movemask_ps(outside);
+				int const intersect_mask = _mm_movemask_ps(intersect);
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					results[i + j] = (outside_mask & (1 << j)) ? BoundOverlap::No
+						: ((intersect_mask & (1 << j)) ? BoundOverlap::Partial : BoundOverlap::Yes);
+				}
+			}
+#endif
+			for (; i < num; ++ i)
+			{
+				bool outside = false;
+				bool intersect = false;
+				for (uint32_t p = 0; p < 6; ++ p)
+				{
+					float const d0 = planes[p][0] * v0[p][0][i] + planes[p][1] * v0[p][1][i] + planes[p][2] * v0[p][2][i] + planes[p][3];
+					float const d1 = planes[p][0] * v1[p][0][i] + planes[p][1] * v1[p][1][i] + planes[p][2] * v1[p][2][i] + planes[p][3];
+					outside |= (d0 < 0);
+					intersect |= (d1 < 0);
+				}
+
+				results[i] = outside ? BoundOverlap::No : (intersect ? BoundOverlap::Partial : BoundOverlap::Yes);
+			}
+		}
+
+		// Dual quaternion
+		///////////////////////////////////////////////////////////////////////////////
+		void SclerpDualQuaternions(float* out, float const * lhs, float const * rhs, float const * s, uint32_t num, uint32_t stride)
+		{
+			uint32_t i = 0;
+#if defined(SIMD_MATH_SSE)
+			__m128 const zero = _mm_setzero_ps();
+			__m128 const one = _mm_set1_ps(1.0f);
+			__m128 const half = _mm_set1_ps(0.5f);
+			__m128 const two = _mm_set1_ps(2.0f);
+			__m128 const epsilon = _mm_set1_ps(1e-6f);
+			__m128 const sign_mask = _mm_set1_ps(-0.0f);
+			for (; i + 4 <= num; i += 4)
+			{
+				QuaternionX4 const lhs_real = LoadQuaternionX4(lhs + i, stride);
+				QuaternionX4 const lhs_dual = LoadQuaternionX4(lhs + stride * 4 + i, stride);
+				QuaternionX4 rhs_real = LoadQuaternionX4(rhs + i, stride);
+				QuaternionX4 rhs_dual = LoadQuaternionX4(rhs + stride * 4 + i, stride);
+
+				// Make sure dot product is >= 0
+				__m128 const flip = _mm_and_ps(_mm_cmplt_ps(Dot(lhs_real, rhs_real), zero), sign_mask);
+				rhs_real = Xor(rhs_real, flip);
+				rhs_dual = Xor(rhs_dual, flip);
+
+				__m128 const sqr_len_0 = Dot(lhs_real, lhs_real);
+				__m128 const sqr_len_e = _mm_mul_ps(two, Dot(lhs_real, lhs_dual));
+				__m128 const inv_sqr_len_0 = _mm_div_ps(one, sqr_len_0);
+				__m128 const inv_sqr_len_e = _mm_div_ps(_mm_xor_ps(sqr_len_e, sign_mask), _mm_mul_ps(sqr_len_0, sqr_len_0));
+				QuaternionX4 const conj_real = Conjugate(lhs_real);
+				QuaternionX4 const inv_real = Scale(conj_real, inv_sqr_len_0);
+				QuaternionX4 const inv_dual = Add(Scale(Conjugate(lhs_dual), inv_sqr_len_0), Scale(conj_real, inv_sqr_len_e));
+
+				QuaternionX4 const dif_dual = Add(Mul(inv_real, rhs_dual), Mul(inv_dual, rhs_real));
+				QuaternionX4 const dif_real = Mul(inv_real, rhs_real);
+
+				// To screw. Both branches of MathLib::udq_to_screw are evaluated and blended.
+				__m128 const pure_trans = _mm_cmpge_ps(_mm_andnot_ps(sign_mask, dif_real.w), one);
+
+				__m128 const trans_sq_len = _mm_add_ps(_mm_mul_ps(dif_dual.x, dif_dual.x),
+					_mm_add_ps(_mm_mul_ps(dif_dual.y, dif_dual.y), _mm_mul_ps(dif_dual.z, dif_dual.z)));
+				__m128 const has_trans = _mm_cmpgt_ps(trans_sq_len, epsilon);
+				__m128 const trans_len = _mm_sqrt_ps(trans_sq_len);
+				__m128 const inv_trans_len = _mm_div_ps(one, trans_len);
+				__m128 const trans_pitch = _mm_and_ps(has_trans, _mm_mul_ps(two, trans_len));
+				__m128 const trans_dir_x = Select(has_trans, _mm_mul_ps(dif_dual.x, inv_trans_len), dif_dual.x);
+				__m128 const trans_dir_y = Select(has_trans, _mm_mul_ps(dif_dual.y, inv_trans_len), dif_dual.y);
+				__m128 const trans_dir_z = Select(has_trans, _mm_mul_ps(dif_dual.z, inv_trans_len), dif_dual.z);
+
+				__m128 const rot_sq_len = _mm_add_ps(_mm_mul_ps(dif_real.x, dif_real.x),
+					_mm_add_ps(_mm_mul_ps(dif_real.y, dif_real.y), _mm_mul_ps(dif_real.z, dif_real.z)));
+				__m128 const has_rot = _mm_andnot_ps(_mm_cmplt_ps(rot_sq_len, epsilon), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+				__m128 const oos = RecipSqrt(rot_sq_len);
+				__m128 const rot_dir_x = _mm_and_ps(has_rot, _mm_mul_ps(dif_real.x, oos));
+				__m128 const rot_dir_y = _mm_and_ps(has_rot, _mm_mul_ps(dif_real.y, oos));
+				__m128 const rot_dir_z = _mm_and_ps(has_rot, _mm_mul_ps(dif_real.z, oos));
+				__m128 const rot_pitch = _mm_and_ps(has_rot, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), dif_dual.w), oos));
+				auto const rot_moment = [&](__m128 dual_v, __m128 dir)
+				{
+					__m128 const v = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(dir, rot_pitch), dif_real.w), half);
+					return _mm_and_ps(has_rot, _mm_mul_ps(_mm_sub_ps(dual_v, v), oos));
+				};
+				__m128 const rot_moment_x = rot_moment(dif_dual.x, rot_dir_x);
+				__m128 const rot_moment_y = rot_moment(dif_dual.y, rot_dir_y);
+				__m128 const rot_moment_z = rot_moment(dif_dual.z, rot_dir_z);
+
+				alignas(16) float w[4];
+				_mm_store_ps(w, dif_real.w);
+				alignas(16) float half_angle[4];
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					float const angle = (MathLib::abs(w[j]) >= 1) ? 0.0f : 2 * MathLib::acos(w[j]);
+					half_angle[j] = angle * s[i + j] * 0.5f;
+				}
+
+				__m128 const s4 = _mm_loadu_ps(s + i);
+				__m128 const dir_x = Select(pure_trans, trans_dir_x, rot_dir_x);
+				__m128 const dir_y = Select(pure_trans, trans_dir_y, rot_dir_y);
+				__m128 const dir_z = Select(pure_trans, trans_dir_z, rot_dir_z);
+				__m128 const pitch = _mm_mul_ps(Select(pure_trans, trans_pitch, rot_pitch), s4);
+				__m128 const moment_x = _mm_andnot_ps(pure_trans, rot_moment_x);
+				__m128 const moment_y = _mm_andnot_ps(pure_trans, rot_moment_y);
+				__m128 const moment_z = _mm_andnot_ps(pure_trans, rot_moment_z);
+
+				// From screw
+				alignas(16) float sin_half[4];
+				alignas(16) float cos_half[4];
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					MathLib::sincos(half_angle[j], sin_half[j], cos_half[j]);
+				}
+				__m128 const sa = _mm_load_ps(sin_half);
+				__m128 const ca = _mm_load_ps(cos_half);
+
+				QuaternionX4 const screw_real{_mm_mul_ps(dir_x, sa), _mm_mul_ps(dir_y, sa), _mm_mul_ps(dir_z, sa), ca};
+				__m128 const half_pitch_ca = _mm_mul_ps(_mm_mul_ps(half, pitch), ca);
+				QuaternionX4 const screw_dual{
+					_mm_add_ps(_mm_mul_ps(sa, moment_x), _mm_mul_ps(half_pitch_ca, dir_x)),
+					_mm_add_ps(_mm_mul_ps(sa, moment_y), _mm_mul_ps(half_pitch_ca, dir_y)),
+					_mm_add_ps(_mm_mul_ps(sa, moment_z), _mm_mul_ps(half_pitch_ca, dir_z)),
+					_mm_mul_ps(_mm_mul_ps(_mm_xor_ps(pitch, sign_mask), sa), half)};
+
+				StoreQuaternionX4(out + i, stride, Mul(lhs_real, screw_real));
+				StoreQuaternionX4(out + stride * 4 + i, stride, Add(Mul(lhs_real, screw_dual), Mul(lhs_dual, screw_real)));
+			}
+#endif
+
+			for (; i < num; ++ i)
+			{
+				Quaternion const lhs_real(lhs[i], lhs[stride + i], lhs[stride * 2 + i], lhs[stride * 3 + i]);
+				Quaternion const lhs_dual(lhs[stride * 4 + i], lhs[stride * 5 + i], lhs[stride * 6 + i], lhs[stride * 7 + i]);
+				Quaternion const rhs_real(rhs[i], rhs[stride + i], rhs[stride * 2 + i], rhs[stride * 3 + i]);
+				Quaternion const rhs_dual(rhs[stride * 4 + i], rhs[stride * 5 + i], rhs[stride * 6 + i], rhs[stride * 7 + i]);
+				auto const dq = MathLib::sclerp(lhs_real, lhs_dual, rhs_real, rhs_dual, s[i]);
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					out[stride * j + i] = dq.first[j];
+					out[stride * (j + 4) + i] = dq.second[j];
+				}
+			}
+		}
+
 		// Color
 		///////////////////////////////////////////////////////////////////////////////
 		SIMDVectorF4 NegativeColor(SIMDVectorF4 const & rhs)
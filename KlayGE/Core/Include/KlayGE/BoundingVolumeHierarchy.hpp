@@ -0,0 +1,112 @@
+/**
+ * @file BoundingVolumeHierarchy.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_BOUNDING_VOLUME_HIERARCHY_HPP
+#define KLAYGE_CORE_BOUNDING_VOLUME_HIERARCHY_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/AABBox.hpp>
+#include <KFL/CXX20/span.hpp>
+#include <KFL/Sphere.hpp>
+#include <KFL/Vector.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace KlayGE
+{
+	// A binary tree of boxes over items given as AABBs, built with binned SAH. Items are referred by their index in the bounds
+	//  given to Build. Queries are const and can run on multiple threads.
+	class KLAYGE_CORE_API BoundingVolumeHierarchy final
+	{
+	public:
+		static uint32_t constexpr InvalidIndex = 0xFFFFFFFFU;
+
+		// Gets an item whose box the ray enters at box_dist. Returns the distance of the actual hit, or a negative number for a miss.
+		using RayHitTest = std::function<float(uint32_t item, float box_dist)>;
+		using OverlapCallback = std::function<void(uint32_t item)>;
+
+	public:
+		void Build(std::span<AABBox const> bounds);
+		// Keeps the tree, and only recomputes the boxes. bounds are of the same items as the last Build. Returns false if the tree
+		//  has degraded enough to be worth rebuilding.
+		bool Refit(std::span<AABBox const> bounds);
+		void Clear();
+
+		uint32_t NumItems() const noexcept
+		{
+			return static_cast<uint32_t>(items_.size());
+		}
+		uint32_t NumNodes() const noexcept
+		{
+			return static_cast<uint32_t>(nodes_.size());
+		}
+		AABBox Bound() const;
+
+		// Closest item along dir, with the boxes inflated by radius. dist is the max distance in, and the distance of the hit out.
+		//  Without hit_test, the hits are on the item boxes. Returns InvalidIndex for no hit.
+		uint32_t RayCast(float3 const & orig, float3 const & dir, float radius, float& dist, RayHitTest const & hit_test = {}) const;
+		void Overlap(AABBox const & aabb, OverlapCallback const & callback) const;
+		void Overlap(Sphere const & sphere, OverlapCallback const & callback) const;
+
+	private:
+		// AABBox has virtual functions, the plain one keeps the traversal inlined
+		struct Box
+		{
+			float3 min;
+			float3 max;
+		};
+
+		struct Node
+		{
+			float3 min;
+			// The left child for internal nodes, the right one is next to it. The first item for leaves.
+			uint32_t first;
+			float3 max;
+			// 0 for internal nodes
+			uint32_t count;
+		};
+
+		void UpdateLeafBound(Node& node) const;
+		float Cost() const;
+
+	private:
+		std::vector<Node> nodes_;
+		std::vector<uint32_t> items_;
+		// In the order of items_
+		std::vector<Box> item_bounds_;
+
+		float build_cost_ = 0;
+	};
+} // namespace KlayGE
+
+#endif // KLAYGE_CORE_BOUNDING_VOLUME_HIERARCHY_HPP
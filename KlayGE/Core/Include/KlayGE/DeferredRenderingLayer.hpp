@@ -42,6 +42,7 @@
 #include <KlayGE/IndirectLightingLayer.hpp>
 #include <KlayGE/CascadedShadowLayer.hpp>
 #include <KlayGE/Renderable.hpp>
+#include <KlayGE/RenderGraph.hpp>
 
 #define TRIDITIONAL_DEFERRED 0
 #define LIGHT_INDEXED_DEFERRED 1
@@ -463,6 +464,69 @@ namespace KlayGE
 		uint32_t NumPrimitivesRendered() const;
 		uint32_t NumVerticesRendered() const;
 
+		// How much the per-viewport post process targets save by sharing textures, for the current viewport setup
+		RenderGraph::MemoryReport const& TransientTargetsReport() const noexcept
+		{
+			return transient_graph_.Report();
+		}
+
+		enum PostProcessTarget
+		{
+			PPT_DoF = 0,
+			PPT_MotionBlur,
+			PPT_BeforeSSR,
+
+			PPT_Num
+		};
+		// Declares the post process passes of a viewport with the VPAM_* attrib in the graph, and returns the targets. The ones the
+		//  viewport doesn't need are RenderGraph::InvalidIndex.
+		// Only the targets are allocated through the graph. The jobs are still put together by BuildPassScanList.
+		static std::array<uint32_t, PPT_Num> DeclarePostProcessTargets(RenderGraph& graph, uint32_t attrib,
+			RenderGraph::TextureDesc const & desc);
+
+		enum ShadowMapUpdate : uint8_t
+		{
+			SMU_Full,
+			// The filtered shadow map from an earlier frame is still good
+			SMU_Skip,
+			// Static casters first, their depth is saved before the dynamic ones are drawn
+			SMU_StaticAndDynamic,
+			// Starts from the saved static depth
+			SMU_DynamicOnly
+		};
+		struct CachedShadowMap
+		{
+			LightSource const * light = nullptr;
+			float4x4 view_proj;
+			float range = 0;
+			bool split = false;
+			bool translucency = false;
+			bool valid = false;
+		};
+		// Picks how a cached shadow map is drawn this frame, and makes the cache describe it. key holds the light, view_proj, range,
+		//  split and translucency of this frame. casters_changed is SceneManager::CastersChanged of the light's range, asking for
+		//  the static casters only with split.
+		static ShadowMapUpdate UpdateShadowMapCache(CachedShadowMap& cache, CachedShadowMap const & key, bool casters_changed);
+
+		// Shadow maps of spot and point lights are reused until the light or a caster in its range changes
+		void ShadowMapCaching(bool caching)
+		{
+			shadow_map_caching_ = caching;
+		}
+		bool ShadowMapCaching() const
+		{
+			return shadow_map_caching_;
+		}
+		// Caches the static casters only, and draws the dynamic ones over them every frame
+		void StaticShadowMapSplit(bool split)
+		{
+			static_shadow_map_split_ = split;
+		}
+		bool StaticShadowMapSplit() const
+		{
+			return static_shadow_map_split_;
+		}
+
 #ifndef KLAYGE_SHIP
 		PerfRegion const& ShadowMapPerf() const noexcept
 		{
@@ -510,6 +574,8 @@ namespace KlayGE
 		void AppendCascadedShadowPassScanCode(uint32_t vp_index, uint32_t light_index);
 		void AppendIndirectLightingPassScanCode(uint32_t vp_index, uint32_t light_index);
 		void AppendShadingPassScanCode(uint32_t vp_index, PassTargetBuffer pass_tb);
+		void BuildPassListKey(std::vector<uint32_t>& key) const;
+		void BuildTransientTargets();
 		void PreparePVP(PerViewport& pvp);
 		void GenerateGBuffer(PerViewport const & pvp, PassTargetBuffer pass_tb);
 		void PostGenerateGBuffer(PerViewport const & pvp);
@@ -518,6 +584,7 @@ namespace KlayGE
 		void PrepareLightCamera(PerViewport const & pvp, LightSource const & light,
 			int32_t index_in_pass, PassType pass_type);
 		void PostGenerateShadowMap(PerViewport const & pvp, int32_t light_index, int32_t index_in_pass);
+		void UpdateShadowMapCaches();
 		void UpdateShadowing(PerViewport const & pvp);
 #if DEFAULT_DEFERRED == LIGHT_INDEXED_DEFERRED
 		void UpdateShadowingCS(PerViewport const & pvp);
@@ -558,6 +625,7 @@ namespace KlayGE
 		uint32_t GBufferProcessingDRJob(PerViewport const & pvp);
 		uint32_t OpaqueGBufferProcessingDRJob(PerViewport const & pvp);
 		uint32_t ShadowMapGenerationDRJob(PerViewport const & pvp, PassType pass_type, int32_t light_index, int32_t index_in_pass);
+		uint32_t StaticShadowMapDRJob(PassType pass_type, int32_t light_index);
 		uint32_t IndirectLightingDRJob(PerViewport const & pvp, int32_t light_index);
 		uint32_t ShadowingDRJob(PerViewport const & pvp, PassTargetBuffer pass_tb);
 		uint32_t ShadingDRJob(PerViewport const & pvp, PassType pass_type, int32_t index_in_pass);
@@ -593,6 +661,7 @@ namespace KlayGE
 
 		std::array<PerViewport, 8> viewports_;
 		uint32_t active_viewport_;
+		RenderGraph transient_graph_;
 
 		PostProcessPtr ssvo_pp_;
 		PostProcessPtr ssvo_blur_pp_;
@@ -641,6 +710,9 @@ namespace KlayGE
 
 		std::vector<std::unique_ptr<DeferredRenderingJob>> jobs_;
 		std::vector<std::unique_ptr<DeferredRenderingJob>>::iterator curr_job_iter_;
+		// Everything the job list depends on. The jobs are only rebuilt when it changes.
+		std::vector<uint32_t> pass_list_key_;
+		std::vector<uint32_t> new_pass_list_key_;
 
 		std::array<std::array<RenderTechnique*, 5>, LightSource::LT_NumLightTypes> technique_shadows_;
 		RenderTechnique* technique_no_lighting_;
@@ -706,6 +778,15 @@ namespace KlayGE
 		RenderTargetViewPtr
 			filtered_shadow_map_cube_face_rtvs_[(MAX_NUM_SHADOWED_POINT_LIGHTS + MAX_NUM_PROJECTIVE_SHADOWED_POINT_LIGHTS) * 6];
 
+		// Indexed by light
+		std::vector<ShadowMapUpdate> shadow_map_updates_;
+		CachedShadowMap cached_shadow_map_2ds_[MAX_NUM_SHADOWED_SPOT_LIGHTS];
+		CachedShadowMap cached_shadow_map_cubes_[MAX_NUM_SHADOWED_POINT_LIGHTS];
+		TexturePtr static_shadow_map_2d_depth_texs_[MAX_NUM_SHADOWED_SPOT_LIGHTS];
+		TexturePtr static_shadow_map_cube_depth_texs_[MAX_NUM_SHADOWED_POINT_LIGHTS];
+		bool shadow_map_caching_ = true;
+		bool static_shadow_map_split_ = false;
+
 		PostProcessPtr shadow_map_filter_pp_;
 		PostProcessPtr csm_filter_pp_;
 		PostProcessPtr depth_to_esm_pp_;
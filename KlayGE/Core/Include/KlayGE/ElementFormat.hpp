@@ -673,6 +673,9 @@ namespace KlayGE
 
 	KLAYGE_CORE_API void ConvertToABGR32F(ElementFormat fmt, void const * input, uint32_t num_elems, Color* output);
 	KLAYGE_CORE_API void ConvertFromABGR32F(ElementFormat fmt, Color const * input, uint32_t num_elems, void* output);
+	// Converts between two uncompressed formats. 8-bit RGBA formats are converted directly, others go through ABGR32F.
+	// It can work in place if the destination element is not larger than the source one.
+	KLAYGE_CORE_API void ConvertFormat(ElementFormat src_fmt, void const * input, uint32_t num_elems, ElementFormat dst_fmt, void* output);
 
 
 	enum ElementAccessHint
@@ -18,14 +18,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <list>
+#include <KlayGE/NetMsg.hpp>
 #include <KlayGE/Socket.hpp>
 
 namespace KlayGE
 {
-	uint32_t const Max_Buffer(64);
-
 	class Processor : boost::noncopyable
 	{
 	public:
@@ -53,7 +54,8 @@ namespace KlayGE
 
 		uint32_t		time;
 
-		std::list<std::vector<char>> msgs;
+		// From the pool of the lobby, sent and released at the end of the loop iteration
+		std::vector<NetMsgBuffer*> msgs;
 	};
 
 	class KLAYGE_CORE_API Lobby final : boost::noncopyable
@@ -65,20 +67,33 @@ namespace KlayGE
 		Lobby();
 		~Lobby();
 
-		void Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro);
+		// Runs the server loop on the calling thread, until Close. Messages are received and sent in batches. With port 0, the
+		//  system picks one, see Port. Returns at once if the lobby is already running, or has been closed.
+		void Create(std::string const & Name, uint16_t maxPlayers, uint16_t port, Processor const & pro);
+		// Can be called from any thread, before or during Create. A closed lobby stays closed.
 		void Close();
+		// The port the lobby is bound to, 0 until Create binds it. Can be called from any thread.
+		uint16_t Port() const
+		{
+			return port_;
+		}
 
 		void LobbyName(std::string const & Name);
 		std::string const & LobbyName() const;
 
-		char NumPlayer() const;
+		uint16_t NumPlayer() const;
 
-		void MaxPlayers(char maxPlayers);
-		char MaxPlayers() const;
+		void MaxPlayers(uint16_t maxPlayers);
+		uint16_t MaxPlayers() const;
 
 		int Receive(void* buf, int maxSize, sockaddr_in& from);
 		int Send(void const * buf, int maxSize, sockaddr_in const & to);
 
+		// Queue messages to send with the replies of this loop iteration. Only for the Processor callbacks. Messages longer than
+		//  Max_Buffer are rejected with false.
+		bool SendToPlayer(uint32_t id, void const * buf, int size);
+		bool Broadcast(void const * buf, int size);
+
 		void TimeOut(uint32_t timeOut)
 			{ this->socket_.TimeOut(timeOut); }
 		uint32_t TimeOut()
@@ -88,17 +103,38 @@ namespace KlayGE
 			{ return this->sockAddr_; }
 
 	private:
+		void OnMsg(char* revBuf, sockaddr_in& from, Processor const & pro);
 		void OnJoin(char* revbuf, char* sendbuf, int& sendnum, sockaddr_in& From, Processor const & pro);
 		void OnQuit(PlayerAddrsIter iter, char* sendbuf, int& sendnum, Processor const & pro);
 
 		void OnGetLobbyInfo(char* sendbuf, int& sendnum, Processor const & pro);
 		void OnNop(PlayerAddrsIter iter);
 
+		void RemovePlayer(PlayerAddrsIter iter, Processor const & pro);
+		void FlushSends();
+
 		PlayerAddrsIter ID(sockaddr_in const & Addr);
 
 	private:
 		Socket			socket_;
 		PlayerAddrs		players_;
+		// From the address to the index in players_
+		std::unordered_map<uint64_t, uint32_t> player_indices_;
+		std::vector<uint32_t> free_players_;
+
+		NetMsgBufferPool msg_pool_;
+		std::vector<std::pair<NetMsgBuffer*, sockaddr_in>> replies_;
+		std::vector<NetMsgBuffer*> broadcasts_;
+		std::vector<Socket::Datagram> send_batch_;
+
+		enum class State : uint8_t
+		{
+			Idle,
+			Running,
+			Closed
+		};
+		std::atomic<State> state_{State::Idle};
+		std::atomic<uint16_t> port_{0};
 
 		sockaddr_in		sockAddr_;
 
@@ -28,12 +28,17 @@
 #pragma once
 
 #include <KlayGE/PreDeclare.hpp>
+#include <KlayGE/BoundingVolumeHierarchy.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/RenderLayout.hpp>
+#include <KFL/CXX20/span.hpp>
 #include <KFL/Math.hpp>
 #include <KlayGE/SceneNode.hpp>
 #include <KlayGE/SceneComponent.hpp>
 
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -73,8 +78,6 @@ namespace KlayGE
 		void NumLods(uint32_t lods) override;
 		using Renderable::NumLods;
 
-		virtual void PosBound(AABBox const & aabb);
-		using Renderable::PosBound;
 		virtual void TexcoordBound(AABBox const & aabb);
 		using Renderable::TexcoordBound;
 
@@ -142,6 +145,14 @@ namespace KlayGE
 			return hw_res_ready_;
 		}
 
+		// Reads the triangles of lod 0 back for the per-triangle tests of scene queries. Skinned meshes stay in the bind pose.
+		void BuildCollisionMesh();
+		bool HasCollisionMesh() const override
+		{
+			return !collision_indices_.empty();
+		}
+		bool IntersectRay(float3 const & orig, float3 const & dir, float& dist) const override;
+
 	protected:
 		virtual void DoBuildMeshInfo(RenderModel const & model);
 
@@ -149,6 +160,11 @@ namespace KlayGE
 		int32_t mtl_id_;
 
 		bool hw_res_ready_;
+
+		std::vector<float3> collision_positions_;
+		std::vector<uint32_t> collision_indices_;
+		// Over the triangles
+		BoundingVolumeHierarchy collision_bvh_;
 	};
 
 	class KLAYGE_CORE_API RenderModel : boost::noncopyable
@@ -294,6 +310,10 @@ namespace KlayGE
 		std::vector<float> bind_scale;
 
 		std::tuple<Quaternion, Quaternion, float> Frame(float frame) const;
+		// cursor keeps the key frame found last time. Playing forward then costs O(1) instead of a binary search.
+		std::tuple<Quaternion, Quaternion, float> Frame(float frame, uint32_t& cursor) const;
+		// Finds the key frames around frame and the interpolation factor between them
+		void Locate(float frame, uint32_t& cursor, uint32_t& index0, uint32_t& index1, float& factor) const;
 	};
 
 	struct KLAYGE_CORE_API AABBKeyFrameSet
@@ -313,6 +333,10 @@ namespace KlayGE
 
 	class KLAYGE_CORE_API SkinnedModel : public RenderModel
 	{
+	public:
+		using KeyFramesLoader = std::function<void(std::shared_ptr<std::vector<KeyFrameSet>>& kfs,
+			std::shared_ptr<std::vector<Animation>>& animations)>;
+
 	public:
 		explicit SkinnedModel(SceneNodePtr const & root_node);
 		SkinnedModel(std::wstring_view name, uint32_t node_attrib);
@@ -344,14 +368,10 @@ namespace KlayGE
 			joints_.assign(first, last);
 			this->UpdateBinds();
 		}
-		void AttachKeyFrameSets(std::shared_ptr<std::vector<KeyFrameSet>> const & kf)
-		{
-			key_frame_sets_ = kf;
-		}
-		std::shared_ptr<std::vector<KeyFrameSet>> const & GetKeyFrameSets() const
-		{
-			return key_frame_sets_;
-		}
+		void AttachKeyFrameSets(std::shared_ptr<std::vector<KeyFrameSet>> const & kf);
+		std::shared_ptr<std::vector<KeyFrameSet>> const & GetKeyFrameSets() const;
+		// The loader is called once, on the first access to key frames or animations
+		void DelayLoadKeyFrames(KeyFramesLoader const & loader);
 		uint32_t NumFrames() const
 		{
 			return num_frames_;
@@ -371,6 +391,8 @@ namespace KlayGE
 
 		float GetFrame() const;
 		void SetFrame(float frame);
+		// Same as calling SetFrame on each model, but the models are evaluated in parallel. Models must be distinct.
+		static void SetFrames(std::span<SkinnedModel* const> models, std::span<float const> frames);
 
 		void RebindJoints();
 		void UnbindJoints();
@@ -378,30 +400,46 @@ namespace KlayGE
 		AABBox FramePosBound(uint32_t frame) const;
 
 		void AttachAnimations(std::shared_ptr<std::vector<Animation>> const & animations);
-		std::shared_ptr<std::vector<Animation>> const & GetAnimations() const
-		{
-			return animations_;
-		}
+		std::shared_ptr<std::vector<Animation>> const & GetAnimations() const;
 		uint32_t NumAnimations() const;
 		void GetAnimation(uint32_t index, std::string& name, uint32_t& start_frame, uint32_t& end_frame);
 
 	protected:
 		void BuildBones(float frame);
+		void EvaluateBones(float frame);
+		void SampleKeyFrames(float frame);
 		void UpdateBinds();
+		void ComputeBinds();
 		void SetToEffect();
+		void LoadDelayedKeyFrames() const;
 
 	protected:
 		std::vector<JointComponentPtr> joints_;
 		std::vector<float4> bind_reals_;
 		std::vector<float4> bind_duals_;
 
-		std::shared_ptr<std::vector<KeyFrameSet>> key_frame_sets_;
+		mutable std::shared_ptr<std::vector<KeyFrameSet>> key_frame_sets_;
 		float last_frame_;
 
+		// Per joint key frame cursors and sampling results, reused across frames
+		std::vector<uint32_t> key_frame_cursors_;
+		std::vector<Quaternion> sampled_reals_;
+		std::vector<Quaternion> sampled_duals_;
+		std::vector<float> sampled_scales_;
+		std::vector<uint32_t> sclerp_joints_;
+		std::vector<float> sclerp_lhs_;
+		std::vector<float> sclerp_rhs_;
+		std::vector<float> sclerp_factors_;
+		std::vector<float> sclerp_results_;
+
 		uint32_t num_frames_;
 		uint32_t frame_rate_;
 
-		std::shared_ptr<std::vector<Animation>> animations_;
+		mutable std::shared_ptr<std::vector<Animation>> animations_;
+
+		mutable KeyFramesLoader key_frames_loader_;
+		mutable std::atomic<bool> key_frames_delayed_{false};
+		mutable std::mutex key_frames_mutex_;
 	};
 
 	class KLAYGE_CORE_API SkinnedMesh : public StaticMesh
@@ -434,6 +472,8 @@ namespace KlayGE
 	KLAYGE_CORE_API RenderModelPtr LoadSoftwareModel(std::string_view model_name);
 
 	KLAYGE_CORE_API void SaveModel(RenderModel const & model, std::string_view model_name);
+	// Writes the single LZMA stream layout of .model_bin v19. Only for comparing against the chunked layout.
+	KLAYGE_CORE_API void SaveLegacyModel(RenderModel const & model, std::string_view model_name);
 
 
 	class KLAYGE_CORE_API RenderableLightSourceProxy : public StaticMesh
@@ -15,6 +15,13 @@
 
 #pragma once
 
+#include <KFL/Util.hpp>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
 
 namespace KlayGE
 {
@@ -27,6 +34,56 @@ namespace KlayGE
 
 		MSG_NOP,
 	};
+
+	uint32_t const Max_Buffer(64);
+
+	// A message waiting to be sent
+	struct NetMsgBuffer
+	{
+		uint32_t size;
+		char data[Max_Buffer];
+	};
+
+	// Hands out NetMsgBuffers from blocks, and takes them back for reuse. Queuing a message doesn't allocate once the pool is
+	//  warmed up.
+	class NetMsgBufferPool final : boost::noncopyable
+	{
+		static uint32_t constexpr BLOCK_SIZE = 64;
+
+	public:
+		// Returns nullptr for a message longer than Max_Buffer
+		NetMsgBuffer* Allocate(void const * data, uint32_t size)
+		{
+			if (size > Max_Buffer)
+			{
+				return nullptr;
+			}
+
+			if (free_buffers_.empty())
+			{
+				blocks_.push_back(MakeUniquePtr<NetMsgBuffer[]>(BLOCK_SIZE));
+				for (uint32_t i = 0; i < BLOCK_SIZE; ++ i)
+				{
+					free_buffers_.push_back(&blocks_.back()[BLOCK_SIZE - 1 - i]);
+				}
+			}
+
+			NetMsgBuffer* ret = free_buffers_.back();
+			free_buffers_.pop_back();
+			ret->size = size;
+			std::memcpy(ret->data, data, size);
+			return ret;
+		}
+
+		void Release(NetMsgBuffer* buffer)
+		{
+			free_buffers_.push_back(buffer);
+		}
+
+	private:
+		std::vector<std::unique_ptr<NetMsgBuffer[]>> blocks_;
+		std::vector<NetMsgBuffer*> free_buffers_;
+	};
 }
 
 #endif			// _NETMSG_HPP
@@ -35,7 +35,12 @@
 
 #include <KlayGE/PreDeclare.hpp>
 
+#include <list>
+#include <mutex>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 struct IInArchive;
 
@@ -56,15 +61,46 @@ namespace KlayGE
 		}
 
 	private:
-		uint32_t Find(std::string_view extract_file_path);
+		uint32_t Find(std::string_view extract_file_path) const;
+		std::shared_ptr<std::vector<uint8_t>> ExtractItem(uint32_t index);
+		std::shared_ptr<std::vector<uint8_t>> FindCachedItem(uint32_t index);
+		void TouchBlock(uint32_t block);
 
 	private:
+		struct ItemInfo
+		{
+			uint64_t size;
+			uint64_t mtime;
+			uint32_t block;
+		};
+
+		struct CachedBlock
+		{
+			std::unordered_map<uint32_t, std::shared_ptr<std::vector<uint8_t>>> items;
+			uint64_t num_bytes;
+			std::list<uint32_t>::iterator lru_iter;
+		};
+
 		ResIdentifierPtr archive_is_;
 
 		std::shared_ptr<IInArchive> archive_;
 		std::string password_;
 
 		uint32_t num_items_;
+		std::vector<ItemInfo> items_;
+		// Lower-cased path with '/' separators -> item index, built once in the constructor
+		std::unordered_map<std::string, uint32_t> path_to_index_;
+		std::unordered_map<uint32_t, std::vector<uint32_t>> block_items_;
+
+		// Decoded solid blocks, most recently used in the front
+		std::unordered_map<uint32_t, CachedBlock> cached_blocks_;
+		std::list<uint32_t> block_lru_;
+		uint64_t cached_bytes_ = 0;
+
+		// Guards the block cache. Held only for lookups and inserts, so cache hits don't wait for a decode.
+		std::mutex mutex_;
+		// IInArchive isn't thread safe, but several resource loading threads can extract from one package
+		std::mutex extract_mutex_;
 	};
 }
 
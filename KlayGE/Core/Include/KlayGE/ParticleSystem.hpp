@@ -55,6 +55,130 @@ namespace KlayGE
 		float init_life;
 	};
 
+	// A contiguous range of particles, one pointer per attribute stream. Particles with life <= 0 are dead.
+	struct ParticleSpan
+	{
+		float* pos_x;
+		float* pos_y;
+		float* pos_z;
+		float* vel_x;
+		float* vel_y;
+		float* vel_z;
+		float* life;
+		float* spin;
+		float* size;
+		float* alpha;
+		float* init_life;
+
+		uint32_t num;
+	};
+
+	// Particles stored as structure of arrays, so updaters can process many of them with SIMD
+	class ParticleStore
+	{
+	public:
+		uint32_t Size() const
+		{
+			return static_cast<uint32_t>(life_.size());
+		}
+		void Resize(uint32_t num)
+		{
+			for (auto* stream : {&pos_x_, &pos_y_, &pos_z_, &vel_x_, &vel_y_, &vel_z_, &life_, &spin_, &size_, &alpha_, &init_life_})
+			{
+				stream->resize(num, 0.0f);
+			}
+		}
+
+		Particle Get(uint32_t i) const
+		{
+			BOOST_ASSERT(i < this->Size());
+
+			Particle par;
+			par.pos = float3(pos_x_[i], pos_y_[i], pos_z_[i]);
+			par.vel = float3(vel_x_[i], vel_y_[i], vel_z_[i]);
+			par.life = life_[i];
+			par.spin = spin_[i];
+			par.size = size_[i];
+			par.alpha = alpha_[i];
+			par.init_life = init_life_[i];
+			return par;
+		}
+		void Set(uint32_t i, Particle const & par)
+		{
+			BOOST_ASSERT(i < this->Size());
+
+			pos_x_[i] = par.pos.x();
+			pos_y_[i] = par.pos.y();
+			pos_z_[i] = par.pos.z();
+			vel_x_[i] = par.vel.x();
+			vel_y_[i] = par.vel.y();
+			vel_z_[i] = par.vel.z();
+			life_[i] = par.life;
+			spin_[i] = par.spin;
+			size_[i] = par.size;
+			alpha_[i] = par.alpha;
+			init_life_[i] = par.init_life;
+		}
+
+		ParticleSpan Span(uint32_t first, uint32_t num)
+		{
+			BOOST_ASSERT(first + num <= this->Size());
+
+			return ParticleSpan{&pos_x_[first], &pos_y_[first], &pos_z_[first], &vel_x_[first], &vel_y_[first], &vel_z_[first],
+				&life_[first], &spin_[first], &size_[first], &alpha_[first], &init_life_[first], num};
+		}
+
+		float const * PosX() const
+		{
+			return pos_x_.data();
+		}
+		float const * PosY() const
+		{
+			return pos_y_.data();
+		}
+		float const * PosZ() const
+		{
+			return pos_z_.data();
+		}
+		float const * Life() const
+		{
+			return life_.data();
+		}
+		float* Life()
+		{
+			return life_.data();
+		}
+		float const * Spin() const
+		{
+			return spin_.data();
+		}
+		float const * ParticleSize() const
+		{
+			return size_.data();
+		}
+		float const * Alpha() const
+		{
+			return alpha_.data();
+		}
+		float const * InitLife() const
+		{
+			return init_life_.data();
+		}
+
+	private:
+		std::vector<float> pos_x_;
+		std::vector<float> pos_y_;
+		std::vector<float> pos_z_;
+		std::vector<float> vel_x_;
+		std::vector<float> vel_y_;
+		std::vector<float> vel_z_;
+		std::vector<float> life_;
+		std::vector<float> spin_;
+		std::vector<float> size_;
+		std::vector<float> alpha_;
+		std::vector<float> init_life_;
+	};
+
 	class KLAYGE_CORE_API ParticleEmitter : boost::noncopyable
 	{
 	public:
@@ -211,7 +335,9 @@ namespace KlayGE
 		virtual std::string const & Type() const = 0;
 		virtual ParticleUpdaterPtr Clone() = 0;
 
-		virtual void Update(Particle& par, float elapse_time) = 0;
+		// Updates the live particles in the span and leaves the dead ones untouched.
+		// Called concurrently on disjoint spans of the same system.
+		virtual void Update(ParticleSpan const & pars, float elapse_time) = 0;
 		virtual void SnapParams() = 0;
 
 	protected:
@@ -289,19 +415,17 @@ namespace KlayGE
 
 		uint32_t NumParticles() const
 		{
-			return static_cast<uint32_t>(particles_.size());
+			return particles_.Size();
 		}
 		uint32_t NumActiveParticles() const;
 		uint32_t GetActiveParticleIndex(uint32_t i) const;
-		Particle const & GetParticle(uint32_t i) const
+		Particle GetParticle(uint32_t i) const
 		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
+			return particles_.Get(i);
 		}
-		Particle& GetParticle(uint32_t i)
+		void SetParticle(uint32_t i, Particle const & par)
 		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
+			particles_.Set(i, par);
 		}
 		void ClearParticles();
 
@@ -330,6 +454,7 @@ namespace KlayGE
 
 	private:
 		void UpdateParticlesNoLock(float elapsed_time);
+		void EmitParticlesNoLock(float elapsed_time);
 		void UpdateParticleBufferNoLock();
 
 	private:
@@ -339,10 +464,17 @@ namespace KlayGE
 		std::vector<ParticleEmitterPtr> emitters_;
 		std::vector<ParticleUpdaterPtr> updaters_;
 
-		std::vector<Particle> particles_;
+		ParticleStore particles_;
 		std::vector<std::pair<uint32_t, float>> actived_particles_;
 		mutable std::mutex actived_particles_mutex_;
 
+		// Scratch space reused across frames
+		ParticleStore emitted_particles_;
+		std::vector<uint32_t> emitted_slots_;
+		std::vector<uint32_t> chunk_num_actives_;
+		std::vector<AABBox> chunk_bounds_;
+		std::vector<std::pair<uint32_t, float>> sort_buffer_;
+
 		float gravity_;
 		float3 force_;
 		float media_density_;
@@ -417,7 +549,7 @@ namespace KlayGE
 			return opacity_over_life_;
 		}
 
-		void Update(Particle& par, float elapse_time) override;
+		void Update(ParticleSpan const & pars, float elapse_time) override;
 		void SnapParams() override;
 
 	private:
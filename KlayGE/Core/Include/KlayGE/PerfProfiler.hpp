@@ -37,16 +37,101 @@
 
 #include <KFL/Timer.hpp>
 
+#include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <vector>
 
 namespace KlayGE
 {
+	// A CPU zone from begin to end on one thread. name has to outlive the profiler, a string literal usually.
+	struct PerfZoneEvent
+	{
+		char const* name;
+		uint64_t begin_ns;
+		uint64_t end_ns;
+		uint32_t depth;
+	};
+
+	// Records the events of one thread. Only the owning thread writes, so pushing is lock free. Old events are overwritten when
+	// the ring is full. Snapshots from other threads drop the events overwritten while they are copied.
+	class KLAYGE_CORE_API PerfThreadTrack final : boost::noncopyable
+	{
+	public:
+		static uint32_t constexpr RING_SIZE = 1U << 13;
+
+		explicit PerfThreadTrack(uint32_t id);
+
+		void Push(PerfZoneEvent const & event) noexcept
+		{
+			uint64_t const head = head_.load(std::memory_order_relaxed);
+			auto& slot = events_[head & (RING_SIZE - 1)];
+			slot.name.store(event.name, std::memory_order_relaxed);
+			slot.begin_ns.store(event.begin_ns, std::memory_order_relaxed);
+			slot.end_ns.store(event.end_ns, std::memory_order_relaxed);
+			slot.depth.store(event.depth, std::memory_order_relaxed);
+			head_.store(head + 1, std::memory_order_release);
+		}
+
+		uint32_t& Depth() noexcept
+		{
+			return depth_;
+		}
+
+		uint32_t Id() const noexcept
+		{
+			return id_;
+		}
+
+		void Name(std::string_view name);
+		std::string Name() const;
+
+		// Copies the events ending not earlier than since_ns, from oldest to newest
+		void Snapshot(std::vector<PerfZoneEvent>& events, uint64_t since_ns) const;
+
+	private:
+		// Relaxed atomics are plain loads and stores on the common CPUs, and keep the concurrent snapshots well defined
+		struct EventSlot
+		{
+			std::atomic<char const*> name;
+			std::atomic<uint64_t> begin_ns;
+			std::atomic<uint64_t> end_ns;
+			std::atomic<uint32_t> depth;
+		};
+
+	private:
+		uint32_t const id_;
+		uint32_t depth_ = 0;
+
+		std::unique_ptr<EventSlot[]> events_;
+		std::atomic<uint64_t> head_{0};
+
+		mutable std::mutex name_mutex_;
+		std::string name_;
+	};
+
+	// Measures the CPU time of a scope on the current thread, and records it into the thread's track
+	class KLAYGE_CORE_API PerfScope final : boost::noncopyable
+	{
+	public:
+		explicit PerfScope(char const* name);
+		~PerfScope() noexcept;
+
+	private:
+		char const* name_;
+		PerfThreadTrack* track_;
+		uint64_t begin_ns_;
+	};
+
 	class KLAYGE_CORE_API PerfRegion final : boost::noncopyable
 	{
 	public:
-		PerfRegion();
+		explicit PerfRegion(std::string_view name);
 
 		void Begin();
 		void End();
@@ -66,10 +151,24 @@ namespace KlayGE
 			return dirty_;
 		}
 
+		std::string const & Name() const noexcept
+		{
+			return name_;
+		}
+		uint64_t BeginTimestamp() const noexcept
+		{
+			return begin_ns_;
+		}
+
 	private:
+		std::string name_;
+
 		Timer cpu_timer_;
 		QueryPtr gpu_timer_query_;
 
+		uint64_t begin_ns_ = 0;
+		PerfThreadTrack* track_ = nullptr;
+
 		double cpu_time_ = 0;
 		double gpu_time_ = 0;
 
@@ -79,6 +178,8 @@ namespace KlayGE
 	class KLAYGE_CORE_API PerfProfiler final : boost::noncopyable
 	{
 	public:
+		PerfProfiler();
+
 		static PerfProfiler& Instance();
 		static void Destroy();
 
@@ -88,7 +189,23 @@ namespace KlayGE
 		PerfRegion* CreatePerfRegion(int category, std::string const& name);
 		void CollectData();
 
+		// Only the latest num_frames frames are kept, both for the regions and the zones
+		void FrameWindow(uint32_t num_frames);
+		uint32_t FrameWindow() const noexcept
+		{
+			return frame_window_;
+		}
+
+		// Names the current thread in the exported trace
+		void ThreadName(std::string_view name);
+
+		// Nanoseconds since the first call
+		static uint64_t Now() noexcept;
+		PerfThreadTrack* CurrentThreadTrack();
+
 		void ExportToCSV(std::string const& file_name) const;
+		// Chrome trace event format, which can be opened in chrome://tracing or ui.perfetto.dev
+		void ExportToChromeTrace(std::string const& file_name) const;
 
 	private:
 		static std::unique_ptr<PerfProfiler> perf_profiler_instance_;
@@ -105,11 +222,22 @@ namespace KlayGE
 			int category;
 			std::string name;
 			std::unique_ptr<PerfRegion> perf_region;
-			std::vector<FramePerfInfo> frames;
+			std::deque<FramePerfInfo> frames;
 		};
 
 		std::vector<PerfInfo> perf_regions_;
 		uint32_t frame_id_ = 0;
+		uint32_t frame_window_ = 300;
+
+		uint32_t const instance_id_;
+
+		mutable std::mutex tracks_mutex_;
+		std::vector<std::shared_ptr<PerfThreadTrack>> tracks_;
+
+		// Timer queries only give durations. GPU zones are placed from the CPU begin time of their regions.
+		std::shared_ptr<PerfThreadTrack> gpu_track_;
+
+		std::deque<uint64_t> frame_begins_;
 	};
 } // namespace KlayGE
 
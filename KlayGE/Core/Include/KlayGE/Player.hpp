@@ -18,8 +18,7 @@
 
 #pragma once
 
-#include <list>
-#include <vector>
+#include <atomic>
 
 #include <KFL/Thread.hpp>
 #include <KlayGE/Socket.hpp>
@@ -28,8 +27,8 @@ namespace KlayGE
 {
 	struct LobbyDes
 	{
-		char			numPlayer;
-		char			maxPlayers;
+		uint16_t		numPlayer;
+		uint16_t		maxPlayers;
 		std::string		name;
 		sockaddr_in		addr;
 	};
@@ -57,13 +56,11 @@ namespace KlayGE
 	private:
 		Socket		socket_;
 
-		char		playerID_;
+		uint32_t	playerID_;
 		std::string	name_;
 
 		std::future<void>	receiveThread_;
-		bool			receiveLoop_;
-
-		std::list<std::vector<char>> sendQueue_;
+		std::atomic<bool>	receiveLoop_{false};
 	};
 }
 
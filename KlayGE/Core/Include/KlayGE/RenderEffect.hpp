@@ -65,6 +65,9 @@
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/ShaderObject.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Hash.hpp>
+
+#include <type_traits>
 
 namespace KlayGE
 {
@@ -446,6 +449,35 @@ namespace KlayGE
 		std::vector<StrcutMemberType> members_;
 	};
 
+	// Precomputed name hash of an effect parameter or technique. Build it once with EFFECT_HANDLE and look up
+	// with it every frame, no string hashing is involved.
+	class RenderEffectHandle final
+	{
+	public:
+		constexpr RenderEffectHandle() noexcept = default;
+		constexpr explicit RenderEffectHandle(size_t name_hash) noexcept : name_hash_(name_hash)
+		{
+		}
+		explicit RenderEffectHandle(std::string_view name) noexcept : name_hash_(HashValue(name))
+		{
+		}
+
+		constexpr size_t NameHash() const noexcept
+		{
+			return name_hash_;
+		}
+
+		constexpr bool operator==(RenderEffectHandle const& rhs) const noexcept
+		{
+			return name_hash_ == rhs.name_hash_;
+		}
+
+	private:
+		size_t name_hash_ = 0;
+	};
+
+#define EFFECT_HANDLE(x) (KlayGE::RenderEffectHandle(std::integral_constant<size_t, CT_HASH(x)>::value))
+
 	// ȾЧ
 	//////////////////////////////////////////////////////////////////////////////////
 	class KLAYGE_CORE_API RenderEffect final : boost::noncopyable
@@ -480,6 +512,8 @@ namespace KlayGE
 		RenderEffectParameter const* ParameterBySemantic(std::string_view semantic) const noexcept;
 		RenderEffectParameter* ParameterByName(std::string_view name) noexcept;
 		RenderEffectParameter const* ParameterByName(std::string_view name) const noexcept;
+		RenderEffectParameter* ParameterByName(RenderEffectHandle handle) noexcept;
+		RenderEffectParameter const* ParameterByName(RenderEffectHandle handle) const noexcept;
 		RenderEffectParameter* ParameterByIndex(uint32_t n) noexcept;
 		RenderEffectParameter const* ParameterByIndex(uint32_t n) const noexcept;
 
@@ -506,6 +540,7 @@ namespace KlayGE
 			return static_cast<uint32_t>(immutable_->techniques.size());
 		}
 		RenderTechnique* TechniqueByName(std::string_view name) const noexcept;
+		RenderTechnique* TechniqueByName(RenderEffectHandle handle) const noexcept;
 		RenderTechnique* TechniqueByIndex(uint32_t n) const noexcept;
 
 		uint32_t NumShaderFragments() const noexcept
@@ -553,7 +588,27 @@ namespace KlayGE
 		void Load(XMLNode const& root);
 #endif
 
+		void BuildLookupTables();
+
 	private:
+		// Minimal perfect hash from name hashes to indices, in the hash-and-displace form. Find returns the only
+		// candidate, the caller has to confirm the name hash.
+		class NameHashTable final
+		{
+		public:
+			void Build(std::span<size_t const> name_hashes);
+			uint32_t Find(size_t name_hash) const noexcept;
+
+			bool Empty() const noexcept
+			{
+				return indices_.empty();
+			}
+
+		private:
+			std::vector<int32_t> displacements_;
+			std::vector<uint32_t> indices_;
+		};
+
 		struct Immutable final : boost::noncopyable
 		{
 			std::string res_name;
@@ -578,6 +633,9 @@ namespace KlayGE
 			std::vector<ShaderDesc> shader_descs;
 
 			std::vector<RenderShaderGraphNode> shader_graph_nodes;
+
+			NameHashTable param_table;
+			NameHashTable tech_table;
 		};
 
 		std::shared_ptr<Immutable> immutable_;
@@ -684,6 +742,8 @@ namespace KlayGE
 		void Load(RenderEffect& effect, XMLNode const& node, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
 		void Load(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
 		void CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
+		// Compiles one stage if this pass owns it. Stages of different passes can be compiled concurrently.
+		void CompileShader(RenderEffect const& effect, uint32_t tech_index, uint32_t pass_index, ShaderStage stage) const;
 #endif
 		void CreateHwShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
 
@@ -113,6 +113,8 @@ namespace KlayGE
 		uint32_t NumVerticesJustRendered();
 		uint32_t NumDrawsJustCalled();
 		uint32_t NumDispatchesJustCalled();
+		// Draws that bound the same technique or the same layout as the draw right before them
+		uint32_t NumRedundantBindsJustCalled();
 
 		void CreateRenderWindow(std::string const & name, RenderSettings& settings);
 		void DestroyRenderWindow();
@@ -477,6 +479,11 @@ namespace KlayGE
 		uint32_t num_vertices_just_rendered_;
 		uint32_t num_draws_just_called_;
 		uint32_t num_dispatches_just_called_;
+		uint32_t num_redundant_binds_just_called_ = 0;
+
+		RenderEffect const * last_effect_ = nullptr;
+		RenderTechnique const * last_tech_ = nullptr;
+		RenderLayout const * last_layout_ = nullptr;
 
 		RenderDeviceCaps caps_;
 
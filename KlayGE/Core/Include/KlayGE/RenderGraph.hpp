@@ -0,0 +1,165 @@
+/**
+ * @file RenderGraph.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_RENDER_GRAPH_HPP
+#define KLAYGE_CORE_RENDER_GRAPH_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/CXX20/span.hpp>
+#include <KlayGE/ElementFormat.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace KlayGE
+{
+	// Passes of a frame, declared by the textures they read and write. Compile gives transient textures with disjoint
+	//  lifetimes the same physical texture. Every pass is taken as running, the graph doesn't decide what runs.
+	class KLAYGE_CORE_API RenderGraph final : boost::noncopyable
+	{
+	public:
+		static uint32_t constexpr InvalidIndex = 0xFFFFFFFFU;
+
+		struct TextureDesc
+		{
+			uint32_t width;
+			uint32_t height;
+			uint32_t num_mip_maps;
+			uint32_t array_size;
+			ElementFormat format;
+			uint32_t sample_count;
+			uint32_t sample_quality;
+			uint32_t access_hint;
+
+			uint64_t NumBytes() const noexcept;
+
+			bool operator==(TextureDesc const& rhs) const noexcept;
+			bool operator!=(TextureDesc const& rhs) const noexcept
+			{
+				return !(*this == rhs);
+			}
+		};
+
+		struct MemoryReport
+		{
+			uint32_t num_transient_textures;
+			uint32_t num_physical_textures;
+			uint64_t requested_bytes;
+			uint64_t allocated_bytes;
+
+			uint64_t SavedBytes() const noexcept
+			{
+				return requested_bytes - allocated_bytes;
+			}
+		};
+
+	public:
+		RenderGraph();
+
+		// Drops passes and textures. Physical textures are kept, Realize reuses the ones that still fit.
+		void Clear();
+
+		uint32_t AddTexture(std::string_view name, TextureDesc const& desc);
+		// Owned outside of the graph, tex can be null if it's not a texture. Never aliased.
+		uint32_t ImportTexture(std::string_view name, TexturePtr const& tex);
+		// Passes run in the order they are added
+		uint32_t AddPass(std::string_view name, std::span<uint32_t const> reads, std::span<uint32_t const> writes);
+
+		void Compile();
+		// Creates the physical textures of the compiled graph
+		void Realize();
+
+		bool Compiled() const noexcept
+		{
+			return compiled_;
+		}
+
+		uint32_t NumPasses() const noexcept
+		{
+			return static_cast<uint32_t>(passes_.size());
+		}
+		std::string const& PassName(uint32_t pass) const;
+
+		uint32_t NumTextures() const noexcept
+		{
+			return static_cast<uint32_t>(textures_.size());
+		}
+		std::string const& TextureName(uint32_t tex) const;
+		// InvalidIndex for imported textures, and transient ones that no pass touches
+		uint32_t PhysicalIndex(uint32_t tex) const;
+		TexturePtr const& Texture(uint32_t tex) const;
+
+		MemoryReport const& Report() const noexcept
+		{
+			return report_;
+		}
+
+	private:
+		struct TextureNode
+		{
+			std::string name;
+			TextureDesc desc;
+			bool imported;
+			TexturePtr imported_tex;
+			uint32_t first_pass;
+			uint32_t last_pass;
+			uint32_t physical;
+		};
+
+		struct PassNode
+		{
+			std::string name;
+			std::vector<uint32_t> reads;
+			std::vector<uint32_t> writes;
+		};
+
+		struct PhysicalTexture
+		{
+			TextureDesc desc;
+			uint32_t last_pass;
+			TexturePtr tex;
+		};
+
+	private:
+		std::vector<TextureNode> textures_;
+		std::vector<PassNode> passes_;
+		std::vector<PhysicalTexture> physical_textures_;
+
+		bool compiled_ = false;
+		MemoryReport report_;
+	};
+} // namespace KlayGE
+
+#endif // KLAYGE_CORE_RENDER_GRAPH_HPP
@@ -183,6 +183,33 @@ namespace KlayGE
 
 		virtual AABBox const & PosBound() const;
 		virtual AABBox const & TexcoordBound() const;
+		// The scene nodes holding this renderable recompute their bounds on the next update
+		void PosBound(AABBox const & aabb);
+		// Changes every time the bound box is set
+		uint32_t PosBoundVersion() const noexcept
+		{
+			return pos_bound_version_;
+		}
+
+		// For per-triangle scene queries. The ray is in model space, dist is the max distance in, and the distance of the hit out.
+		virtual bool HasCollisionMesh() const
+		{
+			return false;
+		}
+		virtual bool IntersectRay(float3 const & orig, float3 const & dir, float& dist) const
+		{
+			KFL_UNUSED(orig);
+			KFL_UNUSED(dir);
+			KFL_UNUSED(dist);
+			return false;
+		}
+
+		// Whether it can look different from the last frame without its node moving, like skinned meshes and the ones switching
+		//  LODs. Cached shadow maps treat it as a moving caster.
+		virtual bool DynamicContent() const
+		{
+			return is_skinned_ || (this->NumLods() > 1);
+		}
 
 		virtual void AddToRenderQueue();
 
@@ -304,6 +331,7 @@ namespace KlayGE
 
 		AABBox pos_aabb_;
 		AABBox tc_aabb_;
+		uint32_t pos_bound_version_ = 0;
 
 		std::vector<SceneNode const *> instances_;
 		SceneNode const * curr_node_ = nullptr;
@@ -389,6 +417,10 @@ namespace KlayGE
 		SceneComponentPtr Clone() const override;
 
 		Renderable& BoundRenderable() const;
+		RenderablePtr const& BoundRenderablePtr() const
+		{
+			return renderable_;
+		}
 
 		template <typename T>
 		T& BoundRenderableOfType() const
@@ -396,8 +428,12 @@ namespace KlayGE
 			return checked_cast<T&>(this->BoundRenderable());
 		}
 
+		// Whether the bound box of the renderable has been set since the last call
+		bool PosBoundChanged();
+
 	private:
 		RenderablePtr renderable_;
+		uint32_t pos_bound_version_;
 	};
 }
 
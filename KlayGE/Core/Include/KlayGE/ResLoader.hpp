@@ -34,8 +34,10 @@
 #pragma once
 
 #include <KlayGE/PreDeclare.hpp>
+#include <atomic>
 #include <istream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <KFL/ResIdentifier.hpp>
@@ -66,6 +68,8 @@ namespace KlayGE
 		virtual bool HasSubThreadStage() const = 0;
 
 		virtual bool Match(ResLoadingDesc const & rhs) const = 0;
+		// Descs that Match each other must return the same hash
+		virtual uint64_t Hash() const = 0;
 		virtual void CopyDataFrom(ResLoadingDesc const & rhs) = 0;
 		virtual std::shared_ptr<void> CloneResourceFrom(std::shared_ptr<void> const & resource) = 0;
 
@@ -101,9 +105,15 @@ namespace KlayGE
 		std::string AbsPath(std::string_view path);
 
 		std::shared_ptr<void> SyncQuery(ResLoadingDescPtr const & res_desc);
-		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const & res_desc);
+		std::shared_ptr<void> ASyncQuery(ResLoadingDescPtr const & res_desc, int32_t priority = 0);
 		void Unload(std::shared_ptr<void> const & res);
 
+		// Changes the priority of a pending async request. Higher priority requests are loaded first.
+		void Reprioritize(std::shared_ptr<void> const & res, int32_t priority);
+		// Drops a pending async request. Has no effect once a worker has started loading it. Requests that were merged
+		//  because they match each other are dropped only after every requester has cancelled.
+		void Cancel(std::shared_ptr<void> const & res);
+
 		template <typename T>
 		std::shared_ptr<T> SyncQueryT(ResLoadingDescPtr const & res_desc)
 		{
@@ -111,9 +121,9 @@ namespace KlayGE
 		}
 
 		template <typename T>
-		std::shared_ptr<T> ASyncQueryT(ResLoadingDescPtr const & res_desc)
+		std::shared_ptr<T> ASyncQueryT(ResLoadingDescPtr const & res_desc, int32_t priority = 0)
 		{
-			return std::static_pointer_cast<T>(this->ASyncQuery(res_desc));
+			return std::static_pointer_cast<T>(this->ASyncQuery(res_desc, priority));
 		}
 
 		template <typename T>
@@ -156,10 +166,29 @@ namespace KlayGE
 		enum LoadingStatus
 		{
 			LS_Loading,
+			LS_Processing,
 			LS_Complete,
 			LS_CanBeRemoved
 		};
 
+		using LoadingResPair = std::pair<ResLoadingDescPtr, std::shared_ptr<std::atomic<LoadingStatus>>>;
+
+		struct LoadingRequest
+		{
+			LoadingResPair res_pair;
+			int32_t priority;
+			uint64_t order;
+			uint32_t num_requesters;
+
+			bool operator<(LoadingRequest const & rhs) const noexcept
+			{
+				// Max-heap on priority, FIFO among equal priorities
+				return (priority < rhs.priority) || ((priority == rhs.priority) && (order > rhs.order));
+			}
+		};
+
+		bool FindMatchLoadingResource(ResLoadingDescPtr const & res_desc, std::shared_ptr<std::atomic<LoadingStatus>>& status);
+
 		std::string exe_path_;
 		std::string local_path_;
 		std::vector<std::tuple<uint64_t, uint32_t, std::string, PackagePtr>> paths_;
@@ -167,16 +196,18 @@ namespace KlayGE
 
 		std::mutex loaded_mutex_;
 		std::mutex loading_mutex_;
-		std::vector<std::pair<ResLoadingDescPtr, std::weak_ptr<void>>> loaded_res_;
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_;
+		// Keyed on ResLoadingDesc::Hash, so matching only runs inside one bucket
+		std::unordered_multimap<uint64_t, std::pair<ResLoadingDescPtr, std::weak_ptr<void>>> loaded_res_;
+		std::vector<LoadingResPair> loading_res_;
+		std::unordered_multimap<uint64_t, LoadingResPair> loading_res_index_;
 
-		bool non_empty_loading_res_queue_ = false;
 		std::condition_variable loading_res_queue_cv_;
 		std::mutex loading_res_queue_mutex_;
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_queue_;
+		std::vector<LoadingRequest> loading_res_queue_;
+		uint64_t loading_res_order_ = 0;
 
-		std::future<void> loading_thread_;
-		volatile bool quit_{false};
+		std::vector<std::future<void>> loading_threads_;
+		std::atomic<bool> quit_{false};
 	};
 }
 
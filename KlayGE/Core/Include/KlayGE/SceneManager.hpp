@@ -25,9 +25,12 @@
 
 #include <KlayGE/SceneNode.hpp>
 #include <KlayGE/Renderable.hpp>
+#include <KlayGE/BoundingVolumeHierarchy.hpp>
+#include <KFL/CXX20/span.hpp>
 #include <KFL/Frustum.hpp>
 #include <KFL/Thread.hpp>
 
+#include <array>
 #include <optional>
 #include <vector>
 #include <unordered_map>
@@ -36,6 +39,13 @@ namespace KlayGE
 {
 	class KLAYGE_CORE_API SceneManager : boost::noncopyable
 	{
+	public:
+		struct QueryHit
+		{
+			SceneNode* node;
+			float dist;
+		};
+
 	public:
 		SceneManager();
 		virtual ~SceneManager();
@@ -73,6 +83,7 @@ namespace KlayGE
 			return overlay_root_;
 		}
 
+		// Guards the scene against the update thread. The scene passes work on the published snapshot and don't take it.
 		std::mutex& MutexForUpdate()
 		{
 			return update_mutex_;
@@ -88,6 +99,9 @@ namespace KlayGE
 		virtual void ClearObject();
 
 		void Update();
+		// Updates the transforms and the bounds, and refreshes the snapshot the render passes and the scene queries see. Update
+		//  does it every frame, call it to see a changed scene without rendering.
+		void UpdateScene();
 
 		uint32_t NumObjectsRendered() const;
 		uint32_t NumRenderablesRendered() const;
@@ -95,14 +109,37 @@ namespace KlayGE
 		uint32_t NumVerticesRendered() const;
 		uint32_t NumDrawCalls() const;
 		uint32_t NumDispatchCalls() const;
+		uint32_t NumRedundantBinds() const;
 
 		virtual void OnSceneChanged() = 0;
+		// Called for every node of a sub-tree attached to or detached from the scene root. A removed node could be destroyed
+		//  right after, only its pointer can be kept.
+		virtual void OnNodeAdded(SceneNode& node);
+		virtual void OnNodeRemoved(SceneNode& node);
 
 		bool NodesUpdated() const
 		{
 			return nodes_updated_;
 		}
 
+		// Whether a shadow caster in the volume could look different from the last frame. The ones under a moveable node, and the
+		//  ones with dynamic content (see SceneNode::DynamicContent), count as changed every frame, unless only the static casters
+		//  are asked for.
+		bool CastersChanged(AABBox const & volume, bool static_only) const;
+
+		// Scene queries on the nodes with renderables, against the last rendered snapshot. Call them on the main thread, the same
+		//  as rendering. Hidden nodes are skipped. dir is normalized, dist of a hit is along it.
+		// With per_triangle, renderables having a collision mesh (see StaticMesh::BuildCollisionMesh) when the snapshot was taken
+		//  are hit by their triangles, the others by the bounds of their nodes.
+		std::optional<QueryHit> RayCast(float3 const & orig, float3 const & dir, float max_dist, bool per_triangle = false);
+		// The rays are cast on the thread pool
+		void RayCast(std::span<float3 const> origs, std::span<float3 const> dirs, float max_dist, bool per_triangle,
+			std::span<std::optional<QueryHit>> hits);
+		// Against the node bounds inflated by the radius, which is a bit conservative around the corners
+		std::optional<QueryHit> SweepSphere(Sphere const & sphere, float3 const & dir, float max_dist);
+		void OverlapAABB(AABBox const & aabb, std::vector<SceneNode*>& nodes);
+		void OverlapSphere(Sphere const & sphere, std::vector<SceneNode*>& nodes);
+
 	protected:
 		void Flush(uint32_t urt);
 
@@ -113,6 +150,71 @@ namespace KlayGE
 
 		BoundOverlap VisibleTestFromParent(SceneNode const & node, uint32_t camera_index);
 
+		// Builds query_bvh_ for the current snapshot, or refits it if the topology is the same
+		void UpdateQueryBvh();
+		std::optional<QueryHit> DoRayCast(float3 const & orig, float3 const & dir, float radius, float max_dist, bool per_triangle) const;
+		bool QueryVisible(uint32_t item) const;
+
+		// Tests all_scene_nodes_ against all non-omnidirectional cameras' frustums, on multiple threads. The result of node n
+		// and camera i goes to frustum_overlaps_[i * all_scene_nodes_.size() + n].
+		void UpdateFrustumOverlaps(uint32_t num_cameras);
+
+	protected:
+		// What the render passes of a frame see of the scene. Double buffered: Update fills the back one under update_mutex_
+		//  after the transforms and bounds are done, and publishes it. The passes read the front one without the mutex, so
+		//  SubThreadUpdate can run while they draw. Sub-thread handlers must not change renderables, that goes in the main-thread
+		//  handlers, which run before the publish.
+		struct SceneSnapshot
+		{
+			enum Flags : uint8_t
+			{
+				SF_Updated = 1U << 0,
+				// All the ancestors are visible
+				SF_Reachable = 1U << 1,
+				// It or one of its ancestors is moveable
+				SF_Moveable = 1U << 2,
+				// The bounds differ from the last snapshot
+				SF_Moved = 1U << 3,
+				// Moveable, or a node with renderables having dynamic content (see SceneNode::DynamicContent)
+				SF_Dynamic = 1U << 4,
+				SF_HasRenderables = 1U << 5
+			};
+
+			uint32_t topology_version = static_cast<uint32_t>(-1);
+			// Increases with every refresh
+			uint64_t serial = 0;
+			// The scene in breadth-first order. The references keep removed nodes alive until the snapshot is replaced.
+			std::vector<SceneNode*> nodes;
+			std::vector<SceneNodePtr> node_refs;
+			std::vector<uint32_t> parent_indices;
+
+			std::vector<uint32_t> attribs;
+			std::vector<uint8_t> flags;
+			// World space bounds in SoA: min x, y, z, max x, y, z
+			std::array<std::vector<float>, 6> bounds;
+			// World transforms and their inverses, only copied for the nodes that moved since this buffer was last filled
+			std::vector<float4x4> xforms;
+			std::vector<float4x4> inv_xforms;
+			// The nodes whose world transform changed in this refresh, so the other buffer can catch up
+			std::vector<uint32_t> xform_changed_node_indices;
+			// The renderables having a collision mesh, so the per-triangle queries don't touch the components the update thread
+			//  can change
+			std::vector<std::vector<RenderablePtr>> collision_renderables;
+
+			// The nodes with bounds differing from the last snapshot, in breadth-first order
+			std::vector<uint32_t> moved_node_indices;
+
+			// Static casters that appeared, disappeared or moved since the last snapshot, with their old and new bounds
+			std::vector<AABBox> changed_static_caster_bounds;
+			std::vector<AABBox> dynamic_caster_bounds;
+			bool all_casters_changed = true;
+		};
+
+		SceneSnapshot const & FrontSnapshot() const noexcept
+		{
+			return scene_snapshots_[front_snapshot_];
+		}
+
 	protected:
 		std::vector<CameraPtr> frame_cameras_;
 		std::vector<Frustum const*> camera_frustums_;
@@ -120,6 +222,7 @@ namespace KlayGE
 		std::vector<LightSourcePtr> frame_lights_;
 		SceneNode scene_root_;
 		SceneNode overlay_root_;
+		SceneHierarchy scene_hierarchy_;
 
 		std::unordered_map<size_t, std::unique_ptr<std::array<BoundOverlap, RenderEngine::PredefinedCameraCBuffer::max_num_cameras>[]>>
 			visible_marks_map_;
@@ -127,16 +230,43 @@ namespace KlayGE
 		float small_obj_threshold_;
 		float update_elapse_;
 
+		// Same as the nodes of the front snapshot, only copied when the topology changes
 		std::vector<SceneNode*> all_scene_nodes_;
+		uint32_t all_scene_nodes_version_ = static_cast<uint32_t>(-1);
 		std::vector<SceneNode*> all_overlay_nodes_;
 
+		std::array<SceneSnapshot, 2> scene_snapshots_;
+		uint32_t front_snapshot_ = 0;
+		std::vector<BoundOverlap> frustum_overlaps_;
+
+		// What the shadow casters looked like in the last snapshot, indexed the same way as the hierarchy
+		uint32_t caster_topology_version_ = static_cast<uint32_t>(-1);
+		std::vector<uint8_t> caster_has_renderables_;
+		std::vector<uint8_t> caster_casting_;
+		std::vector<AABBox> caster_bounds_;
+
+		// Over the bounds of the snapshot nodes in query_node_indices_
+		BoundingVolumeHierarchy query_bvh_;
+		std::vector<uint32_t> query_node_indices_;
+		std::vector<AABBox> query_bounds_;
+		uint32_t query_topology_version_ = static_cast<uint32_t>(-1);
+		uint64_t query_snapshot_serial_ = 0;
+
 	private:
 		void FlushScene();
+		void UpdateSnapshot();
 
 	private:
 		uint32_t urt_;
 
-		std::vector<std::pair<RenderTechnique const *, std::vector<Renderable*>>> render_queue_;
+		struct RenderItem
+		{
+			// From high to low bits: technique weight, technique, material, layout, depth
+			uint64_t key;
+			Renderable* renderable;
+		};
+		std::vector<RenderItem> render_queue_;
+		std::vector<RenderItem> render_queue_scratch_;
 
 		uint32_t num_objects_rendered_;
 		uint32_t num_renderables_rendered_;
@@ -144,6 +274,7 @@ namespace KlayGE
 		uint32_t num_vertices_rendered_;
 		uint32_t num_draw_calls_;
 		uint32_t num_dispatch_calls_;
+		uint32_t num_redundant_binds_ = 0;
 
 		std::mutex update_mutex_;
 		std::optional<std::future<void>> update_thread_;
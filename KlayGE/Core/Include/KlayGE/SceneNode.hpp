@@ -40,6 +40,8 @@
 #include <KlayGE/SceneComponent.hpp>
 #include <KlayGE/Signal.hpp>
 
+#include <atomic>
+
 namespace KlayGE
 {
 	class KLAYGE_CORE_API SceneNode final : boost::noncopyable, public std::enable_shared_from_this<SceneNode>
@@ -80,6 +82,10 @@ namespace KlayGE
 
 		void Traverse(std::function<bool(SceneNode&)> const & callback);
 
+		// Changes every time a node in the tree under this root gains or loses a child or a component. Only kept by the roots,
+		//  so rebuilding the overlay every frame leaves the scene alone.
+		uint32_t TopologyVersion() const;
+
 		uint32_t NumComponents() const;
 		template <typename T>
 		uint32_t NumComponentsOfType() const
@@ -150,7 +156,22 @@ namespace KlayGE
 		float4x4 const& PrevTransformToWorld() const;
 		AABBox const& PosBoundOS() const;
 		AABBox const& PosBoundWS() const;
+		// Overlay nodes and the ones neither cullable nor moveable have no bounds
+		bool HasPosBound() const noexcept;
+		// Whether it can look different from the last frame without moving: an update event is connected to it or to one of its
+		//  components, or a renderable has dynamic content (see Renderable::DynamicContent)
+		bool DynamicContent() const;
+		// Whether the last UpdateTransforms moved it
+		bool TransformChanged() const noexcept
+		{
+			return world_xform_changed_;
+		}
+		// Recomputes the world transforms if this node or one of its ancestors moved since the last call. The parent has to be
+		//  updated first.
 		void UpdateTransforms();
+		// Recomputes the bounds if this node's content, its world transform, or one of its children changed. The children have
+		//  to be updated first.
+		void UpdatePosBound();
 		void UpdatePosBoundSubtree();
 		bool Updated() const;
 		void FillVisibleMark(BoundOverlap vm);
@@ -158,6 +179,8 @@ namespace KlayGE
 		BoundOverlap VisibleMark(uint32_t camera_index) const;
 
 		using UpdateEvent = Signal::Signal<void(SceneNode&, float, float)>;
+		// Runs on the update thread, while the scene passes can be drawing. Handlers can move the node, but changes to the
+		//  renderables belong to OnMainThreadUpdate.
 		UpdateEvent& OnSubThreadUpdate()
 		{
 			return sub_thread_update_event_;
@@ -201,6 +224,8 @@ namespace KlayGE
 
 		void Parent(SceneNode* so);
 		void EmitSceneChanged();
+		void EmitSubTreeChanged(SceneNode& sub_tree, bool added);
+		void TopologyChanged();
 
 	protected:
 		std::wstring name_;
@@ -222,12 +247,66 @@ namespace KlayGE
 		std::unique_ptr<AABBox> pos_aabb_os_;
 		std::unique_ptr<AABBox> pos_aabb_ws_;
 		bool pos_aabb_dirty_ = true;
+		bool xform_dirty_ = true;
+		bool prev_xform_dirty_ = false;
+		// What the last update changed. The children look at the world transform, the parent at the rest.
+		bool local_xform_changed_ = false;
+		bool world_xform_changed_ = false;
+		bool pos_aabb_os_changed_ = false;
 		std::array<BoundOverlap, RenderEngine::PredefinedCameraCBuffer::max_num_cameras> visible_marks_;
 
 		UpdateEvent sub_thread_update_event_;
 		UpdateEvent main_thread_update_event_;
 
 		bool updated_ = false;
+
+		std::atomic<uint32_t> topology_version_{0};
+	};
+
+	// Keeps the subtree of a node flattened in breadth-first order, so every depth level is contiguous and comes after its parents.
+	//  Transforms are updated level by level top-down, bounds bottom-up, and the nodes of a level in parallel. Only the subtrees
+	//  that moved or changed are recomputed.
+	class KLAYGE_CORE_API SceneHierarchy final : boost::noncopyable
+	{
+	public:
+		explicit SceneHierarchy(SceneNode& root);
+
+		void Update();
+
+		uint32_t NumNodes() const
+		{
+			return static_cast<uint32_t>(nodes_.size());
+		}
+		uint32_t NumLevels() const
+		{
+			return static_cast<uint32_t>(level_offsets_.size() - 1);
+		}
+
+		std::vector<SceneNode*> const & Nodes() const
+		{
+			return nodes_;
+		}
+		// Index of each node's parent in Nodes(), or -1 for the root
+		std::vector<uint32_t> const & ParentIndices() const
+		{
+			return parent_indices_;
+		}
+		uint32_t TopologyVersion() const
+		{
+			return topology_version_;
+		}
+
+	private:
+		void Rebuild();
+
+	private:
+		SceneNode& root_;
+
+		std::vector<SceneNode*> nodes_;
+		std::vector<uint32_t> parent_indices_;
+		// Level l covers nodes_[level_offsets_[l], level_offsets_[l + 1])
+		std::vector<uint32_t> level_offsets_;
+		uint32_t topology_version_;
 	};
 }
 
@@ -19,6 +19,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
+
+#include <KFL/CXX20/span.hpp>
 
 #if defined KLAYGE_PLATFORM_WINDOWS
 	#ifndef _WINSOCK_DEPRECATED_NO_WARNINGS
@@ -33,6 +36,7 @@
 	#include <arpa/inet.h>
 	#include <sys/ioctl.h>
 	#include <netdb.h>
+	#include <poll.h>
 	typedef int SOCKET;
 	#define INVALID_SOCKET (~0)
 	#define SOCKET_ERROR (-1)
@@ -48,10 +52,24 @@ namespace KlayGE
 	///////////////////////////////////////////////////////////////////////////////
 	class KLAYGE_CORE_API Socket final : boost::noncopyable
 	{
+	public:
+		// One message of a batched send or receive. When receiving, len is the size of buf in and the size of the message out.
+		struct Datagram
+		{
+			void* buf;
+			int len;
+			sockaddr_in addr;
+		};
+
 	public:
 		Socket();
 		~Socket();
 
+		SOCKET Handle() const noexcept
+		{
+			return socket_;
+		}
+
 		void Create(int socketType = SOCK_STREAM, int protocolType = 0, int addressFormat = PF_INET);
 		void Close();
 
@@ -70,6 +88,13 @@ namespace KlayGE
 		int ReceiveFrom(void* buf, int len, sockaddr_in& sockFrom, int flags = 0);
 		int SendTo(void const * buf, int len, sockaddr_in const & sockTo, int flags = 0);
 
+		// Waits for one message like ReceiveFrom, then takes the ones already arrived, up to msgs.size(). One syscall with
+		//  recvmmsg on Linux, only one message on other platforms. Returns the number of messages, or SOCKET_ERROR.
+		int ReceiveFromBatch(std::span<Datagram> msgs, int flags = 0);
+		// sendmmsg on Linux, SendTo one by one on other platforms. Returns the number of messages sent, which is less than
+		//  msgs.size() only on errors.
+		int SendToBatch(std::span<Datagram const> msgs, int flags = 0);
+
 		enum ShutDownMode
 		{
 			SDM_Receives = 0,
@@ -98,6 +123,29 @@ namespace KlayGE
 	private:
 		SOCKET		socket_;
 	};
+
+	// Waits on many sockets for incoming data. epoll on Linux, poll on other platforms.
+	class KLAYGE_CORE_API SocketPoller final : boost::noncopyable
+	{
+	public:
+		SocketPoller();
+		~SocketPoller();
+
+		// id is what Wait reports for the socket
+		void Add(Socket const & socket, uint32_t id);
+		void Remove(Socket const & socket);
+
+		// Fills the ids of the readable sockets, up to ready_ids.size(). Returns the number of them, 0 for a time out.
+		uint32_t Wait(std::span<uint32_t> ready_ids, int timeout_ms);
+
+	private:
+#if defined KLAYGE_PLATFORM_LINUX
+		int epoll_fd_;
+#else
+		std::vector<pollfd> fds_;
+		std::vector<uint32_t> ids_;
+#endif
+	};
 }
 
 #endif			// _SOCKET_HPP
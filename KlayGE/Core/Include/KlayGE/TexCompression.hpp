@@ -66,6 +66,9 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) = 0;
 		virtual void DecodeBlock(void* output, void const * input) = 0;
 
+		// Encodes num_blocks blocks stored one after another. The default calls EncodeBlock for each of them.
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method);
+
 		virtual void EncodeMem(uint32_t width, uint32_t height, 
 			void* output, uint32_t out_row_pitch, uint32_t out_slice_pitch,
 			void const * input, uint32_t in_row_pitch, uint32_t in_slice_pitch,
@@ -77,6 +80,15 @@ namespace KlayGE
 		virtual void EncodeTex(TexturePtr const & out_tex, TexturePtr const & in_tex, TexCompressionMethod method);
 		virtual void DecodeTex(TexturePtr const & out_tex, TexturePtr const & in_tex);
 
+	protected:
+		// EncodeMem runs block rows on several threads. Codecs keeping per block state in members have to return a new
+		// instance here, so that every worker encodes with its own one. Stateless codecs return nullptr and are shared.
+		virtual std::unique_ptr<TexCompression> CreateWorkerCodec() const;
+
+		void EncodeBlockRows(uint32_t row_begin, uint32_t row_end, uint32_t width, uint32_t height,
+			void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+			TexCompressionMethod method);
+
 	protected:
 		ElementFormat compression_format_;
 	};
@@ -116,6 +116,7 @@ namespace KlayGE
 		TexCompressionBC4();
 
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 	};
 
@@ -125,6 +126,7 @@ namespace KlayGE
 		TexCompressionBC3();
 
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
 	private:
@@ -138,6 +140,7 @@ namespace KlayGE
 		TexCompressionBC5();
 
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
+		virtual void EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
 	private:
@@ -278,6 +281,9 @@ namespace KlayGE
 		virtual void EncodeBlock(void* output, void const * input, TexCompressionMethod method) override;
 		virtual void DecodeBlock(void* output, void const * input) override;
 
+	protected:
+		std::unique_ptr<TexCompression> CreateWorkerCodec() const override;
+
 	private:
 		void PackBC7UniformBlock(void* output, ARGBColor32 const & pixel);
 		void PackBC7Block(int mode, CompressParams& params, void* output);
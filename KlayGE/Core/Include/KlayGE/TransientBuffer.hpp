@@ -35,8 +35,10 @@
 
 #include <KlayGE/PreDeclare.hpp>
 
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <vector>
-#include <list>
 
 namespace KlayGE
 {
@@ -55,19 +57,18 @@ namespace KlayGE
 		}
 	};
 
+	// A ring of per-frame linear allocations. Alloc only bumps a cursor, so it can be called from several threads at once.
+	//  Data are staged in CPU memory and uploaded with one map per EnsureDataReady. Everything allocated between two
+	//  OnPresent is retired together, once the GPU has passed the fence signaled for it.
 	class KLAYGE_CORE_API TransientBuffer final : boost::noncopyable
 	{
-		// Frames that have ended
-		struct RetiredFrame
+		// Frames that have ended but may still be read by the GPU
+		struct InFlightFrame
 		{
-			// Sub allocs that are unuseful and will be freed at the end of the frame
-			std::list<SubAlloc> pending_frees_;
+			uint32_t end;
+			bool wraps;
+			uint64_t fence_id;
 			uint32_t frame_id;
-
-			explicit RetiredFrame(uint32_t id)
-				: frame_id(id)
-			{
-			}
 		};
 
 	public:
@@ -80,12 +81,11 @@ namespace KlayGE
 	public:
 		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag);
 
-		// Allocate a sub space from transient buffer
+		// Allocate a sub space from transient buffer. The space is valid until the next OnPresent.
 		SubAlloc Alloc(uint32_t size_in_byte, void const * data);
-		// Knowtify transient buffer that this alloc is unused and will be freed at the end of the frame.
-		void Dealloc(SubAlloc const & alloc);
+		// Upload everything allocated since last call. Alloc shouldn't be running on other threads.
 		void EnsureDataReady();
-		// Do with retired frames
+		// End the allocations of this frame, and retire the frames GPU has done with
 		void OnPresent();
 
 		GraphicsBufferPtr const & GetBuffer() const
@@ -95,21 +95,36 @@ namespace KlayGE
 
 	private:
 		GraphicsBufferPtr DoCreateBuffer(BindFlag bind_flag, uint32_t size_in_byte);
-		// Free the sub alloc and return the space allocated back to transient buffer.
-		void DoFree(SubAlloc const & alloc);
+		bool TryBumpAlloc(uint32_t size_in_byte, uint32_t& offset);
+		uint32_t DoAllocSlow(uint32_t size_in_byte);
+		void LockExclusive();
+		void UnlockExclusive();
+		void RetireFrames();
 
 	private:
 		bool use_no_overwrite_;
 		uint32_t num_pre_frames_;
+		FencePtr fence_;
 
 		GraphicsBufferPtr buffer_;
-		std::list<SubAlloc> free_list_;
-		std::list<RetiredFrame> retired_frames_;
 		BindFlag bind_flag_;
-
-		std::vector<uint8_t> simulate_buffer_;
-		uint32_t valid_min_;
-		uint32_t valid_max_;
+		std::vector<uint8_t> staging_;
+
+		// Fast path state. head_ only moves forward until limit_, the others are changed under exclusive lock.
+		std::atomic<uint32_t> head_;
+		std::atomic<uint32_t> limit_;
+		std::atomic<uint32_t> num_writers_{0};
+		std::atomic<bool> exclusive_{false};
+		std::mutex slow_mutex_;
+
+		uint32_t tail_;
+		bool wrapped_;
+		uint32_t wrap_end_;
+		uint32_t frame_begin_;
+		bool frame_wraps_;
+		uint32_t dirty_begin_;
+		bool dirty_wraps_;
+		std::deque<InFlightFrame> in_flight_frames_;
 	};
 }
 
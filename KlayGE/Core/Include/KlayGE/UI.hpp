@@ -30,6 +30,8 @@
 
 namespace KlayGE
 {
+	class UIRectRenderable;
+
 	enum UI_Control_State
 	{
 		UICS_Normal = 0,
@@ -427,6 +429,7 @@ namespace KlayGE
 	private:
 		void Init();
 		void InputHandler(InputEngine const & sender, InputAction const & action);
+		UIRectRenderable& RectBatch(TexturePtr const & texture);
 
 	private:
 		static std::unique_ptr<UIManager> ui_mgr_instance_;
@@ -441,7 +444,8 @@ namespace KlayGE
 
 		std::array<std::vector<IRect >, UICT_Num_Control_Types> elem_texture_rcs_;
 
-		std::map<TexturePtr, RenderablePtr> rects_;
+		// One batch and its overlay node per texture, kept across frames
+		std::map<TexturePtr, std::pair<RenderablePtr, SceneNodePtr>> rects_;
 
 		struct string_cache
 		{
@@ -451,7 +455,13 @@ namespace KlayGE
 			std::wstring text;
 			uint32_t align;
 		};
-		std::map<size_t, std::vector<string_cache>> strings_;
+		// Indexed by font. Entries are reused by the next frame, only the first num_strings are drawn.
+		struct string_batch
+		{
+			std::vector<string_cache> strings;
+			size_t num_strings = 0;
+		};
+		std::vector<string_batch> strings_;
 
 		bool mouse_on_ui_{false};
 		bool inited_{false};
@@ -34,6 +34,8 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/RenderFactory.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <mutex>
 
@@ -41,14 +43,124 @@
 
 namespace
 {
+	using namespace KlayGE;
+
 	std::mutex singleton_mutex;
+	std::atomic<uint32_t> profiler_instance_id{0};
+
+	// Tracks are shared with the profiler, so a thread keeps a valid one even if the profiler is destroyed
+	struct ThreadTrackCache
+	{
+		uint32_t instance_id = 0;
+		std::shared_ptr<PerfThreadTrack> track;
+	};
+	thread_local ThreadTrackCache tls_track;
+
+	// The writer could be overwriting the oldest events while a snapshot is taken. Keep away from them, so that few copies are
+	// thrown away.
+	uint32_t constexpr SNAPSHOT_SAFE_DISTANCE = 256;
+
+	void WriteJsonString(std::ostream& os, std::string_view str)
+	{
+		os << '"';
+		for (char const ch : str)
+		{
+			switch (ch)
+			{
+			case '"':
+				os << "\\\"";
+				break;
+
+			case '\\':
+				os << "\\\\";
+				break;
+
+			case '\n':
+				os << "\\n";
+				break;
+
+			default:
+				if (static_cast<unsigned char>(ch) >= 0x20)
+				{
+					os << ch;
+				}
+				break;
+			}
+		}
+		os << '"';
+	}
 }
 
 namespace KlayGE
 {
+	PerfThreadTrack::PerfThreadTrack(uint32_t id)
+		: id_(id), events_(MakeUniquePtr<EventSlot[]>(RING_SIZE))
+	{
+	}
+
+	void PerfThreadTrack::Name(std::string_view name)
+	{
+		std::lock_guard<std::mutex> lock(name_mutex_);
+		name_ = std::string(name);
+	}
+
+	std::string PerfThreadTrack::Name() const
+	{
+		std::lock_guard<std::mutex> lock(name_mutex_);
+		return name_;
+	}
+
+	void PerfThreadTrack::Snapshot(std::vector<PerfZoneEvent>& events, uint64_t since_ns) const
+	{
+		size_t const first_event = events.size();
+
+		uint64_t const head = head_.load(std::memory_order_acquire);
+		uint64_t const begin = head - std::min<uint64_t>(head, RING_SIZE - SNAPSHOT_SAFE_DISTANCE);
+		for (uint64_t i = begin; i < head; ++ i)
+		{
+			auto const & slot = events_[i & (RING_SIZE - 1)];
+			events.push_back(PerfZoneEvent{slot.name.load(std::memory_order_relaxed), slot.begin_ns.load(std::memory_order_relaxed),
+				slot.end_ns.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed)});
+		}
+
+		// The slots the writer reached in the meantime could mix two events. They are the oldest ones, drop them.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t const new_head = head_.load(std::memory_order_relaxed);
+		uint64_t const num_overwritten = std::min(head - begin, std::max(new_head + 1, begin + RING_SIZE) - (begin + RING_SIZE));
+		events.erase(events.begin() + first_event, events.begin() + first_event + static_cast<size_t>(num_overwritten));
+
+		events.erase(std::remove_if(events.begin() + first_event, events.end(),
+						 [since_ns](PerfZoneEvent const & event) { return event.end_ns < since_ns; }),
+			events.end());
+	}
+
+
+	PerfScope::PerfScope(char const* name)
+		: name_(name), track_(nullptr), begin_ns_(0)
+	{
+		if (Context::Instance().Config().perf_profiler)
+		{
+			track_ = PerfProfiler::Instance().CurrentThreadTrack();
+			++ track_->Depth();
+			begin_ns_ = PerfProfiler::Now();
+		}
+	}
+
+	PerfScope::~PerfScope() noexcept
+	{
+		if (track_ != nullptr)
+		{
+			uint64_t const end_ns = PerfProfiler::Now();
+			uint32_t const depth = -- track_->Depth();
+			track_->Push(PerfZoneEvent{name_, begin_ns_, end_ns, depth});
+		}
+	}
+
+
 	std::unique_ptr<PerfProfiler> PerfProfiler::perf_profiler_instance_;
 
-	PerfRegion::PerfRegion()
+	PerfRegion::PerfRegion(std::string_view name)
+		: name_(name)
 	{
 		if (Context::Instance().Config().perf_profiler)
 		{
@@ -62,6 +174,11 @@ namespace KlayGE
 		if (Context::Instance().Config().perf_profiler)
 		{
 			dirty_ = true;
+
+			track_ = PerfProfiler::Instance().CurrentThreadTrack();
+			++ track_->Depth();
+			begin_ns_ = PerfProfiler::Now();
+
 			cpu_timer_.restart();
 			if (gpu_timer_query_)
 			{
@@ -79,6 +196,13 @@ namespace KlayGE
 			{
 				gpu_timer_query_->End();
 			}
+
+			if (track_ != nullptr)
+			{
+				uint32_t const depth = -- track_->Depth();
+				track_->Push(PerfZoneEvent{name_.c_str(), begin_ns_, PerfProfiler::Now(), depth});
+				track_ = nullptr;
+			}
 		}
 	}
 
@@ -95,6 +219,12 @@ namespace KlayGE
 	}
 
 
+	PerfProfiler::PerfProfiler()
+		: instance_id_(++ profiler_instance_id), gpu_track_(MakeSharedPtr<PerfThreadTrack>(0))
+	{
+		gpu_track_->Name("GPU");
+	}
+
 	PerfProfiler& PerfProfiler::Instance()
 	{
 		if (!perf_profiler_instance_)
@@ -124,7 +254,7 @@ namespace KlayGE
 
 	PerfRegion* PerfProfiler::CreatePerfRegion(int category, std::string const& name)
 	{
-		auto perf_region = MakeUniquePtr<PerfRegion>();
+		auto perf_region = MakeUniquePtr<PerfRegion>(name);
 		auto* ret = perf_region.get();
 		perf_regions_.emplace_back(PerfInfo{category, name, std::move(perf_region), {}});
 		return ret;
@@ -141,13 +271,64 @@ namespace KlayGE
 				{
 					perf_region.CollectData();
 					region.frames.emplace_back(FramePerfInfo{frame_id_, perf_region.CpuTime(), perf_region.GpuTime()});
+
+					if (perf_region.GpuTime() > 0)
+					{
+						uint64_t const begin_ns = perf_region.BeginTimestamp();
+						gpu_track_->Push(PerfZoneEvent{perf_region.Name().c_str(), begin_ns,
+							begin_ns + static_cast<uint64_t>(perf_region.GpuTime() * 1e9), 0});
+					}
 				}
+
+				while (!region.frames.empty() && (region.frames.front().frame_id + frame_window_ <= frame_id_))
+				{
+					region.frames.pop_front();
+				}
+			}
+
+			frame_begins_.push_back(Now());
+			while (frame_begins_.size() > frame_window_)
+			{
+				frame_begins_.pop_front();
 			}
 
 			++frame_id_;
 		}
 	}
 
+	void PerfProfiler::FrameWindow(uint32_t num_frames)
+	{
+		frame_window_ = std::max(num_frames, 1U);
+	}
+
+	void PerfProfiler::ThreadName(std::string_view name)
+	{
+		if (Context::Instance().Config().perf_profiler)
+		{
+			this->CurrentThreadTrack()->Name(name);
+		}
+	}
+
+	uint64_t PerfProfiler::Now() noexcept
+	{
+		static auto const epoch = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	PerfThreadTrack* PerfProfiler::CurrentThreadTrack()
+	{
+		if (tls_track.instance_id != instance_id_)
+		{
+			std::lock_guard<std::mutex> lock(tracks_mutex_);
+			auto track = MakeSharedPtr<PerfThreadTrack>(static_cast<uint32_t>(tracks_.size() + 1));
+			tracks_.push_back(track);
+
+			tls_track.instance_id = instance_id_;
+			tls_track.track = std::move(track);
+		}
+		return tls_track.track.get();
+	}
+
 	void PerfProfiler::ExportToCSV(std::string const& file_name) const
 	{
 		if (Context::Instance().Config().perf_profiler)
@@ -171,4 +352,68 @@ namespace KlayGE
 			ofs << '\n';
 		}
 	}
+
+	void PerfProfiler::ExportToChromeTrace(std::string const& file_name) const
+	{
+		if (Context::Instance().Config().perf_profiler)
+		{
+			uint64_t const since_ns = frame_begins_.empty() ? 0 : frame_begins_.front();
+
+			std::vector<std::shared_ptr<PerfThreadTrack>> tracks;
+			{
+				std::lock_guard<std::mutex> lock(tracks_mutex_);
+				tracks = tracks_;
+			}
+			tracks.push_back(gpu_track_);
+
+			std::ofstream ofs(file_name.c_str());
+			ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+			bool first = true;
+			auto begin_event = [&ofs, &first]()
+			{
+				ofs << (first ? "\n" : ",\n");
+				first = false;
+			};
+
+			std::vector<PerfZoneEvent> events;
+			for (auto const& track : tracks)
+			{
+				std::string name = track->Name();
+				if (name.empty())
+				{
+					name = "Thread " + std::to_string(track->Id());
+				}
+
+				begin_event();
+				ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << track->Id() << ",\"args\":{\"name\":";
+				WriteJsonString(ofs, name);
+				ofs << "}}";
+
+				events.clear();
+				track->Snapshot(events, since_ns);
+				for (auto const& event : events)
+				{
+					begin_event();
+					ofs << "{\"name\":";
+					WriteJsonString(ofs, event.name);
+					ofs << ",\"cat\":\"" << ((track == gpu_track_) ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+						<< track->Id() << ",\"ts\":" << event.begin_ns / 1000.0 << ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000.0
+						<< ",\"args\":{\"depth\":" << event.depth << "}}";
+				}
+			}
+
+			// frame_begins_ holds the begin times of the latest frames
+			uint32_t frame_id = frame_id_ + 1 - static_cast<uint32_t>(frame_begins_.size());
+			for (auto const frame_begin : frame_begins_)
+			{
+				begin_event();
+				ofs << "{\"name\":\"Frame " << frame_id << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":"
+					<< frame_begin / 1000.0 << "}";
+				++ frame_id;
+			}
+
+			ofs << "\n]}\n";
+		}
+	}
 } // namespace KlayGE
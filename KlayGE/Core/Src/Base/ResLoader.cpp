@@ -32,13 +32,16 @@
 #include <KFL/Hash.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/Package.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
 #if defined KLAYGE_PLATFORM_LINUX
 #include <cstring>
 #endif
+#include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 #if defined KLAYGE_PLATFORM_WINDOWS_DESKTOP
 #include <windows.h>
@@ -203,20 +206,27 @@ namespace KlayGE
 #endif
 #endif
 
-		loading_thread_ = Context::Instance().ThreadPoolInstance().QueueThread([this] { this->LoadingThreadFunc(); });
+		// Loading is mostly IO and decompression, a few workers are enough to hide the latency
+		uint32_t const num_loading_threads = std::clamp(std::thread::hardware_concurrency() / 2, 1U, 4U);
+		for (uint32_t i = 0; i < num_loading_threads; ++ i)
+		{
+			loading_threads_.push_back(
+				Context::Instance().ThreadPoolInstance().QueueThread([this] { this->LoadingThreadFunc(); }));
+		}
 	}
 
 	ResLoader::~ResLoader()
 	{
-		quit_ = true;
-
 		{
-			std::unique_lock<std::mutex> lock(loading_res_queue_mutex_, std::try_to_lock);
-			non_empty_loading_res_queue_ = true;
-			loading_res_queue_cv_.notify_one();
+			std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+			quit_ = true;
 		}
+		loading_res_queue_cv_.notify_all();
 
-		loading_thread_.wait();
+		for (auto& thread : loading_threads_)
+		{
+			thread.wait();
+		}
 	}
 
 	ResLoader& ResLoader::Instance()
@@ -677,8 +687,6 @@ namespace KlayGE
 
 	std::shared_ptr<void> ResLoader::SyncQuery(ResLoadingDescPtr const & res_desc)
 	{
-		this->RemoveUnrefResources();
-
 		std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc);
 		std::shared_ptr<void> res;
 		if (loaded_res)
@@ -698,27 +706,25 @@ namespace KlayGE
 		}
 		else
 		{
-			std::shared_ptr<volatile LoadingStatus> async_is_done;
-			bool found = false;
+			std::shared_ptr<std::atomic<LoadingStatus>> async_is_done;
+			bool const found = this->FindMatchLoadingResource(res_desc, async_is_done);
+			if (found)
 			{
-				std::lock_guard<std::mutex> lock(loading_mutex_);
-
-				for (auto const & lrq : loading_res_)
+				// Take the request over from the loading threads. If one of them is already in SubThreadStage, let it finish first.
+				LoadingStatus expected = LS_Loading;
+				while (!async_is_done->compare_exchange_weak(expected, LS_Complete))
 				{
-					if (lrq.first->Match(*res_desc))
+					if (expected != LS_Loading)
 					{
-						res_desc->CopyDataFrom(*lrq.first);
-						async_is_done = lrq.second;
-						found = true;
-						break;
+						if (expected != LS_Processing)
+						{
+							break;
+						}
+						std::this_thread::yield();
+						expected = LS_Loading;
 					}
 				}
 			}
-
-			if (found)
-			{
-				*async_is_done = LS_Complete;
-			}
 			else
 			{
 				res = res_desc->CreateResource();
@@ -737,10 +743,8 @@ namespace KlayGE
 		return res;
 	}
 
-	std::shared_ptr<void> ResLoader::ASyncQuery(ResLoadingDescPtr const & res_desc)
+	std::shared_ptr<void> ResLoader::ASyncQuery(ResLoadingDescPtr const & res_desc, int32_t priority)
 	{
-		this->RemoveUnrefResources();
-
 		std::shared_ptr<void> loaded_res = this->FindMatchLoadedResource(res_desc);
 		std::shared_ptr<void> res;
 		if (loaded_res)
@@ -760,23 +764,8 @@ namespace KlayGE
 		}
 		else
 		{
-			std::shared_ptr<volatile LoadingStatus> async_is_done;
-			bool found = false;
-			{
-				std::lock_guard<std::mutex> lock(loading_mutex_);
-
-				for (auto const & lrq : loading_res_)
-				{
-					if (lrq.first->Match(*res_desc))
-					{
-						res_desc->CopyDataFrom(*lrq.first);
-						async_is_done = lrq.second;
-						found = true;
-						break;
-					}
-				}
-			}
-
+			std::shared_ptr<std::atomic<LoadingStatus>> async_is_done;
+			bool const found = this->FindMatchLoadingResource(res_desc, async_is_done);
 			if (found)
 			{
 				res = res_desc->Resource();
@@ -786,6 +775,17 @@ namespace KlayGE
 					std::lock_guard<std::mutex> lock(loading_mutex_);
 					loading_res_.emplace_back(res_desc, async_is_done);
 				}
+				{
+					std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+					for (auto& request : loading_res_queue_)
+					{
+						if (request.res_pair.second == async_is_done)
+						{
+							++ request.num_requesters;
+							break;
+						}
+					}
+				}
 			}
 			else
 			{
@@ -793,18 +793,20 @@ namespace KlayGE
 				{
 					res = res_desc->CreateResource();
 
-					async_is_done = MakeSharedPtr<LoadingStatus>(LS_Loading);
+					async_is_done = MakeSharedPtr<std::atomic<LoadingStatus>>(LS_Loading);
 
 					{
 						std::lock_guard<std::mutex> lock(loading_mutex_);
 						loading_res_.emplace_back(res_desc, async_is_done);
+						loading_res_index_.emplace(res_desc->Hash(), LoadingResPair(res_desc, async_is_done));
 					}
 					{
-						std::unique_lock<std::mutex> lock(loading_res_queue_mutex_, std::try_to_lock);
-						loading_res_queue_.emplace_back(res_desc, async_is_done);
-						non_empty_loading_res_queue_ = true;
-						loading_res_queue_cv_.notify_one();
+						std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+						loading_res_queue_.push_back({LoadingResPair(res_desc, async_is_done), priority, loading_res_order_, 1});
+						++ loading_res_order_;
+						std::push_heap(loading_res_queue_.begin(), loading_res_queue_.end());
 					}
+					loading_res_queue_cv_.notify_one();
 				}
 				else
 				{
@@ -823,7 +825,7 @@ namespace KlayGE
 
 		for (auto iter = loaded_res_.begin(); iter != loaded_res_.end(); ++ iter)
 		{
-			if (res == iter->second.lock())
+			if (res == iter->second.second.lock())
 			{
 				loaded_res_.erase(iter);
 				break;
@@ -831,23 +833,83 @@ namespace KlayGE
 		}
 	}
 
+	void ResLoader::Reprioritize(std::shared_ptr<void> const & res, int32_t priority)
+	{
+		std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+
+		for (auto& request : loading_res_queue_)
+		{
+			if (request.res_pair.first->Resource() == res)
+			{
+				request.priority = priority;
+				std::make_heap(loading_res_queue_.begin(), loading_res_queue_.end());
+				break;
+			}
+		}
+	}
+
+	void ResLoader::Cancel(std::shared_ptr<void> const & res)
+	{
+		// A merged stateful requester has its own desc, so look the request up through loading_res_
+		std::shared_ptr<std::atomic<LoadingStatus>> status;
+		{
+			std::lock_guard<std::mutex> lock(loading_mutex_);
+			for (auto const & lrq : loading_res_)
+			{
+				if ((*lrq.second == LS_Loading) && (lrq.first->Resource() == res))
+				{
+					status = lrq.second;
+					break;
+				}
+			}
+		}
+		if (!status)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(loading_res_queue_mutex_);
+
+		for (auto iter = loading_res_queue_.begin(); iter != loading_res_queue_.end(); ++ iter)
+		{
+			if (iter->res_pair.second == status)
+			{
+				-- iter->num_requesters;
+				if (iter->num_requesters > 0)
+				{
+					break;
+				}
+
+				LoadingStatus expected = LS_Loading;
+				if (iter->res_pair.second->compare_exchange_strong(expected, LS_CanBeRemoved))
+				{
+					loading_res_queue_.erase(iter);
+					std::make_heap(loading_res_queue_.begin(), loading_res_queue_.end());
+				}
+				break;
+			}
+		}
+	}
+
 	void ResLoader::AddLoadedResource(ResLoadingDescPtr const & res_desc, std::shared_ptr<void> const & res)
 	{
 		std::lock_guard<std::mutex> lock(loaded_mutex_);
 
+		uint64_t const hash = res_desc->Hash();
+		auto range = loaded_res_.equal_range(hash);
 		bool found = false;
-		for (auto& c_desc : loaded_res_)
+		for (auto iter = range.first; iter != range.second; ++ iter)
 		{
-			if (c_desc.first == res_desc)
+			if (iter->second.first == res_desc)
 			{
-				c_desc.second = std::weak_ptr<void>(res);
+				iter->second.second = std::weak_ptr<void>(res);
 				found = true;
 				break;
 			}
 		}
 		if (!found)
 		{
-			loaded_res_.emplace_back(res_desc, std::weak_ptr<void>(res));
+			loaded_res_.emplace(hash, std::make_pair(res_desc, std::weak_ptr<void>(res)));
 		}
 	}
 
@@ -856,37 +918,70 @@ namespace KlayGE
 		std::lock_guard<std::mutex> lock(loaded_mutex_);
 
 		std::shared_ptr<void> loaded_res;
-		for (auto const & lr : loaded_res_)
+		auto range = loaded_res_.equal_range(res_desc->Hash());
+		for (auto iter = range.first; iter != range.second;)
 		{
-			if (lr.first->Match(*res_desc))
+			if (iter->second.first->Match(*res_desc))
 			{
-				loaded_res = lr.second.lock();
-				break;
+				loaded_res = iter->second.second.lock();
+				if (loaded_res)
+				{
+					break;
+				}
+
+				// Expired, drop it here instead of waiting for RemoveUnrefResources
+				iter = loaded_res_.erase(iter);
+			}
+			else
+			{
+				++ iter;
 			}
 		}
 		return loaded_res;
 	}
 
+	bool ResLoader::FindMatchLoadingResource(ResLoadingDescPtr const & res_desc,
+		std::shared_ptr<std::atomic<LoadingStatus>>& status)
+	{
+		std::lock_guard<std::mutex> lock(loading_mutex_);
+
+		auto range = loading_res_index_.equal_range(res_desc->Hash());
+		for (auto iter = range.first; iter != range.second; ++ iter)
+		{
+			auto const & lrq = iter->second;
+			if ((*lrq.second != LS_CanBeRemoved) && lrq.first->Match(*res_desc))
+			{
+				res_desc->CopyDataFrom(*lrq.first);
+				status = lrq.second;
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void ResLoader::RemoveUnrefResources()
 	{
 		std::lock_guard<std::mutex> lock(loaded_mutex_);
 
 		for (auto iter = loaded_res_.begin(); iter != loaded_res_.end();)
 		{
-			if (iter->second.lock())
+			if (iter->second.second.expired())
 			{
-				++ iter;
+				iter = loaded_res_.erase(iter);
 			}
 			else
 			{
-				iter = loaded_res_.erase(iter);
+				++ iter;
 			}
 		}
 	}
 
 	void ResLoader::Update()
 	{
-		std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> tmp_loading_res;
+		// Sweeping once per frame instead of on every query keeps the queries O(1)
+		this->RemoveUnrefResources();
+
+		std::vector<LoadingResPair> tmp_loading_res;
 		{
 			std::lock_guard<std::mutex> lock(loading_mutex_);
 			tmp_loading_res = loading_res_;
@@ -940,33 +1035,49 @@ namespace KlayGE
 					++ iter;
 				}
 			}
+			for (auto iter = loading_res_index_.begin(); iter != loading_res_index_.end();)
+			{
+				if (LS_CanBeRemoved == *(iter->second.second))
+				{
+					iter = loading_res_index_.erase(iter);
+				}
+				else
+				{
+					++ iter;
+				}
+			}
 		}
 	}
 
 	void ResLoader::LoadingThreadFunc()
 	{
-		while (!quit_)
+		PerfProfiler::Instance().ThreadName("ResLoader");
+
+		for (;;)
 		{
-			std::vector<std::pair<ResLoadingDescPtr, std::shared_ptr<volatile LoadingStatus>>> loading_res_queue_copy;
+			LoadingResPair res_pair;
 
 			{
 				std::unique_lock<std::mutex> lock(loading_res_queue_mutex_);
-				loading_res_queue_cv_.wait(lock, [this] { return non_empty_loading_res_queue_; });
+				loading_res_queue_cv_.wait(lock, [this] { return quit_ || !loading_res_queue_.empty(); });
+				if (quit_)
+				{
+					break;
+				}
 
-				loading_res_queue_copy.swap(loading_res_queue_);
-				non_empty_loading_res_queue_ = false;
+				std::pop_heap(loading_res_queue_.begin(), loading_res_queue_.end());
+				res_pair = std::move(loading_res_queue_.back().res_pair);
+				loading_res_queue_.pop_back();
 			}
 
-			for (auto& res_pair : loading_res_queue_copy)
+			// A SyncQuery or Cancel could have taken over the request in the meantime
+			LoadingStatus expected = LS_Loading;
+			if (res_pair.second->compare_exchange_strong(expected, LS_Processing))
 			{
-				if (LS_Loading == *res_pair.second)
-				{
-					res_pair.first->SubThreadStage();
-					*res_pair.second = LS_Complete;
-				}
+				PerfScope perf_scope("ResLoader::SubThreadStage");
+				res_pair.first->SubThreadStage();
+				*res_pair.second = LS_Complete;
 			}
-
-			Sleep(10);
 		}
 	}
 
@@ -14,12 +14,27 @@
 #include <KlayGE/Player.hpp>
 
 #include <algorithm>
+#include <array>
 #include <ctime>
 #include <cstring>
 
 #include <KlayGE/NetMsg.hpp>
 #include <KlayGE/Lobby.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t constexpr RECEIVE_BATCH_SIZE = 64;
+	// Players sending nothing in this many seconds are dropped
+	uint32_t constexpr PLAYER_TIME_OUT = 20;
+
+	uint64_t AddrKey(sockaddr_in const & addr)
+	{
+		return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+	}
+}
+
 namespace KlayGE
 {
 	// 캯
@@ -38,12 +53,10 @@ namespace KlayGE
 
 	Lobby::PlayerAddrsIter Lobby::ID(sockaddr_in const & addr)
 	{
-		for (auto iter = players_.begin(); iter != players_.end(); ++ iter)
+		auto const iter = player_indices_.find(AddrKey(addr));
+		if (iter != player_indices_.end())
 		{
-			if (0 == std::memcmp(&addr, &(iter->second.addr), sizeof(addr)))
-			{
-				return iter;
-			}
+			return players_.begin() + iter->second;
 		}
 
 		return players_.end();
@@ -51,90 +64,209 @@ namespace KlayGE
 
 	// Ϸ
 	/////////////////////////////////////////////////////////////////////////////////
-	void Lobby::Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro)
+	void Lobby::Create(std::string const & Name, uint16_t maxPlayers, uint16_t port, Processor const & pro)
 	{
+		// A Close coming first wins, otherwise it stops the loop below
+		State expected = State::Idle;
+		if (!state_.compare_exchange_strong(expected, State::Running))
+		{
+			return;
+		}
+
 		this->LobbyName(Name);
 
 		this->MaxPlayers(maxPlayers);
 
 		this->socket_.Bind(TransAddr("", port));
+		socklen_t len(sizeof(sockAddr_));
+		this->socket_.SockName(sockAddr_, len);
+		port_ = ntohs(sockAddr_.sin_port);
 
-		sockaddr_in from;
-		char revBuf[Max_Buffer];
-		char sendBuf[Max_Buffer];
-		int numSend = 0;
-		for (;;)
+		SocketPoller poller;
+		poller.Add(socket_, 0);
+
+		std::vector<std::array<char, Max_Buffer>> revBufs(RECEIVE_BATCH_SIZE);
+		std::vector<Socket::Datagram> revMsgs(RECEIVE_BATCH_SIZE);
+
+		time_t lastTimeOutCheck = std::time(nullptr);
+		while (State::Running == state_)
 		{
-			if (this->Receive(revBuf, sizeof(revBuf), from) == 0)
+			// Wakes up now and then for the time outs and Close
+			uint32_t readyID;
+			if (poller.Wait(MakeSpan(&readyID, 1), 100) > 0)
 			{
-				break;
+				for (uint32_t i = 0; i < RECEIVE_BATCH_SIZE; ++ i)
+				{
+					revBufs[i].fill(0);
+					revMsgs[i].buf = revBufs[i].data();
+					revMsgs[i].len = Max_Buffer;
+				}
+
+				// Whatever is left for the next batch keeps the socket readable
+				int const numRev = this->socket_.ReceiveFromBatch(revMsgs);
+				for (int i = 0; i < numRev; ++ i)
+				{
+					if (revMsgs[i].len > 0)
+					{
+						this->OnMsg(revBufs[i].data(), revMsgs[i].addr, pro);
+					}
+				}
 			}
 
-			// ÿϢǰ涼1ֽڵϢ
-			char* revPtr(&revBuf[1]);
-			char* sendPtr(&sendBuf[1]);
-			sendBuf[0] = revBuf[0];
+			// Ϣ
+			this->FlushSends();
 
-			switch (revBuf[0])
+			// Ƿûʱ
+			time_t const now = std::time(nullptr);
+			if (now != lastTimeOutCheck)
 			{
-			case MSG_JOIN:
-				this->OnJoin(revPtr, sendPtr, numSend, from, pro);
-				break;
+				lastTimeOutCheck = now;
+				for (auto iter = players_.begin(); iter != players_.end(); ++ iter)
+				{
+					if ((iter->first != 0) && (now - iter->second.time >= PLAYER_TIME_OUT))
+					{
+						this->RemovePlayer(iter, pro);
+					}
+				}
+			}
+		}
+
+		this->socket_.Close();
+	}
 
-			case MSG_QUIT:
-				this->OnQuit(this->ID(from), sendPtr, numSend, pro);
-				break;
+	void Lobby::OnMsg(char* revBuf, sockaddr_in& from, Processor const & pro)
+	{
+		char sendBuf[Max_Buffer];
+		int numSend = 0;
 
-			case MSG_GETLOBBYINFO:
-				this->OnGetLobbyInfo(sendPtr, numSend, pro);
-				break;
+		// ÿϢǰ涼1ֽڵϢ
+		char* revPtr(&revBuf[1]);
+		char* sendPtr(&sendBuf[1]);
+		sendBuf[0] = revBuf[0];
 
-			case MSG_NOP:
-				this->OnNop(this->ID(from));
-				break;
+		switch (revBuf[0])
+		{
+		case MSG_JOIN:
+			this->OnJoin(revPtr, sendPtr, numSend, from, pro);
+			break;
 
-			default:
-				pro.OnDefault(revBuf, sizeof(revBuf), sendBuf, numSend, from);
-				break;
-			}
+		case MSG_QUIT:
+			this->OnQuit(this->ID(from), sendPtr, numSend, pro);
+			break;
 
-			if (numSend != 0)
-			{
-				this->Send(sendBuf, numSend + 1, from);
-			}
+		case MSG_GETLOBBYINFO:
+			this->OnGetLobbyInfo(sendPtr, numSend, pro);
+			break;
 
-			// Ϣ
-			for (auto const & player : players_)
+		case MSG_NOP:
+			this->OnNop(this->ID(from));
+			break;
+
+		default:
+			pro.OnDefault(revBuf, Max_Buffer, sendBuf, numSend, from);
+			break;
+		}
+
+		if (numSend != 0)
+		{
+			NetMsgBuffer* reply = msg_pool_.Allocate(sendBuf, numSend + 1);
+			if (reply != nullptr)
 			{
-				auto const & msgs = player.second.msgs;
-				for (auto const & msg : msgs)
-				{
-					socket_.SendTo(&msg[0], static_cast<int>(msg.size()), player.second.addr);
-				}
+				replies_.emplace_back(reply, from);
 			}
+		}
+	}
 
-			// Ƿûʱ
-			for (auto iter = players_.begin(); iter != players_.end();)
+	void Lobby::FlushSends()
+	{
+		send_batch_.clear();
+		for (auto const & reply : replies_)
+		{
+			send_batch_.push_back({reply.first->data, static_cast<int>(reply.first->size), reply.second});
+		}
+		for (auto& player : players_)
+		{
+			if (player.first != 0)
 			{
-				// 20
-				if (std::time(nullptr) - iter->second.time >= 20 * 1000)
+				for (auto* msg : broadcasts_)
 				{
-					iter = players_.erase(iter);
+					send_batch_.push_back({msg->data, static_cast<int>(msg->size), player.second.addr});
 				}
-				else
+				for (auto* msg : player.second.msgs)
 				{
-					++ iter;
+					send_batch_.push_back({msg->data, static_cast<int>(msg->size), player.second.addr});
 				}
 			}
 		}
+
+		if (!send_batch_.empty())
+		{
+			this->socket_.SendToBatch(send_batch_);
+		}
+
+		for (auto const & reply : replies_)
+		{
+			msg_pool_.Release(reply.first);
+		}
+		replies_.clear();
+		for (auto* msg : broadcasts_)
+		{
+			msg_pool_.Release(msg);
+		}
+		broadcasts_.clear();
+		for (auto& player : players_)
+		{
+			for (auto* msg : player.second.msgs)
+			{
+				msg_pool_.Release(msg);
+			}
+			player.second.msgs.clear();
+		}
+	}
+
+	bool Lobby::SendToPlayer(uint32_t id, void const * buf, int size)
+	{
+		BOOST_ASSERT((id > 0) && (id <= players_.size()));
+
+		if (size < 0)
+		{
+			return false;
+		}
+
+		auto& player = players_[id - 1];
+		if (player.first != 0)
+		{
+			NetMsgBuffer* msg = msg_pool_.Allocate(buf, static_cast<uint32_t>(size));
+			if (msg == nullptr)
+			{
+				return false;
+			}
+			player.second.msgs.push_back(msg);
+		}
+		return true;
+	}
+
+	bool Lobby::Broadcast(void const * buf, int size)
+	{
+		if (size < 0)
+		{
+			return false;
+		}
+
+		NetMsgBuffer* msg = msg_pool_.Allocate(buf, static_cast<uint32_t>(size));
+		if (msg == nullptr)
+		{
+			return false;
+		}
+		broadcasts_.push_back(msg);
+		return true;
 	}
 
 	// 
 	/////////////////////////////////////////////////////////////////////////////////
-	char Lobby::NumPlayer() const
+	uint16_t Lobby::NumPlayer() const
 	{
-		return static_cast<char>(std::count_if(
-			players_.begin(), players_.end(), [](std::pair<uint32_t, PlayerDes> const& player) { return (player.first != 0); }));
+		return static_cast<uint16_t>(players_.size() - free_players_.size());
 	}
 
 	// ô
@@ -160,29 +292,46 @@ namespace KlayGE
 
 	// 
 	/////////////////////////////////////////////////////////////////////////////////
-	void Lobby::MaxPlayers(char maxPlayers)
+	void Lobby::MaxPlayers(uint16_t maxPlayers)
 	{
+		for (auto& player : players_)
+		{
+			for (auto* msg : player.second.msgs)
+			{
+				msg_pool_.Release(msg);
+			}
+		}
+
 		players_.resize(maxPlayers);
 		PlayerAddrs(players_).swap(players_);
+		player_indices_.clear();
 
-		for (auto& player : players_)
+		// The lowest ID goes first
+		free_players_.resize(maxPlayers);
+		for (uint16_t i = 0; i < maxPlayers; ++ i)
 		{
-			player.first = 0;
+			players_[i].first = 0;
+			players_[i].second.msgs.clear();
+			free_players_[i] = maxPlayers - 1 - i;
 		}
 	}
 
 	// ȡ
 	/////////////////////////////////////////////////////////////////////////////////
-	char Lobby::MaxPlayers() const
+	uint16_t Lobby::MaxPlayers() const
 	{
-		return static_cast<char>(this->players_.size());
+		return static_cast<uint16_t>(this->players_.size());
 	}
 
 	// رϷ
 	/////////////////////////////////////////////////////////////////////////////////
 	void Lobby::Close()
 	{
-		this->socket_.Close();
+		// A running loop closes the socket when it stops
+		if (state_.exchange(State::Closed) != State::Running)
+		{
+			this->socket_.Close();
+		}
 	}
 
 	// 
@@ -206,41 +355,35 @@ namespace KlayGE
 		// ʽ:
 		//			Player		16 ֽ
 
-		char id = 1;
-		auto iter = players_.begin();
-		for (; iter != this->players_.end(); ++ iter, ++ id)
+		auto iter = this->ID(from);
+		if ((iter == players_.end()) && !free_players_.empty())
 		{
-			if (0 == iter->first)
-			{
-				size_t i(0);
-				while (revBuf[i] != 0)
-				{
-					++ i;
-				}
-				std::string name(&revBuf[0], i);
-				iter->first			= id;
-				iter->second.name	= name;
-				iter->second.addr	= from;
+			uint32_t const index = free_players_.back();
+			free_players_.pop_back();
+			player_indices_.emplace(AddrKey(from), index);
 
-				pro.OnJoin(iter->first);
-				break;
+			size_t i(0);
+			while ((i < 16) && (revBuf[i] != 0))
+			{
+				++ i;
 			}
-		}
+			std::string name(&revBuf[0], i);
 
-		// ظʽ:
-		//			Player ID		1 ֽ
+			iter = players_.begin() + index;
+			iter->first			= index + 1;
+			iter->second.name	= name;
+			iter->second.addr	= from;
+			iter->second.time	= static_cast<uint32_t>(std::time(nullptr));
 
-		// Ѿ
-		if (iter == players_.end())
-		{
-			sendBuf[0] = 1;
-		}
-		else
-		{
-			sendBuf[0] = 0;
+			pro.OnJoin(iter->first);
 		}
 
-		numSend = 1;
+		// ظʽ:
+		//			Player ID		4 ֽ, ѾΪ0
+
+		uint32_t const id = (iter == players_.end()) ? 0 : iter->first;
+		std::memcpy(sendBuf, &id, sizeof(id));
+		numSend = sizeof(id);
 	}
 
 	void Lobby::OnQuit(PlayerAddrsIter iter, char* sendBuf,
@@ -248,8 +391,7 @@ namespace KlayGE
 	{
 		if (iter != this->players_.end())
 		{
-			pro.OnQuit(iter->first);
-			iter->first = 0;
+			this->RemovePlayer(iter, pro);
 			sendBuf[0] = 0;
 		}
 		else
@@ -263,15 +405,17 @@ namespace KlayGE
 	void Lobby::OnGetLobbyInfo(char* sendBuf, int& numSend, Processor const & /*pro*/)
 	{
 		// ظʽ:
-		//			ǰPlayers	1 ֽ
-		//			Players	1 ֽ
+		//			ǰPlayers	2 ֽ
+		//			Players	2 ֽ
 		//			Lobby		16 ֽ
 
-		memset(sendBuf, 0, 18);
-		sendBuf[0] = this->NumPlayer();
-		sendBuf[1] = this->MaxPlayers();
-		this->LobbyName().copy(&sendBuf[2], this->LobbyName().length());
-		numSend = 18;
+		memset(sendBuf, 0, 20);
+		uint16_t const numPlayer = this->NumPlayer();
+		uint16_t const maxPlayers = this->MaxPlayers();
+		std::memcpy(&sendBuf[0], &numPlayer, sizeof(numPlayer));
+		std::memcpy(&sendBuf[2], &maxPlayers, sizeof(maxPlayers));
+		this->LobbyName().copy(&sendBuf[4], this->LobbyName().length());
+		numSend = 20;
 	}
 
 	void Lobby::OnNop(PlayerAddrsIter iter)
@@ -281,4 +425,19 @@ namespace KlayGE
 			iter->second.time = static_cast<uint32_t>(std::time(nullptr));
 		}
 	}
+
+	void Lobby::RemovePlayer(PlayerAddrsIter iter, Processor const & pro)
+	{
+		pro.OnQuit(iter->first);
+
+		for (auto* msg : iter->second.msgs)
+		{
+			msg_pool_.Release(msg);
+		}
+		iter->second.msgs.clear();
+
+		player_indices_.erase(AddrKey(iter->second.addr));
+		free_players_.push_back(iter->first - 1);
+		iter->first = 0;
+	}
 }
@@ -59,50 +59,30 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void Player::ReceiveFunc()
 	{
-		static time_t lastTime = std::time(nullptr);
+		SocketPoller poller;
+		poller.Add(socket_, 0);
 
-		for (;;)
+		time_t lastTime = std::time(nullptr);
+		while (receiveLoop_)
 		{
-			if (std::time(nullptr) - lastTime >= 10 * 1000)
+			if (std::time(nullptr) - lastTime >= 10)
 			{
 				char msg(MSG_NOP);
 				socket_.Send(&msg, sizeof(msg));
 				lastTime = std::time(nullptr);
 			}
 
-			if (!sendQueue_.empty())
+			// Wakes up now and then for the NOPs and Quit
+			uint32_t readyID;
+			if (poller.Wait(MakeSpan(&readyID, 1), 100) == 0)
 			{
-				// ͶϢ
-				for (auto const & msg : sendQueue_)
-				{
-					socket_.Send(&msg[0], static_cast<int>(msg.size()));
-				}
+				continue;
 			}
 
 			char revBuf[Max_Buffer];
 			memset(revBuf, 0, sizeof(revBuf));
 			if (socket_.Receive(revBuf, sizeof(revBuf)) != -1)
 			{
-				uint32_t ID;
-				std::memcpy(&ID, &revBuf[1], 4);
-
-				// ɾѷ͵Ϣ
-				for (auto iter = sendQueue_.begin(); iter != sendQueue_.end();)
-				{
-					std::vector<char>& msg = *iter;
-
-					uint32_t sendID;
-					std::memcpy(&sendID, &msg[1], 4);
-					if (sendID == ID)
-					{
-						iter = sendQueue_.erase(iter);
-					}
-					else
-					{
-						++ iter;
-					}
-				}
-
 				if (MSG_QUIT == revBuf[0])
 				{
 					break;
@@ -129,7 +109,13 @@ namespace KlayGE
 
 		socket_.Send(buf, sizeof(buf));
 
-		socket_.Receive(&playerID_, sizeof(playerID_));
+		// Returns MSG_JOIN and the player ID, 0 if the lobby is full
+		char revBuf[1 + sizeof(playerID_)];
+		if ((socket_.Receive(revBuf, sizeof(revBuf)) != sizeof(revBuf)) || (revBuf[0] != MSG_JOIN))
+		{
+			return false;
+		}
+		std::memcpy(&playerID_, &revBuf[1], sizeof(playerID_));
 		if (0 == playerID_)
 		{
 			return false;
@@ -172,18 +158,19 @@ namespace KlayGE
 		char msg(MSG_GETLOBBYINFO);
 		socket_.Send(&msg, sizeof(msg));
 
-		char buf[18];
+		char buf[21];
+		memset(buf, 0, sizeof(buf));
 		socket_.Receive(buf, sizeof(buf));
 		if (MSG_GETLOBBYINFO == buf[0])
 		{
-			lobbydes.numPlayer = buf[1];
-			lobbydes.maxPlayers = buf[2];
+			std::memcpy(&lobbydes.numPlayer, &buf[1], sizeof(lobbydes.numPlayer));
+			std::memcpy(&lobbydes.maxPlayers, &buf[3], sizeof(lobbydes.maxPlayers));
 			size_t i(0);
-			while (buf[3 + i] != 0)
+			while ((i < 16) && (buf[5 + i] != 0))
 			{
 				++ i;
 			}
-			lobbydes.name = std::string(&buf[3], i);
+			lobbydes.name = std::string(&buf[5], i);
 		}
 
 		return lobbydes;
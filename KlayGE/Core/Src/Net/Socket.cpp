@@ -16,12 +16,24 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ErrorHandling.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <system_error>
 #include <boost/assert.hpp>
 
 #include <KlayGE/Socket.hpp>
 
+#if defined KLAYGE_PLATFORM_LINUX
+	#include <sys/epoll.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+	// Headers of one batched syscall live on the stack
+	uint32_t constexpr MAX_BATCH_MSGS = 64;
+}
+
 #if defined KLAYGE_PLATFORM_WINDOWS
 	// ʼWinsock
 	/////////////////////////////////////////////////////////////////////////////////
@@ -285,6 +297,94 @@ namespace KlayGE
 			reinterpret_cast<sockaddr const *>(&sockTo), sizeof(sockTo));
 	}
 
+	int Socket::ReceiveFromBatch(std::span<Datagram> msgs, int flags)
+	{
+		BOOST_ASSERT(this->socket_ != INVALID_SOCKET);
+
+		if (msgs.empty())
+		{
+			return 0;
+		}
+
+#if defined KLAYGE_PLATFORM_LINUX
+		mmsghdr headers[MAX_BATCH_MSGS];
+		iovec iovs[MAX_BATCH_MSGS];
+		uint32_t const num = static_cast<uint32_t>(std::min<size_t>(msgs.size(), MAX_BATCH_MSGS));
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			iovs[i].iov_base = msgs[i].buf;
+			iovs[i].iov_len = msgs[i].len;
+
+			std::memset(&headers[i], 0, sizeof(headers[i]));
+			headers[i].msg_hdr.msg_name = &msgs[i].addr;
+			headers[i].msg_hdr.msg_namelen = sizeof(msgs[i].addr);
+			headers[i].msg_hdr.msg_iov = &iovs[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int const ret = recvmmsg(this->socket_, headers, num, flags | MSG_WAITFORONE, nullptr);
+		for (int i = 0; i < ret; ++ i)
+		{
+			msgs[i].len = static_cast<int>(headers[i].msg_len);
+		}
+		return ret;
+#else
+		int const ret = this->ReceiveFrom(msgs[0].buf, msgs[0].len, msgs[0].addr, flags);
+		if (SOCKET_ERROR == ret)
+		{
+			return SOCKET_ERROR;
+		}
+
+		msgs[0].len = ret;
+		return 1;
+#endif
+	}
+
+	int Socket::SendToBatch(std::span<Datagram const> msgs, int flags)
+	{
+		BOOST_ASSERT(this->socket_ != INVALID_SOCKET);
+
+#if defined KLAYGE_PLATFORM_LINUX
+		mmsghdr headers[MAX_BATCH_MSGS];
+		iovec iovs[MAX_BATCH_MSGS];
+		size_t sent = 0;
+		while (sent < msgs.size())
+		{
+			uint32_t const num = static_cast<uint32_t>(std::min<size_t>(msgs.size() - sent, MAX_BATCH_MSGS));
+			for (uint32_t i = 0; i < num; ++ i)
+			{
+				auto const & msg = msgs[sent + i];
+
+				iovs[i].iov_base = msg.buf;
+				iovs[i].iov_len = msg.len;
+
+				std::memset(&headers[i], 0, sizeof(headers[i]));
+				headers[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&msg.addr);
+				headers[i].msg_hdr.msg_namelen = sizeof(msg.addr);
+				headers[i].msg_hdr.msg_iov = &iovs[i];
+				headers[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int const ret = sendmmsg(this->socket_, headers, num, flags);
+			if (ret <= 0)
+			{
+				break;
+			}
+			sent += ret;
+		}
+		return static_cast<int>(sent);
+#else
+		for (size_t i = 0; i < msgs.size(); ++ i)
+		{
+			if (SOCKET_ERROR == this->SendTo(msgs[i].buf, msgs[i].len, msgs[i].addr, flags))
+			{
+				return static_cast<int>(i);
+			}
+		}
+		return static_cast<int>(msgs.size());
+#endif
+	}
+
 	// ӷ
 	/////////////////////////////////////////////////////////////////////////////////
 	void Socket::Connect(sockaddr_in const & sockAddr)
@@ -319,4 +419,88 @@ namespace KlayGE
 
 		return timeOut.tv_sec * 1000 + timeOut.tv_usec;
 	}
+
+
+	SocketPoller::SocketPoller()
+	{
+#if defined KLAYGE_PLATFORM_LINUX
+		epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+		Verify(epoll_fd_ != -1);
+#endif
+	}
+
+	SocketPoller::~SocketPoller()
+	{
+#if defined KLAYGE_PLATFORM_LINUX
+		close(epoll_fd_);
+#endif
+	}
+
+	void SocketPoller::Add(Socket const & socket, uint32_t id)
+	{
+		BOOST_ASSERT(socket.Handle() != INVALID_SOCKET);
+
+#if defined KLAYGE_PLATFORM_LINUX
+		epoll_event event;
+		std::memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.u32 = id;
+		Verify(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket.Handle(), &event) != -1);
+#else
+		pollfd fd;
+		std::memset(&fd, 0, sizeof(fd));
+		fd.fd = socket.Handle();
+		fd.events = POLLIN;
+		fds_.push_back(fd);
+		ids_.push_back(id);
+#endif
+	}
+
+	void SocketPoller::Remove(Socket const & socket)
+	{
+#if defined KLAYGE_PLATFORM_LINUX
+		epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket.Handle(), nullptr);
+#else
+		for (size_t i = 0; i < fds_.size(); ++ i)
+		{
+			if (fds_[i].fd == socket.Handle())
+			{
+				fds_.erase(fds_.begin() + i);
+				ids_.erase(ids_.begin() + i);
+				break;
+			}
+		}
+#endif
+	}
+
+	uint32_t SocketPoller::Wait(std::span<uint32_t> ready_ids, int timeout_ms)
+	{
+#if defined KLAYGE_PLATFORM_LINUX
+		epoll_event events[MAX_BATCH_MSGS];
+		int const max_events = static_cast<int>(std::min<size_t>(ready_ids.size(), MAX_BATCH_MSGS));
+		int const num = epoll_wait(epoll_fd_, events, max_events, timeout_ms);
+		for (int i = 0; i < num; ++ i)
+		{
+			ready_ids[i] = events[i].data.u32;
+		}
+		return static_cast<uint32_t>(std::max(num, 0));
+#else
+	#if defined KLAYGE_PLATFORM_WINDOWS
+		int const num = WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+	#else
+		int const num = poll(fds_.data(), static_cast<nfds_t>(fds_.size()), timeout_ms);
+	#endif
+
+		uint32_t ret = 0;
+		for (size_t i = 0; (num > 0) && (i < fds_.size()) && (ret < ready_ids.size()); ++ i)
+		{
+			if (fds_[i].revents & (POLLIN | POLLERR | POLLHUP))
+			{
+				ready_ids[ret] = ids_[i];
+				++ ret;
+			}
+		}
+		return ret;
+#endif
+	}
 }
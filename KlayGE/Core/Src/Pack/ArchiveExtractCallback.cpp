@@ -45,6 +45,21 @@ namespace KlayGE
 	{
 		Convert(password_, pw);
 	}
+
+	ArchiveExtractCallback::ArchiveExtractCallback(std::string_view pw, std::span<uint32_t const> indices,
+		std::span<ISequentialOutStream* const> out_file_streams)
+		: password_is_defined_(!pw.empty())
+	{
+		BOOST_ASSERT(indices.size() == out_file_streams.size());
+
+		Convert(password_, pw);
+
+		out_file_streams_.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); ++ i)
+		{
+			out_file_streams_.emplace_back(indices[i], com_ptr<ISequentialOutStream>(out_file_streams[i]));
+		}
+	}
 	
 	ArchiveExtractCallback::~ArchiveExtractCallback() noexcept = default;
 
@@ -99,8 +114,6 @@ namespace KlayGE
 
 	STDMETHODIMP ArchiveExtractCallback::GetStream(UInt32 index, ISequentialOutStream** out_stream, Int32 ask_extract_mode) noexcept
 	{
-		KFL_UNUSED(index);
-
 		enum
 		{
 			kExtract = 0,
@@ -108,14 +121,26 @@ namespace KlayGE
 			kSkip,
 		};
 
+		*out_stream = nullptr;
 		if (kExtract == ask_extract_mode)
 		{
-			out_file_stream_->AddRef();
-			*out_stream = out_file_stream_.get();
-		}
-		else
-		{
-			*out_stream = nullptr;
+			if (out_file_stream_)
+			{
+				out_file_stream_->AddRef();
+				*out_stream = out_file_stream_.get();
+			}
+			else
+			{
+				for (auto const & item : out_file_streams_)
+				{
+					if (item.first == index)
+					{
+						item.second->AddRef();
+						*out_stream = item.second.get();
+						break;
+					}
+				}
+			}
 		}
 		return S_OK;
 	}
@@ -35,11 +35,13 @@
 
 #include <atomic>
 #include <string>
+#include <vector>
 
 #include <CPP/7zip/Archive/IArchive.h>
 #include <CPP/7zip/IPassword.h>
 
 #include <KFL/com_ptr.hpp>
+#include <KFL/CXX20/span.hpp>
 
 namespace KlayGE
 {
@@ -65,6 +67,9 @@ namespace KlayGE
 
 	public:
 		ArchiveExtractCallback(std::string_view pw, ISequentialOutStream* out_file_stream) noexcept;
+		// Extracting several items in one pass, out_file_streams[i] receives item indices[i]
+		ArchiveExtractCallback(std::string_view pw, std::span<uint32_t const> indices,
+			std::span<ISequentialOutStream* const> out_file_streams);
 		virtual ~ArchiveExtractCallback() noexcept;
 
 	private:
@@ -74,6 +79,7 @@ namespace KlayGE
 		std::wstring password_;
 
 		com_ptr<ISequentialOutStream> out_file_stream_;
+		std::vector<std::pair<uint32_t, com_ptr<ISequentialOutStream>>> out_file_streams_;
 	};
 }
 
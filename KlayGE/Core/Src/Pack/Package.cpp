@@ -31,9 +31,9 @@
 #include <KlayGE/KlayGE.hpp>
 #define INITGUID
 #include <KFL/com_ptr.hpp>
+#include <KFL/CustomizedStreamBuf.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/ResIdentifier.hpp>
-#include <KFL/StringUtil.hpp>
 #include <KFL/Util.hpp>
 
 #ifdef KLAYGE_PLATFORM_WINDOWS
@@ -44,7 +44,8 @@
 #include <KFL/DllLoader.hpp>
 
 #include <algorithm>
-#include <sstream>
+#include <cctype>
+#include <istream>
 #include <string>
 
 #include <boost/assert.hpp>
@@ -123,6 +124,59 @@ namespace
 		}
 	}
 
+	bool IsArchiveItemExtractable(IInArchive* archive, uint32_t index)
+	{
+		PROPVARIANT prop;
+		prop.vt = VT_EMPTY;
+		TIFHR(archive->GetProperty(index, kpidIsAnti, &prop));
+		if ((VT_BOOL == prop.vt) && (VARIANT_FALSE == prop.boolVal))
+		{
+			prop.vt = VT_EMPTY;
+			TIFHR(archive->GetProperty(index, kpidPosition, &prop));
+			if (prop.vt != VT_EMPTY)
+			{
+				if ((prop.vt != VT_UI8) || (prop.uhVal.QuadPart != 0))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	std::string NormalizeItemPath(std::string_view path)
+	{
+		std::string ret(path);
+		for (auto& ch : ret)
+		{
+			ch = (ch == '\\') ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+		}
+		return ret;
+	}
+
+	// Keeps the decoded buffer alive as long as the stream reading it
+	class SharedMemInputStreamBuf final : public MemInputStreamBuf
+	{
+	public:
+		explicit SharedMemInputStreamBuf(std::shared_ptr<std::vector<uint8_t>> const & data)
+			: MemInputStreamBuf(data->data(), static_cast<std::streamsize>(data->size())),
+				data_(data)
+		{
+		}
+
+	private:
+		std::shared_ptr<std::vector<uint8_t>> data_;
+	};
+
+	uint32_t const INVALID_INDEX = 0xFFFFFFFF;
+	uint32_t const NO_BLOCK = 0xFFFFFFFF;
+
+	// Upper bound of decoded solid blocks kept around for sibling files
+	uint64_t const MAX_CACHED_BLOCK_BYTES = 64 * 1024 * 1024;
+	// Larger blocks are decoded only up to the requested file. It keeps a single load from flushing the whole cache.
+	uint64_t const MAX_BLOCK_BYTES_TO_CACHE = MAX_CACHED_BLOCK_BYTES / 8;
+
 	class SevenZipLoader
 	{
 	public:
@@ -175,88 +229,202 @@ namespace KlayGE
 		TIFHR(archive->GetNumberOfItems(&num_items_));
 
 		archive_ = std::shared_ptr<IInArchive>(archive.detach(), std::mem_fn(&IInArchive::Release));
-	}
 
-	bool Package::Locate(std::string_view extract_file_path)
-	{
-		uint32_t real_index = this->Find(extract_file_path);
-		return (real_index != 0xFFFFFFFF);
-	}
-
-	ResIdentifierPtr Package::Extract(std::string_view extract_file_path, std::string_view res_name)
-	{
-		uint32_t real_index = this->Find(extract_file_path);
-		if (real_index != 0xFFFFFFFF)
+		items_.resize(num_items_);
+		for (uint32_t i = 0; i < num_items_; ++ i)
 		{
-			auto decoded_file = MakeSharedPtr<std::stringstream>();
-			com_ptr<IOutStream> out_stream(new OutStream(decoded_file), false);
-			com_ptr<IArchiveExtractCallback> ecb(new ArchiveExtractCallback(password_, out_stream.get()), false);
-			TIFHR(archive_->Extract(&real_index, 1, false, ecb.get()));
+			auto& item = items_[i];
+			item.size = 0;
+			item.mtime = archive_is_->Timestamp();
+			item.block = NO_BLOCK;
+
+			bool is_folder = true;
+			TIFHR(IsArchiveItemFolder(archive_.get(), i, is_folder));
+			if (is_folder || !IsArchiveItemExtractable(archive_.get(), i))
+			{
+				continue;
+			}
+
+			std::string file_path;
+			TIFHR(GetArchiveItemPath(archive_.get(), i, file_path));
+			path_to_index_.emplace(NormalizeItemPath(file_path), i);
 
 			PROPVARIANT prop;
 			prop.vt = VT_EMPTY;
-			TIFHR(archive_->GetProperty(real_index, kpidMTime, &prop));
-			uint64_t mtime;
+			TIFHR(archive_->GetProperty(i, kpidSize, &prop));
+			if (prop.vt == VT_UI8)
+			{
+				item.size = prop.uhVal.QuadPart;
+			}
+
+			prop.vt = VT_EMPTY;
+			TIFHR(archive_->GetProperty(i, kpidMTime, &prop));
 			if (prop.vt == VT_FILETIME)
 			{
-				mtime = (static_cast<uint64_t>(prop.filetime.dwHighDateTime) << 32)
+				item.mtime = (static_cast<uint64_t>(prop.filetime.dwHighDateTime) << 32)
 					+ prop.filetime.dwLowDateTime;
-				mtime -= 116444736000000000ULL;
+				item.mtime -= 116444736000000000ULL;
 			}
-			else
+
+			prop.vt = VT_EMPTY;
+			TIFHR(archive_->GetProperty(i, kpidBlock, &prop));
+			if (prop.vt == VT_UI4)
 			{
-				mtime = archive_is_->Timestamp();
+				item.block = prop.ulVal;
+				block_items_[item.block].push_back(i);
 			}
+		}
+	}
 
-			return MakeSharedPtr<ResIdentifier>(res_name, mtime, decoded_file);
+	bool Package::Locate(std::string_view extract_file_path)
+	{
+		return (this->Find(extract_file_path) != INVALID_INDEX);
+	}
+
+	ResIdentifierPtr Package::Extract(std::string_view extract_file_path, std::string_view res_name)
+	{
+		uint32_t const real_index = this->Find(extract_file_path);
+		if (real_index != INVALID_INDEX)
+		{
+			std::shared_ptr<std::vector<uint8_t>> decoded_file = this->ExtractItem(real_index);
+
+			auto decoded_buf = MakeSharedPtr<SharedMemInputStreamBuf>(decoded_file);
+			return MakeSharedPtr<ResIdentifier>(res_name, items_[real_index].mtime,
+				MakeSharedPtr<std::istream>(decoded_buf.get()), decoded_buf);
 		}
 		return ResIdentifierPtr();
 	}
 
-	uint32_t Package::Find(std::string_view extract_file_path)
+	uint32_t Package::Find(std::string_view extract_file_path) const
 	{
-		uint32_t real_index = 0xFFFFFFFF;
+		auto iter = path_to_index_.find(NormalizeItemPath(extract_file_path));
+		return (iter != path_to_index_.end()) ? iter->second : INVALID_INDEX;
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> Package::ExtractItem(uint32_t index)
+	{
+		auto const & item = items_[index];
 
-		for (uint32_t i = 0; i < num_items_; ++ i)
 		{
-			bool is_folder = true;
-			TIFHR(IsArchiveItemFolder(archive_.get(), i, is_folder));
-			if (!is_folder)
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (auto cached_item = this->FindCachedItem(index))
+			{
+				return cached_item;
+			}
+		}
+
+		std::lock_guard<std::mutex> extract_lock(extract_mutex_);
+
+		if (item.block != NO_BLOCK)
+		{
+			// Someone else could have decoded this block while we were waiting
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (auto cached_item = this->FindCachedItem(index))
 			{
-				std::string file_path;
-				TIFHR(GetArchiveItemPath(archive_.get(), i, file_path));
-				std::replace(file_path.begin(), file_path.end(), '\\', '/');
-				if (!StringUtil::CaseInsensitiveLexicographicalCompare(extract_file_path, file_path) &&
-					!StringUtil::CaseInsensitiveLexicographicalCompare(file_path, extract_file_path))
+				return cached_item;
+			}
+		}
+
+		// Decoding a file in a solid block has to go through everything before it anyway. Decode the whole block once
+		//  and keep the siblings around, unless the block is too large to cache.
+		std::vector<uint32_t> indices;
+		uint64_t block_bytes = 0;
+		if (item.block != NO_BLOCK)
+		{
+			auto const & siblings = block_items_.at(item.block);
+			if (siblings.size() > 1)
+			{
+				for (uint32_t sibling : siblings)
+				{
+					block_bytes += items_[sibling].size;
+				}
+				if (block_bytes <= MAX_BLOCK_BYTES_TO_CACHE)
 				{
-					real_index = i;
-					break;
+					indices = siblings;
 				}
 			}
 		}
-		if (real_index != 0xFFFFFFFF)
+		bool const cache_block = !indices.empty();
+		if (!cache_block)
 		{
-			PROPVARIANT prop;
-			prop.vt = VT_EMPTY;
-			TIFHR(archive_->GetProperty(real_index, kpidIsAnti, &prop));
-			if ((VT_BOOL == prop.vt) && (VARIANT_FALSE == prop.boolVal))
+			indices.assign(1, index);
+		}
+
+		std::vector<std::shared_ptr<std::vector<uint8_t>>> decoded_items(indices.size());
+		std::vector<com_ptr<IOutStream>> out_streams(indices.size());
+		std::vector<ISequentialOutStream*> raw_out_streams(indices.size());
+		for (size_t i = 0; i < indices.size(); ++ i)
+		{
+			decoded_items[i] = MakeSharedPtr<std::vector<uint8_t>>();
+			decoded_items[i]->reserve(static_cast<size_t>(items_[indices[i]].size));
+			out_streams[i] = com_ptr<IOutStream>(new MemOutStream(decoded_items[i]), false);
+			raw_out_streams[i] = out_streams[i].get();
+		}
+
+		com_ptr<IArchiveExtractCallback> ecb(new ArchiveExtractCallback(password_, indices, raw_out_streams), false);
+		TIFHR(archive_->Extract(indices.data(), static_cast<uint32_t>(indices.size()), false, ecb.get()));
+
+		std::shared_ptr<std::vector<uint8_t>> ret;
+		if (cache_block)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			while (!block_lru_.empty() && (cached_bytes_ + block_bytes > MAX_CACHED_BLOCK_BYTES))
+			{
+				uint32_t const evicted = block_lru_.back();
+				block_lru_.pop_back();
+
+				auto evicted_iter = cached_blocks_.find(evicted);
+				cached_bytes_ -= evicted_iter->second.num_bytes;
+				cached_blocks_.erase(evicted_iter);
+			}
+
+			CachedBlock cached_block;
+			for (size_t i = 0; i < indices.size(); ++ i)
 			{
-				prop.vt = VT_EMPTY;
-				TIFHR(archive_->GetProperty(real_index, kpidPosition, &prop));
-				if (prop.vt != VT_EMPTY)
+				cached_block.items.emplace(indices[i], decoded_items[i]);
+				if (indices[i] == index)
 				{
-					if ((prop.vt != VT_UI8) || (prop.uhVal.QuadPart != 0))
-					{
-						real_index = 0xFFFFFFFF;
-					}
+					ret = decoded_items[i];
 				}
 			}
-			else
+			cached_block.num_bytes = block_bytes;
+			block_lru_.push_front(item.block);
+			cached_block.lru_iter = block_lru_.begin();
+
+			cached_blocks_.emplace(item.block, std::move(cached_block));
+			cached_bytes_ += block_bytes;
+		}
+		else
+		{
+			ret = decoded_items[0];
+		}
+
+		return ret;
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> Package::FindCachedItem(uint32_t index)
+	{
+		uint32_t const block = items_[index].block;
+		if (block != NO_BLOCK)
+		{
+			auto block_iter = cached_blocks_.find(block);
+			if (block_iter != cached_blocks_.end())
 			{
-				real_index = 0xFFFFFFFF;
+				auto item_iter = block_iter->second.items.find(index);
+				if (item_iter != block_iter->second.items.end())
+				{
+					this->TouchBlock(block);
+					return item_iter->second;
+				}
 			}
 		}
+		return std::shared_ptr<std::vector<uint8_t>>();
+	}
 
-		return real_index;
+	void Package::TouchBlock(uint32_t block)
+	{
+		auto& cached_block = cached_blocks_[block];
+		block_lru_.splice(block_lru_.begin(), block_lru_, cached_block.lru_iter);
 	}
 }
@@ -38,6 +38,7 @@
 #include <atomic>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include <CPP/7zip/IStream.h>
 
@@ -91,6 +92,31 @@ namespace KlayGE
 
 		std::shared_ptr<std::ostream> os_;
 	};
+
+	// Decodes straight into a contiguous buffer. Reserve the buffer with the unpacked size to avoid reallocation.
+	class MemOutStream final : boost::noncopyable, public IOutStream
+	{
+	public:
+		// IUnknown
+		STDMETHOD_(ULONG, AddRef)() noexcept;
+		STDMETHOD_(ULONG, Release)() noexcept;
+		STDMETHOD(QueryInterface)(REFGUID iid, void** out_object) noexcept;
+
+		// IOutStream
+		STDMETHOD(Write)(void const * data, UInt32 size, UInt32* processed_size) noexcept;
+		STDMETHOD(Seek)(Int64 offset, UInt32 seek_origin, UInt64* new_position) noexcept;
+		STDMETHOD(SetSize)(UInt64 new_size) noexcept;
+
+	public:
+		explicit MemOutStream(std::shared_ptr<std::vector<uint8_t>> const & buff) noexcept;
+		virtual ~MemOutStream() noexcept;
+
+	private:
+		std::atomic<int32_t> ref_count_{1};
+
+		std::shared_ptr<std::vector<uint8_t>> buff_;
+		uint64_t pos_ = 0;
+	};
 }
 
 #endif		// KLAYGE_CORE_STREAMS_HPP
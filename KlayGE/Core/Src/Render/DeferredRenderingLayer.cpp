@@ -399,8 +399,8 @@ namespace
 			PostProcess::OnRenderBegin();
 
 			Camera const & camera = Context::Instance().AppInstance().ActiveCamera();
-			*(effect_->ParameterByName("inv_proj")) = camera.InverseProjMatrix();
-			*(effect_->ParameterByName("depth_near_far_invfar")) = float3(camera.NearPlane(), camera.FarPlane(), 1 / camera.FarPlane());
+			*(effect_->ParameterByName(EFFECT_HANDLE("inv_proj"))) = camera.InverseProjMatrix();
+			*(effect_->ParameterByName(EFFECT_HANDLE("depth_near_far_invfar"))) = float3(camera.NearPlane(), camera.FarPlane(), 1 / camera.FarPlane());
 		}
 	};
 }
@@ -1487,28 +1487,7 @@ namespace KlayGE
 			}
 		}
 
-		if (!(attrib & VPAM_NoDoF))
-		{
-			pvp.dof_tex = rf.MakeTexture2D(width, height, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
-			KLAYGE_TEXTURE_DEBUG_NAME(pvp.dof_tex);
-			pvp.dof_srv = rf.MakeTextureSrv(pvp.dof_tex);
-			pvp.dof_rtv = rf.Make2DRtv(pvp.dof_tex, 0, 1, 0);
-		}
-
-		if (!(attrib & VPAM_NoMotionBlur))
-		{
-			pvp.motion_blur_tex = rf.MakeTexture2D(width, height, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
-			KLAYGE_TEXTURE_DEBUG_NAME(pvp.motion_blur_tex);
-			pvp.motion_blur_srv = rf.MakeTextureSrv(pvp.motion_blur_tex);
-			pvp.motion_blur_rtv = rf.Make2DRtv(pvp.motion_blur_tex, 0, 1, 0);
-		}
-
-		if (!(attrib & VPAM_NoSSR) && !(attrib & VPAM_NoPPR))
-		{
-			pvp.merged_shading_resolved_before_ssr_tex = rf.MakeTexture2D(width, height, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
-			KLAYGE_TEXTURE_DEBUG_NAME(pvp.merged_shading_resolved_before_ssr_tex);
-			pvp.merged_shading_resolved_before_ssr_srv = rf.MakeTextureSrv(pvp.merged_shading_resolved_before_ssr_tex);
-		}
+		this->BuildTransientTargets();
 
 #if DEFAULT_DEFERRED == LIGHT_INDEXED_DEFERRED
 		if (cs_cldr_)
@@ -1604,6 +1583,102 @@ namespace KlayGE
 		}
 	}
 
+	std::array<uint32_t, DeferredRenderingLayer::PPT_Num> DeferredRenderingLayer::DeclarePostProcessTargets(RenderGraph& graph,
+		uint32_t attrib, RenderGraph::TextureDesc const & desc)
+	{
+		std::array<uint32_t, PPT_Num> targets;
+		targets.fill(RenderGraph::InvalidIndex);
+
+		uint32_t const shading = graph.ImportTexture("merged_shading", TexturePtr());
+		uint32_t const output = graph.ImportTexture("frame_buffer", TexturePtr());
+
+		if (!(attrib & VPAM_NoSSR) && !(attrib & VPAM_NoPPR))
+		{
+			uint32_t const before_ssr = graph.AddTexture("merged_shading_resolved_before_ssr", desc);
+			uint32_t const reads[] = {shading, before_ssr};
+			uint32_t const writes[] = {shading, before_ssr};
+			graph.AddPass("ScreenSpaceReflection", reads, writes);
+			targets[PPT_BeforeSSR] = before_ssr;
+		}
+
+		// Bokeh and motion blur may be turned on and off at any time, so they are always taken as running
+		std::vector<uint32_t> color_inputs = {shading};
+		if (!(attrib & VPAM_NoDoF))
+		{
+			uint32_t const dof = graph.AddTexture("dof", desc);
+			graph.AddPass("DepthOfField", color_inputs, MakeSpan(&dof, 1));
+			color_inputs.push_back(dof);
+			targets[PPT_DoF] = dof;
+		}
+		if (!(attrib & VPAM_NoMotionBlur))
+		{
+			uint32_t const motion_blur = graph.AddTexture("motion_blur", desc);
+			graph.AddPass("MotionBlur", color_inputs, MakeSpan(&motion_blur, 1));
+			color_inputs.push_back(motion_blur);
+			targets[PPT_MotionBlur] = motion_blur;
+		}
+		graph.AddPass("FinishingViewport", color_inputs, MakeSpan(&output, 1));
+
+		return targets;
+	}
+
+	// DoF, motion blur and the copy before SSR/PPR are written and consumed inside one job of one viewport. Declares them in a
+	//  render graph, so the ones that never overlap, in one viewport or across viewports, share a texture.
+	void DeferredRenderingLayer::BuildTransientTargets()
+	{
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+
+		std::array<std::array<uint32_t, PPT_Num>, std::tuple_size<decltype(viewports_)>::value> targets;
+
+		transient_graph_.Clear();
+		for (uint32_t vpi = 0; vpi < viewports_.size(); ++ vpi)
+		{
+			PerViewport const & pvp = viewports_[vpi];
+			if (!pvp.frame_buffer)
+			{
+				targets[vpi].fill(RenderGraph::InvalidIndex);
+				continue;
+			}
+
+			uint32_t const width = pvp.frame_buffer->Viewport()->Width();
+			uint32_t const height = pvp.frame_buffer->Viewport()->Height();
+			RenderGraph::TextureDesc const desc = {
+				width, height, 1, 1, pvp.merged_shading_texs[0]->Format(), 1, 0, EAH_GPU_Read | EAH_GPU_Write};
+			targets[vpi] = DeclarePostProcessTargets(transient_graph_, pvp.attrib, desc);
+		}
+
+		transient_graph_.Compile();
+		transient_graph_.Realize();
+
+		for (uint32_t vpi = 0; vpi < viewports_.size(); ++ vpi)
+		{
+			PerViewport& pvp = viewports_[vpi];
+
+			uint32_t tt = targets[vpi][PPT_DoF];
+			pvp.dof_tex = (tt != RenderGraph::InvalidIndex) ? transient_graph_.Texture(tt) : TexturePtr();
+			pvp.dof_srv = pvp.dof_tex ? rf.MakeTextureSrv(pvp.dof_tex) : ShaderResourceViewPtr();
+			pvp.dof_rtv = pvp.dof_tex ? rf.Make2DRtv(pvp.dof_tex, 0, 1, 0) : RenderTargetViewPtr();
+
+			tt = targets[vpi][PPT_MotionBlur];
+			pvp.motion_blur_tex = (tt != RenderGraph::InvalidIndex) ? transient_graph_.Texture(tt) : TexturePtr();
+			pvp.motion_blur_srv = pvp.motion_blur_tex ? rf.MakeTextureSrv(pvp.motion_blur_tex) : ShaderResourceViewPtr();
+			pvp.motion_blur_rtv = pvp.motion_blur_tex ? rf.Make2DRtv(pvp.motion_blur_tex, 0, 1, 0) : RenderTargetViewPtr();
+
+			tt = targets[vpi][PPT_BeforeSSR];
+			pvp.merged_shading_resolved_before_ssr_tex = (tt != RenderGraph::InvalidIndex) ? transient_graph_.Texture(tt) : TexturePtr();
+			pvp.merged_shading_resolved_before_ssr_srv
+				= pvp.merged_shading_resolved_before_ssr_tex ? rf.MakeTextureSrv(pvp.merged_shading_resolved_before_ssr_tex)
+															 : ShaderResourceViewPtr();
+		}
+
+#ifdef KLAYGE_DEBUG
+		auto const& report = transient_graph_.Report();
+		LogDebug() << "Post process targets: " << report.num_transient_textures << " in " << report.num_physical_textures
+				   << " textures, " << report.SavedBytes() / 1024 << " KB of " << report.requested_bytes / 1024 << " KB saved."
+				   << std::endl;
+#endif
+	}
+
 	RenderEffectPtr const & DeferredRenderingLayer::GBufferEffect(RenderMaterial const * material, bool line, bool skinning) const
 	{
 		EffectIndex effect_index;
@@ -1917,6 +1992,45 @@ namespace KlayGE
 
 	void DeferredRenderingLayer::BuildPassScanList(bool has_opaque_objs, bool has_transparency_back_objs, bool has_transparency_front_objs)
 	{
+		if (dr_effect_->HWResourceReady())
+		{
+			for (uint32_t vpi = 0; vpi < viewports_.size(); ++ vpi)
+			{
+				PerViewport& pvp = viewports_[vpi];
+				if (pvp.attrib & VPAM_Enabled)
+				{
+					pvp.g_buffer_enables[PTB_Opaque] = (pvp.attrib & VPAM_NoOpaque) ? false : has_opaque_objs;
+					pvp.g_buffer_enables[PTB_TransparencyBack] = (pvp.attrib & VPAM_NoTransparencyBack) ? false : has_transparency_back_objs;
+					pvp.g_buffer_enables[PTB_TransparencyFront]
+						= (pvp.attrib & VPAM_NoTransparencyFront) ? false : has_transparency_front_objs;
+
+					pvp.light_visibles.resize(lights_.size());
+					for (uint32_t li = 0; li < lights_.size(); ++ li)
+					{
+						auto const & light = *lights_[li];
+						if (light.Enabled())
+						{
+							this->CheckLightVisible(vpi, li);
+						}
+						else
+						{
+							pvp.light_visibles[li] = false;
+						}
+					}
+				}
+			}
+
+			this->UpdateShadowMapCaches();
+		}
+
+		// The jobs only hold indices, so the list from last frame is still good if nothing it depends on changed
+		this->BuildPassListKey(new_pass_list_key_);
+		if (!jobs_.empty() && (new_pass_list_key_ == pass_list_key_))
+		{
+			return;
+		}
+		pass_list_key_.swap(new_pass_list_key_);
+
 		jobs_.clear();
 
 		if (dr_effect_->HWResourceReady())
@@ -1950,25 +2064,6 @@ namespace KlayGE
 
 					jobs_.push_back(MakeUniquePtr<DeferredRenderingJob>([this, vpi] { return this->SwitchViewportDRJob(vpi); }));
 
-					pvp.g_buffer_enables[PTB_Opaque] = (pvp.attrib & VPAM_NoOpaque) ? false : has_opaque_objs;
-					pvp.g_buffer_enables[PTB_TransparencyBack] = (pvp.attrib & VPAM_NoTransparencyBack) ? false : has_transparency_back_objs;
-					pvp.g_buffer_enables[PTB_TransparencyFront]
-						= (pvp.attrib & VPAM_NoTransparencyFront) ? false : has_transparency_front_objs;
-
-					pvp.light_visibles.resize(lights_.size());
-					for (uint32_t li = 0; li < lights_.size(); ++ li)
-					{
-						auto const & light = *lights_[li];
-						if (light.Enabled())
-						{
-							this->CheckLightVisible(vpi, li);
-						}
-						else
-						{
-							pvp.light_visibles[li] = false;
-						}
-					}
-
 					for (uint32_t i = PTB_Opaque; i < PTB_None; ++ i)
 					{
 						PassTargetBuffer const pass_tb = static_cast<PassTargetBuffer>(i);
@@ -2072,6 +2167,53 @@ namespace KlayGE
 		}
 	}
 
+	void DeferredRenderingLayer::BuildPassListKey(std::vector<uint32_t>& key) const
+	{
+		key.clear();
+
+		bool const hw_ready = dr_effect_->HWResourceReady();
+		key.push_back(hw_ready);
+		if (!hw_ready)
+		{
+			return;
+		}
+
+		key.push_back(display_type_);
+		key.push_back((has_reflective_objs_ ? 1U : 0U) | (has_vdm_objs_ ? 2U : 0U) | (has_simple_forward_objs_ ? 4U : 0U)
+			| (rsm_fb_ ? 8U : 0U) | (tex_array_support_ ? 16U : 0U) | ((shadow_map_caching_ && static_shadow_map_split_) ? 32U : 0U));
+		key.push_back(static_cast<uint32_t>(illum_));
+		key.push_back(static_cast<uint32_t>(cascaded_shadow_index_));
+
+		key.push_back(static_cast<uint32_t>(lights_.size()));
+		for (auto const * light : lights_)
+		{
+			key.push_back(light->Enabled());
+			key.push_back(light->Type());
+			key.push_back(static_cast<uint32_t>(light->Attrib()));
+		}
+
+		for (auto const & pvp : viewports_)
+		{
+			key.push_back(pvp.attrib);
+			if (pvp.attrib & VPAM_Enabled)
+			{
+				key.push_back(pvp.num_cascades);
+				key.push_back((pvp.g_buffer_enables[PTB_Opaque] ? 1U : 0U) | (pvp.g_buffer_enables[PTB_TransparencyBack] ? 2U : 0U)
+					| (pvp.g_buffer_enables[PTB_TransparencyFront] ? 4U : 0U));
+
+				// Visibility only decides the indirect lighting passes. Keeps the rest out, they change whenever the camera moves.
+				for (uint32_t li = 0; li < lights_.size(); ++ li)
+				{
+					auto const & light = *lights_[li];
+					if ((LightSource::LT_Spot == light.Type()) && (light.Attrib() & LightSource::LSA_IndirectLighting))
+					{
+						key.push_back(pvp.light_visibles[li]);
+					}
+				}
+			}
+		}
+	}
+
 	void DeferredRenderingLayer::CheckLightVisible(uint32_t vp_index, uint32_t light_index)
 	{
 		SceneManager& scene_mgr = Context::Instance().SceneManagerInstance();
@@ -2223,6 +2365,16 @@ namespace KlayGE
 				{
 					return this->ShadowMapGenerationDRJob(viewports_[0], shadow_pt, light_index, i);
 				}));
+
+			// Whether it actually runs is decided every frame in UpdateShadowMapCaches
+			if ((0 == i) && (2 == passes) && (shadow_pt != PT_GenReflectiveShadowMap) && shadow_map_caching_ && static_shadow_map_split_)
+			{
+				jobs_.push_back(MakeUniquePtr<DeferredRenderingJob>(
+					[this, shadow_pt, light_index]
+					{
+						return this->StaticShadowMapDRJob(shadow_pt, light_index);
+					}));
+			}
 		}
 	}
 
@@ -2654,6 +2806,89 @@ namespace KlayGE
 		}
 	}
 
+	void DeferredRenderingLayer::UpdateShadowMapCaches()
+	{
+		auto& rf = Context::Instance().RenderFactoryInstance();
+		auto const & scene_mgr = Context::Instance().SceneManagerInstance();
+
+		bool const translucency = has_sss_objs_ && translucency_enabled_;
+
+		shadow_map_updates_.assign(lights_.size(), SMU_Full);
+		for (uint32_t li = 0; li < lights_.size(); ++ li)
+		{
+			auto const & light = *lights_[li];
+			LightSource::LightType const type = light.Type();
+			bool const is_spot = (LightSource::LT_Spot == type);
+			if (!light.Enabled() || !(is_spot || (LightSource::LT_Point == type) || (LightSource::LT_SphereArea == type)
+									  || (LightSource::LT_TubeArea == type)))
+			{
+				continue;
+			}
+
+			int32_t const slot = shadow_map_light_indices_[li].first;
+			if (slot < 0)
+			{
+				continue;
+			}
+
+			auto& cache = is_spot ? cached_shadow_map_2ds_[slot] : cached_shadow_map_cubes_[slot];
+			if (!shadow_map_caching_ || (static_cast<int32_t>(li) == projective_light_index_)
+				|| (is_spot && (light.Attrib() & LightSource::LSA_IndirectLighting) && rsm_fb_ && (illum_ != 1)))
+			{
+				// Drawn every frame, and it overwrites whatever was cached in the slot
+				cache.valid = false;
+				continue;
+			}
+
+			// Only the 2-pass paths have a single depth buffer to save and restore. The translucency copy needs all the casters.
+			bool const with_translucency = is_spot && translucency;
+			bool const split = static_shadow_map_split_ && (is_spot ? !with_translucency : tex_array_support_);
+			float4x4 const & view_proj = light.SMCamera(0)->ViewProjMatrix();
+
+			// Nothing further than the range is lit, a caster out there can't cast a visible shadow
+			float const range = light.Range() * light_scale_;
+			float3 const & pos = light.Position();
+			AABBox const volume(pos - float3(range, range, range), pos + float3(range, range, range));
+
+			CachedShadowMap key;
+			key.light = &light;
+			key.view_proj = view_proj;
+			key.range = range;
+			key.split = split;
+			key.translucency = with_translucency;
+			shadow_map_updates_[li] = UpdateShadowMapCache(cache, key, scene_mgr.CastersChanged(volume, split));
+			if (split)
+			{
+				auto& static_depth_tex = is_spot ? static_shadow_map_2d_depth_texs_[slot] : static_shadow_map_cube_depth_texs_[slot];
+				if (!static_depth_tex)
+				{
+					static_depth_tex = rf.MakeTexture2D(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1, is_spot ? 1 : 6, EF_D24S8, 1, 0,
+						EAH_GPU_Read | EAH_GPU_Write);
+					KLAYGE_TEXTURE_DEBUG_NAME(static_depth_tex);
+				}
+			}
+		}
+	}
+
+	DeferredRenderingLayer::ShadowMapUpdate DeferredRenderingLayer::UpdateShadowMapCache(CachedShadowMap& cache,
+		CachedShadowMap const & key, bool casters_changed)
+	{
+		bool const hit = cache.valid && (cache.light == key.light) && (cache.view_proj == key.view_proj) && (cache.range == key.range)
+			&& (cache.split == key.split) && (cache.translucency == key.translucency) && !casters_changed;
+
+		cache = key;
+		cache.valid = true;
+
+		if (key.split)
+		{
+			return hit ? SMU_DynamicOnly : SMU_StaticAndDynamic;
+		}
+		else
+		{
+			return hit ? SMU_Skip : SMU_Full;
+		}
+	}
+
 	void DeferredRenderingLayer::UpdateShadowing(PerViewport const & pvp)
 	{
 		for (uint32_t li = 0; li < lights_.size(); ++ li)
@@ -4529,6 +4764,12 @@ namespace KlayGE
 		auto& re = rf.RenderEngineInstance();
 		auto& scene_mgr = Context::Instance().SceneManagerInstance();
 
+		ShadowMapUpdate const update = shadow_map_updates_[light_index];
+		if (SMU_Skip == update)
+		{
+			return 0;
+		}
+
 		for (auto const & node : visible_scene_nodes_)
 		{
 			node->Pass(pass_type);
@@ -4591,7 +4832,15 @@ namespace KlayGE
 				shadow_map_fb_->Viewport()->Camera(shadow_map_camera);
 				re.BindFrameBuffer(shadow_map_fb_);
 				shadow_map_fb_->AttachedRtv(FrameBuffer::Attachment::Color0)->Discard();
-				shadow_map_fb_->AttachedDsv()->ClearDepth(1.0f);
+				if (SMU_DynamicOnly == update)
+				{
+					static_shadow_map_2d_depth_texs_[shadow_map_light_indices_[light_index].first]->CopyToTexture(
+						*shadow_map_depth_tex_, TextureFilter::Point);
+				}
+				else
+				{
+					shadow_map_fb_->AttachedDsv()->ClearDepth(1.0f);
+				}
 				break;
 
 			case PRT_ShadowMapMultiView:
@@ -4601,7 +4850,15 @@ namespace KlayGE
 				}
 				re.BindFrameBuffer(shadow_map_array_fb_);
 				shadow_map_array_fb_->AttachedRtv(FrameBuffer::Attachment::Color0)->Discard();
-				shadow_map_array_fb_->AttachedDsv()->ClearDepth(1.0f);
+				if (SMU_DynamicOnly == update)
+				{
+					static_shadow_map_cube_depth_texs_[shadow_map_light_indices_[light_index].first]->CopyToTexture(
+						*shadow_map_array_depth_tex_, TextureFilter::Point);
+				}
+				else
+				{
+					shadow_map_array_fb_->AttachedDsv()->ClearDepth(1.0f);
+				}
 				break;
 
 			case PRT_CascadedShadowMap:
@@ -4621,11 +4878,54 @@ namespace KlayGE
 			default:
 				KFL_UNREACHABLE("Invalid pass render target");
 			}
+
+			if (SMU_StaticAndDynamic == update)
+			{
+				urv |= App3DFramework::URV_StaticOnly;
+			}
+			else if (SMU_DynamicOnly == update)
+			{
+				urv |= App3DFramework::URV_DynamicOnly;
+			}
 		}
 
 		return urv;
 	}
 
+	uint32_t DeferredRenderingLayer::StaticShadowMapDRJob(PassType pass_type, int32_t light_index)
+	{
+		if (shadow_map_updates_[light_index] != SMU_StaticAndDynamic)
+		{
+			return 0;
+		}
+
+		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto& scene_mgr = Context::Instance().SceneManagerInstance();
+
+		for (auto const & node : visible_scene_nodes_)
+		{
+			node->Pass(pass_type);
+		}
+
+		// The static casters are done. Saves their depth, and draws the dynamic ones on top without clearing.
+		int32_t const slot = shadow_map_light_indices_[light_index].first;
+		if (PRT_ShadowMapMultiView == GetPassRT(pass_type))
+		{
+			shadow_map_array_depth_tex_->CopyToTexture(*static_shadow_map_cube_depth_texs_[slot], TextureFilter::Point);
+			re.BindFrameBuffer(shadow_map_array_fb_);
+		}
+		else
+		{
+			shadow_map_depth_tex_->CopyToTexture(*static_shadow_map_2d_depth_texs_[slot], TextureFilter::Point);
+			re.BindFrameBuffer(shadow_map_fb_);
+		}
+
+		curr_cascade_index_ = -1;
+		scene_mgr.SmallObjectThreshold(0.002f);
+
+		return App3DFramework::URV_NeedFlush | App3DFramework::URV_OpaqueOnly | App3DFramework::URV_DynamicOnly;
+	}
+
 	uint32_t DeferredRenderingLayer::IndirectLightingDRJob(PerViewport const & pvp, int32_t light_index)
 	{
 		depth_to_esm_pp_->InputPin(0, shadow_map_depth_srv_);
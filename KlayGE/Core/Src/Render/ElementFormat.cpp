@@ -30,18 +30,591 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/CXX20/bit.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KlayGE/ElementFormat.hpp>
 
+#include <array>
+#include <cstring>
+
 #include <boost/assert.hpp>
 
 #include <KFL/Math.hpp>
 #include <KFL/Half.hpp>
 
+#if defined(KLAYGE_SSE2_SUPPORT)
+#include <emmintrin.h>
+#if defined(KLAYGE_TARGET_AVX2)
+#include <immintrin.h>
+#endif
+#endif
+
+namespace
+{
+	using namespace KlayGE;
+
+	static_assert(sizeof(Color) == sizeof(float) * 4);
+
+	typedef void (*ToABGR32FFunc)(void const * input, uint32_t num_elems, Color* output);
+	typedef void (*FromABGR32FFunc)(Color const * input, uint32_t num_elems, void* output);
+
+	class CpuFeatures final
+	{
+	public:
+		static CpuFeatures const & Instance()
+		{
+			static CpuFeatures const features;
+			return features;
+		}
+
+		bool Avx2() const noexcept
+		{
+			return avx2_;
+		}
+
+	private:
+		CpuFeatures()
+		{
+			CpuInfo const cpu;
+			avx2_ = cpu.IsFeatureSupport(CpuInfo::CF_AVX2);
+		}
+
+	private:
+		bool avx2_;
+	};
+
+	uint8_t UNormFloatToUInt8(float v) noexcept
+	{
+		return static_cast<uint8_t>(MathLib::clamp(static_cast<int>(v * 255.0f + 0.5f), 0, 255));
+	}
+
+	// Decodes an unsigned float with 5 exponent bits and MANTISSA_BITS mantissa bits, as in EF_B10G11R11F
+	template <int MANTISSA_BITS>
+	float UnsignedSmallFloatToFloat(uint32_t bits) noexcept
+	{
+		uint32_t const mantissa = bits & ((1U << MANTISSA_BITS) - 1);
+		uint32_t const exponent = bits >> MANTISSA_BITS;
+
+		if (0x1F == exponent)
+		{
+			return std::bit_cast<float>(0x7F800000U | (mantissa << (23 - MANTISSA_BITS)));
+		}
+		else if (0 == exponent)
+		{
+			return mantissa * std::bit_cast<float>((127U - 14 - MANTISSA_BITS) << 23);
+		}
+		else
+		{
+			return std::bit_cast<float>(((exponent + 112) << 23) | (mantissa << (23 - MANTISSA_BITS)));
+		}
+	}
+
+	class ConversionTables final
+	{
+	public:
+		static ConversionTables const & Instance()
+		{
+			static ConversionTables const tables;
+			return tables;
+		}
+
+		std::array<float, 256> srgb8_to_linear;
+		std::array<float, 2048> float11_to_float;
+		std::array<float, 1024> float10_to_float;
+
+	private:
+		ConversionTables()
+		{
+			for (uint32_t i = 0; i < srgb8_to_linear.size(); ++ i)
+			{
+				srgb8_to_linear[i] = MathLib::srgb_to_linear(i / 255.0f);
+			}
+			for (uint32_t i = 0; i < float11_to_float.size(); ++ i)
+			{
+				float11_to_float[i] = UnsignedSmallFloatToFloat<6>(i);
+			}
+			for (uint32_t i = 0; i < float10_to_float.size(); ++ i)
+			{
+				float10_to_float[i] = UnsignedSmallFloatToFloat<5>(i);
+			}
+		}
+	};
+
+
+	template <bool SWAP_RB>
+	void UNorm8x4ToABGR32F(void const * input, uint32_t num_elems, Color* output)
+	{
+		uint8_t const * p = static_cast<uint8_t const *>(input);
+		float* out = reinterpret_cast<float*>(output);
+
+		uint32_t i = 0;
+#ifdef KLAYGE_SSE2_SUPPORT
+		__m128 const scale = _mm_set1_ps(255.0f);
+		__m128i const zero = _mm_setzero_si128();
+		for (; i + 4 <= num_elems; i += 4)
+		{
+			__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i * 4));
+			__m128i const lo = _mm_unpacklo_epi8(v, zero);
+			__m128i const hi = _mm_unpackhi_epi8(v, zero);
+			__m128 c[] = {_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)),
+				_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero))};
+			for (uint32_t j = 0; j < 4; ++ j)
+			{
+				// Divides rather than multiplying by the reciprocal, to get the same values as the scalar code
+				c[j] = _mm_div_ps(c[j], scale);
+				if constexpr (SWAP_RB)
+				{
+					c[j] = _mm_shuffle_ps(c[j], c[j], _MM_SHUFFLE(3, 0, 1, 2));
+				}
+				_mm_storeu_ps(out + (i + j) * 4, c[j]);
+			}
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint8_t const * s = p + i * 4;
+			if constexpr (SWAP_RB)
+			{
+				output[i] = Color(s[2] / 255.0f, s[1] / 255.0f, s[0] / 255.0f, s[3] / 255.0f);
+			}
+			else
+			{
+				output[i] = Color(s[0] / 255.0f, s[1] / 255.0f, s[2] / 255.0f, s[3] / 255.0f);
+			}
+		}
+	}
+
+	template <bool SWAP_RB>
+	void UNorm8x4FromABGR32F(Color const * input, uint32_t num_elems, void* output)
+	{
+		float const * in = reinterpret_cast<float const *>(input);
+		uint8_t* p = static_cast<uint8_t*>(output);
+
+		uint32_t i = 0;
+#ifdef KLAYGE_SSE2_SUPPORT
+		__m128 const scale = _mm_set1_ps(255.0f);
+		__m128 const half_one = _mm_set1_ps(0.5f);
+		for (; i + 4 <= num_elems; i += 4)
+		{
+			__m128i c[4];
+			for (uint32_t j = 0; j < 4; ++ j)
+			{
+				__m128 v = _mm_loadu_ps(in + (i + j) * 4);
+				if constexpr (SWAP_RB)
+				{
+					v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+				}
+				c[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half_one));
+			}
+			// Saturating packs do the clamp to [0, 255]
+			__m128i const v = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i * 4), v);
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint8_t* d = p + i * 4;
+			if constexpr (SWAP_RB)
+			{
+				d[0] = UNormFloatToUInt8(input[i].b());
+				d[2] = UNormFloatToUInt8(input[i].r());
+			}
+			else
+			{
+				d[0] = UNormFloatToUInt8(input[i].r());
+				d[2] = UNormFloatToUInt8(input[i].b());
+			}
+			d[1] = UNormFloatToUInt8(input[i].g());
+			d[3] = UNormFloatToUInt8(input[i].a());
+		}
+	}
+
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+	template <bool SWAP_RB>
+	KLAYGE_TARGET_AVX2 void UNorm8x4ToABGR32FAvx2(void const * input, uint32_t num_elems, Color* output)
+	{
+		uint8_t const * p = static_cast<uint8_t const *>(input);
+		float* out = reinterpret_cast<float*>(output);
+
+		__m256 const scale = _mm256_set1_ps(255.0f);
+		uint32_t i = 0;
+		for (; i + 2 <= num_elems; i += 2)
+		{
+			__m256i const v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(p + i * 4)));
+			__m256 c = _mm256_div_ps(_mm256_cvtepi32_ps(v), scale);
+			if constexpr (SWAP_RB)
+			{
+				c = _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 1, 2));
+			}
+			_mm256_storeu_ps(out + i * 4, c);
+		}
+		if (i < num_elems)
+		{
+			UNorm8x4ToABGR32F<SWAP_RB>(p + i * 4, num_elems - i, output + i);
+		}
+	}
+
+	template <bool SWAP_RB>
+	KLAYGE_TARGET_AVX2 void UNorm8x4FromABGR32FAvx2(Color const * input, uint32_t num_elems, void* output)
+	{
+		float const * in = reinterpret_cast<float const *>(input);
+		uint8_t* p = static_cast<uint8_t*>(output);
+
+		__m256 const scale = _mm256_set1_ps(255.0f);
+		__m256 const half_one = _mm256_set1_ps(0.5f);
+		// After the in-lane packs, dwords are in the order of pixel 0, 2, 4, 6, 1, 3, 5, 7
+		__m256i const reorder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		uint32_t i = 0;
+		for (; i + 8 <= num_elems; i += 8)
+		{
+			__m256i c[4];
+			for (uint32_t j = 0; j < 4; ++ j)
+			{
+				__m256 v = _mm256_loadu_ps(in + (i + j * 2) * 4);
+				if constexpr (SWAP_RB)
+				{
+					v = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+				}
+				c[j] = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, scale), half_one));
+			}
+			__m256i v = _mm256_packus_epi16(_mm256_packs_epi32(c[0], c[1]), _mm256_packs_epi32(c[2], c[3]));
+			v = _mm256_permutevar8x32_epi32(v, reorder);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i * 4), v);
+		}
+		if (i < num_elems)
+		{
+			UNorm8x4FromABGR32F<SWAP_RB>(input + i, num_elems - i, p + i * 4);
+		}
+	}
+#endif
+
+	template <bool SWAP_RB>
+	void SRGB8x4ToABGR32F(void const * input, uint32_t num_elems, Color* output)
+	{
+		auto const & lut = ConversionTables::Instance().srgb8_to_linear;
+		uint8_t const * p = static_cast<uint8_t const *>(input);
+		for (uint32_t i = 0; i < num_elems; ++ i, p += 4)
+		{
+			if constexpr (SWAP_RB)
+			{
+				output[i] = Color(lut[p[2]], lut[p[1]], lut[p[0]], lut[p[3]]);
+			}
+			else
+			{
+				output[i] = Color(lut[p[0]], lut[p[1]], lut[p[2]], lut[p[3]]);
+			}
+		}
+	}
+
+	void A2BGR10ToABGR32F(void const * input, uint32_t num_elems, Color* output)
+	{
+		uint32_t const * p = static_cast<uint32_t const *>(input);
+
+		uint32_t i = 0;
+#ifdef KLAYGE_SSE2_SUPPORT
+		float* out = reinterpret_cast<float*>(output);
+		__m128i const mask = _mm_set1_epi32(0x03FF);
+		__m128 const rgb_scale = _mm_set1_ps(1023.0f);
+		__m128 const a_scale = _mm_set1_ps(3.0f);
+		for (; i + 4 <= num_elems; i += 4)
+		{
+			__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i));
+			__m128 r = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(v, mask)), rgb_scale);
+			__m128 g = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 10), mask)), rgb_scale);
+			__m128 b = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 20), mask)), rgb_scale);
+			__m128 a = _mm_div_ps(_mm_cvtepi32_ps(_mm_srli_epi32(v, 30)), a_scale);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			_mm_storeu_ps(out + (i + 0) * 4, r);
+			_mm_storeu_ps(out + (i + 1) * 4, g);
+			_mm_storeu_ps(out + (i + 2) * 4, b);
+			_mm_storeu_ps(out + (i + 3) * 4, a);
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint32_t const s = p[i];
+			output[i] = Color((s & 0x03FF) / 1023.0f, ((s >> 10) & 0x03FF) / 1023.0f,
+				((s >> 20) & 0x03FF) / 1023.0f, ((s >> 30) & 0x03) / 3.0f);
+		}
+	}
+
+	void A2BGR10FromABGR32F(Color const * input, uint32_t num_elems, void* output)
+	{
+		uint32_t* p = static_cast<uint32_t*>(output);
+
+		uint32_t i = 0;
+#ifdef KLAYGE_SSE2_SUPPORT
+		float const * in = reinterpret_cast<float const *>(input);
+		__m128 const half_one = _mm_set1_ps(0.5f);
+		// Truncates first and clamps the integers, the same as the scalar code, so out of range inputs match too
+		auto quantize = [half_one](__m128 v, float scale, int32_t max_value) {
+			__m128i const max_v = _mm_set1_epi32(max_value);
+			__m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(scale)), half_one));
+			q = _mm_andnot_si128(_mm_srai_epi32(q, 31), q);
+			__m128i const over = _mm_cmpgt_epi32(q, max_v);
+			return _mm_or_si128(_mm_and_si128(over, max_v), _mm_andnot_si128(over, q));
+		};
+		for (; i + 4 <= num_elems; i += 4)
+		{
+			__m128 r = _mm_loadu_ps(in + (i + 0) * 4);
+			__m128 g = _mm_loadu_ps(in + (i + 1) * 4);
+			__m128 b = _mm_loadu_ps(in + (i + 2) * 4);
+			__m128 a = _mm_loadu_ps(in + (i + 3) * 4);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			__m128i v = quantize(r, 1023.0f, 1023);
+			v = _mm_or_si128(v, _mm_slli_epi32(quantize(g, 1023.0f, 1023), 10));
+			v = _mm_or_si128(v, _mm_slli_epi32(quantize(b, 1023.0f, 1023), 20));
+			v = _mm_or_si128(v, _mm_slli_epi32(quantize(a, 3.0f, 3), 30));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), v);
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			int r = MathLib::clamp(static_cast<int>(input[i].r() * 1023.0f + 0.5f), 0, 1023);
+			int g = MathLib::clamp(static_cast<int>(input[i].g() * 1023.0f + 0.5f), 0, 1023);
+			int b = MathLib::clamp(static_cast<int>(input[i].b() * 1023.0f + 0.5f), 0, 1023);
+			int a = MathLib::clamp(static_cast<int>(input[i].a() * 3.0f + 0.5f), 0, 3);
+			p[i] = r | (g << 10) | (b << 20) | (a << 30);
+		}
+	}
+
+	void B10G11R11FToABGR32F(void const * input, uint32_t num_elems, Color* output)
+	{
+		auto const & tables = ConversionTables::Instance();
+		uint32_t const * p = static_cast<uint32_t const *>(input);
+		for (uint32_t i = 0; i < num_elems; ++ i)
+		{
+			// E5B5 E5G6 E5R6
+			uint32_t const s = p[i];
+			output[i] = Color(tables.float11_to_float[s & 0x07FF], tables.float11_to_float[(s >> 11) & 0x07FF],
+				tables.float10_to_float[s >> 22], 1);
+		}
+	}
+
+	// Channels other than R go through a small stack buffer, so the bulk half conversions still apply
+	uint32_t const R16F_BATCH = 256;
+
+	void R16FToABGR32F(void const * input, uint32_t num_elems, Color* output)
+	{
+		half const * p = static_cast<half const *>(input);
+
+		float r[R16F_BATCH];
+		for (uint32_t i = 0; i < num_elems; i += R16F_BATCH)
+		{
+			uint32_t const n = std::min(num_elems - i, R16F_BATCH);
+			HalfToFloat(MakeSpan(p + i, n), MakeSpan(r, n));
+			for (uint32_t j = 0; j < n; ++ j)
+			{
+				output[i + j] = Color(r[j], 0, 0, 1);
+			}
+		}
+	}
+
+	void R16FFromABGR32F(Color const * input, uint32_t num_elems, void* output)
+	{
+		half* p = static_cast<half*>(output);
+
+		float r[R16F_BATCH];
+		for (uint32_t i = 0; i < num_elems; i += R16F_BATCH)
+		{
+			uint32_t const n = std::min(num_elems - i, R16F_BATCH);
+			for (uint32_t j = 0; j < n; ++ j)
+			{
+				r[j] = input[i + j].r();
+			}
+			FloatToHalf(MakeSpan(r, n), MakeSpan(p + i, n));
+		}
+	}
+
+	void ABGR16FToABGR32F(void const * input, uint32_t num_elems, Color* output)
+	{
+		HalfToFloat(MakeSpan(static_cast<half const *>(input), num_elems * 4), MakeSpan(&output->r(), num_elems * 4));
+	}
+
+	void ABGR16FFromABGR32F(Color const * input, uint32_t num_elems, void* output)
+	{
+		FloatToHalf(MakeSpan(&input->r(), num_elems * 4), MakeSpan(static_cast<half*>(output), num_elems * 4));
+	}
+
+	// Picks the fastest kernel of a format for this CPU, nullptr means the generic per-element code
+	ToABGR32FFunc SelectToABGR32F(ElementFormat fmt)
+	{
+		[[maybe_unused]] auto const & features = CpuFeatures::Instance();
+
+		switch (fmt)
+		{
+		case EF_ARGB8:
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+			if (features.Avx2())
+			{
+				return UNorm8x4ToABGR32FAvx2<true>;
+			}
+#endif
+			return UNorm8x4ToABGR32F<true>;
+
+		case EF_ABGR8:
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+			if (features.Avx2())
+			{
+				return UNorm8x4ToABGR32FAvx2<false>;
+			}
+#endif
+			return UNorm8x4ToABGR32F<false>;
+
+		case EF_ARGB8_SRGB:
+			return SRGB8x4ToABGR32F<true>;
+
+		case EF_ABGR8_SRGB:
+			return SRGB8x4ToABGR32F<false>;
+
+		case EF_A2BGR10:
+			return A2BGR10ToABGR32F;
+
+		case EF_B10G11R11F:
+			return B10G11R11FToABGR32F;
+
+		case EF_R16F:
+			return R16FToABGR32F;
+
+		case EF_ABGR16F:
+			return ABGR16FToABGR32F;
+
+		default:
+			return nullptr;
+		}
+	}
+
+	FromABGR32FFunc SelectFromABGR32F(ElementFormat fmt)
+	{
+		[[maybe_unused]] auto const & features = CpuFeatures::Instance();
+
+		switch (fmt)
+		{
+		case EF_ARGB8:
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+			if (features.Avx2())
+			{
+				return UNorm8x4FromABGR32FAvx2<true>;
+			}
+#endif
+			return UNorm8x4FromABGR32F<true>;
+
+		case EF_ABGR8:
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+			if (features.Avx2())
+			{
+				return UNorm8x4FromABGR32FAvx2<false>;
+			}
+#endif
+			return UNorm8x4FromABGR32F<false>;
+
+		case EF_A2BGR10:
+			return A2BGR10FromABGR32F;
+
+		case EF_R16F:
+			return R16FFromABGR32F;
+
+		case EF_ABGR16F:
+			return ABGR16FFromABGR32F;
+
+		default:
+			return nullptr;
+		}
+	}
+
+	bool IsRGBA8Family(ElementFormat fmt) noexcept
+	{
+		return (EF_ARGB8 == fmt) || (EF_ABGR8 == fmt) || (EF_ARGB8_SRGB == fmt) || (EF_ABGR8_SRGB == fmt);
+	}
+
+	// Byte remapping tables between 8-bit sRGB and linear channels. They are made by the float path, so the direct
+	// conversion gives the same bytes.
+	class RGBA8RemapTables final
+	{
+	public:
+		static RGBA8RemapTables const & Instance()
+		{
+			static RGBA8RemapTables const tables;
+			return tables;
+		}
+
+		std::array<uint8_t, 256> srgb_to_linear;
+		std::array<uint8_t, 256> linear_to_srgb;
+
+	private:
+		RGBA8RemapTables()
+		{
+			for (uint32_t i = 0; i < 256; ++ i)
+			{
+				uint8_t const src[] = {static_cast<uint8_t>(i), static_cast<uint8_t>(i), static_cast<uint8_t>(i), static_cast<uint8_t>(i)};
+				uint8_t dst[4];
+				Color clr;
+
+				ConvertToABGR32F(EF_ABGR8_SRGB, src, 1, &clr);
+				ConvertFromABGR32F(EF_ABGR8, &clr, 1, dst);
+				srgb_to_linear[i] = dst[0];
+
+				ConvertToABGR32F(EF_ABGR8, src, 1, &clr);
+				ConvertFromABGR32F(EF_ABGR8_SRGB, &clr, 1, dst);
+				linear_to_srgb[i] = dst[0];
+			}
+		}
+	};
+
+	void ConvertRGBA8Family(ElementFormat src_fmt, void const * input, uint32_t num_elems, ElementFormat dst_fmt, void* output)
+	{
+		uint32_t const * src = static_cast<uint32_t const *>(input);
+		uint32_t* dst = static_cast<uint32_t*>(output);
+
+		bool const swap_rb = ((EF_ARGB8 == src_fmt) || (EF_ARGB8_SRGB == src_fmt)) != ((EF_ARGB8 == dst_fmt) || (EF_ARGB8_SRGB == dst_fmt));
+		uint8_t const * remap = nullptr;
+		if (IsSRGB(src_fmt) != IsSRGB(dst_fmt))
+		{
+			auto const & tables = RGBA8RemapTables::Instance();
+			remap = IsSRGB(src_fmt) ? tables.srgb_to_linear.data() : tables.linear_to_srgb.data();
+		}
+
+		uint32_t i = 0;
+#ifdef KLAYGE_SSE2_SUPPORT
+		if (!remap)
+		{
+			__m128i const ga_mask = _mm_set1_epi32(0xFF00FF00U);
+			__m128i const rb_mask = _mm_set1_epi32(0x000000FFU);
+			for (; i + 4 <= num_elems; i += 4)
+			{
+				__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+				__m128i const swapped = _mm_or_si128(_mm_and_si128(v, ga_mask),
+					_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), rb_mask), _mm_slli_epi32(_mm_and_si128(v, rb_mask), 16)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), swap_rb ? swapped : v);
+			}
+		}
+#endif
+		for (; i < num_elems; ++ i)
+		{
+			uint32_t v = src[i];
+			if (swap_rb)
+			{
+				v = (v & 0xFF00FF00U) | ((v >> 16) & 0xFFU) | ((v & 0xFFU) << 16);
+			}
+			if (remap)
+			{
+				v = remap[v & 0xFF] | (remap[(v >> 8) & 0xFF] << 8) | (remap[(v >> 16) & 0xFF] << 16) | (remap[v >> 24] << 24);
+			}
+			dst[i] = v;
+		}
+	}
+}
+
 namespace KlayGE
 {
 	void ConvertToABGR32F(ElementFormat fmt, void const * input, uint32_t num_elems, Color* output)
 	{
+		if (auto const kernel = SelectToABGR32F(fmt))
+		{
+			kernel(input, num_elems, output);
+			return;
+		}
+
 		uint8_t const * p = static_cast<uint8_t const *>(input);
 		uint32_t const elem_size = NumFormatBytes(fmt);
 
@@ -114,20 +687,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_ARGB8:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				*output = Color(p[2] / 255.0f, p[1] / 255.0f, p[0] / 255.0f, p[3] / 255.0f);
-			}
-			break;
-
-		case EF_ABGR8:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				*output = Color(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f);
-			}
-			break;
-
 		case EF_SIGNED_ABGR8:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
@@ -136,15 +695,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_A2BGR10:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				uint32_t const s = *reinterpret_cast<uint32_t const *>(p);
-				*output = Color((s & 0x03FF) / 1023.0f, ((s >> 10) & 0x03FF) / 1023.0f,
-					((s >> 20) & 0x03FF) / 1023.0f, ((s >> 30) & 0x03) / 3.0f);
-			}
-			break;
-
 		case EF_SIGNED_A2BGR10:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
@@ -544,14 +1094,6 @@ namespace KlayGE
 			break;
 
 
-		case EF_R16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				half const s = *reinterpret_cast<half const *>(p);
-				*output = Color(s, 0, 0, 1);
-			}
-			break;
-
 		case EF_GR16F:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
@@ -560,94 +1102,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_B10G11R11F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				// E5B5 E5G6 E5R6
-				uint32_t const s = *reinterpret_cast<uint32_t const *>(p);
-
-				int32_t result[4];
-				uint32_t mantissa;
-				uint32_t exponent;
-
-				for (int j = 0; j < 2; ++ j)
-				{
-					// X & Y Channel (6-bit mantissa)
-					mantissa = (s >> (j * 11)) & 0x3F;
-					exponent = (s >> (j * 11 + 6)) & 0x1F;
-
-					if (0x1F == exponent) // INF or NAN
-					{
-						result[0] = 0x7F800000 | (mantissa << 17);
-					}
-					else
-					{
-						if (0 == exponent)
-						{
-							if (mantissa != 0)
-							{
-								// The value is denormalized
-
-								// Normalize the value in the resulting float
-								exponent = 1;
-
-								do
-								{
-									-- exponent;
-									mantissa <<= 1;
-								} while (0 == (mantissa & 0x40));
-
-								mantissa &= 0x3F;
-							}
-							else
-							{
-								// The value is zero
-
-								exponent = static_cast<uint32_t>(-112);
-							}
-						}
-
-						result[j] = ((exponent + 112) << 23) | (mantissa << 17);
-					}
-				}
-
-				// Z Channel (5-bit mantissa)
-				mantissa = (s >> 22) & 0x3F;
-				exponent = (s >> 27) & 0x1F;
-
-				if (0x1F == exponent) // INF or NAN
-				{
-					result[2] = 0x7F800000 | (mantissa << 17);
-				}
-				else
-				{
-					if (0 == exponent)
-					{
-						if (mantissa != 0)
-						{
-							exponent = 1;
-	
-							do
-							{
-								-- exponent;
-								mantissa <<= 1;
-							} while (0 == (mantissa & 0x20));
-	
-							mantissa &= 0x1F;
-						}
-						else
-						{
-							exponent = static_cast<uint32_t>(-112);
-						}
-					}
-
-					result[2] = ((exponent + 112) << 23) | (mantissa << 18);
-				}
-
-				*output = Color(std::bit_cast<float>(result[0]), std::bit_cast<float>(result[1]), std::bit_cast<float>(result[2]), 1);
-			}
-			break;
-
 		case EF_BGR16F:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
@@ -656,14 +1110,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_ABGR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				half const * s = reinterpret_cast<half const *>(p);
-				*output = Color(s[0], s[1], s[2], s[3]);
-			}
-			break;
-
 		case EF_R32F:
 			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
 			{
@@ -722,26 +1168,6 @@ namespace KlayGE
 			break;
 
 
-		case EF_ARGB8_SRGB:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				*output = Color(MathLib::srgb_to_linear(p[2] / 255.0f),
-					MathLib::srgb_to_linear(p[1] / 255.0f),
-					MathLib::srgb_to_linear(p[0] / 255.0f),
-					MathLib::srgb_to_linear(p[3] / 255.0f));
-			}
-			break;
-
-		case EF_ABGR8_SRGB:
-			for (uint32_t i = 0; i < num_elems; ++ i, p += elem_size, ++ output)
-			{
-				*output = Color(MathLib::srgb_to_linear(p[0] / 255.0f),
-					MathLib::srgb_to_linear(p[1] / 255.0f),
-					MathLib::srgb_to_linear(p[2] / 255.0f),
-					MathLib::srgb_to_linear(p[3] / 255.0f));
-			}
-			break;
-
 		default:
 			KFL_UNREACHABLE("Not supported element format");
 		}
@@ -749,6 +1175,12 @@ namespace KlayGE
 
 	void ConvertFromABGR32F(ElementFormat fmt, Color const * input, uint32_t num_elems, void* output)
 	{
+		if (auto const kernel = SelectFromABGR32F(fmt))
+		{
+			kernel(input, num_elems, output);
+			return;
+		}
+
 		uint8_t* p = static_cast<uint8_t*>(output);
 		uint32_t const elem_size = NumFormatBytes(fmt);
 
@@ -837,26 +1269,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_ARGB8:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				p[0] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->b() * 255.0f + 0.5f), 0, 255));
-				p[1] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->g() * 255.0f + 0.5f), 0, 255));
-				p[2] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->r() * 255.0f + 0.5f), 0, 255));
-				p[3] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->a() * 255.0f + 0.5f), 0, 255));
-			}
-			break;
-
-		case EF_ABGR8:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				p[0] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->r() * 255.0f + 0.5f), 0, 255));
-				p[1] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->g() * 255.0f + 0.5f), 0, 255));
-				p[2] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->b() * 255.0f + 0.5f), 0, 255));
-				p[3] = static_cast<uint8_t>(MathLib::clamp(static_cast<int>(input->a() * 255.0f + 0.5f), 0, 255));
-			}
-			break;
-
 		case EF_SIGNED_ABGR8:
 			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
 			{
@@ -867,18 +1279,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_A2BGR10:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				int r = MathLib::clamp(static_cast<int>(input->r() * 1023.0f + 0.5f), 0, 1023);
-				int g = MathLib::clamp(static_cast<int>(input->g() * 1023.0f + 0.5f), 0, 1023);
-				int b = MathLib::clamp(static_cast<int>(input->b() * 1023.0f + 0.5f), 0, 1023);
-				int a = MathLib::clamp(static_cast<int>(input->a() * 3.0f + 0.5f), 0, 3);
-
-				*reinterpret_cast<uint32_t*>(p) = r | (g << 10) | (b << 20) | (a << 30);
-			}
-			break;
-
 		case EF_SIGNED_A2BGR10:
 			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
 			{
@@ -1314,14 +1714,6 @@ namespace KlayGE
 			break;
 
 
-		case EF_R16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				half* s = reinterpret_cast<half*>(p);
-				*s = half(input->r());
-			}
-			break;
-
 		case EF_GR16F:
 			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
 			{
@@ -1454,17 +1846,6 @@ namespace KlayGE
 			}
 			break;
 
-		case EF_ABGR16F:
-			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
-			{
-				half* s = reinterpret_cast<half*>(p);
-				s[0] = half(input->r());
-				s[1] = half(input->g());
-				s[2] = half(input->b());
-				s[3] = half(input->a());
-			}
-			break;
-
 		case EF_R32F:
 			for (uint32_t i = 0; i < num_elems; ++ i, ++ input, p += elem_size)
 			{
@@ -1553,4 +1934,33 @@ namespace KlayGE
 			KFL_UNREACHABLE("Not supported element format");
 		}
 	}
+
+	void ConvertFormat(ElementFormat src_fmt, void const * input, uint32_t num_elems, ElementFormat dst_fmt, void* output)
+	{
+		if (src_fmt == dst_fmt)
+		{
+			// In place conversions overlap
+			std::memmove(output, input, num_elems * NumFormatBytes(src_fmt));
+		}
+		else if (IsRGBA8Family(src_fmt) && IsRGBA8Family(dst_fmt))
+		{
+			ConvertRGBA8Family(src_fmt, input, num_elems, dst_fmt, output);
+		}
+		else
+		{
+			uint32_t const CHUNK_SIZE = 256;
+			Color colors[CHUNK_SIZE];
+
+			uint8_t const * src = static_cast<uint8_t const *>(input);
+			uint8_t* dst = static_cast<uint8_t*>(output);
+			uint32_t const src_elem_size = NumFormatBytes(src_fmt);
+			uint32_t const dst_elem_size = NumFormatBytes(dst_fmt);
+			for (uint32_t i = 0; i < num_elems; i += CHUNK_SIZE)
+			{
+				uint32_t const n = std::min(num_elems - i, CHUNK_SIZE);
+				ConvertToABGR32F(src_fmt, src + i * src_elem_size, n, colors);
+				ConvertFromABGR32F(dst_fmt, colors, n, dst + i * dst_elem_size);
+			}
+		}
+	}
 }
@@ -178,7 +178,8 @@ namespace KlayGE
 
 	void GpuFftPS::CreateButterflyLookups(std::vector<half>& lookup_i_wr_wi, int log_n, int n)
 	{
-		half* ptr = &lookup_i_wr_wi[0];
+		std::vector<float> lookup_f32(lookup_i_wr_wi.size());
+		float* ptr = lookup_f32.data();
 
 		for (int i = 0; i < log_n; ++ i)
 		{
@@ -205,20 +206,22 @@ namespace KlayGE
 					float wr, wi;
 					this->ComputeWeight(wr, wi, n, k * blocks);
 
-					ptr[i1 * 4 + 0] = half((j1 + 0.5f) / n);
-					ptr[i1 * 4 + 1] = half((j2 + 0.5f) / n);
-					ptr[i1 * 4 + 2] = half(+wr);
-					ptr[i1 * 4 + 3] = half(+wi);
+					ptr[i1 * 4 + 0] = (j1 + 0.5f) / n;
+					ptr[i1 * 4 + 1] = (j2 + 0.5f) / n;
+					ptr[i1 * 4 + 2] = +wr;
+					ptr[i1 * 4 + 3] = +wi;
 
-					ptr[i2 * 4 + 0] = half((j1 + 0.5f) / n);
-					ptr[i2 * 4 + 1] = half((j2 + 0.5f) / n);
-					ptr[i2 * 4 + 2] = half(-wr);
-					ptr[i2 * 4 + 3] = half(-wi);
+					ptr[i2 * 4 + 0] = (j1 + 0.5f) / n;
+					ptr[i2 * 4 + 1] = (j2 + 0.5f) / n;
+					ptr[i2 * 4 + 2] = -wr;
+					ptr[i2 * 4 + 3] = -wi;
 				}
 			}
 
 			ptr += n * 4;
 		}
+
+		FloatToHalf(lookup_f32, lookup_i_wr_wi);
 	}
 	
 
@@ -301,16 +304,16 @@ namespace KlayGE
 		uint32_t pstride = width_;
 		float phase_base = -PI2 / (width_ * height_);
 
-		*(effect_->ParameterByName("thread_count")) = thread_count;
+		*(effect_->ParameterByName(EFFECT_HANDLE("thread_count"))) = thread_count;
 
 		// X direction
 		
-		*(effect_->ParameterByName("ostride")) = ostride;
-		*(effect_->ParameterByName("pstride")) = pstride;
+		*(effect_->ParameterByName(EFFECT_HANDLE("ostride"))) = ostride;
+		*(effect_->ParameterByName(EFFECT_HANDLE("pstride"))) = pstride;
 
-		*(effect_->ParameterByName("istride")) = istride;
-		*(effect_->ParameterByName("istride3")) = uint2(0, istride3);
-		*(effect_->ParameterByName("phase_base")) = phase_base;
+		*(effect_->ParameterByName(EFFECT_HANDLE("istride"))) = istride;
+		*(effect_->ParameterByName(EFFECT_HANDLE("istride3"))) = uint2(0, istride3);
+		*(effect_->ParameterByName(EFFECT_HANDLE("phase_base"))) = phase_base;
 		this->Radix008A(tmp_buffer_uav_, src_srv_, thread_count, istride, true);
 
 		ShaderResourceViewPtr srvs[2] = { dst_srv_, tmp_buffer_srv_ };
@@ -323,9 +326,9 @@ namespace KlayGE
 			istride /= 8;
 			istride3 /= 8;
 			phase_base *= 8.0f;
-			*(effect_->ParameterByName("istride")) = istride;
-			*(effect_->ParameterByName("istride3")) = uint2(0, istride3);
-			*(effect_->ParameterByName("phase_base")) = phase_base;
+			*(effect_->ParameterByName(EFFECT_HANDLE("istride"))) = istride;
+			*(effect_->ParameterByName(EFFECT_HANDLE("istride3"))) = uint2(0, istride3);
+			*(effect_->ParameterByName(EFFECT_HANDLE("phase_base"))) = phase_base;
 			this->Radix008A(uavs[index], srvs[!index], thread_count, istride, false);
 			index = !index;
 
@@ -336,15 +339,15 @@ namespace KlayGE
 		
 		ostride = height_ / 8;
 		pstride = 1;
-		*(effect_->ParameterByName("ostride")) = ostride;
-		*(effect_->ParameterByName("pstride")) = pstride;
+		*(effect_->ParameterByName(EFFECT_HANDLE("ostride"))) = ostride;
+		*(effect_->ParameterByName(EFFECT_HANDLE("pstride"))) = pstride;
 
 		istride /= 8;
 		istride3 /= 8;
 		phase_base *= 8.0f;
-		*(effect_->ParameterByName("istride")) = istride;
-		*(effect_->ParameterByName("istride3")) = uint2(istride3, 0);
-		*(effect_->ParameterByName("phase_base")) = phase_base;
+		*(effect_->ParameterByName(EFFECT_HANDLE("istride"))) = istride;
+		*(effect_->ParameterByName(EFFECT_HANDLE("istride3"))) = uint2(istride3, 0);
+		*(effect_->ParameterByName(EFFECT_HANDLE("phase_base"))) = phase_base;
 		this->Radix008A(uavs[index], srvs[!index], thread_count, istride, false);
 		index = !index;
 
@@ -354,9 +357,9 @@ namespace KlayGE
 			istride /= 8;
 			istride3 /= 8;
 			phase_base *= 8.0f;
-			*(effect_->ParameterByName("istride")) = istride;
-			*(effect_->ParameterByName("istride3")) = uint2(istride3, 0);
-			*(effect_->ParameterByName("phase_base")) = phase_base;
+			*(effect_->ParameterByName(EFFECT_HANDLE("istride"))) = istride;
+			*(effect_->ParameterByName(EFFECT_HANDLE("istride3"))) = uint2(istride3, 0);
+			*(effect_->ParameterByName(EFFECT_HANDLE("phase_base"))) = phase_base;
 			this->Radix008A(uavs[index], srvs[!index], thread_count, istride, false);
 			index = !index;
 
@@ -379,8 +382,8 @@ namespace KlayGE
 		uint32_t grid = (thread_count + COHERENCY_GRANULARITY - 1) / COHERENCY_GRANULARITY;
 
 		// Buffers
-		*(effect_->ParameterByName("src_data")) = src;
-		*(effect_->ParameterByName("dst_data")) = dst;
+		*(effect_->ParameterByName(EFFECT_HANDLE("src_data"))) = src;
+		*(effect_->ParameterByName(EFFECT_HANDLE("dst_data"))) = dst;
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine& re = rf.RenderEngineInstance();
@@ -446,11 +449,11 @@ namespace KlayGE
 			uint32_t istride = width_ / 8;
 			float phase_base = -PI2 / width_;
 
-			*(effect_->ParameterByName("ostride2")) = uint2(width_ / 8, 0);
-			*(effect_->ParameterByName("iscale2")) = uint2(8, 1);
+			*(effect_->ParameterByName(EFFECT_HANDLE("ostride2"))) = uint2(width_ / 8, 0);
+			*(effect_->ParameterByName(EFFECT_HANDLE("iscale2"))) = uint2(8, 1);
 
-			*(effect_->ParameterByName("istride2")) = uint4(istride, 0, istride - 1, static_cast<uint32_t>(-1));
-			*(effect_->ParameterByName("phase_base2")) = phase_base;
+			*(effect_->ParameterByName(EFFECT_HANDLE("istride2"))) = uint4(istride, 0, istride - 1, static_cast<uint32_t>(-1));
+			*(effect_->ParameterByName(EFFECT_HANDLE("phase_base2"))) = phase_base;
 			this->Radix008A(tmp_real_tex_[index], tmp_imag_tex_[index], in_real, in_imag, width_ / 8, height_, 1 == istride, false);
 			index = !index;
 
@@ -459,8 +462,8 @@ namespace KlayGE
 			{
 				istride /= 8;
 				phase_base *= 8;
-				*(effect_->ParameterByName("istride2")) = uint4(istride, 0, istride - 1, static_cast<uint32_t>(-1));
-				*(effect_->ParameterByName("phase_base2")) = phase_base;
+				*(effect_->ParameterByName(EFFECT_HANDLE("istride2"))) = uint4(istride, 0, istride - 1, static_cast<uint32_t>(-1));
+				*(effect_->ParameterByName(EFFECT_HANDLE("phase_base2"))) = phase_base;
 				this->Radix008A(tmp_real_tex_[index], tmp_imag_tex_[index], tmp_real_srv_[!index], tmp_imag_srv_[!index], width_ / 8, height_, 1 == istride, false);
 				index = !index;
 
@@ -474,11 +477,11 @@ namespace KlayGE
 			uint32_t istride = height_ / 8;
 			float phase_base = -PI2 / height_;
 
-			*(effect_->ParameterByName("ostride2")) = uint2(0, height_ / 8);
-			*(effect_->ParameterByName("iscale2")) = uint2(1, 8);
+			*(effect_->ParameterByName(EFFECT_HANDLE("ostride2"))) = uint2(0, height_ / 8);
+			*(effect_->ParameterByName(EFFECT_HANDLE("iscale2"))) = uint2(1, 8);
 
-			*(effect_->ParameterByName("istride2")) = uint4(0, istride, static_cast<uint32_t>(-1), istride - 1);
-			*(effect_->ParameterByName("phase_base2")) = phase_base;
+			*(effect_->ParameterByName(EFFECT_HANDLE("istride2"))) = uint4(0, istride, static_cast<uint32_t>(-1), istride - 1);
+			*(effect_->ParameterByName(EFFECT_HANDLE("phase_base2"))) = phase_base;
 			if (1 == istride)
 			{
 				this->Radix008A(out_real, out_imag, tmp_real_srv_[!index], tmp_imag_srv_[!index], width_, height_ / 8, false, 1 == istride);
@@ -494,8 +497,8 @@ namespace KlayGE
 			{
 				istride /= 8;
 				phase_base *= 8;
-				*(effect_->ParameterByName("istride2")) = uint4(0, istride, static_cast<uint32_t>(-1), istride - 1);
-				*(effect_->ParameterByName("phase_base2")) = phase_base;
+				*(effect_->ParameterByName(EFFECT_HANDLE("istride2"))) = uint4(0, istride, static_cast<uint32_t>(-1), istride - 1);
+				*(effect_->ParameterByName(EFFECT_HANDLE("phase_base2"))) = phase_base;
 				if (1 == istride)
 				{
 					this->Radix008A(out_real, out_imag, tmp_real_srv_[!index], tmp_imag_srv_[!index], width_, height_ / 8, false, 1 == istride);
@@ -521,10 +524,10 @@ namespace KlayGE
 		uint32_t grid_y = (thread_y + BLOCK_SIZE_Y - 1) / BLOCK_SIZE_Y;
 
 		// Buffers
-		*(effect_->ParameterByName("src_real_tex")) = src_real_srv;
-		*(effect_->ParameterByName("src_imag_tex")) = src_imag_srv;
-		*(effect_->ParameterByName("dst_real_tex")) = dst_real_tex;
-		*(effect_->ParameterByName("dst_imag_tex")) = dst_imag_tex;
+		*(effect_->ParameterByName(EFFECT_HANDLE("src_real_tex"))) = src_real_srv;
+		*(effect_->ParameterByName(EFFECT_HANDLE("src_imag_tex"))) = src_imag_srv;
+		*(effect_->ParameterByName(EFFECT_HANDLE("dst_real_tex"))) = dst_real_tex;
+		*(effect_->ParameterByName(EFFECT_HANDLE("dst_imag_tex"))) = dst_imag_tex;
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine& re = rf.RenderEngineInstance();
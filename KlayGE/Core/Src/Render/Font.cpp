@@ -125,11 +125,11 @@ namespace KlayGE
 		{
 			if (three_dim_)
 			{
-				return effect_->TechniqueByName("Font3DTec");
+				return effect_->TechniqueByName(EFFECT_HANDLE("Font3DTec"));
 			}
 			else
 			{
-				return effect_->TechniqueByName("Font2DTec");
+				return effect_->TechniqueByName(EFFECT_HANDLE("Font2DTec"));
 			}
 		}
 
@@ -154,7 +154,7 @@ namespace KlayGE
 
 		void OnRenderEnd() override
 		{
-			pos_aabb_ = AABBox(float3(0, 0, 0), float3(0, 0, 0));
+			this->PosBound(AABBox(float3(0, 0, 0), float3(0, 0, 0)));
 
 			tb_vb_sub_allocs_.clear();
 			tb_ib_sub_allocs_.clear();
@@ -193,12 +193,6 @@ namespace KlayGE
 				re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rls_[0]);
 			}
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				tb_vb_->Dealloc(tb_vb_sub_allocs_[i]);
-				tb_ib_->Dealloc(tb_ib_sub_allocs_[i]);
-			}
-
 			this->OnRenderEnd();
 		}
 
@@ -405,7 +399,7 @@ namespace KlayGE
 				BOOST_ASSERT(last_index + 3 <= 0xFFFF);
 				tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
 
-				pos_aabb_ |= AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
+				this->PosBound(pos_aabb_ | AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f)));
 			}
 		}
 
@@ -514,7 +508,7 @@ namespace KlayGE
 			}
 			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
 
-			pos_aabb_ |= AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
+			this->PosBound(pos_aabb_ | AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f)));
 		}
 
 		// ʹLRU㷨
@@ -785,6 +779,15 @@ namespace
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, HashValue(font_desc_.res_name));
+			HashCombine(seed, font_desc_.flag);
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
@@ -872,9 +875,8 @@ namespace KlayGE
 	{
 		if (!text.empty())
 		{
-			auto font_node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(font_renderable_), fsn_attrib_);
 			font_renderable_->AddText2D(x, y, z, xScale, yScale, clr, text, font_size);
-			Context::Instance().SceneManagerInstance().OverlayRootNode().AddChild(font_node);
+			this->AttachOverlayNode();
 		}
 	}
 
@@ -886,9 +888,8 @@ namespace KlayGE
 	{
 		if (!text.empty())
 		{
-			auto font_node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(font_renderable_), fsn_attrib_);
 			font_renderable_->AddText2D(rc, z, xScale, yScale, clr, text, font_size, align);
-			Context::Instance().SceneManagerInstance().OverlayRootNode().AddChild(font_node);
+			this->AttachOverlayNode();
 		}
 	}
 
@@ -904,6 +905,18 @@ namespace KlayGE
 		}
 	}
 
+	void Font::AttachOverlayNode()
+	{
+		if (!overlay_node_)
+		{
+			overlay_node_ = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(font_renderable_), fsn_attrib_);
+		}
+		if (overlay_node_->Parent() == nullptr)
+		{
+			Context::Instance().SceneManagerInstance().OverlayRootNode().AddChild(overlay_node_);
+		}
+	}
+
 
 	FontPtr SyncLoadFont(std::string_view font_name, uint32_t flags)
 	{
@@ -95,7 +95,7 @@ namespace KlayGE
 		re.BindFrameBuffer(re.DefaultFrameBuffer());
 		re.DefaultFrameBuffer()->Discard(FrameBuffer::CBM_Color);
 
-		*(effect_->ParameterByName("dst_tex_dim")) = int2(64, 64);
+		*(effect_->ParameterByName(EFFECT_HANDLE("dst_tex_dim"))) = int2(64, 64);
 
 		this->OnRenderBegin();
 		re.Dispatch(*effect_, *technique_, 2, 2, 1);
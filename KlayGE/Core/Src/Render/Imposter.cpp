@@ -134,6 +134,14 @@ namespace KlayGE
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, HashValue(imposter_desc_.res_name));
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
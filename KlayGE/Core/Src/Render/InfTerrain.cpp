@@ -120,7 +120,7 @@ namespace KlayGE
 		}
 		else
 		{
-			*(effect_->ParameterByName("mvp")) = camera.ViewProjMatrix();
+			*(effect_->ParameterByName(EFFECT_HANDLE("mvp"))) = camera.ViewProjMatrix();
 		}
 
 		float3 look_at_vec = float3(camera.LookAt().x() - camera.EyePos().x(), 0, camera.LookAt().z() - camera.EyePos().z());
@@ -131,8 +131,8 @@ namespace KlayGE
 		float4x4 virtual_view = MathLib::look_at_lh(camera.EyePos(), camera.EyePos() + look_at_vec);
 		float4x4 inv_virtual_view = MathLib::inverse(virtual_view);
 
-		*(effect_->ParameterByName("inv_virtual_view")) = inv_virtual_view;
-		*(effect_->ParameterByName("culling_eye_pos")) = camera.EyePos();
+		*(effect_->ParameterByName(EFFECT_HANDLE("inv_virtual_view"))) = inv_virtual_view;
+		*(effect_->ParameterByName(EFFECT_HANDLE("culling_eye_pos"))) = camera.EyePos();
 	}
 
 
@@ -79,10 +79,10 @@ namespace KlayGE
 		App3DFramework const & app = Context::Instance().AppInstance();
 		Camera const & camera = app.ActiveCamera();
 			
-		*(effect_->ParameterByName("eye_pos")) = camera.EyePos();
+		*(effect_->ParameterByName(EFFECT_HANDLE("eye_pos"))) = camera.EyePos();
 
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
-		*(effect_->ParameterByName("scale")) = static_cast<float>(re.CurFrameBuffer()->Width()) / re.CurFrameBuffer()->Height();
+		*(effect_->ParameterByName(EFFECT_HANDLE("scale"))) = static_cast<float>(re.CurFrameBuffer()->Width()) / re.CurFrameBuffer()->Height();
 	}
 
 
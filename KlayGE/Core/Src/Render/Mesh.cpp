@@ -24,6 +24,8 @@
 #include <KFL/CXX20/span.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/Thread.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/Texture.hpp>
@@ -40,6 +42,7 @@
 #include <KlayGE/SceneManager.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <sstream>
 #include <cstring>
@@ -50,7 +53,206 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const MODEL_BIN_VERSION = 19;
+	uint32_t const MODEL_BIN_VERSION = 20;
+	uint32_t const LEGACY_MODEL_BIN_VERSION = 19;
+
+	// Since v20, a .model_bin is a table of independently stored chunks. Vertex and index streams are kept raw and
+	// aligned, so they can be read straight into buffers. The scene description and key frames are LZMA compressed.
+	uint32_t const MODEL_CHUNK_ALIGNMENT = 16;
+
+	uint32_t const MODEL_CHUNK_SCENE = MakeFourCC<'S', 'C', 'N', 'E'>::value;
+	uint32_t const MODEL_CHUNK_VERTICES = MakeFourCC<'V', 'E', 'R', 'T'>::value;
+	uint32_t const MODEL_CHUNK_INDICES = MakeFourCC<'I', 'N', 'D', 'X'>::value;
+	uint32_t const MODEL_CHUNK_KEY_FRAMES = MakeFourCC<'K', 'F', 'R', 'M'>::value;
+
+	enum ModelChunkFlags : uint16_t
+	{
+		MCF_LZMA = 1U << 0
+	};
+
+	struct ModelChunkDesc
+	{
+		uint32_t type;
+		uint16_t index;
+		uint16_t flags;
+		uint64_t offset;
+		uint64_t original_len;
+		uint64_t len;
+	};
+	static_assert(sizeof(ModelChunkDesc) == 32);
+
+	std::vector<ModelChunkDesc> ReadModelChunkTable(ResIdentifier& file)
+	{
+		uint32_t num_chunks;
+		file.read(&num_chunks, sizeof(num_chunks));
+		num_chunks = LE2Native(num_chunks);
+
+		std::vector<ModelChunkDesc> chunks(num_chunks);
+		file.read(chunks.data(), chunks.size() * sizeof(chunks[0]));
+		for (auto& chunk : chunks)
+		{
+			chunk.type = LE2Native(chunk.type);
+			chunk.index = LE2Native(chunk.index);
+			chunk.flags = LE2Native(chunk.flags);
+			chunk.offset = LE2Native(chunk.offset);
+			chunk.original_len = LE2Native(chunk.original_len);
+			chunk.len = LE2Native(chunk.len);
+		}
+		return chunks;
+	}
+
+	ModelChunkDesc const * FindModelChunk(std::vector<ModelChunkDesc> const & chunks, uint32_t type, uint16_t index)
+	{
+		for (auto const & chunk : chunks)
+		{
+			if ((chunk.type == type) && (chunk.index == index))
+			{
+				return &chunk;
+			}
+		}
+		return nullptr;
+	}
+
+	void DecodeModelChunk(ModelChunkDesc const & chunk, std::span<uint8_t const> data, void* output)
+	{
+		if (chunk.flags & MCF_LZMA)
+		{
+			LZMACodec lzma;
+			lzma.Decode(output, data, chunk.original_len);
+		}
+		else
+		{
+			BOOST_ASSERT(data.size() == chunk.original_len);
+			std::memcpy(output, data.data(), data.size());
+		}
+	}
+
+	void ReadModelChunk(ResIdentifier& file, ModelChunkDesc const & chunk, void* output)
+	{
+		file.seekg(chunk.offset, std::ios_base::beg);
+		if (chunk.flags & MCF_LZMA)
+		{
+			std::vector<uint8_t> data(static_cast<size_t>(chunk.len));
+			file.read(data.data(), data.size());
+			DecodeModelChunk(chunk, data, output);
+		}
+		else
+		{
+			// Raw chunks land in the destination without any intermediate copy
+			file.read(output, static_cast<size_t>(chunk.original_len));
+		}
+	}
+
+	std::shared_ptr<std::vector<KeyFrameSet>> ReadKeyFrames(ResIdentifier& decoded, uint32_t num_kfs, uint32_t num_joints)
+	{
+		auto kfs = MakeSharedPtr<std::vector<KeyFrameSet>>(num_joints);
+		for (uint32_t kf_index = 0; kf_index < num_kfs; ++ kf_index)
+		{
+			uint32_t joint_index = kf_index;
+
+			uint32_t num_kf;
+			decoded.read(&num_kf, sizeof(num_kf));
+			num_kf = LE2Native(num_kf);
+
+			KeyFrameSet kf;
+			kf.frame_id.resize(num_kf);
+			kf.bind_real.resize(num_kf);
+			kf.bind_dual.resize(num_kf);
+			kf.bind_scale.resize(num_kf);
+			for (uint32_t k_index = 0; k_index < num_kf; ++ k_index)
+			{
+				decoded.read(&kf.frame_id[k_index], sizeof(kf.frame_id[k_index]));
+				kf.frame_id[k_index] = LE2Native(kf.frame_id[k_index]);
+				decoded.read(&kf.bind_real[k_index], sizeof(kf.bind_real[k_index]));
+				kf.bind_real[k_index][0] = LE2Native(kf.bind_real[k_index][0]);
+				kf.bind_real[k_index][1] = LE2Native(kf.bind_real[k_index][1]);
+				kf.bind_real[k_index][2] = LE2Native(kf.bind_real[k_index][2]);
+				kf.bind_real[k_index][3] = LE2Native(kf.bind_real[k_index][3]);
+				decoded.read(&kf.bind_dual[k_index], sizeof(kf.bind_dual[k_index]));
+				kf.bind_dual[k_index][0] = LE2Native(kf.bind_dual[k_index][0]);
+				kf.bind_dual[k_index][1] = LE2Native(kf.bind_dual[k_index][1]);
+				kf.bind_dual[k_index][2] = LE2Native(kf.bind_dual[k_index][2]);
+				kf.bind_dual[k_index][3] = LE2Native(kf.bind_dual[k_index][3]);
+
+				float flip = MathLib::SignBit(kf.bind_real[k_index].w());
+
+				kf.bind_scale[k_index] = MathLib::length(kf.bind_real[k_index]);
+				kf.bind_real[k_index] /= kf.bind_scale[k_index];
+
+				kf.bind_scale[k_index] *= flip;
+			}
+
+			if (joint_index < num_joints)
+			{
+				(*kfs)[joint_index] = kf;
+			}
+		}
+
+		return kfs;
+	}
+
+	std::shared_ptr<std::vector<Animation>> ReadAnimations(ResIdentifier& decoded, uint32_t num_animations)
+	{
+		std::shared_ptr<std::vector<Animation>> animations;
+		if (num_animations > 0)
+		{
+			animations = MakeSharedPtr<std::vector<Animation>>(num_animations);
+			for (uint32_t animation_index = 0; animation_index < num_animations; ++animation_index)
+			{
+				Animation animation;
+				animation.name = ReadShortString(decoded);
+				decoded.read(&animation.start_frame, sizeof(animation.start_frame));
+				animation.start_frame = LE2Native(animation.start_frame);
+				decoded.read(&animation.end_frame, sizeof(animation.end_frame));
+				animation.end_frame = LE2Native(animation.end_frame);
+				(*animations)[animation_index] = animation;
+			}
+		}
+
+		return animations;
+	}
+
+	// Holds the still encoded key frame chunk until a SkinnedModel, or any of its clones, needs it
+	class DelayedKeyFrames final : boost::noncopyable
+	{
+	public:
+		DelayedKeyFrames(std::string_view res_name, ModelChunkDesc const & chunk, std::vector<uint8_t> data,
+			uint32_t num_kfs, uint32_t num_joints, uint32_t num_animations)
+			: res_name_(res_name), chunk_(chunk), data_(std::move(data)),
+				num_kfs_(num_kfs), num_joints_(num_joints), num_animations_(num_animations)
+		{
+		}
+
+		void Load(std::shared_ptr<std::vector<KeyFrameSet>>& kfs, std::shared_ptr<std::vector<Animation>>& animations)
+		{
+			std::call_once(decoded_flag_, [this]
+				{
+					std::string decoded_data(static_cast<size_t>(chunk_.original_len), '\0');
+					DecodeModelChunk(chunk_, data_, decoded_data.data());
+					data_.clear();
+					data_.shrink_to_fit();
+
+					ResIdentifier decoded(res_name_, 0, MakeSharedPtr<std::stringstream>(decoded_data));
+					kfs_ = ReadKeyFrames(decoded, num_kfs_, num_joints_);
+					animations_ = ReadAnimations(decoded, num_animations_);
+				});
+
+			kfs = kfs_;
+			animations = animations_;
+		}
+
+	private:
+		std::string const res_name_;
+		ModelChunkDesc const chunk_;
+		std::vector<uint8_t> data_;
+		uint32_t const num_kfs_;
+		uint32_t const num_joints_;
+		uint32_t const num_animations_;
+
+		std::once_flag decoded_flag_;
+		std::shared_ptr<std::vector<KeyFrameSet>> kfs_;
+		std::shared_ptr<std::vector<Animation>> animations_;
+	};
 
 	class RenderModelLoadingDesc : public ResLoadingDesc
 	{
@@ -141,6 +343,15 @@ namespace
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, HashValue(model_desc_.res_name));
+			HashCombine(seed, model_desc_.access_hint);
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
@@ -340,6 +551,36 @@ namespace
 		ModelDesc model_desc_;
 		std::mutex main_thread_stage_mutex_;
 	};
+
+	// Moller-Trumbore. Returns the distance of the hit, or a negative number for a miss.
+	float IntersectRayTriangle(float3 const & orig, float3 const & dir, float3 const & v0, float3 const & v1, float3 const & v2)
+	{
+		float3 const e1 = v1 - v0;
+		float3 const e2 = v2 - v0;
+		float3 const p = MathLib::cross(dir, e2);
+		float const det = MathLib::dot(e1, p);
+		if (std::abs(det) < 1e-12f)
+		{
+			return -1;
+		}
+
+		float const inv_det = 1 / det;
+		float3 const s = orig - v0;
+		float const u = MathLib::dot(s, p) * inv_det;
+		if ((u < 0) || (u > 1))
+		{
+			return -1;
+		}
+
+		float3 const q = MathLib::cross(s, e1);
+		float const v = MathLib::dot(dir, q) * inv_det;
+		if ((v < 0) || (u + v > 1))
+		{
+			return -1;
+		}
+
+		return MathLib::dot(e2, q) * inv_det;
+	}
 }
 
 namespace KlayGE
@@ -588,9 +829,116 @@ namespace KlayGE
 		this->Material(model.GetMaterial(this->MaterialID()));
 	}
 
-	void StaticMesh::PosBound(AABBox const & aabb)
+	void StaticMesh::BuildCollisionMesh()
+	{
+		collision_positions_.clear();
+		collision_indices_.clear();
+		collision_bvh_.Clear();
+
+		RenderLayout const & rl = *rls_[0];
+		if ((rl.TopologyType() != RenderLayout::TT_TriangleList) || !rl.UseIndices())
+		{
+			return;
+		}
+
+		auto& rf = Context::Instance().RenderFactoryInstance();
+
+		uint32_t const num_vertices = rl.NumVertices();
+		for (uint32_t i = 0; (i < rl.NumVertexStreams()) && collision_positions_.empty(); ++ i)
+		{
+			uint32_t offset = 0;
+			for (auto const & ve : rl.VertexStreamFormat(i))
+			{
+				if ((ve.usage == VEU_Position) && (ve.usage_index == 0))
+				{
+					GraphicsBufferPtr const & vb = rl.GetVertexStream(i);
+					GraphicsBufferPtr vb_cpu;
+					if (vb->AccessHint() & EAH_CPU_Read)
+					{
+						vb_cpu = vb;
+					}
+					else
+					{
+						vb_cpu = rf.MakeVertexBuffer(BU_Static, EAH_CPU_Read, vb->Size(), nullptr);
+						vb->CopyToBuffer(*vb_cpu);
+					}
+
+					// Positions are compressed into the bound, the same as the shaders decode them
+					float3 const center = pos_aabb_.Center();
+					float3 const extent = pos_aabb_.HalfSize();
+
+					uint32_t const stride = rl.VertexSize(i);
+					GraphicsBuffer::Mapper mapper(*vb_cpu, BA_Read_Only);
+					uint8_t const * src = mapper.Pointer<uint8_t>() + rl.StartVertexLocation() * stride + offset;
+					collision_positions_.resize(num_vertices);
+					for (uint32_t v = 0; v < num_vertices; ++ v)
+					{
+						Color pos;
+						ConvertToABGR32F(ve.format, src + v * stride, 1, &pos);
+						collision_positions_[v] = float3(pos.r(), pos.g(), pos.b()) * extent + center;
+					}
+					break;
+				}
+
+				offset += ve.element_size();
+			}
+		}
+		if (collision_positions_.empty())
+		{
+			return;
+		}
+
+		{
+			GraphicsBufferPtr const & ib = rl.GetIndexStream();
+			GraphicsBufferPtr ib_cpu;
+			if (ib->AccessHint() & EAH_CPU_Read)
+			{
+				ib_cpu = ib;
+			}
+			else
+			{
+				ib_cpu = rf.MakeIndexBuffer(BU_Static, EAH_CPU_Read, ib->Size(), nullptr);
+				ib->CopyToBuffer(*ib_cpu);
+			}
+
+			uint32_t const num_indices = rl.NumIndices() / 3 * 3;
+			collision_indices_.resize(num_indices);
+
+			GraphicsBuffer::Mapper mapper(*ib_cpu, BA_Read_Only);
+			if (EF_R16UI == rl.IndexStreamFormat())
+			{
+				uint16_t const * src = mapper.Pointer<uint16_t>() + rl.StartIndexLocation();
+				std::copy(src, src + num_indices, collision_indices_.begin());
+			}
+			else
+			{
+				BOOST_ASSERT(EF_R32UI == rl.IndexStreamFormat());
+
+				uint32_t const * src = mapper.Pointer<uint32_t>() + rl.StartIndexLocation();
+				std::copy(src, src + num_indices, collision_indices_.begin());
+			}
+		}
+
+		std::vector<AABBox> tri_bounds(collision_indices_.size() / 3);
+		for (size_t i = 0; i < tri_bounds.size(); ++ i)
+		{
+			float3 const & v0 = collision_positions_[collision_indices_[i * 3 + 0]];
+			float3 const & v1 = collision_positions_[collision_indices_[i * 3 + 1]];
+			float3 const & v2 = collision_positions_[collision_indices_[i * 3 + 2]];
+			tri_bounds[i] = AABBox(MathLib::minimize(MathLib::minimize(v0, v1), v2), MathLib::maximize(MathLib::maximize(v0, v1), v2));
+		}
+		collision_bvh_.Build(tri_bounds);
+	}
+
+	bool StaticMesh::IntersectRay(float3 const & orig, float3 const & dir, float& dist) const
 	{
-		pos_aabb_ = aabb;
+		return collision_bvh_.RayCast(orig, dir, 0, dist,
+				   [this, &orig, &dir](uint32_t tri, float box_dist)
+				   {
+					   KFL_UNUSED(box_dist);
+					   return IntersectRayTriangle(orig, dir, collision_positions_[collision_indices_[tri * 3 + 0]],
+						   collision_positions_[collision_indices_[tri * 3 + 1]], collision_positions_[collision_indices_[tri * 3 + 2]]);
+				   }) != BoundingVolumeHierarchy::InvalidIndex;
 	}
 
 	void StaticMesh::TexcoordBound(AABBox const & aabb)
@@ -625,6 +973,12 @@ namespace KlayGE
 
 
 	std::tuple<Quaternion, Quaternion, float> KeyFrameSet::Frame(float frame) const
+	{
+		uint32_t cursor = 0;
+		return this->Frame(frame, cursor);
+	}
+
+	std::tuple<Quaternion, Quaternion, float> KeyFrameSet::Frame(float frame, uint32_t& cursor) const
 	{
 		std::tuple<Quaternion, Quaternion, float> ret;
 		if (frame_id.size() == 1)
@@ -633,22 +987,47 @@ namespace KlayGE
 		}
 		else
 		{
-			frame = std::fmod(frame, static_cast<float>(frame_id.back() + 1));
-
-			auto iter = std::upper_bound(frame_id.begin(), frame_id.end(), frame);
-			int index = static_cast<int>(iter - frame_id.begin());
-
-			int index0 = index - 1;
-			int index1 = index % frame_id.size();
-			int frame0 = frame_id[index0];
-			int frame1 = frame_id[index1];
-			float factor = (frame - frame0) / (frame1 - frame0);
+			uint32_t index0;
+			uint32_t index1;
+			float factor;
+			this->Locate(frame, cursor, index0, index1, factor);
 			auto dq = MathLib::sclerp(bind_real[index0], bind_dual[index0], bind_real[index1], bind_dual[index1], factor);
 			ret = std::make_tuple(dq.first, dq.second, MathLib::lerp(bind_scale[index0], bind_scale[index1], factor));
 		}
 		return ret;
 	}
 
+	void KeyFrameSet::Locate(float frame, uint32_t& cursor, uint32_t& index0, uint32_t& index1, float& factor) const
+	{
+		BOOST_ASSERT(frame_id.size() > 1);
+
+		frame = std::fmod(frame, static_cast<float>(frame_id.back() + 1));
+
+		// The cursor is the index of the first key frame after frame, the same as std::upper_bound gives
+		uint32_t const num = static_cast<uint32_t>(frame_id.size());
+		auto const in_range = [this, num, frame](uint32_t index)
+			{
+				return (index > 0) && (index <= num) && (frame_id[index - 1] <= frame) && ((index == num) || (frame < frame_id[index]));
+			};
+		if (!in_range(cursor))
+		{
+			if (in_range(cursor + 1))
+			{
+				++ cursor;
+			}
+			else
+			{
+				cursor = static_cast<uint32_t>(std::upper_bound(frame_id.begin(), frame_id.end(), frame) - frame_id.begin());
+			}
+		}
+
+		index0 = cursor - 1;
+		index1 = cursor % num;
+		int frame0 = frame_id[index0];
+		int frame1 = frame_id[index1];
+		factor = (frame - frame0) / (frame1 - frame0);
+	}
+
 	AABBox AABBKeyFrameSet::Frame(float frame) const
 	{
 		if (frame_id.size() == 1)
@@ -721,14 +1100,121 @@ namespace KlayGE
 	{
 	}
 
+	void SkinnedModel::AttachKeyFrameSets(std::shared_ptr<std::vector<KeyFrameSet>> const & kf)
+	{
+		this->LoadDelayedKeyFrames();
+		key_frame_sets_ = kf;
+	}
+
+	std::shared_ptr<std::vector<KeyFrameSet>> const & SkinnedModel::GetKeyFrameSets() const
+	{
+		this->LoadDelayedKeyFrames();
+		return key_frame_sets_;
+	}
+
+	void SkinnedModel::DelayLoadKeyFrames(KeyFramesLoader const & loader)
+	{
+		std::lock_guard<std::mutex> lock(key_frames_mutex_);
+		key_frames_loader_ = loader;
+		key_frames_delayed_ = static_cast<bool>(loader);
+	}
+
+	void SkinnedModel::LoadDelayedKeyFrames() const
+	{
+		if (key_frames_delayed_)
+		{
+			std::lock_guard<std::mutex> lock(key_frames_mutex_);
+			if (key_frames_loader_)
+			{
+				key_frames_loader_(key_frame_sets_, animations_);
+				key_frames_loader_ = nullptr;
+			}
+			key_frames_delayed_ = false;
+		}
+	}
+
 	void SkinnedModel::BuildBones(float frame)
 	{
+		this->EvaluateBones(frame);
+		this->SetToEffect();
+	}
+
+	void SkinnedModel::SampleKeyFrames(float frame)
+	{
+		uint32_t const num_joints = static_cast<uint32_t>(joints_.size());
+		key_frame_cursors_.resize(num_joints, 0);
+		sampled_reals_.resize(num_joints);
+		sampled_duals_.resize(num_joints);
+		sampled_scales_.resize(num_joints);
+
+		// Joints with more than one key frame are interpolated together, in SoA layout
+		uint32_t num_sclerps = 0;
+		for (uint32_t i = 0; i < num_joints; ++ i)
+		{
+			if ((*key_frame_sets_)[i].frame_id.size() > 1)
+			{
+				++ num_sclerps;
+			}
+		}
+		sclerp_joints_.resize(num_sclerps);
+		sclerp_lhs_.resize(num_sclerps * 8);
+		sclerp_rhs_.resize(num_sclerps * 8);
+		sclerp_factors_.resize(num_sclerps);
+		sclerp_results_.resize(num_sclerps * 8);
+
+		uint32_t n = 0;
+		for (uint32_t i = 0; i < num_joints; ++ i)
+		{
+			KeyFrameSet const & kf = (*key_frame_sets_)[i];
+			if (kf.frame_id.size() == 1)
+			{
+				sampled_reals_[i] = kf.bind_real[0];
+				sampled_duals_[i] = kf.bind_dual[0];
+				sampled_scales_[i] = kf.bind_scale[0];
+			}
+			else
+			{
+				uint32_t index0;
+				uint32_t index1;
+				float factor;
+				kf.Locate(frame, key_frame_cursors_[i], index0, index1, factor);
+
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					sclerp_lhs_[j * num_sclerps + n] = kf.bind_real[index0][j];
+					sclerp_lhs_[(j + 4) * num_sclerps + n] = kf.bind_dual[index0][j];
+					sclerp_rhs_[j * num_sclerps + n] = kf.bind_real[index1][j];
+					sclerp_rhs_[(j + 4) * num_sclerps + n] = kf.bind_dual[index1][j];
+				}
+				sclerp_factors_[n] = factor;
+				sclerp_joints_[n] = i;
+				sampled_scales_[i] = MathLib::lerp(kf.bind_scale[index0], kf.bind_scale[index1], factor);
+				++ n;
+			}
+		}
+
+		SIMDMathLib::SclerpDualQuaternions(sclerp_results_.data(), sclerp_lhs_.data(), sclerp_rhs_.data(), sclerp_factors_.data(),
+			num_sclerps, num_sclerps);
+
+		for (n = 0; n < num_sclerps; ++ n)
+		{
+			uint32_t const i = sclerp_joints_[n];
+			float const * result = &sclerp_results_[n];
+			sampled_reals_[i] = Quaternion(result[0], result[num_sclerps], result[num_sclerps * 2], result[num_sclerps * 3]);
+			sampled_duals_[i] = Quaternion(result[num_sclerps * 4], result[num_sclerps * 5], result[num_sclerps * 6], result[num_sclerps * 7]);
+		}
+	}
+
+	void SkinnedModel::EvaluateBones(float frame)
+	{
+		this->LoadDelayedKeyFrames();
+		this->SampleKeyFrames(frame);
+
 		for (size_t i = 0; i < joints_.size(); ++ i)
 		{
 			auto& joint = *joints_[i];
-			KeyFrameSet const & kf = (*key_frame_sets_)[i];
 
-			std::tuple<Quaternion, Quaternion, float> key_dq = kf.Frame(frame);
+			std::tuple<Quaternion, Quaternion, float> key_dq(sampled_reals_[i], sampled_duals_[i], sampled_scales_[i]);
 
 			bool is_root = false;
 			auto* parent_node = joint.BoundSceneNode()->Parent();
@@ -794,10 +1280,16 @@ namespace KlayGE
 			}
 		}
 
-		this->UpdateBinds();
+		this->ComputeBinds();
 	}
 
 	void SkinnedModel::UpdateBinds()
+	{
+		this->ComputeBinds();
+		this->SetToEffect();
+	}
+
+	void SkinnedModel::ComputeBinds()
 	{
 		bind_reals_.resize(joints_.size());
 		bind_duals_.resize(joints_.size());
@@ -860,8 +1352,6 @@ namespace KlayGE
 			bind_reals_[i] = float4(bind_real.x(), bind_real.y(), bind_real.z(), bind_real.w()) * bind_scale;
 			bind_duals_[i] = float4(bind_dual.x(), bind_dual.y(), bind_dual.z(), bind_dual.w());
 		}
-
-		this->SetToEffect();
 	}
 
 	float SkinnedModel::GetFrame() const
@@ -879,6 +1369,37 @@ namespace KlayGE
 		}
 	}
 
+	void SkinnedModel::SetFrames(std::span<SkinnedModel* const> models, std::span<float const> frames)
+	{
+		BOOST_ASSERT(models.size() == frames.size());
+
+		uint32_t const num_models = static_cast<uint32_t>(models.size());
+		std::vector<uint8_t> changed(num_models, false);
+		Context::Instance().ThreadPoolInstance().ParallelFor(0, num_models, 1,
+			[models, frames, &changed](uint32_t sub_begin, uint32_t sub_end)
+			{
+				for (uint32_t i = sub_begin; i < sub_end; ++ i)
+				{
+					auto& model = *models[i];
+					if (model.last_frame_ != frames[i])
+					{
+						model.last_frame_ = frames[i];
+						model.EvaluateBones(frames[i]);
+						changed[i] = true;
+					}
+				}
+			});
+
+		// Effects can be shared between models, so parameters are set on this thread
+		for (uint32_t i = 0; i < num_models; ++ i)
+		{
+			if (changed[i])
+			{
+				models[i]->SetToEffect();
+			}
+		}
+	}
+
 	void SkinnedModel::RebindJoints()
 	{
 		this->BuildBones(last_frame_);
@@ -902,11 +1423,11 @@ namespace KlayGE
 			auto& effect = renderable->GetRenderEffect();
 			if (effect)
 			{
-				auto* joint_reals_ep = effect->ParameterByName("joint_reals");
+				auto* joint_reals_ep = effect->ParameterByName(EFFECT_HANDLE("joint_reals"));
 				if (joint_reals_ep)
 				{
 					*joint_reals_ep = bind_reals_;
-					*(effect->ParameterByName("joint_duals")) = bind_duals_;
+					*(effect->ParameterByName(EFFECT_HANDLE("joint_duals"))) = bind_duals_;
 				}
 			}
 		}
@@ -925,16 +1446,26 @@ namespace KlayGE
 
 	void SkinnedModel::AttachAnimations(std::shared_ptr<std::vector<Animation>> const & animations)
 	{
+		this->LoadDelayedKeyFrames();
 		animations_ = animations;
 	}
+
+	std::shared_ptr<std::vector<Animation>> const & SkinnedModel::GetAnimations() const
+	{
+		this->LoadDelayedKeyFrames();
+		return animations_;
+	}
 	
 	uint32_t SkinnedModel::NumAnimations() const
 	{
+		this->LoadDelayedKeyFrames();
 		return animations_ ? static_cast<uint32_t>(animations_->size()) : 1;
 	}
 
 	void SkinnedModel::GetAnimation(uint32_t index, std::string& name, uint32_t& start_frame, uint32_t& end_frame)
 	{
+		this->LoadDelayedKeyFrames();
+
 		if (animations_)
 		{
 			BOOST_ASSERT(index < animations_->size());
@@ -969,7 +1500,13 @@ namespace KlayGE
 				joints[i] = checked_pointer_cast<JointComponent>(src_skinned_model.GetJoint(i)->Clone());
 			}
 			skinned_model.AssignJoints(joints.begin(), joints.end());
-			skinned_model.AttachKeyFrameSets(src_skinned_model.GetKeyFrameSets());
+			{
+				// Shares the pending loader instead of forcing the source to decode its key frames
+				std::lock_guard<std::mutex> lock(src_skinned_model.key_frames_mutex_);
+				skinned_model.DelayLoadKeyFrames(src_skinned_model.key_frames_loader_);
+				skinned_model.key_frame_sets_ = src_skinned_model.key_frame_sets_;
+				skinned_model.animations_ = src_skinned_model.animations_;
+			}
 
 			auto& root_node = *skinned_model.RootNode();
 			for (uint32_t i = 0; i < root_node.NumComponents(); ++i)
@@ -1011,8 +1548,6 @@ namespace KlayGE
 				auto& skinned_mesh = checked_cast<SkinnedMesh&>(*skinned_model.Mesh(mesh_index));
 				skinned_mesh.AttachFramePosBounds(src_skinned_mesh.GetFramePosBounds());
 			}
-
-			skinned_model.AttachAnimations(src_skinned_model.GetAnimations());
 		}
 	}
 
@@ -1093,7 +1628,7 @@ namespace KlayGE
 				uint32_t ver;
 				runtime_file->read(&ver, sizeof(ver));
 				ver = LE2Native(ver);
-				if ((fourcc != MakeFourCC<'K', 'L', 'M', ' '>::value) || (ver != MODEL_BIN_VERSION))
+				if ((fourcc != MakeFourCC<'K', 'L', 'M', ' '>::value) || ((ver != MODEL_BIN_VERSION) && (ver != LEGACY_MODEL_BIN_VERSION)))
 				{
 					jit = true;
 				}
@@ -1107,6 +1642,13 @@ namespace KlayGE
 					{
 						jit = true;
 					}
+#if KLAYGE_IS_DEV_PLATFORM
+					// Legacy files are still loadable, but upgrade them when the source is around
+					else if ((ver == LEGACY_MODEL_BIN_VERSION) && (input_file_timestamp > 0))
+					{
+						jit = true;
+					}
+#endif
 				}
 			}
 
@@ -1153,6 +1695,8 @@ namespace KlayGE
 		uint32_t frame_rate = 0;
 		std::vector<std::shared_ptr<AABBKeyFrameSet>> frame_pos_bbs;
 
+		std::shared_ptr<DelayedKeyFrames> delayed_kfs;
+
 		ResIdentifierPtr runtime_file = ResLoader::Instance().Open(runtime_name);
 
 		uint32_t fourcc;
@@ -1163,18 +1707,34 @@ namespace KlayGE
 		uint32_t ver;
 		runtime_file->read(&ver, sizeof(ver));
 		ver = LE2Native(ver);
-		BOOST_ASSERT(MODEL_BIN_VERSION == ver);
+		BOOST_ASSERT((MODEL_BIN_VERSION == ver) || (LEGACY_MODEL_BIN_VERSION == ver));
+
+		bool const chunked = (ver >= MODEL_BIN_VERSION);
+		std::vector<ModelChunkDesc> chunks;
 
 		std::shared_ptr<std::stringstream> ss = MakeSharedPtr<std::stringstream>();
+		if (chunked)
+		{
+			chunks = ReadModelChunkTable(*runtime_file);
+
+			auto const * scene_chunk = FindModelChunk(chunks, MODEL_CHUNK_SCENE, 0);
+			BOOST_ASSERT(scene_chunk != nullptr);
 
-		uint64_t original_len, len;
-		runtime_file->read(&original_len, sizeof(original_len));
-		original_len = LE2Native(original_len);
-		runtime_file->read(&len, sizeof(len));
-		len = LE2Native(len);
+			std::string scene_data(static_cast<size_t>(scene_chunk->original_len), '\0');
+			ReadModelChunk(*runtime_file, *scene_chunk, scene_data.data());
+			ss->str(scene_data);
+		}
+		else
+		{
+			uint64_t original_len, len;
+			runtime_file->read(&original_len, sizeof(original_len));
+			original_len = LE2Native(original_len);
+			runtime_file->read(&len, sizeof(len));
+			len = LE2Native(len);
 
-		LZMACodec lzma;
-		lzma.Decode(*ss, runtime_file, len, original_len);
+			LZMACodec lzma;
+			lzma.Decode(*ss, runtime_file, len, original_len);
+		}
 
 		ResIdentifierPtr decoded = MakeSharedPtr<ResIdentifier>(runtime_file->ResName(), runtime_file->Timestamp(), ss);
 
@@ -1321,14 +1881,17 @@ namespace KlayGE
 
 		int const index_elem_size = all_is_index_16_bit ? 2 : 4;
 
-		merged_buff.resize(merged_ves.size());
-		for (size_t i = 0; i < merged_buff.size(); ++ i)
+		if (!chunked)
 		{
-			merged_buff[i].resize(all_num_vertices * merged_ves[i].element_size());
-			decoded->read(&merged_buff[i][0], merged_buff[i].size() * sizeof(merged_buff[i][0]));
+			merged_buff.resize(merged_ves.size());
+			for (size_t i = 0; i < merged_buff.size(); ++ i)
+			{
+				merged_buff[i].resize(all_num_vertices * merged_ves[i].element_size());
+				decoded->read(&merged_buff[i][0], merged_buff[i].size() * sizeof(merged_buff[i][0]));
+			}
+			merged_indices.resize(all_num_indices * index_elem_size);
+			decoded->read(&merged_indices[0], merged_indices.size() * sizeof(merged_indices[0]));
 		}
-		merged_indices.resize(all_num_indices * index_elem_size);
-		decoded->read(&merged_indices[0], merged_indices.size() * sizeof(merged_indices[0]));
 
 		mesh_names.resize(num_meshes);
 		mtl_ids.resize(num_meshes);
@@ -1498,47 +2061,9 @@ namespace KlayGE
 			decoded->read(&frame_rate, sizeof(frame_rate));
 			frame_rate = LE2Native(frame_rate);
 
-			kfs = MakeSharedPtr<std::vector<KeyFrameSet>>(joints.size());
-			for (uint32_t kf_index = 0; kf_index < num_kfs; ++ kf_index)
+			if (!chunked)
 			{
-				uint32_t joint_index = kf_index;
-
-				uint32_t num_kf;
-				decoded->read(&num_kf, sizeof(num_kf));
-				num_kf = LE2Native(num_kf);
-
-				KeyFrameSet kf;
-				kf.frame_id.resize(num_kf);
-				kf.bind_real.resize(num_kf);
-				kf.bind_dual.resize(num_kf);
-				kf.bind_scale.resize(num_kf);
-				for (uint32_t k_index = 0; k_index < num_kf; ++ k_index)
-				{
-					decoded->read(&kf.frame_id[k_index], sizeof(kf.frame_id[k_index]));
-					kf.frame_id[k_index] = LE2Native(kf.frame_id[k_index]);
-					decoded->read(&kf.bind_real[k_index], sizeof(kf.bind_real[k_index]));
-					kf.bind_real[k_index][0] = LE2Native(kf.bind_real[k_index][0]);
-					kf.bind_real[k_index][1] = LE2Native(kf.bind_real[k_index][1]);
-					kf.bind_real[k_index][2] = LE2Native(kf.bind_real[k_index][2]);
-					kf.bind_real[k_index][3] = LE2Native(kf.bind_real[k_index][3]);
-					decoded->read(&kf.bind_dual[k_index], sizeof(kf.bind_dual[k_index]));
-					kf.bind_dual[k_index][0] = LE2Native(kf.bind_dual[k_index][0]);
-					kf.bind_dual[k_index][1] = LE2Native(kf.bind_dual[k_index][1]);
-					kf.bind_dual[k_index][2] = LE2Native(kf.bind_dual[k_index][2]);
-					kf.bind_dual[k_index][3] = LE2Native(kf.bind_dual[k_index][3]);
-
-					float flip = MathLib::SignBit(kf.bind_real[k_index].w());
-
-					kf.bind_scale[k_index] = MathLib::length(kf.bind_real[k_index]);
-					kf.bind_real[k_index] /= kf.bind_scale[k_index];
-
-					kf.bind_scale[k_index] *= flip;
-				}
-
-				if (joint_index < num_joints)
-				{
-					(*kfs)[joint_index] = kf;
-				}
+				kfs = ReadKeyFrames(*decoded, num_kfs, num_joints);
 			}
 
 			frame_pos_bbs.resize(num_meshes);
@@ -1570,23 +2095,26 @@ namespace KlayGE
 				}
 			}
 
-			if (num_animations > 0)
+			if (chunked)
 			{
-				animations = MakeSharedPtr<std::vector<Animation>>(num_animations);
-				for (uint32_t animation_index = 0; animation_index < num_animations; ++animation_index)
-				{
-					Animation animation;
-					animation.name = ReadShortString(*decoded);
-					decoded->read(&animation.start_frame, sizeof(animation.start_frame));
-					animation.start_frame = LE2Native(animation.start_frame);
-					decoded->read(&animation.end_frame, sizeof(animation.end_frame));
-					animation.end_frame = LE2Native(animation.end_frame);
-					(*animations)[animation_index] = animation;
-				}
+				// Only the encoded bytes are read here. Decoding waits until the animation is actually played.
+				auto const * kf_chunk = FindModelChunk(chunks, MODEL_CHUNK_KEY_FRAMES, 0);
+				BOOST_ASSERT(kf_chunk != nullptr);
+
+				std::vector<uint8_t> kf_data(static_cast<size_t>(kf_chunk->len));
+				runtime_file->seekg(kf_chunk->offset, std::ios_base::beg);
+				runtime_file->read(kf_data.data(), kf_data.size());
+
+				delayed_kfs = MakeSharedPtr<DelayedKeyFrames>(runtime_file->ResName(), *kf_chunk, std::move(kf_data),
+					num_kfs, num_joints, num_animations);
+			}
+			else
+			{
+				animations = ReadAnimations(*decoded, num_animations);
 			}
 		}
 
-		bool const skinned = kfs && !kfs->empty();
+		bool const skinned = (num_kfs > 0) && (num_joints > 0);
 
 		RenderModelPtr model;
 		if (skinned)
@@ -1604,16 +2132,35 @@ namespace KlayGE
 			model->GetMaterial(mtl_index) = mtls[mtl_index];
 		}
 
-		std::vector<GraphicsBufferPtr> merged_vbs(merged_buff.size());
-		for (size_t i = 0; i < merged_buff.size(); ++ i)
+		auto load_merged_buffer = [chunked, &chunks, &runtime_file](uint32_t chunk_type, uint16_t chunk_index, uint32_t size,
+			void const * legacy_data)
 		{
-			auto vb = MakeSharedPtr<SoftwareGraphicsBuffer>(static_cast<uint32_t>(merged_buff[i].size()), false);
-			vb->CreateHWResource(merged_buff[i].data());
+			auto buff = MakeSharedPtr<SoftwareGraphicsBuffer>(size, false);
+			if (chunked)
+			{
+				auto const * chunk = FindModelChunk(chunks, chunk_type, chunk_index);
+				BOOST_ASSERT((chunk != nullptr) && (chunk->original_len == size));
+
+				buff->CreateHWResource(nullptr);
 
-			merged_vbs[i] = vb;
+				GraphicsBuffer::Mapper mapper(*buff, BA_Write_Only);
+				ReadModelChunk(*runtime_file, *chunk, mapper.Pointer<uint8_t>());
+			}
+			else
+			{
+				buff->CreateHWResource(legacy_data);
+			}
+			return buff;
+		};
+
+		std::vector<GraphicsBufferPtr> merged_vbs(merged_ves.size());
+		for (size_t i = 0; i < merged_vbs.size(); ++ i)
+		{
+			merged_vbs[i] = load_merged_buffer(MODEL_CHUNK_VERTICES, static_cast<uint16_t>(i),
+				all_num_vertices * merged_ves[i].element_size(), chunked ? nullptr : merged_buff[i].data());
 		}
-		auto merged_ib = MakeSharedPtr<SoftwareGraphicsBuffer>(static_cast<uint32_t>(merged_indices.size()), false);
-		merged_ib->CreateHWResource(merged_indices.data());
+		auto merged_ib = load_merged_buffer(MODEL_CHUNK_INDICES, 0, all_num_indices * index_elem_size,
+			chunked ? nullptr : merged_indices.data());
 
 		uint32_t mesh_lod_index = 0;
 		std::vector<StaticMeshPtr> meshes(num_meshes);
@@ -1640,7 +2187,7 @@ namespace KlayGE
 			mesh->NumLods(lods);
 			for (uint32_t lod = 0; lod < lods; ++ lod, ++ mesh_lod_index)
 			{
-				for (uint32_t ve_index = 0; ve_index < merged_buff.size(); ++ ve_index)
+				for (uint32_t ve_index = 0; ve_index < merged_vbs.size(); ++ ve_index)
 				{
 					mesh->AddVertexStream(lod, merged_vbs[ve_index], merged_ves[ve_index]);
 				}
@@ -1653,14 +2200,25 @@ namespace KlayGE
 			}
 		}
 
-		if (kfs && !kfs->empty())
+		if (skinned)
 		{
-			if (!joints.empty())
 			{
 				SkinnedModelPtr skinned_model = checked_pointer_cast<SkinnedModel>(model);
 
 				skinned_model->AssignJoints(joints.begin(), joints.end());
-				skinned_model->AttachKeyFrameSets(kfs);
+				if (delayed_kfs)
+				{
+					skinned_model->DelayLoadKeyFrames(
+						[delayed_kfs](std::shared_ptr<std::vector<KeyFrameSet>>& kfs, std::shared_ptr<std::vector<Animation>>& animations)
+						{
+							delayed_kfs->Load(kfs, animations);
+						});
+				}
+				else
+				{
+					skinned_model->AttachKeyFrameSets(kfs);
+					skinned_model->AttachAnimations(animations);
+				}
 
 				skinned_model->NumFrames(num_frames);
 				skinned_model->FrameRate(frame_rate);
@@ -1670,8 +2228,6 @@ namespace KlayGE
 					SkinnedMeshPtr skinned_mesh = checked_pointer_cast<SkinnedMesh>(meshes[mesh_index]);
 					skinned_mesh->AttachFramePosBounds(frame_pos_bbs[mesh_index]);
 				}
-
-				skinned_model->AttachAnimations(animations);
 			}
 		}
 
@@ -1780,7 +2336,7 @@ namespace
 		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices,
 		std::vector<uint32_t> const & mesh_num_indices, std::vector<uint32_t> const & mesh_start_indices,
 		std::vector<VertexElement> const & merged_ves,
-		std::vector<std::vector<uint8_t>> const & merged_vertices, std::vector<uint8_t> const & merged_indices,
+		std::vector<std::vector<uint8_t>> const * merged_vertices, std::vector<uint8_t> const * merged_indices,
 		char is_index_16_bit, std::ostream& os)
 	{
 		uint32_t num_merged_ves = Native2LE(static_cast<uint32_t>(merged_ves.size()));
@@ -1799,11 +2355,18 @@ namespace
 		os.write(reinterpret_cast<char*>(&num_indices), sizeof(num_indices));
 		os.write(&is_index_16_bit, sizeof(is_index_16_bit));
 
-		for (size_t i = 0; i < merged_vertices.size(); ++ i)
+		// Chunked models keep vertices and indices in their own chunks
+		if (merged_vertices != nullptr)
 		{
-			os.write(reinterpret_cast<char const *>(&merged_vertices[i][0]), merged_vertices[i].size() * sizeof(merged_vertices[i][0]));
+			for (size_t i = 0; i < merged_vertices->size(); ++ i)
+			{
+				os.write(reinterpret_cast<char const *>(&(*merged_vertices)[i][0]), (*merged_vertices)[i].size() * sizeof((*merged_vertices)[i][0]));
+			}
+		}
+		if (merged_indices != nullptr)
+		{
+			os.write(reinterpret_cast<char const *>(&(*merged_indices)[0]), merged_indices->size() * sizeof((*merged_indices)[0]));
 		}
-		os.write(reinterpret_cast<char const *>(&merged_indices[0]), merged_indices.size() * sizeof(merged_indices[0]));
 
 		uint32_t mesh_lod_index = 0;
 		for (uint32_t mesh_index = 0; mesh_index < mesh_names.size(); ++ mesh_index)
@@ -1978,14 +2541,16 @@ namespace
 		}
 	}
 
-	void WriteKeyFramesChunk(uint32_t num_frames, uint32_t frame_rate, std::vector<KeyFrameSet>& kfs,
-		std::ostream& os)
+	void WriteFrameInfoChunk(uint32_t num_frames, uint32_t frame_rate, std::ostream& os)
 	{
 		num_frames = Native2LE(num_frames);
 		os.write(reinterpret_cast<char*>(&num_frames), sizeof(num_frames));
 		frame_rate = Native2LE(frame_rate);
 		os.write(reinterpret_cast<char*>(&frame_rate), sizeof(frame_rate));
+	}
 
+	void WriteKeyFramesChunk(std::vector<KeyFrameSet>& kfs, std::ostream& os)
+	{
 		for (size_t i = 0; i < kfs.size(); ++ i)
 		{
 			uint32_t num_kf = Native2LE(static_cast<uint32_t>(kfs[i].frame_id.size()));
@@ -2065,9 +2630,12 @@ namespace
 		std::vector<SceneNode const *> const & nodes, std::vector<Renderable const *> const & renderables,
 		std::vector<JointComponent const*> const & joints, std::shared_ptr<std::vector<Animation>> const & animations,
 		std::shared_ptr<std::vector<KeyFrameSet>> const & kfs, uint32_t num_frames, uint32_t frame_rate,
-		std::vector<std::shared_ptr<AABBKeyFrameSet>> const & frame_pos_bbs)
+		std::vector<std::shared_ptr<AABBKeyFrameSet>> const & frame_pos_bbs, uint32_t version)
 	{
+		bool const chunked = (version >= MODEL_BIN_VERSION);
+
 		std::ostringstream ss;
+		std::ostringstream kf_ss;
 
 		{
 			uint32_t num_mtls = Native2LE(static_cast<uint32_t>(mtls.size()));
@@ -2098,7 +2666,7 @@ namespace
 		{
 			WriteMeshesChunk(mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
 				mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
-				merged_ves, merged_buffs, merged_indices, all_is_index_16_bit, ss);
+				merged_ves, chunked ? nullptr : &merged_buffs, chunked ? nullptr : &merged_indices, all_is_index_16_bit, ss);
 		}
 
 		if (!nodes.empty())
@@ -2113,11 +2681,24 @@ namespace
 
 		if (kfs && !kfs->empty())
 		{
-			WriteKeyFramesChunk(num_frames, frame_rate, *kfs, ss);
+			WriteFrameInfoChunk(num_frames, frame_rate, ss);
+
+			if (chunked)
+			{
+				// Bounding boxes are needed for culling right away, key frames only when the animation is played
+				WriteBBKeyFramesChunk(frame_pos_bbs, ss);
+
+				WriteKeyFramesChunk(*kfs, kf_ss);
+				WriteAnimationsChunk(*animations, kf_ss);
+			}
+			else
+			{
+				WriteKeyFramesChunk(*kfs, ss);
 
-			WriteBBKeyFramesChunk(frame_pos_bbs, ss);
+				WriteBBKeyFramesChunk(frame_pos_bbs, ss);
 
-			WriteAnimationsChunk(*animations, ss);
+				WriteAnimationsChunk(*animations, ss);
+			}
 		}
 
 		std::ofstream ofs(jit_name.c_str(), std::ios_base::binary);
@@ -2125,29 +2706,102 @@ namespace
 		uint32_t fourcc = Native2LE(MakeFourCC<'K', 'L', 'M', ' '>::value);
 		ofs.write(reinterpret_cast<char*>(&fourcc), sizeof(fourcc));
 
-		uint32_t ver = Native2LE(MODEL_BIN_VERSION);
+		uint32_t ver = Native2LE(version);
 		ofs.write(reinterpret_cast<char*>(&ver), sizeof(ver));
 
 		auto const & ss_str = ss.str();
-		uint64_t original_len = Native2LE(static_cast<uint64_t>(ss_str.size()));
-		ofs.write(reinterpret_cast<char*>(&original_len), sizeof(original_len));
+		if (chunked)
+		{
+			struct ChunkSource
+			{
+				uint32_t type;
+				uint16_t index;
+				bool compress;
+				std::span<uint8_t const> data;
+			};
+
+			std::vector<ChunkSource> sources;
+			sources.push_back({MODEL_CHUNK_SCENE, 0, true, MakeSpan(reinterpret_cast<uint8_t const *>(ss_str.data()), ss_str.size())});
+			if (!mesh_names.empty())
+			{
+				for (size_t i = 0; i < merged_buffs.size(); ++ i)
+				{
+					sources.push_back({MODEL_CHUNK_VERTICES, static_cast<uint16_t>(i), false, merged_buffs[i]});
+				}
+				sources.push_back({MODEL_CHUNK_INDICES, 0, false, merged_indices});
+			}
+			auto const & kf_str = kf_ss.str();
+			if (!kf_str.empty())
+			{
+				sources.push_back({MODEL_CHUNK_KEY_FRAMES, 0, true, MakeSpan(reinterpret_cast<uint8_t const *>(kf_str.data()), kf_str.size())});
+			}
+
+			uint32_t num_chunks = Native2LE(static_cast<uint32_t>(sources.size()));
+			ofs.write(reinterpret_cast<char*>(&num_chunks), sizeof(num_chunks));
 
-		std::ofstream::pos_type p = ofs.tellp();
-		uint64_t len = 0;
-		ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+			std::vector<ModelChunkDesc> chunks(sources.size());
+			std::ofstream::pos_type const table_pos = ofs.tellp();
+			ofs.write(reinterpret_cast<char*>(chunks.data()), chunks.size() * sizeof(chunks[0]));
 
-		LZMACodec lzma;
-		len = lzma.Encode(ofs, MakeSpan(reinterpret_cast<uint8_t const *>(ss_str.c_str()), ss_str.size()));
+			for (size_t i = 0; i < sources.size(); ++ i)
+			{
+				auto const & source = sources[i];
+				auto& chunk = chunks[i];
+
+				uint64_t const pos = static_cast<uint64_t>(ofs.tellp());
+				uint64_t const aligned_pos = (pos + MODEL_CHUNK_ALIGNMENT - 1) & ~static_cast<uint64_t>(MODEL_CHUNK_ALIGNMENT - 1);
+				char const padding[MODEL_CHUNK_ALIGNMENT] = {};
+				ofs.write(padding, static_cast<std::streamsize>(aligned_pos - pos));
 
-		ofs.seekp(p, std::ios_base::beg);
-		len = Native2LE(len);
-		ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+				chunk.type = source.type;
+				chunk.index = source.index;
+				chunk.offset = aligned_pos;
+				chunk.original_len = source.data.size();
+				if (source.compress)
+				{
+					LZMACodec lzma;
+					chunk.flags = MCF_LZMA;
+					chunk.len = lzma.Encode(ofs, source.data);
+				}
+				else
+				{
+					chunk.flags = 0;
+					chunk.len = source.data.size();
+					ofs.write(reinterpret_cast<char const *>(source.data.data()), source.data.size());
+				}
+			}
+
+			for (auto& chunk : chunks)
+			{
+				chunk.type = Native2LE(chunk.type);
+				chunk.index = Native2LE(chunk.index);
+				chunk.flags = Native2LE(chunk.flags);
+				chunk.offset = Native2LE(chunk.offset);
+				chunk.original_len = Native2LE(chunk.original_len);
+				chunk.len = Native2LE(chunk.len);
+			}
+			ofs.seekp(table_pos, std::ios_base::beg);
+			ofs.write(reinterpret_cast<char*>(chunks.data()), chunks.size() * sizeof(chunks[0]));
+		}
+		else
+		{
+			uint64_t original_len = Native2LE(static_cast<uint64_t>(ss_str.size()));
+			ofs.write(reinterpret_cast<char*>(&original_len), sizeof(original_len));
+
+			std::ofstream::pos_type p = ofs.tellp();
+			uint64_t len = 0;
+			ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+
+			LZMACodec lzma;
+			len = lzma.Encode(ofs, MakeSpan(reinterpret_cast<uint8_t const *>(ss_str.c_str()), ss_str.size()));
+
+			ofs.seekp(p, std::ios_base::beg);
+			len = Native2LE(len);
+			ofs.write(reinterpret_cast<char*>(&len), sizeof(len));
+		}
 	}
-} // namespace
 
-namespace KlayGE
-{
-	void SaveModel(RenderModel const & model, std::string_view model_name)
+	void SaveModel(RenderModel const & model, std::string_view model_name, uint32_t version)
 	{
 		FILESYSTEM_NS::path output_path(model_name.begin(), model_name.end());
 		auto const output_ext = output_path.extension().string();
@@ -2321,7 +2975,7 @@ namespace KlayGE
 			mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
 			mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
 			nodes, renderables,
-			joints, animations, kfs, num_frame, frame_rate, frame_pos_bbs);
+			joints, animations, kfs, num_frame, frame_rate, frame_pos_bbs, version);
 
 #if KLAYGE_IS_DEV_PLATFORM
 		if (need_conversion)
@@ -2337,6 +2991,19 @@ namespace KlayGE
 		}
 #endif
 	}
+} // namespace
+
+namespace KlayGE
+{
+	void SaveModel(RenderModel const & model, std::string_view model_name)
+	{
+		::SaveModel(model, model_name, MODEL_BIN_VERSION);
+	}
+
+	void SaveLegacyModel(RenderModel const & model, std::string_view model_name)
+	{
+		::SaveModel(model, model_name, LEGACY_MODEL_BIN_VERSION);
+	}
 
 
 	RenderableLightSourceProxy::RenderableLightSourceProxy(std::wstring_view name)
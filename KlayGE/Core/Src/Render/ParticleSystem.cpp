@@ -45,10 +45,20 @@
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/RadixSort.hpp>
 
+#include <algorithm>
+#include <bit>
 #include <fstream>
 #include <string>
 
+#if defined(KLAYGE_SSE2_SUPPORT)
+	#include <emmintrin.h>
+#endif
+#if defined(KLAYGE_AVX_SUPPORT)
+	#include <immintrin.h>
+#endif
+
 #include <KlayGE/ParticleSystem.hpp>
 
 namespace
@@ -56,6 +66,68 @@ namespace
 	using namespace KlayGE;
 
 	uint32_t const NUM_PARTICLES = 4096;
+	uint32_t const PARTICLE_CHUNK_SIZE = 4096;
+
+	// Maps a float to an uint32_t whose unsigned order is the reversed float order
+	uint32_t BackToFrontKey(float depth)
+	{
+		uint32_t const bits = std::bit_cast<uint32_t>(depth);
+		uint32_t const key = (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+		return ~key;
+	}
+
+	float EvalPolyline(std::vector<float2> const & polyline, float pos)
+	{
+		for (auto iter = std::next(polyline.begin()); iter != polyline.end(); ++ iter)
+		{
+			if (iter->x() >= pos)
+			{
+				float2 const & prev = *std::prev(iter);
+				float const s = (pos - prev.x()) / (iter->x() - prev.x());
+				return MathLib::lerp(prev.y(), iter->y(), s);
+			}
+		}
+		return polyline.back().y();
+	}
+
+#if defined(KLAYGE_SSE2_SUPPORT)
+	// Evaluates the polyline at 4 positions. Segments are visited from the back, so the first segment ending at or after pos wins, same as the scalar version.
+	__m128 EvalPolyline(std::vector<float2> const & polyline, __m128 pos)
+	{
+		__m128 ret = _mm_set1_ps(polyline.back().y());
+		for (size_t i = polyline.size() - 1; i > 0; -- i)
+		{
+			float2 const & prev = polyline[i - 1];
+			float2 const & curr = polyline[i];
+			__m128 const prev_x = _mm_set1_ps(prev.x());
+			__m128 const prev_y = _mm_set1_ps(prev.y());
+			__m128 const s = _mm_div_ps(_mm_sub_ps(pos, prev_x), _mm_set1_ps(curr.x() - prev.x()));
+			__m128 const v = _mm_add_ps(prev_y, _mm_mul_ps(_mm_set1_ps(curr.y() - prev.y()), s));
+			__m128 const in_segment = _mm_cmpge_ps(_mm_set1_ps(curr.x()), pos);
+			ret = _mm_or_ps(_mm_and_ps(in_segment, v), _mm_andnot_ps(in_segment, ret));
+		}
+		return ret;
+	}
+#endif
+
+#if defined(KLAYGE_AVX_SUPPORT)
+	__m256 EvalPolyline(std::vector<float2> const & polyline, __m256 pos)
+	{
+		__m256 ret = _mm256_set1_ps(polyline.back().y());
+		for (size_t i = polyline.size() - 1; i > 0; -- i)
+		{
+			float2 const & prev = polyline[i - 1];
+			float2 const & curr = polyline[i];
+			__m256 const prev_x = _mm256_set1_ps(prev.x());
+			__m256 const prev_y = _mm256_set1_ps(prev.y());
+			__m256 const s = _mm256_div_ps(_mm256_sub_ps(pos, prev_x), _mm256_set1_ps(curr.x() - prev.x()));
+			__m256 const v = _mm256_add_ps(prev_y, _mm256_mul_ps(_mm256_set1_ps(curr.y() - prev.y()), s));
+			__m256 const in_segment = _mm256_cmp_ps(_mm256_set1_ps(curr.x()), pos, _CMP_GE_OQ);
+			ret = _mm256_blendv_ps(ret, v, in_segment);
+		}
+		return ret;
+	}
+#endif
 
 	class ParticleSystemLoadingDesc : public ResLoadingDesc
 	{
@@ -336,6 +408,14 @@ namespace
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, HashValue(ps_desc_.res_name));
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
@@ -501,6 +581,11 @@ namespace
 			*(effect_->ParameterByName("particle_alpha_to_tex")) = tex;
 		}
 
+		bool DynamicContent() const override
+		{
+			return true;
+		}
+
 		void OnRenderBegin()
 		{
 			Camera const & camera = Context::Instance().AppInstance().ActiveCamera();
@@ -508,27 +593,20 @@ namespace
 			float4x4 const & view = camera.ViewMatrix();
 			float4x4 const & proj = camera.ProjMatrix();
 
-			*(effect_->ParameterByName("model_view")) = model_mat_ * view;
-			*(effect_->ParameterByName("proj")) = proj;
-			*(effect_->ParameterByName("far_plane")) = camera.FarPlane();
+			*(effect_->ParameterByName(EFFECT_HANDLE("model_view"))) = model_mat_ * view;
+			*(effect_->ParameterByName(EFFECT_HANDLE("proj"))) = proj;
+			*(effect_->ParameterByName(EFFECT_HANDLE("far_plane"))) = camera.FarPlane();
 
 			float scale_x = sqrt(model_mat_(0, 0) * model_mat_(0, 0) + model_mat_(0, 1) * model_mat_(0, 1) + model_mat_(0, 2) * model_mat_(0, 2));
 			float scale_y = sqrt(model_mat_(1, 0) * model_mat_(1, 0) + model_mat_(1, 1) * model_mat_(1, 1) + model_mat_(1, 2) * model_mat_(1, 2));
-			*(effect_->ParameterByName("point_radius")) = 0.08f * std::max(scale_x, scale_y);
+			*(effect_->ParameterByName(EFFECT_HANDLE("point_radius"))) = 0.08f * std::max(scale_x, scale_y);
 
 			auto drl = Context::Instance().DeferredRenderingLayerInstance();
 			if (drl)
 			{
-				*(effect_->ParameterByName("depth_tex")) = drl->CurrFrameResolvedDepthTex(drl->ActiveViewport());
+				*(effect_->ParameterByName(EFFECT_HANDLE("depth_tex"))) = drl->CurrFrameResolvedDepthTex(drl->ActiveViewport());
 			}
 		}
-
-		void PosBound(AABBox const & pos_aabb)
-		{
-			pos_aabb_ = pos_aabb;
-		}
-
-		using Renderable::PosBound;
 	};
 }
 
@@ -585,10 +663,10 @@ namespace KlayGE
 
 	ParticleSystem::ParticleSystem(uint32_t max_num_particles, bool sort_particles)
 		: root_node_(MakeSharedPtr<SceneNode>(L"ParticleSystemRootNode", SceneNode::SOA_Moveable | SceneNode::SOA_NotCastShadow)),
-			particles_(max_num_particles),
 			gravity_(0.5f), force_(0, 0, 0), media_density_(0.0f),
 			sort_particles_(sort_particles)
 	{
+		particles_.Resize(max_num_particles);
 		this->ClearParticles();
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
@@ -596,33 +674,24 @@ namespace KlayGE
 		render_particles_ = MakeSharedPtr<RenderParticles>(gs_support_);
 		root_node_->AddComponent(MakeSharedPtr<RenderableComponent>(render_particles_));
 
-		root_node_->OnMainThreadUpdate().Connect([this, &rf](SceneNode& node, float app_time, float elapsed_time)
+		// The render layout is refilled on the main thread, before the scene is published. The passes draw it without
+		//  update_mutex_, while the sub thread simulates the next step.
+		root_node_->OnMainThreadUpdate().Connect([this](SceneNode& node, float app_time, float elapsed_time)
 			{
 				KFL_UNUSED(node);
 				KFL_UNUSED(app_time);
 				KFL_UNUSED(elapsed_time);
 
-				auto const& caps = rf.RenderEngineInstance().DeviceCaps();
-				if (!caps.arbitrary_multithread_rendering_support)
-				{
-					std::lock_guard<std::mutex> lock(actived_particles_mutex_);
-					this->UpdateParticleBufferNoLock();
-				}
+				std::lock_guard<std::mutex> lock(actived_particles_mutex_);
+				this->UpdateParticleBufferNoLock();
 			});
-		root_node_->OnSubThreadUpdate().Connect([this, &rf](SceneNode& node, float app_time, float elapsed_time)
+		root_node_->OnSubThreadUpdate().Connect([this](SceneNode& node, float app_time, float elapsed_time)
 			{
 				KFL_UNUSED(node);
 				KFL_UNUSED(app_time);
 
 				std::lock_guard<std::mutex> lock(actived_particles_mutex_);
-
 				this->UpdateParticlesNoLock(elapsed_time);
-
-				auto const& caps = rf.RenderEngineInstance().DeviceCaps();
-				if (caps.arbitrary_multithread_rendering_support)
-				{
-					this->UpdateParticleBufferNoLock();
-				}
 			});
 	}
 
@@ -736,103 +805,186 @@ namespace KlayGE
 
 	void ParticleSystem::ClearParticles()
 	{
-		for (auto& particle : particles_)
-		{
-			particle.life = 0;
-		}
+		std::fill(particles_.Life(), particles_.Life() + particles_.Size(), 0.0f);
 	}
 
 	void ParticleSystem::UpdateParticlesNoLock(float elapsed_time)
 	{
-		auto emitter_iter = emitters_.begin();
-		uint32_t new_particle = (*emitter_iter)->Update(elapsed_time);
-
 		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		auto const& camera = *re.DefaultFrameBuffer()->Viewport()->Camera();
 		float4x4 const& view_mat = camera.ViewMatrix();
 
-		actived_particles_.clear();
-
-		float3 min_bb(+1e10f, +1e10f, +1e10f);
-		float3 max_bb(-1e10f, -1e10f, -1e10f);
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
 
 		for (auto const & updater : updaters_)
 		{
 			updater->SnapParams();
 		}
 
-		for (uint32_t i = 0; i < particles_.size(); ++ i)
-		{
-			Particle& particle = particles_[i];
+		uint32_t const num_particles = particles_.Size();
+		uint32_t const num_chunks = (num_particles + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
 
-			if (particle.life > 0)
-			{
-				for (auto const & updater : updaters_)
+		if (!updaters_.empty())
+		{
+			thread_pool.ParallelFor(0, num_chunks, 1, [this, num_particles, elapsed_time](uint32_t sub_begin, uint32_t sub_end)
 				{
-					updater->Update(particle, elapsed_time);
-				}
-			}
-			else
+					for (uint32_t c = sub_begin; c < sub_end; ++ c)
+					{
+						uint32_t const first = c * PARTICLE_CHUNK_SIZE;
+						ParticleSpan const span = particles_.Span(first, std::min(PARTICLE_CHUNK_SIZE, num_particles - first));
+						for (auto const & updater : updaters_)
+						{
+							updater->Update(span, elapsed_time);
+						}
+					}
+				});
+		}
+
+		this->EmitParticlesNoLock(elapsed_time);
+
+		// Count the live particles of each chunk, so the active list can be filled in parallel
+		chunk_num_actives_.resize(num_chunks + 1);
+		chunk_bounds_.resize(num_chunks);
+		thread_pool.ParallelFor(0, num_chunks, 1, [this, num_particles](uint32_t sub_begin, uint32_t sub_end)
 			{
-				if (new_particle > 0)
+				float const * life = particles_.Life();
+				float const * pos_x = particles_.PosX();
+				float const * pos_y = particles_.PosY();
+				float const * pos_z = particles_.PosZ();
+				for (uint32_t c = sub_begin; c < sub_end; ++ c)
 				{
-					(*emitter_iter)->Emit(particle);
-					for (auto const & updater : updaters_)
+					uint32_t const first = c * PARTICLE_CHUNK_SIZE;
+					uint32_t const last = std::min(first + PARTICLE_CHUNK_SIZE, num_particles);
+
+					float3 min_bb(+1e10f, +1e10f, +1e10f);
+					float3 max_bb(-1e10f, -1e10f, -1e10f);
+					uint32_t num_actives = 0;
+					for (uint32_t i = first; i < last; ++ i)
 					{
-						updater->Update(particle, 0);
+						if (life[i] > 0)
+						{
+							float3 const pos(pos_x[i], pos_y[i], pos_z[i]);
+							min_bb = MathLib::minimize(min_bb, pos);
+							max_bb = MathLib::maximize(max_bb, pos);
+							++ num_actives;
+						}
 					}
-					-- new_particle;
+
+					chunk_num_actives_[c + 1] = num_actives;
+					chunk_bounds_[c] = AABBox(min_bb, max_bb);
 				}
-				else
+			});
+
+		chunk_num_actives_[0] = 0;
+		for (uint32_t c = 0; c < num_chunks; ++ c)
+		{
+			chunk_num_actives_[c + 1] += chunk_num_actives_[c];
+		}
+
+		actived_particles_.resize(chunk_num_actives_[num_chunks]);
+		thread_pool.ParallelFor(0, num_chunks, 1, [this, num_particles, &view_mat](uint32_t sub_begin, uint32_t sub_end)
+			{
+				float4 const z_row = view_mat.Col(2);
+				float4 const w_row = view_mat.Col(3);
+
+				float const * life = particles_.Life();
+				float const * pos_x = particles_.PosX();
+				float const * pos_y = particles_.PosY();
+				float const * pos_z = particles_.PosZ();
+				for (uint32_t c = sub_begin; c < sub_end; ++ c)
 				{
-					if (emitter_iter != emitters_.end())
+					uint32_t const first = c * PARTICLE_CHUNK_SIZE;
+					uint32_t const last = std::min(first + PARTICLE_CHUNK_SIZE, num_particles);
+
+					auto* out = &actived_particles_[chunk_num_actives_[c]];
+					for (uint32_t i = first; i < last; ++ i)
 					{
-						++ emitter_iter;
-						if (emitter_iter != emitters_.end())
+						if (life[i] > 0)
 						{
-							new_particle = (*emitter_iter)->Update(elapsed_time);
+							float depth_es;
+							if (sort_particles_)
+							{
+								float4 const pos4(pos_x[i], pos_y[i], pos_z[i], 1);
+								depth_es = MathLib::dot(pos4, z_row) / MathLib::dot(pos4, w_row);
+							}
+							else
+							{
+								depth_es = 0;
+							}
+
+							*out = std::make_pair(i, depth_es);
+							++ out;
 						}
 					}
 				}
-			}
+			});
 
-			if (particle.life > 0)
+		if (!actived_particles_.empty())
+		{
+			if (sort_particles_)
 			{
-				float3 const & pos = particle.pos;
+				sort_buffer_.resize(actived_particles_.size());
+				RadixSort(std::span(actived_particles_), std::span(sort_buffer_),
+					[](std::pair<uint32_t, float> const & par) { return static_cast<uint64_t>(BackToFrontKey(par.second)); },
+					&thread_pool.Scheduler());
+			}
 
-				float depth_es;
-				if (sort_particles_)
+			AABBox pos_bb(float3(+1e10f, +1e10f, +1e10f), float3(-1e10f, -1e10f, -1e10f));
+			for (uint32_t c = 0; c < num_chunks; ++ c)
+			{
+				if (chunk_num_actives_[c + 1] > chunk_num_actives_[c])
 				{
-					float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
-					float4 const z_row = view_mat.Col(2);
-					float4 const w_row = view_mat.Col(3);
-
-					depth_es = MathLib::dot(pos4, z_row) / MathLib::dot(pos4, w_row);
+					pos_bb |= chunk_bounds_[c];
 				}
-				else
+			}
+			checked_cast<RenderParticles&>(*render_particles_).PosBound(pos_bb);
+		}
+	}
+
+	void ParticleSystem::EmitParticlesNoLock(float elapsed_time)
+	{
+		// Emitters own random generators, so emission stays serial. New particles are gathered and then initialized by the updaters in one batch.
+		emitted_slots_.clear();
+
+		uint32_t const num_particles = particles_.Size();
+		float const * life = particles_.Life();
+		uint32_t slot = 0;
+		for (auto const & emitter : emitters_)
+		{
+			uint32_t new_particle = emitter->Update(elapsed_time);
+			for (; (new_particle > 0) && (slot < num_particles); ++ slot)
+			{
+				if (life[slot] <= 0)
 				{
-					depth_es = 0;
-				}
+					uint32_t const index = static_cast<uint32_t>(emitted_slots_.size());
+					if (emitted_particles_.Size() <= index)
+					{
+						emitted_particles_.Resize(std::max(index + 1, emitted_particles_.Size() * 2));
+					}
 
-				actived_particles_.emplace_back(i, depth_es);
+					Particle par = particles_.Get(slot);
+					emitter->Emit(par);
+					emitted_particles_.Set(index, par);
 
-				min_bb = MathLib::minimize(min_bb, pos);
-				max_bb = MathLib::maximize(min_bb, pos);
+					emitted_slots_.push_back(slot);
+					-- new_particle;
+				}
 			}
 		}
 
-		if (!actived_particles_.empty())
+		uint32_t const num_emitted = static_cast<uint32_t>(emitted_slots_.size());
+		if (num_emitted > 0)
 		{
-			if (sort_particles_)
+			ParticleSpan const span = emitted_particles_.Span(0, num_emitted);
+			for (auto const & updater : updaters_)
 			{
-				std::sort(actived_particles_.begin(), actived_particles_.end(),
-					[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
-					{
-						return lhs.second > rhs.second;
-					});
+				updater->Update(span, 0);
 			}
 
-			checked_cast<RenderParticles&>(*render_particles_).PosBound(AABBox(min_bb, max_bb));
+			for (uint32_t i = 0; i < num_emitted; ++ i)
+			{
+				particles_.Set(emitted_slots_[i], emitted_particles_.Get(i));
+			}
 		}
 	}
 
@@ -885,16 +1037,29 @@ namespace KlayGE
 			{
 				GraphicsBuffer::Mapper mapper(*instance_gb, BA_Write_Only);
 				ParticleInstance* instance_data = mapper.Pointer<ParticleInstance>();
-				for (uint32_t i = 0; i < num_active_particles; ++ i, ++ instance_data)
-				{
-					Particle const & par = particles_[actived_particles_[i].first];
-					instance_data->pos = par.pos;
-					instance_data->life = par.life;
-					instance_data->spin = par.spin;
-					instance_data->size = par.size;
-					instance_data->life_factor = (par.init_life - par.life) / par.init_life;
-					instance_data->alpha = par.alpha;
-				}
+				Context::Instance().ThreadPoolInstance().ParallelFor(0, num_active_particles, PARTICLE_CHUNK_SIZE,
+					[this, instance_data](uint32_t sub_begin, uint32_t sub_end)
+					{
+						float const * pos_x = particles_.PosX();
+						float const * pos_y = particles_.PosY();
+						float const * pos_z = particles_.PosZ();
+						float const * life = particles_.Life();
+						float const * spin = particles_.Spin();
+						float const * size = particles_.ParticleSize();
+						float const * alpha = particles_.Alpha();
+						float const * init_life = particles_.InitLife();
+						for (uint32_t i = sub_begin; i < sub_end; ++ i)
+						{
+							uint32_t const index = actived_particles_[i].first;
+							ParticleInstance& instance = instance_data[i];
+							instance.pos = float3(pos_x[index], pos_y[index], pos_z[index]);
+							instance.life = life[index];
+							instance.spin = spin[index];
+							instance.size = size[index];
+							instance.life_factor = (init_life[index] - life[index]) / init_life[index];
+							instance.alpha = alpha[index];
+						}
+					});
 			}
 		}
 	}
@@ -1146,59 +1311,148 @@ namespace KlayGE
 		return ret;
 	}
 
-	void PolylineParticleUpdater::Update(Particle& par, float elapse_time)
+	void PolylineParticleUpdater::Update(ParticleSpan const & pars, float elapse_time)
 	{
 		BOOST_ASSERT(!this_frame_size_over_life_.empty());
 		BOOST_ASSERT(!this_frame_mass_over_life_.empty());
 		BOOST_ASSERT(!this_frame_opacity_over_life_.empty());
 
-		float pos = (par.init_life - par.life) / par.init_life;
+		ParticleSystemPtr ps = ps_.lock();
+		float const buoyancy_scale = 4.0f / 3 * PI;
+		float const media_density = ps->MediaDensity();
+		float const gravity = ps->Gravity();
+		float3 const force = ps->Force();
 
-		float cur_size = this_frame_size_over_life_.back().y();
-		for (auto iter = std::next(this_frame_size_over_life_.begin()); iter != this_frame_size_over_life_.end(); ++ iter)
+		uint32_t i = 0;
+#if defined(KLAYGE_AVX_SUPPORT)
 		{
-			if (iter->x() >= pos)
+			__m256 const zero = _mm256_setzero_ps();
+			__m256 const dt = _mm256_set1_ps(elapse_time);
+			__m256 const spin_inc = _mm256_set1_ps(0.001f);
+			for (; i + 8 <= pars.num; i += 8)
 			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_size = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
+				__m256 const life = _mm256_loadu_ps(pars.life + i);
+				__m256 const alive = _mm256_cmp_ps(life, zero, _CMP_GT_OQ);
+				if (_mm256_movemask_ps(alive) == 0)
+				{
+					continue;
+				}
+
+				__m256 const init_life = _mm256_loadu_ps(pars.init_life + i);
+				__m256 const pos = _mm256_div_ps(_mm256_sub_ps(init_life, life), init_life);
+
+				__m256 const cur_size = EvalPolyline(this_frame_size_over_life_, pos);
+				__m256 const cur_mass = EvalPolyline(this_frame_mass_over_life_, pos);
+				__m256 const cur_alpha = EvalPolyline(this_frame_opacity_over_life_, pos);
+
+				__m256 const buoyancy = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(buoyancy_scale),
+					_mm256_mul_ps(_mm256_mul_ps(cur_size, cur_size), cur_size)), _mm256_set1_ps(media_density)), _mm256_set1_ps(gravity));
+				__m256 const inv_mass = _mm256_div_ps(_mm256_set1_ps(1.0f), cur_mass);
+				__m256 const accel_x = _mm256_mul_ps(_mm256_set1_ps(force.x()), inv_mass);
+				__m256 const accel_y = _mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(force.y()), buoyancy), inv_mass),
+					_mm256_set1_ps(gravity));
+				__m256 const accel_z = _mm256_mul_ps(_mm256_set1_ps(force.z()), inv_mass);
+
+				__m256 const vel_x = _mm256_add_ps(_mm256_loadu_ps(pars.vel_x + i), _mm256_mul_ps(accel_x, dt));
+				__m256 const vel_y = _mm256_add_ps(_mm256_loadu_ps(pars.vel_y + i), _mm256_mul_ps(accel_y, dt));
+				__m256 const vel_z = _mm256_add_ps(_mm256_loadu_ps(pars.vel_z + i), _mm256_mul_ps(accel_z, dt));
+				__m256 const pos_x = _mm256_add_ps(_mm256_loadu_ps(pars.pos_x + i), _mm256_mul_ps(vel_x, dt));
+				__m256 const pos_y = _mm256_add_ps(_mm256_loadu_ps(pars.pos_y + i), _mm256_mul_ps(vel_y, dt));
+				__m256 const pos_z = _mm256_add_ps(_mm256_loadu_ps(pars.pos_z + i), _mm256_mul_ps(vel_z, dt));
+
+				auto store = [alive](float* dst, __m256 v) { _mm256_storeu_ps(dst, _mm256_blendv_ps(_mm256_loadu_ps(dst), v, alive)); };
+				store(pars.vel_x + i, vel_x);
+				store(pars.vel_y + i, vel_y);
+				store(pars.vel_z + i, vel_z);
+				store(pars.pos_x + i, pos_x);
+				store(pars.pos_y + i, pos_y);
+				store(pars.pos_z + i, pos_z);
+				store(pars.life + i, _mm256_sub_ps(life, dt));
+				store(pars.spin + i, _mm256_add_ps(_mm256_loadu_ps(pars.spin + i), spin_inc));
+				store(pars.size + i, cur_size);
+				store(pars.alpha + i, cur_alpha);
 			}
 		}
-
-		float cur_mass = this_frame_mass_over_life_.back().y();
-		for (auto iter = std::next(this_frame_mass_over_life_.begin()); iter != this_frame_mass_over_life_.end(); ++ iter)
+#endif
+#if defined(KLAYGE_SSE2_SUPPORT)
 		{
-			if (iter->x() >= pos)
+			__m128 const zero = _mm_setzero_ps();
+			__m128 const dt = _mm_set1_ps(elapse_time);
+			__m128 const spin_inc = _mm_set1_ps(0.001f);
+			for (; i + 4 <= pars.num; i += 4)
 			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_mass = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
+				__m128 const life = _mm_loadu_ps(pars.life + i);
+				__m128 const alive = _mm_cmpgt_ps(life, zero);
+				if (_mm_movemask_ps(alive) == 0)
+				{
+					continue;
+				}
+
+				__m128 const init_life = _mm_loadu_ps(pars.init_life + i);
+				__m128 const pos = _mm_div_ps(_mm_sub_ps(init_life, life), init_life);
+
+				__m128 const cur_size = EvalPolyline(this_frame_size_over_life_, pos);
+				__m128 const cur_mass = EvalPolyline(this_frame_mass_over_life_, pos);
+				__m128 const cur_alpha = EvalPolyline(this_frame_opacity_over_life_, pos);
+
+				__m128 const buoyancy = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(buoyancy_scale),
+					_mm_mul_ps(_mm_mul_ps(cur_size, cur_size), cur_size)), _mm_set1_ps(media_density)), _mm_set1_ps(gravity));
+				__m128 const inv_mass = _mm_div_ps(_mm_set1_ps(1.0f), cur_mass);
+				__m128 const accel_x = _mm_mul_ps(_mm_set1_ps(force.x()), inv_mass);
+				__m128 const accel_y = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps(force.y()), buoyancy), inv_mass), _mm_set1_ps(gravity));
+				__m128 const accel_z = _mm_mul_ps(_mm_set1_ps(force.z()), inv_mass);
+
+				__m128 const vel_x = _mm_add_ps(_mm_loadu_ps(pars.vel_x + i), _mm_mul_ps(accel_x, dt));
+				__m128 const vel_y = _mm_add_ps(_mm_loadu_ps(pars.vel_y + i), _mm_mul_ps(accel_y, dt));
+				__m128 const vel_z = _mm_add_ps(_mm_loadu_ps(pars.vel_z + i), _mm_mul_ps(accel_z, dt));
+				__m128 const pos_x = _mm_add_ps(_mm_loadu_ps(pars.pos_x + i), _mm_mul_ps(vel_x, dt));
+				__m128 const pos_y = _mm_add_ps(_mm_loadu_ps(pars.pos_y + i), _mm_mul_ps(vel_y, dt));
+				__m128 const pos_z = _mm_add_ps(_mm_loadu_ps(pars.pos_z + i), _mm_mul_ps(vel_z, dt));
+
+				auto store = [alive](float* dst, __m128 v)
+				{
+					_mm_storeu_ps(dst, _mm_or_ps(_mm_and_ps(alive, v), _mm_andnot_ps(alive, _mm_loadu_ps(dst))));
+				};
+				store(pars.vel_x + i, vel_x);
+				store(pars.vel_y + i, vel_y);
+				store(pars.vel_z + i, vel_z);
+				store(pars.pos_x + i, pos_x);
+				store(pars.pos_y + i, pos_y);
+				store(pars.pos_z + i, pos_z);
+				store(pars.life + i, _mm_sub_ps(life, dt));
+				store(pars.spin + i, _mm_add_ps(_mm_loadu_ps(pars.spin + i), spin_inc));
+				store(pars.size + i, cur_size);
+				store(pars.alpha + i, cur_alpha);
 			}
 		}
+#endif
 
-		float cur_alpha = this_frame_opacity_over_life_.back().y();
-		for (auto iter = std::next(this_frame_opacity_over_life_.begin()); iter != this_frame_opacity_over_life_.end(); ++ iter)
+		for (; i < pars.num; ++ i)
 		{
-			if (iter->x() >= pos)
+			if (pars.life[i] <= 0)
 			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_alpha = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
+				continue;
 			}
-		}
 
-		ParticleSystemPtr ps = ps_.lock();
-		float buoyancy = 4.0f / 3 * PI * MathLib::cube(cur_size) * ps->MediaDensity() * ps->Gravity();
-		float3 accel = (ps->Force() + float3(0, buoyancy, 0)) / cur_mass - float3(0, ps->Gravity(), 0);
-		par.vel += accel * elapse_time;
-		par.pos += par.vel * elapse_time;
-		par.life -= elapse_time;
-		par.spin += 0.001f;
-		par.size = cur_size;
-		par.alpha = cur_alpha;
+			float const pos = (pars.init_life[i] - pars.life[i]) / pars.init_life[i];
+
+			float const cur_size = EvalPolyline(this_frame_size_over_life_, pos);
+			float const cur_mass = EvalPolyline(this_frame_mass_over_life_, pos);
+			float const cur_alpha = EvalPolyline(this_frame_opacity_over_life_, pos);
+
+			float const buoyancy = buoyancy_scale * MathLib::cube(cur_size) * media_density * gravity;
+			float3 const accel = (force + float3(0, buoyancy, 0)) / cur_mass - float3(0, gravity, 0);
+			pars.vel_x[i] += accel.x() * elapse_time;
+			pars.vel_y[i] += accel.y() * elapse_time;
+			pars.vel_z[i] += accel.z() * elapse_time;
+			pars.pos_x[i] += pars.vel_x[i] * elapse_time;
+			pars.pos_y[i] += pars.vel_y[i] * elapse_time;
+			pars.pos_z[i] += pars.vel_z[i] * elapse_time;
+			pars.life[i] -= elapse_time;
+			pars.spin[i] += 0.001f;
+			pars.size[i] = cur_size;
+			pars.alpha[i] = cur_alpha;
+		}
 	}
 
 	void PolylineParticleUpdater::SnapParams()
@@ -195,6 +195,15 @@ namespace
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, HashValue(pp_desc_.res_name));
+			HashCombine(seed, HashValue(pp_desc_.pp_name));
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
@@ -49,6 +49,7 @@
 #include <KFL/CXX20/format.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/StringUtil.hpp>
+#include <KFL/Thread.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/Context.hpp>
@@ -68,6 +69,7 @@
 #ifdef KLAYGE_CXX17_LIBRARY_CHARCONV_SUPPORT
 #include <charconv>
 #endif
+#include <utility>
 #include <variant>
 
 #include <boost/assert.hpp>
@@ -80,6 +82,18 @@ namespace
 
 	uint32_t const KFX_VERSION = 0x0150;
 
+	// Scrambles a name hash with a displacement, used by the perfect hash tables of the effect
+	uint64_t MixNameHash(size_t name_hash, uint32_t displacement) noexcept
+	{
+		uint64_t x = static_cast<uint64_t>(name_hash) ^ (displacement * 0x9E3779B97F4A7C15ULL);
+		x ^= x >> 33;
+		x *= 0xFF51AFD7ED558CCDULL;
+		x ^= x >> 33;
+		x *= 0xC4CEB9FE1A85EC53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+
 #if KLAYGE_IS_DEV_PLATFORM
 	std::unique_ptr<RenderVariable> LoadVariable(
 		RenderEffect const& effect, XMLNode const& node, RenderEffectDataType type, uint32_t array_size);
@@ -4240,6 +4254,17 @@ namespace KlayGE
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			for (auto const & name : effect_desc_.res_name)
+			{
+				HashCombine(seed, HashValue(name));
+			}
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
@@ -4542,6 +4567,141 @@ namespace KlayGE
 			}
 #endif
 		}
+
+		this->BuildLookupTables();
+	}
+
+	void RenderEffect::BuildLookupTables()
+	{
+		std::vector<size_t> name_hashes(params_.size());
+		for (size_t i = 0; i < params_.size(); ++i)
+		{
+			name_hashes[i] = params_[i].NameHash();
+		}
+		immutable_->param_table.Build(name_hashes);
+
+		name_hashes.resize(immutable_->techniques.size());
+		for (size_t i = 0; i < immutable_->techniques.size(); ++i)
+		{
+			name_hashes[i] = immutable_->techniques[i].NameHash();
+		}
+		immutable_->tech_table.Build(name_hashes);
+	}
+
+	void RenderEffect::NameHashTable::Build(std::span<size_t const> name_hashes)
+	{
+		displacements_.clear();
+		indices_.clear();
+
+		if (name_hashes.empty())
+		{
+			return;
+		}
+
+		uint32_t table_size = 1;
+		while (table_size < name_hashes.size())
+		{
+			table_size <<= 1;
+		}
+		uint32_t const mask = table_size - 1;
+
+		std::vector<std::vector<uint32_t>> buckets(table_size);
+		for (uint32_t i = 0; i < name_hashes.size(); ++i)
+		{
+			buckets[MixNameHash(name_hashes[i], 0) & mask].push_back(i);
+		}
+
+		std::vector<uint32_t> bucket_order(table_size);
+		for (uint32_t i = 0; i < table_size; ++i)
+		{
+			bucket_order[i] = i;
+		}
+		std::stable_sort(bucket_order.begin(), bucket_order.end(),
+			[&buckets](uint32_t lhs, uint32_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+		displacements_.assign(table_size, 0);
+		indices_.assign(table_size, static_cast<uint32_t>(-1));
+
+		// Larger buckets first, search for a displacement that puts all of its items into free slots
+		uint32_t const max_displacement = table_size * 64;
+		std::vector<uint32_t> slots;
+		uint32_t order_index = 0;
+		for (; order_index < table_size; ++order_index)
+		{
+			auto const& bucket = buckets[bucket_order[order_index]];
+			if (bucket.size() <= 1)
+			{
+				break;
+			}
+
+			bool placed = false;
+			for (uint32_t d = 1; (d < max_displacement) && !placed; ++d)
+			{
+				slots.clear();
+				placed = true;
+				for (uint32_t const item : bucket)
+				{
+					uint32_t const slot = static_cast<uint32_t>(MixNameHash(name_hashes[item], d) & mask);
+					if ((indices_[slot] != static_cast<uint32_t>(-1)) || (std::find(slots.begin(), slots.end(), slot) != slots.end()))
+					{
+						placed = false;
+						break;
+					}
+					slots.push_back(slot);
+				}
+
+				if (placed)
+				{
+					for (size_t i = 0; i < bucket.size(); ++i)
+					{
+						indices_[slots[i]] = bucket[i];
+					}
+					displacements_[bucket_order[order_index]] = static_cast<int32_t>(d);
+				}
+			}
+
+			if (!placed)
+			{
+				// Usually duplicated names. Leave the table empty, lookups fall back to linear scans.
+				displacements_.clear();
+				indices_.clear();
+				return;
+			}
+		}
+
+		// Single item buckets go directly to the remaining free slots
+		uint32_t free_slot = 0;
+		for (; order_index < table_size; ++order_index)
+		{
+			auto const& bucket = buckets[bucket_order[order_index]];
+			if (bucket.empty())
+			{
+				break;
+			}
+
+			while (indices_[free_slot] != static_cast<uint32_t>(-1))
+			{
+				++free_slot;
+			}
+			indices_[free_slot] = bucket[0];
+			displacements_[bucket_order[order_index]] = -static_cast<int32_t>(free_slot) - 1;
+		}
+	}
+
+	uint32_t RenderEffect::NameHashTable::Find(size_t name_hash) const noexcept
+	{
+		BOOST_ASSERT(!this->Empty());
+
+		uint32_t const mask = static_cast<uint32_t>(indices_.size() - 1);
+		int32_t const d = displacements_[MixNameHash(name_hash, 0) & mask];
+		if (d < 0)
+		{
+			return indices_[-d - 1];
+		}
+		else
+		{
+			return indices_[MixNameHash(name_hash, d) & mask];
+		}
 	}
 
 #if KLAYGE_IS_DEV_PLATFORM
@@ -4549,11 +4709,43 @@ namespace KlayGE
 	{
 		if (immutable_->need_compile)
 		{
-			uint32_t tech_index = 0;
-			for (auto& tech : immutable_->techniques)
+			struct StageJob
+			{
+				uint32_t tech_index;
+				uint32_t pass_index;
+				ShaderStage stage;
+			};
+
+			// Every stage is an independent job. Domain shaders read their hull shader's compile results on some back ends,
+			// so they go in a second round.
+			std::vector<StageJob> jobs;
+			std::vector<StageJob> domain_jobs;
+			for (uint32_t tech_index = 0; tech_index < immutable_->techniques.size(); ++tech_index)
 			{
-				tech.CompileShaders(*this, tech_index);
-				++tech_index;
+				auto const& tech = immutable_->techniques[tech_index];
+				for (uint32_t pass_index = 0; pass_index < tech.NumPasses(); ++pass_index)
+				{
+					for (uint32_t stage_index = 0; stage_index < NumShaderStages; ++stage_index)
+					{
+						ShaderStage const stage = static_cast<ShaderStage>(stage_index);
+						auto& round = (stage == ShaderStage::Domain) ? domain_jobs : jobs;
+						round.push_back({tech_index, pass_index, stage});
+					}
+				}
+			}
+
+			auto& thread_pool = Context::Instance().ThreadPoolInstance();
+			for (auto const* round : {&jobs, &domain_jobs})
+			{
+				thread_pool.ParallelFor(0, static_cast<uint32_t>(round->size()), 1, [this, round](uint32_t sub_begin, uint32_t sub_end)
+					{
+						for (uint32_t i = sub_begin; i < sub_end; ++i)
+						{
+							StageJob const& job = (*round)[i];
+							immutable_->techniques[job.tech_index].Pass(job.pass_index).CompileShader(
+								*this, job.tech_index, job.pass_index, job.stage);
+						}
+					});
 			}
 
 			std::ofstream ofs(immutable_->kfx_name.c_str(), std::ios_base::binary | std::ios_base::out);
@@ -4663,25 +4855,38 @@ namespace KlayGE
 
 	RenderEffectParameter* RenderEffect::ParameterByName(std::string_view name) noexcept
 	{
-		size_t const name_hash = HashValue(std::move(name));
-		for (auto& param : params_)
-		{
-			if (name_hash == param.NameHash())
-			{
-				return &param;
-			}
-		}
-		return nullptr;
+		return this->ParameterByName(RenderEffectHandle(std::move(name)));
 	}
 
 	RenderEffectParameter const* RenderEffect::ParameterByName(std::string_view name) const noexcept
 	{
-		size_t const name_hash = HashValue(std::move(name));
-		for (auto const& param : params_)
+		return this->ParameterByName(RenderEffectHandle(std::move(name)));
+	}
+
+	RenderEffectParameter* RenderEffect::ParameterByName(RenderEffectHandle handle) noexcept
+	{
+		return const_cast<RenderEffectParameter*>(std::as_const(*this).ParameterByName(handle));
+	}
+
+	RenderEffectParameter const* RenderEffect::ParameterByName(RenderEffectHandle handle) const noexcept
+	{
+		size_t const name_hash = handle.NameHash();
+		if (immutable_ && !immutable_->param_table.Empty())
 		{
-			if (name_hash == param.NameHash())
+			uint32_t const index = immutable_->param_table.Find(name_hash);
+			if ((index < params_.size()) && (params_[index].NameHash() == name_hash))
 			{
-				return &param;
+				return &params_[index];
+			}
+		}
+		else
+		{
+			for (auto const& param : params_)
+			{
+				if (name_hash == param.NameHash())
+				{
+					return &param;
+				}
 			}
 		}
 		return nullptr;
@@ -4772,12 +4977,29 @@ namespace KlayGE
 
 	RenderTechnique* RenderEffect::TechniqueByName(std::string_view name) const noexcept
 	{
-		size_t const name_hash = HashValue(std::move(name));
-		for (auto& tech : immutable_->techniques)
+		return this->TechniqueByName(RenderEffectHandle(std::move(name)));
+	}
+
+	RenderTechnique* RenderEffect::TechniqueByName(RenderEffectHandle handle) const noexcept
+	{
+		size_t const name_hash = handle.NameHash();
+		auto& techniques = immutable_->techniques;
+		if (!immutable_->tech_table.Empty())
+		{
+			uint32_t const index = immutable_->tech_table.Find(name_hash);
+			if ((index < techniques.size()) && (techniques[index].NameHash() == name_hash))
+			{
+				return &techniques[index];
+			}
+		}
+		else
 		{
-			if (name_hash == tech.NameHash())
+			for (auto& tech : techniques)
 			{
-				return &tech;
+				if (name_hash == tech.NameHash())
+				{
+					return &tech;
+				}
 			}
 		}
 		return nullptr;
@@ -6742,18 +6964,22 @@ namespace KlayGE
 
 	void RenderPass::CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index)
 	{
-		auto const & shader_obj = this->GetShaderObject(effect);
 		for (uint32_t stage_index = 0; stage_index < NumShaderStages; ++stage_index)
 		{
-			ShaderDesc const& sd = effect.GetShaderDesc(shader_desc_ids_[stage_index]);
-			if (!sd.func_name.empty())
+			this->CompileShader(effect, tech_index, pass_index, static_cast<ShaderStage>(stage_index));
+		}
+	}
+
+	void RenderPass::CompileShader(RenderEffect const& effect, uint32_t tech_index, uint32_t pass_index, ShaderStage stage) const
+	{
+		uint32_t const stage_index = static_cast<uint32_t>(stage);
+		ShaderDesc const& sd = effect.GetShaderDesc(shader_desc_ids_[stage_index]);
+		if (!sd.func_name.empty())
+		{
+			if (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + stage_index)
 			{
-				ShaderStage const stage = static_cast<ShaderStage>(stage_index);
-				if (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + stage_index)
-				{
-					auto const & tech = *effect.TechniqueByIndex(tech_index);
-					shader_obj->Stage(stage)->CompileShader(effect, tech, *this, shader_desc_ids_);
-				}
+				auto const & tech = *effect.TechniqueByIndex(tech_index);
+				this->GetShaderObject(effect)->Stage(stage)->CompileShader(effect, tech, *this, shader_desc_ids_);
 			}
 		}
 	}
@@ -606,6 +606,18 @@ namespace KlayGE
 	{
 		if (tech.HWResourceReady(effect))
 		{
+			if ((&effect == last_effect_) && (&tech == last_tech_))
+			{
+				++ num_redundant_binds_just_called_;
+			}
+			if (&rl == last_layout_)
+			{
+				++ num_redundant_binds_just_called_;
+			}
+			last_effect_ = &effect;
+			last_tech_ = &tech;
+			last_layout_ = &rl;
+
 			this->DoRender(effect, tech, rl);
 		}
 	}
@@ -614,6 +626,7 @@ namespace KlayGE
 	{
 		if (tech.HWResourceReady(effect))
 		{
+			last_tech_ = nullptr;
 			this->DoDispatch(effect, tech, tgx, tgy, tgz);
 		}
 	}
@@ -623,6 +636,7 @@ namespace KlayGE
 	{
 		if (tech.HWResourceReady(effect))
 		{
+			last_tech_ = nullptr;
 			this->DoDispatchIndirect(effect, tech, buff_args, offset);
 		}
 	}
@@ -659,6 +673,13 @@ namespace KlayGE
 		return ret;
 	}
 
+	uint32_t RenderEngine::NumRedundantBindsJustCalled()
+	{
+		uint32_t const ret = num_redundant_binds_just_called_;
+		num_redundant_binds_just_called_ = 0;
+		return ret;
+	}
+
 	// ȡȾ豸
 	/////////////////////////////////////////////////////////////////////////////////
 	RenderDeviceCaps const & RenderEngine::DeviceCaps() const
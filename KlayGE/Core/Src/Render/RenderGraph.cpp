@@ -0,0 +1,283 @@
+/**
+ * @file RenderGraph.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/Texture.hpp>
+
+#include <algorithm>
+
+#include <KlayGE/RenderGraph.hpp>
+
+namespace KlayGE
+{
+	uint64_t RenderGraph::TextureDesc::NumBytes() const noexcept
+	{
+		uint64_t const texel_size = static_cast<uint64_t>(NumFormatBytes(format)) * array_size * sample_count;
+
+		uint64_t ret = 0;
+		uint32_t w = width;
+		uint32_t h = height;
+		for (uint32_t level = 0; level < num_mip_maps; ++ level)
+		{
+			ret += texel_size * w * h;
+
+			w = std::max(1U, w / 2);
+			h = std::max(1U, h / 2);
+		}
+		return ret;
+	}
+
+	bool RenderGraph::TextureDesc::operator==(TextureDesc const& rhs) const noexcept
+	{
+		return (width == rhs.width) && (height == rhs.height) && (num_mip_maps == rhs.num_mip_maps)
+			&& (array_size == rhs.array_size) && (format == rhs.format) && (sample_count == rhs.sample_count)
+			&& (sample_quality == rhs.sample_quality) && (access_hint == rhs.access_hint);
+	}
+
+
+	RenderGraph::RenderGraph()
+	{
+		report_ = {};
+	}
+
+	void RenderGraph::Clear()
+	{
+		textures_.clear();
+		passes_.clear();
+		compiled_ = false;
+		report_ = {};
+	}
+
+	uint32_t RenderGraph::AddTexture(std::string_view name, TextureDesc const& desc)
+	{
+		BOOST_ASSERT(desc.width * desc.height * desc.num_mip_maps * desc.array_size * desc.sample_count != 0);
+
+		auto& node = textures_.emplace_back();
+		node.name = std::string(name);
+		node.desc = desc;
+		node.imported = false;
+		compiled_ = false;
+		return static_cast<uint32_t>(textures_.size() - 1);
+	}
+
+	uint32_t RenderGraph::ImportTexture(std::string_view name, TexturePtr const& tex)
+	{
+		auto& node = textures_.emplace_back();
+		node.name = std::string(name);
+		node.desc = {};
+		node.imported = true;
+		node.imported_tex = tex;
+		compiled_ = false;
+		return static_cast<uint32_t>(textures_.size() - 1);
+	}
+
+	uint32_t RenderGraph::AddPass(std::string_view name, std::span<uint32_t const> reads, std::span<uint32_t const> writes)
+	{
+		auto& node = passes_.emplace_back();
+		node.name = std::string(name);
+		node.reads.assign(reads.begin(), reads.end());
+		node.writes.assign(writes.begin(), writes.end());
+		compiled_ = false;
+
+#ifdef KLAYGE_DEBUG
+		for (auto tex : node.reads)
+		{
+			BOOST_ASSERT(tex < textures_.size());
+		}
+		for (auto tex : node.writes)
+		{
+			BOOST_ASSERT(tex < textures_.size());
+		}
+#endif
+
+		return static_cast<uint32_t>(passes_.size() - 1);
+	}
+
+	void RenderGraph::Compile()
+	{
+		for (auto& tex : textures_)
+		{
+			tex.first_pass = InvalidIndex;
+			tex.last_pass = 0;
+			tex.physical = InvalidIndex;
+		}
+		for (uint32_t i = 0; i < passes_.size(); ++ i)
+		{
+			auto const& pass = passes_[i];
+			auto touch = [this, i](uint32_t tex)
+			{
+				auto& node = textures_[tex];
+				node.first_pass = std::min(node.first_pass, i);
+				node.last_pass = std::max(node.last_pass, i);
+			};
+			std::for_each(pass.reads.begin(), pass.reads.end(), touch);
+			std::for_each(pass.writes.begin(), pass.writes.end(), touch);
+		}
+
+		std::vector<uint32_t> order;
+		for (uint32_t i = 0; i < textures_.size(); ++ i)
+		{
+			auto const& tex = textures_[i];
+			if (!tex.imported && (tex.first_pass != InvalidIndex))
+			{
+				order.push_back(i);
+			}
+		}
+		std::stable_sort(order.begin(), order.end(),
+			[this](uint32_t lhs, uint32_t rhs) { return textures_[lhs].first_pass < textures_[rhs].first_pass; });
+
+		// Greedy interval packing. Physical textures survive from the last compile, so their order stays stable and Realize
+		//  can keep the resources.
+		for (auto& phy : physical_textures_)
+		{
+			phy.last_pass = InvalidIndex;
+		}
+		std::vector<bool> used(physical_textures_.size());
+
+		report_ = {};
+		for (auto const i : order)
+		{
+			auto& tex = textures_[i];
+
+			uint32_t slot = InvalidIndex;
+			for (uint32_t s = 0; s < physical_textures_.size(); ++ s)
+			{
+				auto const& phy = physical_textures_[s];
+				if ((phy.desc == tex.desc) && ((phy.last_pass == InvalidIndex) || (phy.last_pass < tex.first_pass)))
+				{
+					slot = s;
+					break;
+				}
+			}
+			if (slot == InvalidIndex)
+			{
+				slot = static_cast<uint32_t>(physical_textures_.size());
+				physical_textures_.push_back({tex.desc, InvalidIndex, TexturePtr()});
+				used.push_back(false);
+			}
+
+			physical_textures_[slot].last_pass = tex.last_pass;
+			tex.physical = slot;
+
+			++ report_.num_transient_textures;
+			report_.requested_bytes += tex.desc.NumBytes();
+			if (!used[slot])
+			{
+				used[slot] = true;
+				++ report_.num_physical_textures;
+				report_.allocated_bytes += tex.desc.NumBytes();
+			}
+		}
+
+		// Drops the leftovers, and renumbers the rest
+		std::vector<uint32_t> remap(physical_textures_.size(), InvalidIndex);
+		uint32_t num_used = 0;
+		for (uint32_t s = 0; s < physical_textures_.size(); ++ s)
+		{
+			if (used[s])
+			{
+				remap[s] = num_used;
+				if (s != num_used)
+				{
+					physical_textures_[num_used] = std::move(physical_textures_[s]);
+				}
+				++ num_used;
+			}
+		}
+		physical_textures_.resize(num_used);
+		for (auto& tex : textures_)
+		{
+			if (tex.physical != InvalidIndex)
+			{
+				tex.physical = remap[tex.physical];
+			}
+		}
+
+		compiled_ = true;
+	}
+
+	void RenderGraph::Realize()
+	{
+		BOOST_ASSERT(compiled_);
+
+		auto& rf = Context::Instance().RenderFactoryInstance();
+		for (auto& phy : physical_textures_)
+		{
+			if (!phy.tex)
+			{
+				auto const& desc = phy.desc;
+				phy.tex = rf.MakeTexture2D(desc.width, desc.height, desc.num_mip_maps, desc.array_size, desc.format, desc.sample_count,
+					desc.sample_quality, desc.access_hint);
+			}
+		}
+	}
+
+	std::string const& RenderGraph::PassName(uint32_t pass) const
+	{
+		BOOST_ASSERT(pass < passes_.size());
+		return passes_[pass].name;
+	}
+
+	std::string const& RenderGraph::TextureName(uint32_t tex) const
+	{
+		BOOST_ASSERT(tex < textures_.size());
+		return textures_[tex].name;
+	}
+
+	uint32_t RenderGraph::PhysicalIndex(uint32_t tex) const
+	{
+		BOOST_ASSERT(compiled_);
+		BOOST_ASSERT(tex < textures_.size());
+		return textures_[tex].physical;
+	}
+
+	TexturePtr const& RenderGraph::Texture(uint32_t tex) const
+	{
+		BOOST_ASSERT(compiled_);
+		BOOST_ASSERT(tex < textures_.size());
+
+		auto const& node = textures_[tex];
+		if (node.imported)
+		{
+			return node.imported_tex;
+		}
+		else if (node.physical != InvalidIndex)
+		{
+			return physical_textures_[node.physical].tex;
+		}
+		else
+		{
+			static TexturePtr const null_tex;
+			return null_tex;
+		}
+	}
+} // namespace KlayGE
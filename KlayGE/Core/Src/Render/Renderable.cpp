@@ -248,6 +248,12 @@ namespace KlayGE
 		return pos_aabb_;
 	}
 
+	void Renderable::PosBound(AABBox const & aabb)
+	{
+		pos_aabb_ = aabb;
+		++ pos_bound_version_;
+	}
+
 	AABBox const & Renderable::TexcoordBound() const
 	{
 		return tc_aabb_;
@@ -672,7 +678,7 @@ namespace KlayGE
 
 
 	RenderableComponent::RenderableComponent(RenderablePtr const& renderable)
-		: renderable_(renderable)
+		: renderable_(renderable), pos_bound_version_(renderable->PosBoundVersion())
 	{
 		BOOST_ASSERT(renderable);
 	}
@@ -686,4 +692,12 @@ namespace KlayGE
 	{
 		return *renderable_;
 	}
+
+	bool RenderableComponent::PosBoundChanged()
+	{
+		uint32_t const version = renderable_->PosBoundVersion();
+		bool const changed = (pos_bound_version_ != version);
+		pos_bound_version_ = version;
+		return changed;
+	}
 }
@@ -30,7 +30,10 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/CXX20/format.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/Hash.hpp>
 #include <KFL/com_ptr.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/RenderEffect.hpp>
@@ -40,11 +43,16 @@
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/CustomizedStreamBuf.hpp>
 
+#include <atomic>
+#include <cstring>
+#include <list>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <fstream>
+#include <unordered_map>
 
 #include <KlayGE/ShaderObject.hpp>
 
@@ -142,7 +150,9 @@ namespace
 			}
 			return hr;
 #else
-			std::string mark = std::to_string(reinterpret_cast<uint64_t>(src_data.c_str()));
+			// Stages can be compiled concurrently, so every compile needs its own temporary files
+			static std::atomic<uint32_t> compile_counter{0};
+			std::string mark = std::to_string(reinterpret_cast<uint64_t>(src_data.c_str())) + '_' + std::to_string(compile_counter++);
 			std::string compile_input_file = entry_point + mark + "Input.tmp";
 			std::string compile_output_file = entry_point + mark + "Output.tmp";
 
@@ -180,16 +190,14 @@ namespace
 #ifdef KLAYGE_PLATFORM_WINDOWS
 			ss << d3dcompiler_wrapper_name << ".exe";
 #else
-			static bool first = true;
-			if (first)
-			{
-				ss << KFL_STRINGIZE(WINE_PATH) << "wineserver -p";
-				int err = system(ss.str().c_str());
-				KFL_UNUSED(err);
-				// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
-				first = false;
-				ss.str(std::string());
-			}
+			static std::once_flag wineserver_flag;
+			std::call_once(wineserver_flag, []
+				{
+					std::string const wineserver_cmd = std::string(KFL_STRINGIZE(WINE_PATH)) + "wineserver -p";
+					int err = system(wineserver_cmd.c_str());
+					KFL_UNUSED(err);
+					// We should hold on a persistant wineserver, or XCode will lost connection after wineserver instance close and wine may not be able to find '.exe.so' file
+				});
 			d3dcompiler_wrapper_name += ".exe.so";
 			std::string wrapper_path = ResLoader::Instance().Locate(d3dcompiler_wrapper_name);
 			ss << KFL_STRINGIZE(WINE_PATH) << "wine " << wrapper_path;
@@ -301,6 +309,142 @@ namespace
 		D3DStripShaderFunc DynamicD3DStripShader_;
 #endif
 	};
+
+	// Compiled shader blobs keyed by a SHA-256 of everything that affects the compiler output. It's shared by all effects and
+	// kept on disk, so identical stage permutations compile once, and a rebuilt .kfx only recompiles the stages that changed.
+	// The blobs in memory are capped, the least recently used ones go first.
+	class ShaderBytecodeCache
+	{
+	public:
+		using Key = Sha256::Digest;
+
+		static ShaderBytecodeCache& Instance()
+		{
+			static ShaderBytecodeCache cache;
+			return cache;
+		}
+
+		bool Find(Key const& key, std::vector<uint8_t>& code)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				auto iter = blob_map_.find(key);
+				if (iter != blob_map_.end())
+				{
+					blobs_.splice(blobs_.begin(), blobs_, iter->second);
+					code = iter->second->second;
+					return true;
+				}
+			}
+
+			std::ifstream ifs(this->BlobPath(key).c_str(), std::ios_base::binary);
+			if (ifs)
+			{
+				uint32_t fourcc = 0;
+				Key stored_key;
+				uint32_t size = 0;
+				ifs.read(reinterpret_cast<char*>(&fourcc), sizeof(fourcc));
+				ifs.read(reinterpret_cast<char*>(stored_key.data()), stored_key.size());
+				ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
+				if (ifs && (LE2Native(fourcc) == BLOB_FOURCC) && (stored_key == key))
+				{
+					code.resize(LE2Native(size));
+					ifs.read(reinterpret_cast<char*>(code.data()), code.size());
+					if (ifs && !code.empty())
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+						this->AddToMemoryNoLock(key, code);
+						return true;
+					}
+				}
+			}
+
+			return false;
+		}
+
+		void Add(Key const& key, std::vector<uint8_t> const& code)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				this->AddToMemoryNoLock(key, code);
+			}
+
+			// Written under a temporary name first, so a reader never sees a half written blob
+			std::string const blob_path = this->BlobPath(key);
+			std::string const tmp_path = std::format("{}.{}.tmp", blob_path, tmp_counter_++);
+			{
+				std::ofstream ofs(tmp_path.c_str(), std::ios_base::binary);
+				uint32_t const fourcc = Native2LE(BLOB_FOURCC);
+				uint32_t const size = Native2LE(static_cast<uint32_t>(code.size()));
+				ofs.write(reinterpret_cast<char const*>(&fourcc), sizeof(fourcc));
+				ofs.write(reinterpret_cast<char const*>(key.data()), key.size());
+				ofs.write(reinterpret_cast<char const*>(&size), sizeof(size));
+				ofs.write(reinterpret_cast<char const*>(code.data()), code.size());
+			}
+			std::error_code ec;
+			FILESYSTEM_NS::rename(tmp_path, blob_path, ec);
+			if (ec)
+			{
+				FILESYSTEM_NS::remove(tmp_path, ec);
+			}
+		}
+
+	private:
+		ShaderBytecodeCache()
+			: cache_dir_(ResLoader::Instance().LocalFolder() + "ShaderCache/")
+		{
+			std::error_code ec;
+			FILESYSTEM_NS::create_directories(cache_dir_, ec);
+		}
+
+		std::string BlobPath(Key const& key) const
+		{
+			return std::format("{}{}.dxbc", cache_dir_, Sha256::ToString(key));
+		}
+
+		void AddToMemoryNoLock(Key const& key, std::vector<uint8_t> const& code)
+		{
+			if (blob_map_.find(key) != blob_map_.end())
+			{
+				return;
+			}
+
+			blobs_.emplace_front(key, code);
+			blob_map_.emplace(key, blobs_.begin());
+			memory_size_ += code.size();
+
+			while ((memory_size_ > MAX_MEMORY_SIZE) && (blobs_.size() > 1))
+			{
+				auto const & lru = blobs_.back();
+				memory_size_ -= lru.second.size();
+				blob_map_.erase(lru.first);
+				blobs_.pop_back();
+			}
+		}
+
+	private:
+		struct KeyHash
+		{
+			size_t operator()(Key const& key) const noexcept
+			{
+				// Already uniformly distributed
+				size_t ret;
+				std::memcpy(&ret, key.data(), sizeof(ret));
+				return ret;
+			}
+		};
+
+		static constexpr uint32_t BLOB_FOURCC = MakeFourCC<'S', 'B', 'C', '2'>::value;
+		static constexpr size_t MAX_MEMORY_SIZE = 64 * 1024 * 1024;
+
+		std::string cache_dir_;
+		std::mutex mutex_;
+		// Most recently used first
+		std::list<std::pair<Key, std::vector<uint8_t>>> blobs_;
+		std::unordered_map<Key, decltype(blobs_)::iterator, KeyHash> blob_map_;
+		size_t memory_size_ = 0;
+		std::atomic<uint32_t> tmp_counter_{0};
+	};
 }
 
 #endif
@@ -417,11 +561,43 @@ namespace KlayGE
 			macros.emplace_back(D3D_SHADER_MACRO{name_value.first.c_str(), name_value.second.c_str()});
 		}
 
+		ShaderBytecodeCache::Key cache_key;
+		{
+			// Strings are terminated, so moving a character from one to the next makes a different key
+			auto hash_string = [](Sha256& hasher, std::string_view str) {
+				hasher.Update(str);
+				hasher.Update(std::string_view("", 1));
+			};
+
+			Sha256 hasher;
+			hash_string(hasher, hlsl_shader_text);
+			for (auto const& macro : macros)
+			{
+				hash_string(hasher, macro.Name);
+				hash_string(hasher, macro.Definition);
+			}
+			hash_string(hasher, func_name);
+			hash_string(hasher, shader_profile);
+			uint32_t const le_flags = Native2LE(flags);
+			hasher.Update(std::span(reinterpret_cast<uint8_t const*>(&le_flags), sizeof(le_flags)));
+			cache_key = hasher.Final();
+		}
+
+		auto& bytecode_cache = ShaderBytecodeCache::Instance();
+		if (bytecode_cache.Find(cache_key, code))
+		{
+			return code;
+		}
+
 		macros.emplace_back(D3D_SHADER_MACRO{nullptr, nullptr});
 
 		D3DCompilerLoader::Instance().D3DCompile(hlsl_shader_text, &macros[0],
 			func_name, shader_profile,
 			flags, 0, code, err_msg);
+		if (!code.empty())
+		{
+			bytecode_cache.Add(cache_key, code);
+		}
 		if (!err_msg.empty())
 		{
 			LogError() << "Error when compiling " << func_name << ":" << std::endl;
@@ -29,10 +29,13 @@
 */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/Thread.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/Texture.hpp>
 
+#include <algorithm>
+#include <mutex>
 #include <vector>
 #include <cstring>
 
@@ -286,40 +289,131 @@ namespace KlayGE
 		KFL_UNUSED(out_slice_pitch);
 		KFL_UNUSED(in_slice_pitch);
 
+		uint32_t const block_height = BlockHeight(compression_format_);
+		uint32_t const num_block_rows = (height + block_height - 1) / block_height;
+
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
+
+		// A few chunks per thread (the caller runs chunks too) keeps the load balanced without paying the scheduling cost per row
+		uint32_t const num_threads = thread_pool.Scheduler().NumWorkers() + 1;
+		uint32_t const grain_size = std::max((num_block_rows + num_threads * 4 - 1) / (num_threads * 4), 1U);
+
+		// Worker codecs are created on demand and recycled across chunks, so there is at most one per concurrent thread
+		std::mutex worker_codecs_mutex;
+		std::vector<std::unique_ptr<TexCompression>> worker_codecs;
+
+		thread_pool.ParallelFor(0, num_block_rows, grain_size,
+			[this, width, height, output, out_row_pitch, input, in_row_pitch, method, &worker_codecs_mutex, &worker_codecs](
+				uint32_t row_begin, uint32_t row_end)
+			{
+				std::unique_ptr<TexCompression> worker_codec;
+				{
+					std::lock_guard<std::mutex> lock(worker_codecs_mutex);
+					if (!worker_codecs.empty())
+					{
+						worker_codec = std::move(worker_codecs.back());
+						worker_codecs.pop_back();
+					}
+				}
+				if (!worker_codec)
+				{
+					worker_codec = this->CreateWorkerCodec();
+				}
+
+				TexCompression& codec = worker_codec ? *worker_codec : *this;
+				codec.EncodeBlockRows(row_begin, row_end, width, height, output, out_row_pitch, input, in_row_pitch, method);
+
+				if (worker_codec)
+				{
+					std::lock_guard<std::mutex> lock(worker_codecs_mutex);
+					worker_codecs.push_back(std::move(worker_codec));
+				}
+			});
+	}
+
+	void TexCompression::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		uint32_t const block_bytes = BlockBytes(compression_format_);
+		uint32_t const uncompressed_block_bytes =
+			BlockWidth(compression_format_) * BlockHeight(compression_format_) * NumFormatBytes(DecodedFormat(compression_format_));
+
+		uint8_t* dst = static_cast<uint8_t*>(output);
+		uint8_t const * src = static_cast<uint8_t const *>(input);
+		for (uint32_t i = 0; i < num_blocks; ++ i)
+		{
+			this->EncodeBlock(dst, src, method);
+			dst += block_bytes;
+			src += uncompressed_block_bytes;
+		}
+	}
+
+	std::unique_ptr<TexCompression> TexCompression::CreateWorkerCodec() const
+	{
+		return std::unique_ptr<TexCompression>();
+	}
+
+	void TexCompression::EncodeBlockRows(uint32_t row_begin, uint32_t row_end, uint32_t width, uint32_t height,
+		void* output, uint32_t out_row_pitch, void const * input, uint32_t in_row_pitch,
+		TexCompressionMethod method)
+	{
 		uint32_t const elem_size = NumFormatBytes(DecodedFormat(compression_format_));
 		uint32_t const block_width = BlockWidth(compression_format_);
 		uint32_t const block_height = BlockHeight(compression_format_);
 		uint32_t const block_bytes = BlockBytes(compression_format_);
+		uint32_t const block_row_bytes = block_width * elem_size;
+		uint32_t const uncompressed_block_bytes = block_width * block_height * elem_size;
+
+		// Blocks are gathered in batches, so that codecs overriding EncodeBlocks can search several of them at once
+		uint32_t const BATCH_BLOCKS = 8;
 
 		uint8_t const * src = static_cast<uint8_t const *>(input);
 
-		std::vector<uint8_t> uncompressed(block_width * block_height * elem_size);
-		for (uint32_t y_base = 0; y_base < height; y_base += block_height)
+		std::vector<uint8_t> uncompressed_batch(BATCH_BLOCKS * uncompressed_block_bytes);
+		for (uint32_t row = row_begin; row < row_end; ++ row)
 		{
-			uint8_t* dst = static_cast<uint8_t*>(output) + (y_base / block_height) * out_row_pitch;
+			uint32_t const y_base = row * block_height;
+			uint8_t* dst = static_cast<uint8_t*>(output) + row * out_row_pitch;
 
+			uint32_t num_batched = 0;
 			for (uint32_t x_base = 0; x_base < width; x_base += block_width)
 			{
-				for (uint32_t y = 0; y < block_height; ++ y)
+				uint8_t* uncompressed = &uncompressed_batch[num_batched * uncompressed_block_bytes];
+				if ((x_base + block_width <= width) && (y_base + block_height <= height))
 				{
-					for (uint32_t x = 0; x < block_width; ++ x)
+					for (uint32_t y = 0; y < block_height; ++ y)
 					{
-						if ((x_base + x < width) && (y_base + y < height))
-						{
-							memcpy(&uncompressed[(y * block_width + x) * elem_size],
-								&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
-								elem_size);
-						}
-						else
+						memcpy(&uncompressed[y * block_row_bytes], &src[(y_base + y) * in_row_pitch + x_base * elem_size],
+							block_row_bytes);
+					}
+				}
+				else
+				{
+					for (uint32_t y = 0; y < block_height; ++ y)
+					{
+						for (uint32_t x = 0; x < block_width; ++ x)
 						{
-							memset(&uncompressed[(y * block_width + x) * elem_size],
-								0, elem_size);
+							if ((x_base + x < width) && (y_base + y < height))
+							{
+								memcpy(&uncompressed[(y * block_width + x) * elem_size],
+									&src[(y_base + y) * in_row_pitch + (x_base + x) * elem_size],
+									elem_size);
+							}
+							else
+							{
+								memset(&uncompressed[(y * block_width + x) * elem_size],
+									0, elem_size);
+							}
 						}
 					}
 				}
 
-				this->EncodeBlock(dst, &uncompressed[0], method);
-				dst += block_bytes;
+				++ num_batched;
+				if ((num_batched == BATCH_BLOCKS) || (x_base + block_width >= width))
+				{
+					this->EncodeBlocks(dst, &uncompressed_batch[0], num_batched, method);
+					dst += num_batched * block_bytes;
+					num_batched = 0;
+				}
 			}
 		}
 	}
@@ -34,15 +34,24 @@
 #include <KlayGE/Context.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KFL/Color.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KFL/Half.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <iterator>
 #include <random>
 #include <vector>
 #include <boost/assert.hpp>
 
+#if defined(KLAYGE_SSE2_SUPPORT)
+#include <emmintrin.h>
+#if defined(KLAYGE_TARGET_AVX2)
+#include <immintrin.h>
+#endif
+#endif
+
 #include <KlayGE/TexCompressionBC.hpp>
 #include "../Base/TableGen/Tables.hpp"
 
@@ -50,6 +59,56 @@ namespace
 {
 	using namespace KlayGE;
 
+	bool IsConstantBlock(ARGBColor32 const * argb)
+	{
+#if defined(KLAYGE_SSE2_SUPPORT)
+		__m128i const first = _mm_set1_epi32(static_cast<int>(argb[0].ARGB()));
+		__m128i eq = _mm_set1_epi32(-1);
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&argb[i]));
+			eq = _mm_and_si128(eq, _mm_cmpeq_epi32(v, first));
+		}
+		return 0xFFFF == _mm_movemask_epi8(eq);
+#else
+		for (int i = 1; i < 16; ++ i)
+		{
+			if (argb[i].ARGB() != argb[0].ARGB())
+			{
+				return false;
+			}
+		}
+		return true;
+#endif
+	}
+
+	// dots[i] = r * dirr + g * dirg + b * dirb for all 16 pixels of a block
+	void ProjectBlockColors(int* dots, ARGBColor32 const * argb, int dirr, int dirg, int dirb)
+	{
+#if defined(KLAYGE_SSE2_SUPPORT)
+		// Channels are widened to 16 bits, so that madd produces b * dirb + g * dirg and r * dirr per pixel
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const dir = _mm_set_epi16(0, static_cast<int16_t>(dirr), static_cast<int16_t>(dirg), static_cast<int16_t>(dirb),
+			0, static_cast<int16_t>(dirr), static_cast<int16_t>(dirg), static_cast<int16_t>(dirb));
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&argb[i]));
+			__m128i const lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), dir);
+			__m128i const hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), dir);
+			__m128 const lo_f = _mm_castsi128_ps(lo);
+			__m128 const hi_f = _mm_castsi128_ps(hi);
+			__m128i const even = _mm_castps_si128(_mm_shuffle_ps(lo_f, hi_f, _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i const odd = _mm_castps_si128(_mm_shuffle_ps(lo_f, hi_f, _MM_SHUFFLE(3, 1, 3, 1)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&dots[i]), _mm_add_epi32(even, odd));
+		}
+#else
+		for (int i = 0; i < 16; ++ i)
+		{
+			dots[i] = argb[i].r() * dirr + argb[i].g() * dirg + argb[i].b() * dirb;
+		}
+#endif
+	}
+
 	static int const BC67_PREC_WEIGHTS[][16] =
 	{
 		{ 0, 21, 43, 64 },
@@ -843,6 +902,227 @@ namespace
 		std::uniform_int_distribution<int> random_dis(0, RAND_MAX);
 		return random_dis(gen);
 	}
+
+	void PackBC4Indices(BC4Block& bc4, int16_t const * indices)
+	{
+		int bits = 0, mask = 0;
+		int dest = 0;
+		for (int i = 0; i < 16; ++ i)
+		{
+			int const ind = indices[i];
+
+			// write index
+			mask |= ind << bits;
+			if ((bits += 3) >= 8)
+			{
+				bc4.bitmap[dest] = static_cast<uint8_t>(mask);
+				++ dest;
+				mask >>= 8;
+				bits -= 8;
+			}
+		}
+	}
+
+	// Alpha block compression (this is easy for a change)
+	void EncodeBC4Block(BC4Block& bc4, uint8_t const * r)
+	{
+		// find min/max color
+		int min, max;
+#if defined(KLAYGE_SSE2_SUPPORT)
+		__m128i const r_v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(r));
+		__m128i min_v = r_v;
+		__m128i max_v = r_v;
+		min_v = _mm_min_epu8(min_v, _mm_srli_si128(min_v, 8));
+		max_v = _mm_max_epu8(max_v, _mm_srli_si128(max_v, 8));
+		min_v = _mm_min_epu8(min_v, _mm_srli_si128(min_v, 4));
+		max_v = _mm_max_epu8(max_v, _mm_srli_si128(max_v, 4));
+		min_v = _mm_min_epu8(min_v, _mm_srli_si128(min_v, 2));
+		max_v = _mm_max_epu8(max_v, _mm_srli_si128(max_v, 2));
+		min_v = _mm_min_epu8(min_v, _mm_srli_si128(min_v, 1));
+		max_v = _mm_max_epu8(max_v, _mm_srli_si128(max_v, 1));
+		min = _mm_cvtsi128_si32(min_v) & 0xFF;
+		max = _mm_cvtsi128_si32(max_v) & 0xFF;
+#else
+		min = max = r[0];
+
+		for (int i = 1; i < 16; ++ i)
+		{
+			min = std::min<int>(min, r[i]);
+			max = std::max<int>(max, r[i]);
+		}
+#endif
+
+		// encode them
+		bc4.alpha_0 = static_cast<uint8_t>(max);
+		bc4.alpha_1 = static_cast<uint8_t>(min);
+
+		// determine bias and emit color indices
+		int dist = max - min;
+		int bias = min * 7 - (dist >> 1);
+		int dist4 = dist * 4;
+		int dist2 = dist * 2;
+
+		int16_t indices[16];
+#if defined(KLAYGE_SSE2_SUPPORT)
+		{
+			// Same bit magic as the scalar path below, 8 pixels per register. All intermediates fit in 16 bits.
+			__m128i const zero = _mm_setzero_si128();
+			__m128i const seven = _mm_set1_epi16(7);
+			__m128i const bias_v = _mm_set1_epi16(static_cast<int16_t>(bias));
+			__m128i const dist_v = _mm_set1_epi16(static_cast<int16_t>(dist));
+			__m128i const dist2_v = _mm_set1_epi16(static_cast<int16_t>(dist2));
+			__m128i const dist4_v = _mm_set1_epi16(static_cast<int16_t>(dist4));
+			__m128i const one = _mm_set1_epi16(1);
+			__m128i const two = _mm_set1_epi16(2);
+			__m128i const four = _mm_set1_epi16(4);
+
+			__m128i const halves[] = { _mm_unpacklo_epi8(r_v, zero), _mm_unpackhi_epi8(r_v, zero) };
+			for (int h = 0; h < 2; ++ h)
+			{
+				__m128i a = _mm_sub_epi16(_mm_mullo_epi16(halves[h], seven), bias_v);
+
+				__m128i t = _mm_cmpgt_epi16(a, dist4_v);
+				__m128i ind = _mm_and_si128(t, four);
+				a = _mm_sub_epi16(a, _mm_and_si128(dist4_v, t));
+				t = _mm_cmpgt_epi16(a, dist2_v);
+				ind = _mm_add_epi16(ind, _mm_and_si128(t, two));
+				a = _mm_sub_epi16(a, _mm_and_si128(dist2_v, t));
+				t = _mm_cmpgt_epi16(a, dist_v);
+				ind = _mm_add_epi16(ind, _mm_and_si128(t, one));
+
+				ind = _mm_and_si128(_mm_sub_epi16(zero, ind), seven);
+				ind = _mm_xor_si128(ind, _mm_and_si128(_mm_cmpgt_epi16(two, ind), one));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&indices[h * 8]), ind);
+			}
+		}
+#else
+		for (int i = 0; i < 16; ++ i)
+		{
+			int a = r[i] * 7 - bias;
+			int ind, t;
+
+			// select index (hooray for bit magic)
+			t = (dist4 - a) >> 31;  ind = t & 4; a -= dist4 & t;
+			t = (dist2 - a) >> 31;  ind += t & 2; a -= dist2 & t;
+			t = (dist - a) >> 31;   ind += t & 1;
+
+			ind = -ind & 7;
+			ind ^= (2 > ind);
+
+			indices[i] = static_cast<int16_t>(ind);
+		}
+#endif
+
+		PackBC4Indices(bc4, indices);
+	}
+
+	using EncodeBC4BlocksFunc = void (*)(BC4Block* output, uint8_t const * input, uint32_t num_blocks);
+
+	void EncodeBC4BlocksDefault(BC4Block* output, uint8_t const * input, uint32_t num_blocks)
+	{
+		for (uint32_t i = 0; i < num_blocks; ++ i)
+		{
+			EncodeBC4Block(output[i], input + i * 16);
+		}
+	}
+
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+	// Same results as EncodeBC4Block. The min/max search runs on 2 blocks per register, one in each 128-bit lane,
+	// and the index search on a whole block per register.
+	KLAYGE_TARGET_AVX2 void EncodeBC4BlocksAvx2(BC4Block* output, uint8_t const * input, uint32_t num_blocks)
+	{
+		uint32_t i = 0;
+		for (; i + 2 <= num_blocks; i += 2)
+		{
+			__m256i const r_v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(input + i * 16));
+			__m256i min_v = r_v;
+			__m256i max_v = r_v;
+			min_v = _mm256_min_epu8(min_v, _mm256_srli_si256(min_v, 8));
+			max_v = _mm256_max_epu8(max_v, _mm256_srli_si256(max_v, 8));
+			min_v = _mm256_min_epu8(min_v, _mm256_srli_si256(min_v, 4));
+			max_v = _mm256_max_epu8(max_v, _mm256_srli_si256(max_v, 4));
+			min_v = _mm256_min_epu8(min_v, _mm256_srli_si256(min_v, 2));
+			max_v = _mm256_max_epu8(max_v, _mm256_srli_si256(max_v, 2));
+			min_v = _mm256_min_epu8(min_v, _mm256_srli_si256(min_v, 1));
+			max_v = _mm256_max_epu8(max_v, _mm256_srli_si256(max_v, 1));
+
+			int const mins[] = { _mm256_cvtsi256_si32(min_v) & 0xFF,
+				_mm_cvtsi128_si32(_mm256_extracti128_si256(min_v, 1)) & 0xFF };
+			int const maxs[] = { _mm256_cvtsi256_si32(max_v) & 0xFF,
+				_mm_cvtsi128_si32(_mm256_extracti128_si256(max_v, 1)) & 0xFF };
+
+			__m256i const seven = _mm256_set1_epi16(7);
+			__m256i const one = _mm256_set1_epi16(1);
+			__m256i const two = _mm256_set1_epi16(2);
+			__m256i const four = _mm256_set1_epi16(4);
+			for (uint32_t b = 0; b < 2; ++ b)
+			{
+				int const min = mins[b];
+				int const max = maxs[b];
+
+				BC4Block& bc4 = output[i + b];
+				bc4.alpha_0 = static_cast<uint8_t>(max);
+				bc4.alpha_1 = static_cast<uint8_t>(min);
+
+				int const dist = max - min;
+				int const bias = min * 7 - (dist >> 1);
+				__m256i const bias_v = _mm256_set1_epi16(static_cast<int16_t>(bias));
+				__m256i const dist_v = _mm256_set1_epi16(static_cast<int16_t>(dist));
+				__m256i const dist2_v = _mm256_set1_epi16(static_cast<int16_t>(dist * 2));
+				__m256i const dist4_v = _mm256_set1_epi16(static_cast<int16_t>(dist * 4));
+
+				__m256i const pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const *>(input + (i + b) * 16)));
+				__m256i a = _mm256_sub_epi16(_mm256_mullo_epi16(pixels, seven), bias_v);
+
+				__m256i t = _mm256_cmpgt_epi16(a, dist4_v);
+				__m256i ind = _mm256_and_si256(t, four);
+				a = _mm256_sub_epi16(a, _mm256_and_si256(dist4_v, t));
+				t = _mm256_cmpgt_epi16(a, dist2_v);
+				ind = _mm256_add_epi16(ind, _mm256_and_si256(t, two));
+				a = _mm256_sub_epi16(a, _mm256_and_si256(dist2_v, t));
+				t = _mm256_cmpgt_epi16(a, dist_v);
+				ind = _mm256_add_epi16(ind, _mm256_and_si256(t, one));
+
+				ind = _mm256_and_si256(_mm256_sub_epi16(_mm256_setzero_si256(), ind), seven);
+				ind = _mm256_xor_si256(ind, _mm256_and_si256(_mm256_cmpgt_epi16(two, ind), one));
+
+				// Pack the 3-bit indices, 2 per 32-bit lane, then 4 per 64-bit lane
+				ind = _mm256_madd_epi16(ind, _mm256_set1_epi32(0x00080001));
+				ind = _mm256_or_si256(_mm256_and_si256(ind, _mm256_set1_epi64x(0x3F)),
+					_mm256_and_si256(_mm256_srli_epi64(ind, 26), _mm256_set1_epi64x(0xFC0)));
+				alignas(32) uint64_t packed[4];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(packed), ind);
+				uint64_t const bitmap = packed[0] | (packed[1] << 12) | (packed[2] << 24) | (packed[3] << 36);
+				for (int j = 0; j < 6; ++ j)
+				{
+					bc4.bitmap[j] = static_cast<uint8_t>(bitmap >> (j * 8));
+				}
+			}
+		}
+
+		EncodeBC4BlocksDefault(output + i, input + i * 16, num_blocks - i);
+	}
+#endif
+
+	EncodeBC4BlocksFunc SelectEncodeBC4Blocks()
+	{
+#if defined(KLAYGE_SSE2_SUPPORT) && defined(KLAYGE_TARGET_AVX2)
+		CpuInfo const cpu;
+		if (cpu.IsFeatureSupport(CpuInfo::CF_AVX) && cpu.IsFeatureSupport(CpuInfo::CF_AVX2))
+		{
+			return EncodeBC4BlocksAvx2;
+		}
+#endif
+		return EncodeBC4BlocksDefault;
+	}
+
+	// Encodes blocks of 16 single channel pixels stored one after another
+	void EncodeBC4Blocks(BC4Block* output, uint8_t const * input, uint32_t num_blocks)
+	{
+		static EncodeBC4BlocksFunc const encode_func = SelectEncodeBC4Blocks();
+		encode_func(output, input, num_blocks);
+	}
 }
 
 namespace KlayGE
@@ -959,10 +1239,7 @@ namespace KlayGE
 		int dirb = color[0].b() - color[1].b();
 
 		int dots[16];
-		for (int i = 0; i < 16; ++ i)
-		{
-			dots[i] = argb[i].r() * dirr + argb[i].g() * dirg + argb[i].b() * dirb;
-		}
+		ProjectBlockColors(dots, argb, dirr, dirg, dirb);
 
 		if (alpha)
 		{
@@ -1004,6 +1281,29 @@ namespace KlayGE
 			int half_point = (stops[3] + stops[2]) >> 1;
 			int c3_point = (stops[2] + stops[0]) >> 1;
 
+#if defined(KLAYGE_SSE2_SUPPORT)
+			__m128i const c0_v = _mm_set1_epi32(c0_point);
+			__m128i const half_v = _mm_set1_epi32(half_point);
+			__m128i const c3_v = _mm_set1_epi32(c3_point);
+			__m128i const two = _mm_set1_epi32(2);
+			__m128i const three = _mm_set1_epi32(3);
+			for (int i = 0; i < 16; i += 4)
+			{
+				__m128i const dot = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&dots[i]));
+				__m128i const below_half = _mm_cmplt_epi32(dot, half_v);
+				__m128i const below_c0 = _mm_cmplt_epi32(dot, c0_v);
+				__m128i const below_c3 = _mm_cmplt_epi32(dot, c3_v);
+
+				// below_half ? (below_c0 ? 1 : 3) : (below_c3 ? 2 : 0)
+				__m128i const index = _mm_or_si128(_mm_and_si128(below_half, _mm_sub_epi32(three, _mm_and_si128(below_c0, two))),
+					_mm_andnot_si128(below_half, _mm_and_si128(below_c3, two)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&dots[i]), index);
+			}
+			for (int i = 15; i >= 0; -- i)
+			{
+				mask = (mask << 2) | dots[i];
+			}
+#else
 			for (int i = 15; i >= 0; -- i)
 			{
 				mask <<= 2;
@@ -1018,6 +1318,7 @@ namespace KlayGE
 					mask |= (dot < c3_point) ? 2 : 0;
 				}
 			}
+#endif
 		}
 
 		return mask;
@@ -1237,18 +1538,9 @@ namespace KlayGE
 	{
 		BOOST_ASSERT(argb);
 
-		// check if block is constant
-		uint32_t min32, max32;
-		min32 = max32 = argb[0].ARGB();
-		for (int i = 1; i < 16; ++ i)
-		{
-			min32 = std::min(min32, argb[i].ARGB());
-			max32 = std::max(max32, argb[i].ARGB());
-		}
-
 		uint32_t mask;
 		uint16_t max16, min16;
-		if (min32 != max32) // no constant color
+		if (!IsConstantBlock(argb)) // no constant color
 		{
 			ARGBColor32 max_clr, min_clr;
 			this->OptimizeColorsBlock(argb, min_clr, max_clr, method);
@@ -1413,6 +1705,43 @@ namespace KlayGE
 		bc4_codec_.EncodeBlock(&bc3.alpha, &alpha[0], method);
 	}
 
+	void TexCompressionBC3::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		BC3Block* bc3 = static_cast<BC3Block*>(output);
+		ARGBColor32 const * argb = static_cast<ARGBColor32 const *>(input);
+
+		// Color endpoints come from an iterative per block search, only the alpha channel goes through the batched BC4 path
+		uint32_t const BATCH_BLOCKS = 8;
+		std::array<uint8_t, BATCH_BLOCKS * 16> alpha;
+		std::array<BC4Block, BATCH_BLOCKS> bc4;
+		std::array<ARGBColor32, 16> xrgb;
+		for (uint32_t batch_begin = 0; batch_begin < num_blocks; batch_begin += BATCH_BLOCKS)
+		{
+			uint32_t const batch_size = std::min(num_blocks - batch_begin, BATCH_BLOCKS);
+			for (uint32_t b = 0; b < batch_size; ++ b)
+			{
+				ARGBColor32 const * block_argb = argb + (batch_begin + b) * 16;
+				for (size_t i = 0; i < xrgb.size(); ++ i)
+				{
+					xrgb[i] = block_argb[i];
+					xrgb[i].a() = 255;
+					alpha[b * 16 + i] = static_cast<uint8_t>(block_argb[i].a());
+				}
+
+				bc1_codec_.EncodeBC1Internal(bc3[batch_begin + b].bc1, &xrgb[0], false, method);
+			}
+
+			EncodeBC4Blocks(&bc4[0], &alpha[0], batch_size);
+			for (uint32_t b = 0; b < batch_size; ++ b)
+			{
+				bc3[batch_begin + b].alpha = bc4[b];
+			}
+		}
+	}
+
 	void TexCompressionBC3::DecodeBlock(void* output, void const * input)
 	{
 		BOOST_ASSERT(output);
@@ -1438,7 +1767,6 @@ namespace KlayGE
 		compression_format_ = EF_BC4;
 	}
 
-	// Alpha block compression (this is easy for a change)
 	void TexCompressionBC4::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1446,54 +1774,17 @@ namespace KlayGE
 
 		KFL_UNUSED(method);
 
-		BC4Block& bc4 = *static_cast<BC4Block*>(output);
-		uint8_t const * r = static_cast<uint8_t const *>(input);
-
-		// find min/max color
-		int min, max;
-		min = max = r[0];
-
-		for (int i = 1; i < 16; ++ i)
-		{
-			min = std::min<int>(min, r[i]);
-			max = std::max<int>(max, r[i]);
-		}
-
-		// encode them
-		bc4.alpha_0 = static_cast<uint8_t>(max);
-		bc4.alpha_1 = static_cast<uint8_t>(min);
-
-		// determine bias and emit color indices
-		int dist = max - min;
-		int bias = min * 7 - (dist >> 1);
-		int dist4 = dist * 4;
-		int dist2 = dist * 2;
-		int bits = 0, mask = 0;
-
-		int dest = 0;
-		for (int i = 0; i < 16; ++ i)
-		{
-			int a = r[i] * 7 - bias;
-			int ind, t;
+		EncodeBC4Block(*static_cast<BC4Block*>(output), static_cast<uint8_t const *>(input));
+	}
 
-			// select index (hooray for bit magic)
-			t = (dist4 - a) >> 31;  ind = t & 4; a -= dist4 & t;
-			t = (dist2 - a) >> 31;  ind += t & 2; a -= dist2 & t;
-			t = (dist - a) >> 31;   ind += t & 1;
+	void TexCompressionBC4::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
 
-			ind = -ind & 7;
-			ind ^= (2 > ind);
+		KFL_UNUSED(method);
 
-			// write index
-			mask |= ind << bits;
-			if ((bits += 3) >= 8)
-			{
-				bc4.bitmap[dest] = static_cast<uint8_t>(mask);
-				++ dest;
-				mask >>= 8;
-				bits -= 8;
-			}
-		}
+		EncodeBC4Blocks(static_cast<BC4Block*>(output), static_cast<uint8_t const *>(input), num_blocks);
 	}
 
 	void TexCompressionBC4::DecodeBlock(void* output, void const * input)
@@ -1564,6 +1855,41 @@ namespace KlayGE
 		bc4_codec_.EncodeBlock(&bc5.green, &g[0], method);
 	}
 
+	void TexCompressionBC5::EncodeBlocks(void* output, void const * input, uint32_t num_blocks, TexCompressionMethod method)
+	{
+		BOOST_ASSERT(output);
+		BOOST_ASSERT(input);
+
+		KFL_UNUSED(method);
+
+		BC5Block* bc5 = static_cast<BC5Block*>(output);
+		uint16_t const * gr = static_cast<uint16_t const *>(input);
+
+		uint32_t const BATCH_BLOCKS = 8;
+		std::array<uint8_t, BATCH_BLOCKS * 16> r;
+		std::array<uint8_t, BATCH_BLOCKS * 16> g;
+		std::array<BC4Block, BATCH_BLOCKS> red;
+		std::array<BC4Block, BATCH_BLOCKS> green;
+		for (uint32_t batch_begin = 0; batch_begin < num_blocks; batch_begin += BATCH_BLOCKS)
+		{
+			uint32_t const batch_size = std::min(num_blocks - batch_begin, BATCH_BLOCKS);
+			uint16_t const * batch_gr = gr + batch_begin * 16;
+			for (uint32_t i = 0; i < batch_size * 16; ++ i)
+			{
+				r[i] = batch_gr[i] & 0xFF;
+				g[i] = batch_gr[i] >> 8;
+			}
+
+			EncodeBC4Blocks(&red[0], &r[0], batch_size);
+			EncodeBC4Blocks(&green[0], &g[0], batch_size);
+			for (uint32_t b = 0; b < batch_size; ++ b)
+			{
+				bc5[batch_begin + b].red = red[b];
+				bc5[batch_begin + b].green = green[b];
+			}
+		}
+	}
+
 	void TexCompressionBC5::DecodeBlock(void* output, void const * input)
 	{
 		BOOST_ASSERT(output);
@@ -2137,6 +2463,12 @@ namespace KlayGE
 		compression_format_ = EF_BC7;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionBC7::CreateWorkerCodec() const
+	{
+		// sa_steps_, error_metric_, rotate_mode_ and index_mode_ change during every block
+		return MakeUniquePtr<TexCompressionBC7>();
+	}
+
 	void TexCompressionBC7::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
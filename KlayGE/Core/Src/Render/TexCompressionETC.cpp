@@ -650,6 +650,11 @@ namespace KlayGE
 		sorted_luma_indices_ = nullptr;
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionETC1::CreateWorkerCodec() const
+	{
+		return MakeUniquePtr<TexCompressionETC1>();
+	}
+
 	void TexCompressionETC1::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		BOOST_ASSERT(output);
@@ -1822,6 +1827,11 @@ namespace KlayGE
 		etc1_codec_ = MakeUniquePtr<TexCompressionETC1>();
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionETC2RGB8::CreateWorkerCodec() const
+	{
+		return MakeUniquePtr<TexCompressionETC2RGB8>();
+	}
+
 	void TexCompressionETC2RGB8::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		KFL_UNUSED(output);
@@ -2043,6 +2053,11 @@ namespace KlayGE
 		etc2_rgb8_codec_ = MakeUniquePtr<TexCompressionETC2RGB8>();
 	}
 
+	std::unique_ptr<TexCompression> TexCompressionETC2RGB8A1::CreateWorkerCodec() const
+	{
+		return MakeUniquePtr<TexCompressionETC2RGB8A1>();
+	}
+
 	void TexCompressionETC2RGB8A1::EncodeBlock(void* output, void const * input, TexCompressionMethod method)
 	{
 		KFL_UNUSED(output);
@@ -1317,6 +1317,15 @@ namespace
 			return false;
 		}
 
+		uint64_t Hash() const override
+		{
+			size_t seed = 0;
+			HashCombine(seed, this->Type());
+			HashCombine(seed, HashValue(tex_desc_.res_name));
+			HashCombine(seed, tex_desc_.access_hint);
+			return seed;
+		}
+
 		void CopyDataFrom(ResLoadingDesc const & rhs) override
 		{
 			BOOST_ASSERT(this->Type() == rhs.Type());
@@ -3650,123 +3659,132 @@ namespace KlayGE
 		uint8_t const * src_ptr = static_cast<uint8_t const *>(src_cpu_data);
 		uint8_t* dst_ptr = static_cast<uint8_t*>(dst_cpu_data);
 		uint32_t const src_elem_size = NumFormatBytes(src_cpu_format);
-		uint32_t const dst_elem_size = NumFormatBytes(dst_cpu_format);
 
-		if (((filter == TextureFilter::Point) || ((src_width == dst_width) && (src_height == dst_height) && (src_depth == dst_depth))) &&
-			(src_cpu_format == dst_cpu_format))
-		{
-			for (uint32_t z = 0; z < dst_depth; ++ z)
-			{
-				float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
-				uint32_t sz = std::min(static_cast<uint32_t>(fz), src_depth - 1);
+		// Destination rows of all slices are independent, they are spread across the thread pool in tiles of about 16K texels
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
+		uint32_t const rows_per_tile = std::max(1U, 16384 / dst_width);
 
-				for (uint32_t y = 0; y < dst_height; ++ y)
+		if ((filter == TextureFilter::Point) || ((src_width == dst_width) && (src_height == dst_height) && (src_depth == dst_depth)))
+		{
+			// Point sampling picks texels without filtering, so they are converted between formats directly
+			thread_pool.ParallelFor(0, dst_depth * dst_height, rows_per_tile, [&](uint32_t row_begin, uint32_t row_end)
 				{
-					float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
-					uint32_t sy = std::min(static_cast<uint32_t>(fy), src_height - 1);
-
-					uint8_t const * src_p = src_ptr + sz * src_cpu_slice_pitch + sy * src_cpu_row_pitch;
-					uint8_t* dst_p = dst_ptr + z * dst_cpu_slice_pitch + y * dst_cpu_row_pitch;
-
-					if (src_width == dst_width)
+					std::vector<uint8_t> src_row;
+					if ((src_width != dst_width) && (src_cpu_format != dst_cpu_format))
 					{
-						std::memcpy(dst_p, src_p, src_width * src_elem_size);
+						src_row.resize(dst_width * src_elem_size);
 					}
-					else
+
+					for (uint32_t row = row_begin; row < row_end; ++ row)
 					{
-						for (uint32_t x = 0; x < dst_width; ++ x, dst_p += dst_elem_size)
+						uint32_t const z = row / dst_height;
+						uint32_t const y = row - z * dst_height;
+
+						float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
+						uint32_t sz = std::min(static_cast<uint32_t>(fz), src_depth - 1);
+
+						float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
+						uint32_t sy = std::min(static_cast<uint32_t>(fy), src_height - 1);
+
+						uint8_t const * src_p = src_ptr + sz * src_cpu_slice_pitch + sy * src_cpu_row_pitch;
+						uint8_t* dst_p = dst_ptr + z * dst_cpu_slice_pitch + y * dst_cpu_row_pitch;
+
+						if (src_width == dst_width)
+						{
+							ConvertFormat(src_cpu_format, src_p, src_width, dst_cpu_format, dst_p);
+						}
+						else
 						{
-							float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
-							uint32_t sx = std::min(static_cast<uint32_t>(fx), src_width - 1);
-							std::memcpy(dst_p, src_p + sx * src_elem_size, src_elem_size);
+							uint8_t* gather_p = src_row.empty() ? dst_p : src_row.data();
+							for (uint32_t x = 0; x < dst_width; ++ x)
+							{
+								float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
+								uint32_t sx = std::min(static_cast<uint32_t>(fx), src_width - 1);
+								std::memcpy(gather_p + x * src_elem_size, src_p + sx * src_elem_size, src_elem_size);
+							}
+							if (!src_row.empty())
+							{
+								ConvertFormat(src_cpu_format, src_row.data(), dst_width, dst_cpu_format, dst_p);
+							}
 						}
 					}
-				}
-			}
+				});
 		}
 		else
 		{
 			std::vector<Color> src_32f(src_width * src_height * src_depth);
-			{
-				for (uint32_t z = 0; z < src_depth; ++ z)
+			thread_pool.ParallelFor(0, src_depth * src_height, std::max(1U, 16384 / src_width),
+				[&](uint32_t row_begin, uint32_t row_end)
 				{
-					for (uint32_t y = 0; y < src_height; ++ y)
+					for (uint32_t row = row_begin; row < row_end; ++ row)
 					{
+						uint32_t const z = row / src_height;
+						uint32_t const y = row - z * src_height;
 						ConvertToABGR32F(src_cpu_format, src_ptr + z * src_cpu_slice_pitch + y * src_cpu_row_pitch,
-							src_width, &src_32f[(z * src_height + y) * src_width]);
+							src_width, &src_32f[row * src_width]);
 					}
-				}
-			}
+				});
 
-			std::vector<Color> dst_32f(dst_width * dst_height * dst_depth);
-			if (filter == TextureFilter::Linear)
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
+			// Each row is filtered into a local buffer and converted to the destination format right away
+			thread_pool.ParallelFor(0, dst_depth * dst_height, rows_per_tile, [&](uint32_t row_begin, uint32_t row_end)
 				{
-					float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
-					uint32_t sz0 = static_cast<uint32_t>(fz - 0.5f);
-					uint32_t sz1 = MathLib::clamp<uint32_t>(sz0 + 1, 0, src_depth - 1);
-					float weight_z = fz - sz0 - 0.5f;
-							
-					for (uint32_t y = 0; y < dst_height; ++ y)
+					std::vector<Color> dst_32f(dst_width);
+					for (uint32_t row = row_begin; row < row_end; ++ row)
 					{
-						float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
-						uint32_t sy0 = static_cast<uint32_t>(fy - 0.5f);
-						uint32_t sy1 = MathLib::clamp<uint32_t>(sy0 + 1, 0, src_height - 1);
-						float weight_y = fy - sy0 - 0.5f;
-							
-						for (uint32_t x = 0; x < dst_width; ++ x)
+						uint32_t const z = row / dst_height;
+						uint32_t const y = row - z * dst_height;
+
+						if (filter == TextureFilter::Linear)
 						{
-							float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
-							uint32_t sx0 = static_cast<uint32_t>(fx - 0.5f);
-							uint32_t sx1 = MathLib::clamp<uint32_t>(sx0 + 1, 0, src_width - 1);
-							float weight_x = fx - sx0 - 0.5f;
-							Color clr_x00 = MathLib::lerp(src_32f[(sz0 * src_height + sy0) * src_width + sx0],
-								src_32f[(sz0 * src_height + sy0) * src_width + sx1], weight_x);
-							Color clr_x01 = MathLib::lerp(src_32f[(sz0 * src_height + sy1) * src_width + sx0],
-								src_32f[(sz0 * src_height + sy1) * src_width + sx1], weight_x);
-							Color clr_y0 = MathLib::lerp(clr_x00, clr_x01, weight_y);
-							Color clr_x10 = MathLib::lerp(src_32f[(sz1 * src_height + sy0) * src_width + sx0],
-								src_32f[(sz1 * src_height + sy0) * src_width + sx1], weight_x);
-							Color clr_x11 = MathLib::lerp(src_32f[(sz1 * src_height + sy1) * src_width + sx0],
-								src_32f[(sz1 * src_height + sy1) * src_width + sx1], weight_x);
-							Color clr_y1 = MathLib::lerp(clr_x10, clr_x11, weight_y);
-							dst_32f[(z * dst_height + y) * dst_width + x] = MathLib::lerp(clr_y0, clr_y1, weight_z);
-						}
-					}
-				}
-			}
-			else
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
-				{
-					float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
-					uint32_t sz = std::min(static_cast<uint32_t>(fz), src_depth - 1);
+							float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
+							uint32_t sz0 = static_cast<uint32_t>(fz - 0.5f);
+							uint32_t sz1 = MathLib::clamp<uint32_t>(sz0 + 1, 0, src_depth - 1);
+							float weight_z = fz - sz0 - 0.5f;
 
-					for (uint32_t y = 0; y < dst_height; ++ y)
-					{
-						float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
-						uint32_t sy = std::min(static_cast<uint32_t>(fy), src_height - 1);
+							float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
+							uint32_t sy0 = static_cast<uint32_t>(fy - 0.5f);
+							uint32_t sy1 = MathLib::clamp<uint32_t>(sy0 + 1, 0, src_height - 1);
+							float weight_y = fy - sy0 - 0.5f;
 
-						for (uint32_t x = 0; x < dst_width; ++ x)
+							for (uint32_t x = 0; x < dst_width; ++ x)
+							{
+								float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
+								uint32_t sx0 = static_cast<uint32_t>(fx - 0.5f);
+								uint32_t sx1 = MathLib::clamp<uint32_t>(sx0 + 1, 0, src_width - 1);
+								float weight_x = fx - sx0 - 0.5f;
+								Color clr_x00 = MathLib::lerp(src_32f[(sz0 * src_height + sy0) * src_width + sx0],
+									src_32f[(sz0 * src_height + sy0) * src_width + sx1], weight_x);
+								Color clr_x01 = MathLib::lerp(src_32f[(sz0 * src_height + sy1) * src_width + sx0],
+									src_32f[(sz0 * src_height + sy1) * src_width + sx1], weight_x);
+								Color clr_y0 = MathLib::lerp(clr_x00, clr_x01, weight_y);
+								Color clr_x10 = MathLib::lerp(src_32f[(sz1 * src_height + sy0) * src_width + sx0],
+									src_32f[(sz1 * src_height + sy0) * src_width + sx1], weight_x);
+								Color clr_x11 = MathLib::lerp(src_32f[(sz1 * src_height + sy1) * src_width + sx0],
+									src_32f[(sz1 * src_height + sy1) * src_width + sx1], weight_x);
+								Color clr_y1 = MathLib::lerp(clr_x10, clr_x11, weight_y);
+								dst_32f[x] = MathLib::lerp(clr_y0, clr_y1, weight_z);
+							}
+						}
+						else
 						{
-							float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
-							uint32_t sx = std::min(static_cast<uint32_t>(fx), src_width - 1);
-							dst_32f[(z * dst_height + y) * dst_width + x] = src_32f[(sz * src_height + sy) * src_width + sx];
+							float fz = static_cast<float>(z + 0.5f) / dst_depth * src_depth;
+							uint32_t sz = std::min(static_cast<uint32_t>(fz), src_depth - 1);
+
+							float fy = static_cast<float>(y + 0.5f) / dst_height * src_height;
+							uint32_t sy = std::min(static_cast<uint32_t>(fy), src_height - 1);
+
+							for (uint32_t x = 0; x < dst_width; ++ x)
+							{
+								float fx = static_cast<float>(x + 0.5f) / dst_width * src_width;
+								uint32_t sx = std::min(static_cast<uint32_t>(fx), src_width - 1);
+								dst_32f[x] = src_32f[(sz * src_height + sy) * src_width + sx];
+							}
 						}
-					}
-				}
-			}
 
-			{
-				for (uint32_t z = 0; z < dst_depth; ++ z)
-				{
-					for (uint32_t y = 0; y < dst_height; ++ y)
-					{
-						ConvertFromABGR32F(dst_cpu_format, &dst_32f[(z * dst_height + y) * dst_width], dst_width, dst_ptr + z * dst_cpu_slice_pitch + y * dst_cpu_row_pitch);
+						ConvertFromABGR32F(dst_cpu_format, dst_32f.data(), dst_width,
+							dst_ptr + z * dst_cpu_slice_pitch + y * dst_cpu_row_pitch);
 					}
-				}
-			}
+				});
 		}
 
 		if (IsCompressedFormat(dst_format))
@@ -33,15 +33,20 @@
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/App3D.hpp>
+#include <KlayGE/Fence.hpp>
 
 #include <cstring>
+#include <thread>
 
 #include <KlayGE/TransientBuffer.hpp>
 
 namespace KlayGE
 {
 	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag)
-		: bind_flag_(bind_flag)
+		: bind_flag_(bind_flag),
+			head_(0), limit_(size_in_byte),
+			tail_(0), wrapped_(false), wrap_end_(size_in_byte),
+			frame_begin_(0), frame_wraps_(false), dirty_begin_(0), dirty_wraps_(false)
 	{
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine const & re = rf.RenderEngineInstance();
@@ -49,22 +54,18 @@ namespace KlayGE
 		use_no_overwrite_ = caps.no_overwrite_support;
 
 		buffer_ = this->DoCreateBuffer(bind_flag_, size_in_byte);
+		staging_.resize(size_in_byte);
 		if (use_no_overwrite_)
 		{
+			// Without a fence, frames are retired by counting
 			num_pre_frames_ = 3;
+			fence_ = rf.MakeFence();
 		}
 		else
 		{
+			// Every upload discards the whole buffer, nothing has to be kept across frames
 			num_pre_frames_ = 1;
-			simulate_buffer_.resize(buffer_->Size());
-			valid_min_ = 0;
-			valid_max_ = 0;
 		}
-
-		free_list_.emplace_back(0, size_in_byte);
-
-		App3DFramework const & app = Context::Instance().AppInstance();
-		retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
 	}
 
 	GraphicsBufferPtr TransientBuffer::DoCreateBuffer(TransientBuffer::BindFlag bind_flag, uint32_t size_in_byte)
@@ -90,204 +91,213 @@ namespace KlayGE
 	SubAlloc TransientBuffer::Alloc(uint32_t size_in_byte, void const * data)
 	{
 		SubAlloc ret;
+		ret.length_ = size_in_byte;
 
-		// Use first fit method to find a free sub alloc
-		bool found = false;
-		auto iter = free_list_.begin();
-		auto first_fit_iter = iter;
-		for (; iter != free_list_.end(); ++ iter)
+		num_writers_.fetch_add(1);
+		bool allocated = false;
+		if (!exclusive_.load())
 		{
-			if (iter->length_ >= size_in_byte)
+			allocated = this->TryBumpAlloc(size_in_byte, ret.offset_);
+			if (allocated)
 			{
-				first_fit_iter = iter;
-				found = true;
-				break;
+				memcpy(staging_.data() + ret.offset_, data, size_in_byte);
 			}
 		}
+		num_writers_.fetch_sub(1, std::memory_order_release);
 
-		// If there is not enough space, reallocate a larger buffer.
-		if (!found)
+		if (!allocated)
 		{
-			uint32_t const old_buffer_size = buffer_->Size();
-			uint32_t larger_buffer_size = std::max(old_buffer_size * 2, old_buffer_size + size_in_byte);
-			GraphicsBufferPtr larger_buffer = this->DoCreateBuffer(bind_flag_, larger_buffer_size);
-			SubAlloc alloc(old_buffer_size, larger_buffer_size - old_buffer_size);
-			if (!free_list_.empty() && (free_list_.back().offset_ + free_list_.back().length_ == alloc.offset_))
-			{
-				free_list_.back().length_ += alloc.length_;
-			}
-			else
-			{
-				free_list_.push_back(alloc);
-			}
-			first_fit_iter = free_list_.end();
-			-- first_fit_iter;
-			if (use_no_overwrite_)
-			{
-				buffer_->CopyToBuffer(*larger_buffer);
-			}
-			else
+			this->LockExclusive();
+			ret.offset_ = this->DoAllocSlow(size_in_byte);
+			memcpy(staging_.data() + ret.offset_, data, size_in_byte);
+			this->UnlockExclusive();
+		}
+
+		return ret;
+	}
+
+	bool TransientBuffer::TryBumpAlloc(uint32_t size_in_byte, uint32_t& offset)
+	{
+		uint32_t const limit = limit_.load(std::memory_order_relaxed);
+		uint32_t head = head_.load(std::memory_order_relaxed);
+		do
+		{
+			if (size_in_byte > limit - head)
 			{
-				simulate_buffer_.resize(larger_buffer_size);
+				return false;
 			}
-			buffer_ = larger_buffer;
-		}
+		} while (!head_.compare_exchange_weak(head, head + size_in_byte, std::memory_order_relaxed));
 
-		uint32_t left_size = first_fit_iter->length_ - size_in_byte;
-		ret.length_ = size_in_byte;
-		ret.offset_ = first_fit_iter->offset_;
-		if (0 == left_size)
+		offset = head;
+		return true;
+	}
+
+	uint32_t TransientBuffer::DoAllocSlow(uint32_t size_in_byte)
+	{
+		uint32_t offset;
+		if (this->TryBumpAlloc(size_in_byte, offset))
 		{
-			free_list_.erase(first_fit_iter);
+			return offset;
 		}
-		else
+
+		uint32_t const head = head_.load(std::memory_order_relaxed);
+		if (!wrapped_ && (size_in_byte <= tail_))
 		{
-			first_fit_iter->length_ = left_size;
-			first_fit_iter->offset_ += size_in_byte;
+			// Skip the end of the buffer and continue from the beginning, up to the oldest frame in flight
+			wrapped_ = true;
+			wrap_end_ = head;
+			frame_wraps_ = true;
+			dirty_wraps_ = true;
+
+			head_.store(size_in_byte, std::memory_order_relaxed);
+			limit_.store(tail_, std::memory_order_relaxed);
+			return 0;
 		}
 
-		if (use_no_overwrite_)
+		// If there is not enough space, reallocate a larger buffer. Draws already issued keep the old one,
+		// only allocations of current frame have to move over, at the same offsets.
+		uint32_t const old_buffer_size = static_cast<uint32_t>(staging_.size());
+		uint32_t const larger_buffer_size = std::max(old_buffer_size * 2, old_buffer_size + size_in_byte);
+		buffer_ = this->DoCreateBuffer(bind_flag_, larger_buffer_size);
+		staging_.resize(larger_buffer_size);
+
+		offset = head;
+		if (frame_wraps_)
 		{
-			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_No_Overwrite);
-			uint8_t* buffer_data = mapper.Pointer<uint8_t>();
-			memcpy(buffer_data + ret.offset_, data, ret.length_);
+			frame_begin_ = 0;
+			offset = wrap_end_;
 		}
-		else
+		tail_ = frame_begin_;
+		wrapped_ = false;
+		wrap_end_ = larger_buffer_size;
+		frame_wraps_ = false;
+		dirty_begin_ = frame_begin_;
+		dirty_wraps_ = false;
+		in_flight_frames_.clear();
+
+		head_.store(offset + size_in_byte, std::memory_order_relaxed);
+		limit_.store(larger_buffer_size, std::memory_order_relaxed);
+		return offset;
+	}
+
+	void TransientBuffer::LockExclusive()
+	{
+		slow_mutex_.lock();
+		exclusive_.store(true);
+		while (num_writers_.load() != 0)
 		{
-			memcpy(&simulate_buffer_[ret.offset_], data, ret.length_);
-			valid_min_ = std::min(valid_min_, ret.offset_);
-			valid_max_ = std::max(valid_max_, ret.offset_ + ret.length_);
+			std::this_thread::yield();
 		}
+	}
 
-		return ret;
+	void TransientBuffer::UnlockExclusive()
+	{
+		exclusive_.store(false);
+		slow_mutex_.unlock();
 	}
 
-	void TransientBuffer::Dealloc(SubAlloc const & alloc)
+	void TransientBuffer::EnsureDataReady()
 	{
-		if ((alloc.length_ > 0) && !retired_frames_.empty())
+		this->LockExclusive();
+
+		uint32_t const head = head_.load(std::memory_order_relaxed);
+		uint32_t begin;
+		bool wraps;
+		if (use_no_overwrite_)
 		{
-			RetiredFrame& frame = retired_frames_.back();
-			frame.pending_frees_.push_back(alloc);
+			begin = dirty_begin_;
+			wraps = dirty_wraps_;
+		}
+		else
+		{
+			begin = frame_begin_;
+			wraps = frame_wraps_;
+		}
+		uint32_t const end = wraps ? wrap_end_ : head;
 
-			if (!use_no_overwrite_)
+		if ((begin < end) || (wraps && (head > 0)))
+		{
+			GraphicsBuffer::Mapper mapper(*buffer_, use_no_overwrite_ ? BA_Write_No_Overwrite : BA_Write_Only);
+			uint8_t* buffer_data = mapper.Pointer<uint8_t>();
+			memcpy(buffer_data + begin, staging_.data() + begin, end - begin);
+			if (wraps)
 			{
-				if (alloc.offset_ == valid_min_)
-				{
-					valid_min_ += alloc.length_;
-				}
-				if (alloc.offset_ + alloc.length_ == valid_max_)
-				{
-					valid_max_ -= alloc.length_;
-				}
+				memcpy(buffer_data, staging_.data(), head);
 			}
 		}
+
+		dirty_begin_ = head;
+		dirty_wraps_ = false;
+
+		this->UnlockExclusive();
 	}
 
 	void TransientBuffer::OnPresent()
 	{
-		if (!retired_frames_.empty())
-		{
-			App3DFramework const & app = Context::Instance().AppInstance();
-			uint32_t const frame_id = app.TotalNumFrames();
+		this->LockExclusive();
 
-			// First, deal with deletes from this frame
-			RetiredFrame& ret_frame = retired_frames_.back();
-			if (!ret_frame.pending_frees_.empty()) 
-			{
-				// Append a new (empty) RetiredFrame to retired_frames_
-				retired_frames_.push_back(RetiredFrame(frame_id + 1));
-			}
-			// Second, return pending frees to free_list
-			auto frame_iter = retired_frames_.begin();
-			for (; frame_iter != retired_frames_.end();)
+		uint32_t const head = head_.load(std::memory_order_relaxed);
+		if ((head != frame_begin_) || frame_wraps_)
+		{
+			if (use_no_overwrite_)
 			{
-				if (frame_iter->frame_id + num_pre_frames_ <= frame_id)
-				{
-					auto iter = frame_iter->pending_frees_.begin();
-					for (; iter != frame_iter->pending_frees_.end(); ++ iter)
-					{
-						this->DoFree(*iter);
-					}
-					frame_iter = retired_frames_.erase(frame_iter);
-				}
-				else
-				{
-					++ frame_iter;
-				}
+				InFlightFrame frame;
+				frame.end = head;
+				frame.wraps = frame_wraps_;
+				frame.fence_id = fence_ ? fence_->Signal(Fence::FT_Render) : 0;
+				frame.frame_id = Context::Instance().AppInstance().TotalNumFrames();
+				in_flight_frames_.push_back(frame);
 			}
+
+			frame_begin_ = head;
+			frame_wraps_ = false;
 		}
+
+		this->RetireFrames();
+
+		this->UnlockExclusive();
 	}
 
-	void TransientBuffer::DoFree(SubAlloc const & alloc)
+	void TransientBuffer::RetireFrames()
 	{
-		if (free_list_.empty())
-		{
-			free_list_.push_back(alloc);
-		}
-		else
+		uint32_t const frame_id = Context::Instance().AppInstance().TotalNumFrames();
+		while (!in_flight_frames_.empty())
 		{
-			// Find where to insert the alloc
-			auto insert_position = free_list_.begin();
-			while (insert_position != free_list_.end())
+			InFlightFrame const & frame = in_flight_frames_.front();
+			if (fence_)
 			{
-				if (insert_position->offset_ > alloc.offset_)
+				if (!fence_->Completed(frame.fence_id))
 				{
 					break;
 				}
-				++ insert_position;
-			}
 
-			bool left_merged = false;
-			// If the alloc is adjacent to previous alloc, merge them.
-			auto previous = insert_position;
-			if (insert_position != free_list_.begin())
-			{
-				-- previous;
-				if (previous->offset_ + previous->length_ == alloc.offset_)
-				{
-					previous->length_ += alloc.length_;
-					left_merged = true;
-				}
+				// Doesn't block, but lets the fence release what it holds for this id
+				fence_->Wait(frame.fence_id);
 			}
-
-			bool right_merged = false;
-			// If the alloc is adjecent to next alloc, merge them.
-			auto next = insert_position;
-			if (insert_position != free_list_.end())
+			else if (frame.frame_id + num_pre_frames_ > frame_id)
 			{
-				if (left_merged)
-				{
-					if (previous->offset_ + previous->length_ == next->offset_)
-					{
-						previous->length_ += next->length_;
-						free_list_.erase(next);
-						right_merged = true;
-					}
-				}
-				else
-				{
-					if (alloc.offset_ + alloc.length_ == next->offset_)
-					{
-						next->offset_ -= alloc.length_;
-						next->length_ += alloc.length_;
-						right_merged = true;
-					}
-				}
+				break;
 			}
-			if (!(left_merged || right_merged))
+
+			tail_ = frame.end;
+			if (frame.wraps)
 			{
-				free_list_.emplace(insert_position, alloc);
+				wrapped_ = false;
 			}
+			in_flight_frames_.pop_front();
 		}
-	}
 
-	void TransientBuffer::EnsureDataReady()
-	{
-		if (!use_no_overwrite_)
+		uint32_t const buffer_size = static_cast<uint32_t>(staging_.size());
+		if (in_flight_frames_.empty() && (head_.load(std::memory_order_relaxed) == frame_begin_) && !frame_wraps_)
 		{
-			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_Only);
-			memcpy(mapper.Pointer<uint8_t>() + valid_min_, &simulate_buffer_[valid_min_],
-				valid_max_ - valid_min_);
+			// Nothing is alive, start over from the beginning
+			head_.store(0, std::memory_order_relaxed);
+			tail_ = 0;
+			wrapped_ = false;
+			frame_begin_ = 0;
+			dirty_begin_ = 0;
+			dirty_wraps_ = false;
 		}
+		limit_.store(wrapped_ ? tail_ : buffer_size, std::memory_order_relaxed);
 	}
 }
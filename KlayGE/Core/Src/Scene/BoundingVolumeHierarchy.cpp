@@ -0,0 +1,592 @@
+/**
+ * @file BoundingVolumeHierarchy.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include <KlayGE/BoundingVolumeHierarchy.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t constexpr MAX_LEAF_ITEMS = 4;
+	// Leaves can be larger if SAH finds nothing better
+	uint32_t constexpr MAX_SAH_LEAF_ITEMS = 16;
+	uint32_t constexpr NUM_BINS = 16;
+	// Deeper than this, nodes are split at the median. Keeps the depth under MAX_DEPTH, which sizes the traversal stacks.
+	uint32_t constexpr MAX_SAH_DEPTH = 32;
+	uint32_t constexpr MAX_DEPTH = 64;
+	float constexpr MAX_REFIT_DEGRADATION = 2;
+
+	void Merge(float3& min, float3& max, float3 const & rhs_min, float3 const & rhs_max)
+	{
+		for (size_t i = 0; i < 3; ++ i)
+		{
+			min[i] = std::min(min[i], rhs_min[i]);
+			max[i] = std::max(max[i], rhs_max[i]);
+		}
+	}
+
+	float HalfArea(float3 const & min, float3 const & max)
+	{
+		float const x = max[0] - min[0];
+		float const y = max[1] - min[1];
+		float const z = max[2] - min[2];
+		return x * y + y * z + z * x;
+	}
+
+	// Branchless slab test, with everything per ray computed once
+	struct RayData
+	{
+		std::array<float, 3> inv_dir;
+		// Where the inflated min and max planes are in ray distance, as min * inv_dir + min_offset
+		std::array<float, 3> min_offset;
+		std::array<float, 3> max_offset;
+
+		RayData(float3 const & orig, float3 const & dir, float radius)
+		{
+			for (size_t i = 0; i < 3; ++ i)
+			{
+				// Keeps 0 * inf out of the slab tests
+				float d = dir[i];
+				if (std::abs(d) < 1e-20f)
+				{
+					d = (d < 0) ? -1e-20f : 1e-20f;
+				}
+				inv_dir[i] = 1 / d;
+				min_offset[i] = -(orig[i] + radius) * inv_dir[i];
+				max_offset[i] = -(orig[i] - radius) * inv_dir[i];
+			}
+		}
+
+		bool Intersect(float3 const & min, float3 const & max, float max_dist, float& enter_dist) const
+		{
+			float const tx0 = min[0] * inv_dir[0] + min_offset[0];
+			float const tx1 = max[0] * inv_dir[0] + max_offset[0];
+			float const ty0 = min[1] * inv_dir[1] + min_offset[1];
+			float const ty1 = max[1] * inv_dir[1] + max_offset[1];
+			float const tz0 = min[2] * inv_dir[2] + min_offset[2];
+			float const tz1 = max[2] * inv_dir[2] + max_offset[2];
+
+			float const t0 = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+			float const t1 = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), max_dist));
+			enter_dist = t0;
+			return t0 <= t1;
+		}
+	};
+
+	bool IntersectBoxBox(float3 const & min, float3 const & max, float3 const & rhs_min, float3 const & rhs_max)
+	{
+		return (min[0] <= rhs_max[0]) && (max[0] >= rhs_min[0]) && (min[1] <= rhs_max[1]) && (max[1] >= rhs_min[1])
+			&& (min[2] <= rhs_max[2]) && (max[2] >= rhs_min[2]);
+	}
+
+	bool IntersectBoxSphere(float3 const & min, float3 const & max, float3 const & center, float radius_sq)
+	{
+		float dist_sq = 0;
+		for (size_t i = 0; i < 3; ++ i)
+		{
+			float const v = center[i];
+			if (v < min[i])
+			{
+				dist_sq += (min[i] - v) * (min[i] - v);
+			}
+			else if (v > max[i])
+			{
+				dist_sq += (v - max[i]) * (v - max[i]);
+			}
+		}
+		return dist_sq <= radius_sq;
+	}
+}
+
+namespace KlayGE
+{
+	void BoundingVolumeHierarchy::Build(std::span<AABBox const> bounds)
+	{
+		uint32_t const num_items = static_cast<uint32_t>(bounds.size());
+
+		nodes_.clear();
+		items_.resize(num_items);
+		std::iota(items_.begin(), items_.end(), 0U);
+		item_bounds_.resize(num_items);
+		build_cost_ = 0;
+		if (num_items == 0)
+		{
+			return;
+		}
+
+		std::vector<Box> boxes(num_items);
+		std::vector<float3> centroids(num_items);
+		for (uint32_t i = 0; i < num_items; ++ i)
+		{
+			boxes[i].min = bounds[i].Min();
+			boxes[i].max = bounds[i].Max();
+			centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+		}
+
+		nodes_.reserve(num_items * 2 - 1);
+		nodes_.push_back({float3(0, 0, 0), 0, float3(0, 0, 0), num_items});
+
+		struct PendingNode
+		{
+			uint32_t index;
+			uint32_t depth;
+		};
+		std::vector<PendingNode> pending(1, {0, 0});
+		while (!pending.empty())
+		{
+			PendingNode const curr = pending.back();
+			pending.pop_back();
+
+			uint32_t const first = nodes_[curr.index].first;
+			uint32_t const count = nodes_[curr.index].count;
+
+			float3 bb_min = boxes[items_[first]].min;
+			float3 bb_max = boxes[items_[first]].max;
+			float3 centroid_min = centroids[items_[first]];
+			float3 centroid_max = centroid_min;
+			for (uint32_t i = first + 1; i < first + count; ++ i)
+			{
+				uint32_t const item = items_[i];
+				Merge(bb_min, bb_max, boxes[item].min, boxes[item].max);
+				Merge(centroid_min, centroid_max, centroids[item], centroids[item]);
+			}
+			nodes_[curr.index].min = bb_min;
+			nodes_[curr.index].max = bb_max;
+
+			if (count <= MAX_LEAF_ITEMS)
+			{
+				continue;
+			}
+
+			float3 const centroid_size = centroid_max - centroid_min;
+
+			// Cost of a leaf against the cost of traversing plus the children, in half areas
+			float best_cost = count * HalfArea(bb_min, bb_max);
+			uint32_t best_axis = 3;
+			uint32_t best_plane = 0;
+			float best_scale = 0;
+			if (curr.depth < MAX_SAH_DEPTH)
+			{
+				for (uint32_t axis = 0; axis < 3; ++ axis)
+				{
+					if (!(centroid_size[axis] > 0))
+					{
+						continue;
+					}
+
+					float const scale = NUM_BINS / centroid_size[axis];
+
+					uint32_t bin_counts[NUM_BINS] = {};
+					Box bin_boxes[NUM_BINS];
+					for (uint32_t i = first; i < first + count; ++ i)
+					{
+						uint32_t const item = items_[i];
+						uint32_t const b = std::min(NUM_BINS - 1, static_cast<uint32_t>((centroids[item][axis] - centroid_min[axis]) * scale));
+						if (bin_counts[b] == 0)
+						{
+							bin_boxes[b] = boxes[item];
+						}
+						else
+						{
+							Merge(bin_boxes[b].min, bin_boxes[b].max, boxes[item].min, boxes[item].max);
+						}
+						++ bin_counts[b];
+					}
+
+					// Plane p splits bins [0, p) from [p, NUM_BINS)
+					float left_costs[NUM_BINS];
+					uint32_t left_count = 0;
+					Box left_box;
+					for (uint32_t p = 1; p < NUM_BINS; ++ p)
+					{
+						uint32_t const b = p - 1;
+						if (bin_counts[b] > 0)
+						{
+							if (left_count == 0)
+							{
+								left_box = bin_boxes[b];
+							}
+							else
+							{
+								Merge(left_box.min, left_box.max, bin_boxes[b].min, bin_boxes[b].max);
+							}
+							left_count += bin_counts[b];
+						}
+						left_costs[p] = (left_count == 0) ? -1 : left_count * HalfArea(left_box.min, left_box.max);
+					}
+
+					uint32_t right_count = 0;
+					Box right_box;
+					for (uint32_t p = NUM_BINS - 1; p > 0; -- p)
+					{
+						if (bin_counts[p] > 0)
+						{
+							if (right_count == 0)
+							{
+								right_box = bin_boxes[p];
+							}
+							else
+							{
+								Merge(right_box.min, right_box.max, bin_boxes[p].min, bin_boxes[p].max);
+							}
+							right_count += bin_counts[p];
+						}
+						if ((right_count > 0) && (left_costs[p] >= 0))
+						{
+							float const cost =
+								HalfArea(bb_min, bb_max) + left_costs[p] + right_count * HalfArea(right_box.min, right_box.max);
+							if (cost < best_cost)
+							{
+								best_cost = cost;
+								best_axis = axis;
+								best_plane = p;
+								best_scale = scale;
+							}
+						}
+					}
+				}
+			}
+
+			uint32_t num_left;
+			if (best_axis < 3)
+			{
+				float const min_centroid = centroid_min[best_axis];
+				auto const mid_iter = std::partition(items_.begin() + first, items_.begin() + first + count,
+					[&centroids, best_axis, best_plane, best_scale, min_centroid](uint32_t item)
+					{
+						return std::min(NUM_BINS - 1, static_cast<uint32_t>((centroids[item][best_axis] - min_centroid) * best_scale))
+							< best_plane;
+					});
+				num_left = static_cast<uint32_t>(mid_iter - (items_.begin() + first));
+			}
+			else if ((count <= MAX_SAH_LEAF_ITEMS) && (curr.depth < MAX_SAH_DEPTH))
+			{
+				continue;
+			}
+			else
+			{
+				uint32_t axis = 0;
+				if (centroid_size[1] > centroid_size[axis])
+				{
+					axis = 1;
+				}
+				if (centroid_size[2] > centroid_size[axis])
+				{
+					axis = 2;
+				}
+
+				num_left = count / 2;
+				std::nth_element(items_.begin() + first, items_.begin() + first + num_left, items_.begin() + first + count,
+					[&centroids, axis](uint32_t lhs, uint32_t rhs) { return centroids[lhs][axis] < centroids[rhs][axis]; });
+			}
+			BOOST_ASSERT((num_left > 0) && (num_left < count));
+
+			uint32_t const left = static_cast<uint32_t>(nodes_.size());
+			nodes_.push_back({float3(0, 0, 0), first, float3(0, 0, 0), num_left});
+			nodes_.push_back({float3(0, 0, 0), first + num_left, float3(0, 0, 0), count - num_left});
+			nodes_[curr.index].first = left;
+			nodes_[curr.index].count = 0;
+
+			BOOST_ASSERT(curr.depth + 1 < MAX_DEPTH);
+			pending.push_back({left + 1, curr.depth + 1});
+			pending.push_back({left, curr.depth + 1});
+		}
+
+		for (uint32_t i = 0; i < num_items; ++ i)
+		{
+			item_bounds_[i] = boxes[items_[i]];
+		}
+
+		build_cost_ = this->Cost();
+	}
+
+	bool BoundingVolumeHierarchy::Refit(std::span<AABBox const> bounds)
+	{
+		BOOST_ASSERT(bounds.size() == items_.size());
+
+		for (size_t i = 0; i < items_.size(); ++ i)
+		{
+			auto const & aabb = bounds[items_[i]];
+			item_bounds_[i].min = aabb.Min();
+			item_bounds_[i].max = aabb.Max();
+		}
+
+		// Children always come after their parents
+		for (size_t i = nodes_.size(); i > 0; -- i)
+		{
+			auto& node = nodes_[i - 1];
+			if (node.count > 0)
+			{
+				this->UpdateLeafBound(node);
+			}
+			else
+			{
+				auto const & left = nodes_[node.first];
+				auto const & right = nodes_[node.first + 1];
+				node.min = left.min;
+				node.max = left.max;
+				Merge(node.min, node.max, right.min, right.max);
+			}
+		}
+
+		return this->Cost() <= build_cost_ * MAX_REFIT_DEGRADATION;
+	}
+
+	void BoundingVolumeHierarchy::Clear()
+	{
+		nodes_.clear();
+		items_.clear();
+		item_bounds_.clear();
+		build_cost_ = 0;
+	}
+
+	AABBox BoundingVolumeHierarchy::Bound() const
+	{
+		if (nodes_.empty())
+		{
+			return AABBox(float3(0, 0, 0), float3(0, 0, 0));
+		}
+		else
+		{
+			return AABBox(nodes_[0].min, nodes_[0].max);
+		}
+	}
+
+	uint32_t BoundingVolumeHierarchy::RayCast(float3 const & orig, float3 const & dir, float radius, float& dist,
+		RayHitTest const & hit_test) const
+	{
+		if (nodes_.empty())
+		{
+			return InvalidIndex;
+		}
+
+		RayData const ray(orig, dir, radius);
+
+		float root_dist;
+		if (!ray.Intersect(nodes_[0].min, nodes_[0].max, dist, root_dist))
+		{
+			return InvalidIndex;
+		}
+
+		uint32_t ret = InvalidIndex;
+
+		std::pair<uint32_t, float> stack[MAX_DEPTH];
+		uint32_t stack_size = 0;
+		stack[stack_size] = {0, root_dist};
+		++ stack_size;
+		while (stack_size > 0)
+		{
+			-- stack_size;
+			uint32_t const node_index = stack[stack_size].first;
+			if (stack[stack_size].second > dist)
+			{
+				continue;
+			}
+
+			auto const & node = nodes_[node_index];
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; ++ i)
+				{
+					auto const & box = item_bounds_[i];
+					float box_dist;
+					if (ray.Intersect(box.min, box.max, dist, box_dist))
+					{
+						uint32_t const item = items_[i];
+						float const item_dist = hit_test ? hit_test(item, box_dist) : box_dist;
+						if ((item_dist >= 0) && (item_dist <= dist))
+						{
+							dist = item_dist;
+							ret = item;
+						}
+					}
+				}
+			}
+			else
+			{
+				auto const & left = nodes_[node.first];
+				auto const & right = nodes_[node.first + 1];
+				float left_dist;
+				float right_dist;
+				bool const hit_left = ray.Intersect(left.min, left.max, dist, left_dist);
+				bool const hit_right = ray.Intersect(right.min, right.max, dist, right_dist);
+
+				// The nearer one goes on top
+				if (hit_left && hit_right)
+				{
+					if (left_dist <= right_dist)
+					{
+						stack[stack_size] = {node.first + 1, right_dist};
+						stack[stack_size + 1] = {node.first, left_dist};
+					}
+					else
+					{
+						stack[stack_size] = {node.first, left_dist};
+						stack[stack_size + 1] = {node.first + 1, right_dist};
+					}
+					stack_size += 2;
+				}
+				else if (hit_left)
+				{
+					stack[stack_size] = {node.first, left_dist};
+					++ stack_size;
+				}
+				else if (hit_right)
+				{
+					stack[stack_size] = {node.first + 1, right_dist};
+					++ stack_size;
+				}
+			}
+		}
+
+		return ret;
+	}
+
+	void BoundingVolumeHierarchy::Overlap(AABBox const & aabb, OverlapCallback const & callback) const
+	{
+		if (nodes_.empty())
+		{
+			return;
+		}
+
+		float3 const & query_min = aabb.Min();
+		float3 const & query_max = aabb.Max();
+
+		uint32_t stack[MAX_DEPTH];
+		uint32_t stack_size = 0;
+		stack[stack_size] = 0;
+		++ stack_size;
+		while (stack_size > 0)
+		{
+			-- stack_size;
+			auto const & node = nodes_[stack[stack_size]];
+			if (IntersectBoxBox(node.min, node.max, query_min, query_max))
+			{
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.first; i < node.first + node.count; ++ i)
+					{
+						if (IntersectBoxBox(item_bounds_[i].min, item_bounds_[i].max, query_min, query_max))
+						{
+							callback(items_[i]);
+						}
+					}
+				}
+				else
+				{
+					stack[stack_size] = node.first + 1;
+					stack[stack_size + 1] = node.first;
+					stack_size += 2;
+				}
+			}
+		}
+	}
+
+	void BoundingVolumeHierarchy::Overlap(Sphere const & sphere, OverlapCallback const & callback) const
+	{
+		if (nodes_.empty())
+		{
+			return;
+		}
+
+		float3 const & center = sphere.Center();
+		float const radius_sq = sphere.Radius() * sphere.Radius();
+
+		uint32_t stack[MAX_DEPTH];
+		uint32_t stack_size = 0;
+		stack[stack_size] = 0;
+		++ stack_size;
+		while (stack_size > 0)
+		{
+			-- stack_size;
+			auto const & node = nodes_[stack[stack_size]];
+			if (IntersectBoxSphere(node.min, node.max, center, radius_sq))
+			{
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.first; i < node.first + node.count; ++ i)
+					{
+						if (IntersectBoxSphere(item_bounds_[i].min, item_bounds_[i].max, center, radius_sq))
+						{
+							callback(items_[i]);
+						}
+					}
+				}
+				else
+				{
+					stack[stack_size] = node.first + 1;
+					stack[stack_size + 1] = node.first;
+					stack_size += 2;
+				}
+			}
+		}
+	}
+
+	void BoundingVolumeHierarchy::UpdateLeafBound(Node& node) const
+	{
+		node.min = item_bounds_[node.first].min;
+		node.max = item_bounds_[node.first].max;
+		for (uint32_t i = node.first + 1; i < node.first + node.count; ++ i)
+		{
+			Merge(node.min, node.max, item_bounds_[i].min, item_bounds_[i].max);
+		}
+	}
+
+	// SAH cost relative to the root: nodes weighted by their area, leaves also by their items
+	float BoundingVolumeHierarchy::Cost() const
+	{
+		if (nodes_.empty())
+		{
+			return 0;
+		}
+
+		float const root_area = HalfArea(nodes_[0].min, nodes_[0].max);
+		if (!(root_area > 0))
+		{
+			return 0;
+		}
+
+		float cost = 0;
+		for (auto const & node : nodes_)
+		{
+			float const area = HalfArea(node.min, node.max);
+			cost += (node.count > 0) ? area * node.count : area;
+		}
+		return cost / root_area;
+	}
+} // namespace KlayGE
@@ -37,6 +37,7 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Util.hpp>
+#include <KFL/CXX20/bit.hpp>
 #include <KlayGE/Context.hpp>
 #include <KFL/Math.hpp>
 #include <KlayGE/App3D.hpp>
@@ -53,12 +54,73 @@
 #include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KFL/Hash.hpp>
+#include <KlayGE/PerfProfiler.hpp>
+#include <KFL/RadixSort.hpp>
+#include <KFL/SIMDMath.hpp>
 
 #include <map>
 #include <algorithm>
+#include <limits>
 
 #include <KlayGE/SceneManager.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// Flips floats into unsigned integers of the same order
+	uint32_t SortableFloatBits(float v)
+	{
+		uint32_t const bits = std::bit_cast<uint32_t>(v);
+		return (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+	}
+
+	// Only groups equal pointers, so a scrambled few bits are enough. Collisions cost state changes, not correctness.
+	uint64_t PointerBits(void const * p, uint32_t num_bits)
+	{
+		return (reinterpret_cast<uintptr_t>(p) * 0x9E3779B97F4A7C15ULL) >> (64 - num_bits);
+	}
+
+	uint32_t constexpr WEIGHT_BITS = 16;
+	uint32_t constexpr TECH_BITS = 10;
+	uint32_t constexpr MATERIAL_BITS = 10;
+	uint32_t constexpr LAYOUT_BITS = 8;
+	uint32_t constexpr DEPTH_BITS = 20;
+	static_assert(WEIGHT_BITS + TECH_BITS + MATERIAL_BITS + LAYOUT_BITS + DEPTH_BITS == 64);
+
+	// Blended items leave the material and layout bits 0, so they are drawn in the order they were submitted
+	uint64_t MakeRenderKey(RenderTechnique const & tech, RenderMaterial const * mtl, RenderLayout const * layout)
+	{
+		bool const blended = tech.Transparent();
+		uint64_t key = SortableFloatBits(tech.Weight()) >> (32 - WEIGHT_BITS);
+		key = (key << TECH_BITS) | PointerBits(&tech, TECH_BITS);
+		key = (key << MATERIAL_BITS) | (blended ? 0 : PointerBits(mtl, MATERIAL_BITS));
+		key = (key << LAYOUT_BITS) | (blended ? 0 : PointerBits(layout, LAYOUT_BITS));
+		return key << DEPTH_BITS;
+	}
+
+	// The view space depth of the nearest bounding box corner over all instances
+	float MinViewDepth(Renderable const & renderable, float4 const & view_mat_z)
+	{
+		AABBox const & box = renderable.PosBound();
+		float3 const center = box.Center();
+		float3 const half_size = box.HalfSize();
+
+		float ret = 1e10f;
+		for (uint32_t i = 0; i < renderable.NumInstances(); ++ i)
+		{
+			float4x4 const & mat = renderable.GetInstance(i)->TransformToWorld();
+			float4 const zvec(MathLib::dot(mat.Row(0), view_mat_z), MathLib::dot(mat.Row(1), view_mat_z),
+				MathLib::dot(mat.Row(2), view_mat_z), MathLib::dot(mat.Row(3), view_mat_z));
+			float const center_z = center.x() * zvec.x() + center.y() * zvec.y() + center.z() * zvec.z() + zvec.w();
+			float const extent_z = half_size.x() * MathLib::abs(zvec.x()) + half_size.y() * MathLib::abs(zvec.y())
+				+ half_size.z() * MathLib::abs(zvec.z());
+			ret = std::min(ret, center_z - extent_z);
+		}
+		return ret;
+	}
+}
+
 namespace KlayGE
 {
 	// 캯
@@ -66,6 +128,7 @@ namespace KlayGE
 	SceneManager::SceneManager()
 		: scene_root_(L"SceenRoot", SceneNode::SOA_Cullable),
 			overlay_root_(L"OverlayRoot", SceneNode::SOA_Cullable | SceneNode::SOA_Overlay),
+			scene_hierarchy_(scene_root_),
 			small_obj_threshold_(0),
 			update_elapse_(1.0f / 60),
 			num_objects_rendered_(0), num_renderables_rendered_(0),
@@ -114,19 +177,25 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::ClipScene()
 	{
+		PerfScope perf_scope("SceneManager::ClipScene");
+
 		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		auto const& viewport = *re.CurFrameBuffer()->Viewport();
 		uint32_t const num_cameras = viewport.NumCameras();
 
-		for (auto* sn : all_scene_nodes_)
+		this->UpdateFrustumOverlaps(num_cameras);
+
+		auto const & snapshot = this->FrontSnapshot();
+		size_t const num_nodes = all_scene_nodes_.size();
+		for (size_t n = 0; n < num_nodes; ++ n)
 		{
-			auto& node = *sn;
+			auto& node = *all_scene_nodes_[n];
 			node.FillVisibleMark(BoundOverlap::No);
-			if (node.Visible())
+			uint32_t const attr = snapshot.attribs[n];
+			if (!(attr & SceneNode::SOA_Invisible))
 			{
-				if (node.Updated())
+				if (snapshot.flags[n] & SceneSnapshot::SF_Updated)
 				{
-					uint32_t const attr = node.Attrib();
 
 					for (uint32_t i = 0; i < num_cameras; ++i)
 					{
@@ -136,7 +205,7 @@ namespace KlayGE
 						auto visible = this->VisibleTestFromParent(node, i);
 						if (BoundOverlap::Partial == visible)
 						{
-							if (attr & SceneNode::SOA_Cullable)
+							if ((attr & SceneNode::SOA_Cullable) && node.HasPosBound())
 							{
 								visible = (small_obj_threshold_ <= 0) ||
 												  ((MathLib::ortho_area(camera.ForwardVec(), node.PosBoundWS()) > small_obj_threshold_) &&
@@ -152,7 +221,7 @@ namespace KlayGE
 
 							if (!camera.OmniDirectionalMode() && (attr & SceneNode::SOA_Cullable) && (BoundOverlap::Yes == visible))
 							{
-								visible = camera_frustums_[i]->Intersect(node.PosBoundWS());
+								visible = frustum_overlaps_[i * num_nodes + n];
 							}
 						}
 
@@ -254,20 +323,7 @@ namespace KlayGE
 			{
 				RenderTechnique const * obj_tech = obj->GetRenderTechnique();
 				BOOST_ASSERT(obj_tech);
-				bool found = false;
-				for (auto& items : render_queue_)
-				{
-					if (items.first == obj_tech)
-					{
-						items.second.push_back(obj);
-						found = true;
-						break;
-					}
-				}
-				if (!found)
-				{
-					render_queue_.emplace_back(obj_tech, std::vector<Renderable*>(1, obj));
-				}
+				render_queue_.push_back({MakeRenderKey(*obj_tech, obj->Material().get(), &obj->GetRenderLayout()), obj});
 			}
 		}
 	}
@@ -360,6 +416,16 @@ namespace KlayGE
 		return ret;
 	}
 
+	void SceneManager::OnNodeAdded(SceneNode& node)
+	{
+		KFL_UNUSED(node);
+	}
+
+	void SceneManager::OnNodeRemoved(SceneNode& node)
+	{
+		KFL_UNUSED(node);
+	}
+
 	void SceneManager::ClearObject()
 	{
 		std::lock_guard<std::mutex> lock(update_mutex_);
@@ -371,6 +437,8 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::Update()
 	{
+		PerfScope perf_scope("SceneManager::Update");
+
 		deferred_mode_ = !!Context::Instance().DeferredRenderingLayerInstance();
 
 		App3DFramework& app = Context::Instance().AppInstance();
@@ -390,7 +458,6 @@ namespace KlayGE
 
 			scene_root_.Traverse([this, app_time, frame_time](SceneNode& node) {
 				node.MainThreadUpdate(app_time, frame_time);
-				node.UpdateTransforms();
 
 				if (node.Visible())
 				{
@@ -405,13 +472,13 @@ namespace KlayGE
 
 				return true;
 			});
-			scene_root_.UpdatePosBoundSubtree();
+			scene_hierarchy_.Update();
+			nodes_updated_ = true;
+			this->UpdateSnapshot();
 
 			overlay_root_.ClearChildren();
 		}
 
-		nodes_updated_ = true;
-
 		this->FlushScene();
 
 		FrameBuffer& fb = *re.ScreenFrameBuffer();
@@ -430,11 +497,27 @@ namespace KlayGE
 		nodes_updated_ = false;
 	}
 
+	void SceneManager::UpdateScene()
+	{
+		std::lock_guard<std::mutex> lock(update_mutex_);
+
+		scene_hierarchy_.Update();
+		nodes_updated_ = true;
+		this->UpdateSnapshot();
+		nodes_updated_ = false;
+	}
+
 	// ȾеȾ
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::Flush(uint32_t urt)
 	{
-		std::lock_guard<std::mutex> lock(update_mutex_);
+		// The scene nodes come from the published snapshot, and their world transforms and bounds are only written by Update.
+		//  Overlay nodes are live, and get their main-thread update here.
+		std::unique_lock<std::mutex> lock(update_mutex_, std::defer_lock);
+		if (urt & App3DFramework::URV_Overlay)
+		{
+			lock.lock();
+		}
 
 		urt_ = urt;
 
@@ -451,16 +534,15 @@ namespace KlayGE
 		num_primitives_rendered_ = 0;
 		num_vertices_rendered_ = 0;
 
-		scene_root_.Traverse([this](SceneNode& node)
-			{
-				all_scene_nodes_.push_back(&node);
-				return true;
-			});
-		overlay_root_.Traverse([this](SceneNode& node)
-			{
-				all_overlay_nodes_.push_back(&node);
-				return true;
-			});
+		auto const & snapshot = this->FrontSnapshot();
+		if (urt & App3DFramework::URV_Overlay)
+		{
+			overlay_root_.Traverse([this](SceneNode& node)
+				{
+					all_overlay_nodes_.push_back(&node);
+					return true;
+				});
+		}
 
 		auto& scene_nodes = (urt & App3DFramework::URV_Overlay) ? all_overlay_nodes_ : all_scene_nodes_;
 
@@ -470,19 +552,19 @@ namespace KlayGE
 		}
 		if (!(urt & App3DFramework::URV_Overlay))
 		{
-			scene_root_.Traverse([num_cameras](SceneNode& node)
+			for (size_t i = 0; i < scene_nodes.size(); ++ i)
+			{
+				uint32_t const attr = snapshot.attribs[i];
+				if ((snapshot.flags[i] & SceneSnapshot::SF_Reachable)
+					&& ((i == 0)
+						|| (!(attr & SceneNode::SOA_Invisible) && (!(attr & SceneNode::SOA_Cullable) || (attr & SceneNode::SOA_Moveable)))))
 				{
-					uint32_t const attr = node.Attrib();
-					if ((node.Parent() == nullptr)
-						|| (node.Visible() && (!(attr & SceneNode::SOA_Cullable) || (attr & SceneNode::SOA_Moveable))))
+					for (uint32_t j = 0; j < num_cameras; ++ j)
 					{
-						for (uint32_t i = 0; i < num_cameras; ++i)
-						{
-							node.VisibleMark(i, BoundOverlap::Partial);
-						}
+						scene_nodes[i]->VisibleMark(j, BoundOverlap::Partial);
 					}
-					return node.Visible();
-				});
+				}
+			}
 		}
 		if (urt & App3DFramework::URV_NeedFlush)
 		{
@@ -495,7 +577,7 @@ namespace KlayGE
 			std::vector<uint32_t> visible_list((scene_nodes.size() + 31) / 32, 0);
 			for (size_t i = 0; i < scene_nodes.size(); ++ i)
 			{
-				if (scene_nodes[i]->Visible())
+				if (!(snapshot.attribs[i] & SceneNode::SOA_Invisible))
 				{
 					visible_list[i / 32] |= (1UL << (i & 31));
 				}
@@ -581,6 +663,17 @@ namespace KlayGE
 				}
 			}
 		}
+		if (!(urt & App3DFramework::URV_Overlay) && (urt & (App3DFramework::URV_StaticOnly | App3DFramework::URV_DynamicOnly)))
+		{
+			uint8_t const wanted = (urt & App3DFramework::URV_DynamicOnly) ? SceneSnapshot::SF_Dynamic : 0;
+			for (size_t i = 0; i < scene_nodes.size(); ++i)
+			{
+				if ((snapshot.flags[i] & SceneSnapshot::SF_Dynamic) != wanted)
+				{
+					node_visible[i] = false;
+				}
+			}
+		}
 
 		for (size_t i = 0; i < scene_nodes.size(); ++i)
 		{
@@ -612,70 +705,42 @@ namespace KlayGE
 			}
 		}
 
-		std::sort(render_queue_.begin(), render_queue_.end(),
-			[](std::pair<RenderTechnique const *, std::vector<Renderable*>> const & lhs,
-				std::pair<RenderTechnique const *, std::vector<Renderable*>> const & rhs)
-			{
-				BOOST_ASSERT(lhs.first);
-				BOOST_ASSERT(rhs.first);
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
+		uint32_t const num_items = static_cast<uint32_t>(render_queue_.size());
 
-				return lhs.first->Weight() < rhs.first->Weight();
-			});
-
-		float4 view_mat_z;
+		// Opaque items go front to back within the same states, for early z. Blended ones have nothing but the technique in the
+		//  key, so the stable sort keeps them in the order they were submitted.
 		if (viewport.NumCameras() == 1)
 		{
-			view_mat_z = viewport.Camera(0)->ViewMatrix().Col(2);
-		}
-		for (auto& items : render_queue_)
-		{
-			if ((viewport.NumCameras() == 1) && !items.first->Transparent() && !items.first->HasDiscard() && (items.second.size() > 1))
-			{
-				std::vector<std::pair<float, uint32_t>> min_depths(items.second.size());
-				for (size_t j = 0; j < min_depths.size(); ++ j)
+			float4 const view_mat_z = viewport.Camera(0)->ViewMatrix().Col(2);
+			thread_pool.ParallelFor(0, num_items, 256, [this, &view_mat_z](uint32_t begin, uint32_t end)
 				{
-					Renderable const * renderable = items.second[j];
-					AABBox const & box = renderable->PosBound();
-					uint32_t const num = renderable->NumInstances();
-					float md = 1e10f;
-					for (uint32_t i = 0; i < num; ++ i)
+					for (uint32_t i = begin; i < end; ++ i)
 					{
-						float4x4 const & mat = renderable->GetInstance(i)->TransformToWorld();
-						float4 const zvec(MathLib::dot(mat.Row(0), view_mat_z),
-							MathLib::dot(mat.Row(1), view_mat_z), MathLib::dot(mat.Row(2), view_mat_z),
-							MathLib::dot(mat.Row(3), view_mat_z));
-						for (int k = 0; k < 8; ++ k)
+						auto& item = render_queue_[i];
+						RenderTechnique const & tech = *item.renderable->GetRenderTechnique();
+						if (!tech.Transparent() && !tech.HasDiscard())
 						{
-							float3 const v = box.Corner(k);
-							md = std::min(md, v.x() * zvec.x() + v.y() * zvec.y() + v.z() * zvec.z() + zvec.w());
+							item.key |= SortableFloatBits(MinViewDepth(*item.renderable, view_mat_z)) >> (32 - DEPTH_BITS);
 						}
 					}
+				});
+		}
 
-					min_depths[j] = std::make_pair(md, static_cast<uint32_t>(j));
-				}
-
-				std::sort(min_depths.begin(), min_depths.end());
-
-				std::vector<Renderable*> sorted_items(min_depths.size());
-				for (size_t j = 0; j < min_depths.size(); ++ j)
-				{
-					sorted_items[j] = items.second[min_depths[j].second];
-				}
-				items.second.swap(sorted_items);
-			}
+		render_queue_scratch_.resize(num_items);
+		RadixSort(std::span(render_queue_), std::span(render_queue_scratch_), [](RenderItem const & item) { return item.key; },
+			&thread_pool.Scheduler());
 
-			for (auto const & item : items.second)
-			{
-				item->Render();
-			}
-			num_renderables_rendered_ += static_cast<uint32_t>(items.second.size());
+		for (auto const & item : render_queue_)
+		{
+			item.renderable->Render();
 		}
+		num_renderables_rendered_ += num_items;
 		render_queue_.resize(0);
 
 		num_primitives_rendered_ += re.NumPrimitivesJustRendered();
 		num_vertices_rendered_ += re.NumVerticesJustRendered();
 
-		all_scene_nodes_.clear();
 		all_overlay_nodes_.clear();
 
 		urt_ = 0;
@@ -719,12 +784,24 @@ namespace KlayGE
 		return num_dispatch_calls_;
 	}
 
+	uint32_t SceneManager::NumRedundantBinds() const
+	{
+		return num_redundant_binds_;
+	}
+
 	void SceneManager::FlushScene()
 	{
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
 		visible_marks_map_.clear();
 
+		auto const & snapshot = this->FrontSnapshot();
+		if (all_scene_nodes_version_ != snapshot.topology_version)
+		{
+			all_scene_nodes_ = snapshot.nodes;
+			all_scene_nodes_version_ = snapshot.topology_version;
+		}
+
 		uint32_t urt;
 		App3DFramework& app = Context::Instance().AppInstance();
 		for (uint32_t pass = 0;; ++ pass)
@@ -759,10 +836,13 @@ namespace KlayGE
 
 		num_draw_calls_ = re.NumDrawsJustCalled();
 		num_dispatch_calls_ = re.NumDispatchesJustCalled();
+		num_redundant_binds_ = re.NumRedundantBindsJustCalled();
 	}
 
 	void SceneManager::UpdateThreadFunc()
 	{
+		PerfProfiler::Instance().ThreadName("Scene update");
+
 		Timer timer;
 		float app_time = 0;
 		while (!quit_)
@@ -776,6 +856,8 @@ namespace KlayGE
 				WindowPtr const & win = Context::Instance().AppInstance().MainWnd();
 				if (win && win->Active())
 				{
+					PerfScope perf_scope("SceneManager::SubThreadUpdate");
+
 					std::lock_guard<std::mutex> lock(update_mutex_);
 
 					auto updater = [app_time, frame_time](SceneNode& node) {
@@ -794,6 +876,395 @@ namespace KlayGE
 		}
 	}
 
+	void SceneManager::UpdateSnapshot()
+	{
+		uint32_t const back_snapshot = 1 - front_snapshot_;
+		auto const & front = scene_snapshots_[front_snapshot_];
+		auto& snapshot = scene_snapshots_[back_snapshot];
+		auto const & nodes = scene_hierarchy_.Nodes();
+		uint32_t const num_nodes = static_cast<uint32_t>(nodes.size());
+		bool const topology_changed = (snapshot.topology_version != scene_hierarchy_.TopologyVersion());
+		if (topology_changed)
+		{
+			snapshot.topology_version = scene_hierarchy_.TopologyVersion();
+			snapshot.nodes = nodes;
+			snapshot.parent_indices = scene_hierarchy_.ParentIndices();
+			snapshot.node_refs.resize(num_nodes - 1);
+			for (uint32_t i = 1; i < num_nodes; ++ i)
+			{
+				snapshot.node_refs[i - 1] = nodes[i]->shared_from_this();
+			}
+
+			snapshot.attribs.resize(num_nodes);
+			snapshot.flags.resize(num_nodes);
+			for (auto& bounds : snapshot.bounds)
+			{
+				bounds.resize(num_nodes);
+			}
+			snapshot.xforms.resize(num_nodes);
+			snapshot.inv_xforms.resize(num_nodes);
+			snapshot.collision_renderables.resize(num_nodes);
+		}
+		else
+		{
+			// Same topology as when this buffer was last filled. What moved in between is in the front one, and what moves
+			//  now is copied over it below.
+			for (auto const i : front.xform_changed_node_indices)
+			{
+				snapshot.xforms[i] = front.xforms[i];
+				snapshot.inv_xforms[i] = front.inv_xforms[i];
+			}
+		}
+
+		bool const caster_topology_changed = (caster_topology_version_ != scene_hierarchy_.TopologyVersion());
+		if (caster_topology_changed)
+		{
+			caster_topology_version_ = scene_hierarchy_.TopologyVersion();
+			caster_has_renderables_.resize(num_nodes);
+			for (uint32_t i = 0; i < num_nodes; ++ i)
+			{
+				caster_has_renderables_[i] = (nodes[i]->FirstComponentOfType<RenderableComponent>() != nullptr);
+			}
+			caster_casting_.assign(num_nodes, 0);
+			caster_bounds_.resize(num_nodes);
+		}
+
+		Context::Instance().ThreadPoolInstance().ParallelFor(0, num_nodes, 1024,
+			[this, &snapshot, &nodes, topology_changed](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; ++ i)
+				{
+					auto const & node = *nodes[i];
+					uint32_t const attr = node.Attrib();
+					snapshot.attribs[i] = attr;
+					snapshot.flags[i] = node.Updated() ? SceneSnapshot::SF_Updated : 0;
+
+					auto& collision_renderables = snapshot.collision_renderables[i];
+					collision_renderables.clear();
+					if (caster_has_renderables_[i])
+					{
+						snapshot.flags[i] |= SceneSnapshot::SF_HasRenderables;
+						if (node.DynamicContent())
+						{
+							snapshot.flags[i] |= SceneSnapshot::SF_Dynamic;
+						}
+
+						node.ForEachComponentOfType<RenderableComponent>([&collision_renderables](RenderableComponent& renderable_comp) {
+							auto const & renderable = renderable_comp.BoundRenderablePtr();
+							if (renderable->HasCollisionMesh())
+							{
+								collision_renderables.push_back(renderable);
+							}
+						});
+					}
+
+					if (topology_changed || node.TransformChanged())
+					{
+						snapshot.xforms[i] = node.TransformToWorld();
+						snapshot.inv_xforms[i] = node.InverseTransformToWorld();
+					}
+
+					if (node.HasPosBound())
+					{
+						AABBox const & aabb = node.PosBoundWS();
+						snapshot.bounds[0][i] = aabb.Min().x();
+						snapshot.bounds[1][i] = aabb.Min().y();
+						snapshot.bounds[2][i] = aabb.Min().z();
+						snapshot.bounds[3][i] = aabb.Max().x();
+						snapshot.bounds[4][i] = aabb.Max().y();
+						snapshot.bounds[5][i] = aabb.Max().z();
+
+						if (!(aabb == caster_bounds_[i]))
+						{
+							snapshot.flags[i] |= SceneSnapshot::SF_Moved;
+						}
+					}
+					else
+					{
+						for (auto& bounds : snapshot.bounds)
+						{
+							bounds[i] = 0;
+						}
+					}
+				}
+			});
+
+		snapshot.xform_changed_node_indices.clear();
+		snapshot.moved_node_indices.clear();
+		snapshot.changed_static_caster_bounds.clear();
+		snapshot.dynamic_caster_bounds.clear();
+		snapshot.all_casters_changed = caster_topology_changed;
+
+		// Parents come first in breadth-first order
+		for (uint32_t i = 0; i < num_nodes; ++ i)
+		{
+			uint32_t const parent = snapshot.parent_indices[i];
+			uint32_t const attr = snapshot.attribs[i];
+			uint8_t& flags = snapshot.flags[i];
+			if ((i == 0)
+				|| ((snapshot.flags[parent] & SceneSnapshot::SF_Reachable) && !(snapshot.attribs[parent] & SceneNode::SOA_Invisible)))
+			{
+				flags |= SceneSnapshot::SF_Reachable;
+			}
+			if ((attr & SceneNode::SOA_Moveable) || ((i != 0) && (snapshot.flags[parent] & SceneSnapshot::SF_Moveable)))
+			{
+				flags |= SceneSnapshot::SF_Moveable | SceneSnapshot::SF_Dynamic;
+			}
+
+			AABBox const aabb(float3(snapshot.bounds[0][i], snapshot.bounds[1][i], snapshot.bounds[2][i]),
+				float3(snapshot.bounds[3][i], snapshot.bounds[4][i], snapshot.bounds[5][i]));
+			if (caster_has_renderables_[i])
+			{
+				// 0 for not casting, 1 for a static caster, 2 for a dynamic one
+				uint8_t casting = 0;
+				if ((flags & SceneSnapshot::SF_Reachable) && !(attr & (SceneNode::SOA_Invisible | SceneNode::SOA_NotCastShadow)))
+				{
+					casting = (flags & SceneSnapshot::SF_Dynamic) ? 2 : 1;
+				}
+
+				if (casting == 2)
+				{
+					snapshot.dynamic_caster_bounds.push_back(aabb);
+				}
+				if (((casting != caster_casting_[i]) && ((casting == 1) || (caster_casting_[i] == 1)))
+					|| ((casting == 1) && (flags & SceneSnapshot::SF_Moved)))
+				{
+					if (!(attr & SceneNode::SOA_Overlay) && (attr & (SceneNode::SOA_Cullable | SceneNode::SOA_Moveable)))
+					{
+						if (caster_casting_[i] == 1)
+						{
+							snapshot.changed_static_caster_bounds.push_back(caster_bounds_[i]);
+						}
+						if (casting == 1)
+						{
+							snapshot.changed_static_caster_bounds.push_back(aabb);
+						}
+					}
+					else
+					{
+						// Without bounds, there is no telling where it was
+						snapshot.all_casters_changed = true;
+					}
+				}
+
+				caster_casting_[i] = casting;
+			}
+			if (flags & SceneSnapshot::SF_Moved)
+			{
+				caster_bounds_[i] = aabb;
+				snapshot.moved_node_indices.push_back(i);
+			}
+			if (nodes[i]->TransformChanged())
+			{
+				snapshot.xform_changed_node_indices.push_back(i);
+			}
+		}
+
+		snapshot.serial = front.serial + 1;
+		front_snapshot_ = back_snapshot;
+	}
+
+	bool SceneManager::CastersChanged(AABBox const & volume, bool static_only) const
+	{
+		auto const & snapshot = this->FrontSnapshot();
+		if (snapshot.all_casters_changed)
+		{
+			return true;
+		}
+
+		auto const overlaps = [&volume](AABBox const & aabb) { return MathLib::intersect_aabb_aabb(volume, aabb); };
+		if (std::any_of(snapshot.changed_static_caster_bounds.begin(), snapshot.changed_static_caster_bounds.end(), overlaps))
+		{
+			return true;
+		}
+		return !static_only && std::any_of(snapshot.dynamic_caster_bounds.begin(), snapshot.dynamic_caster_bounds.end(), overlaps);
+	}
+
+	std::optional<SceneManager::QueryHit> SceneManager::RayCast(float3 const & orig, float3 const & dir, float max_dist, bool per_triangle)
+	{
+		this->UpdateQueryBvh();
+		return this->DoRayCast(orig, dir, 0, max_dist, per_triangle);
+	}
+
+	void SceneManager::RayCast(std::span<float3 const> origs, std::span<float3 const> dirs, float max_dist, bool per_triangle,
+		std::span<std::optional<QueryHit>> hits)
+	{
+		BOOST_ASSERT((origs.size() == dirs.size()) && (origs.size() == hits.size()));
+
+		this->UpdateQueryBvh();
+		Context::Instance().ThreadPoolInstance().ParallelFor(0, static_cast<uint32_t>(hits.size()), 64,
+			[this, origs, dirs, max_dist, per_triangle, hits](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; ++ i)
+				{
+					hits[i] = this->DoRayCast(origs[i], dirs[i], 0, max_dist, per_triangle);
+				}
+			});
+	}
+
+	std::optional<SceneManager::QueryHit> SceneManager::SweepSphere(Sphere const & sphere, float3 const & dir, float max_dist)
+	{
+		this->UpdateQueryBvh();
+		return this->DoRayCast(sphere.Center(), dir, sphere.Radius(), max_dist, false);
+	}
+
+	void SceneManager::OverlapAABB(AABBox const & aabb, std::vector<SceneNode*>& nodes)
+	{
+		this->UpdateQueryBvh();
+
+		auto const & snapshot = this->FrontSnapshot();
+		query_bvh_.Overlap(aabb, [this, &snapshot, &nodes](uint32_t item)
+			{
+				if (this->QueryVisible(item))
+				{
+					nodes.push_back(snapshot.nodes[query_node_indices_[item]]);
+				}
+			});
+	}
+
+	void SceneManager::OverlapSphere(Sphere const & sphere, std::vector<SceneNode*>& nodes)
+	{
+		this->UpdateQueryBvh();
+
+		auto const & snapshot = this->FrontSnapshot();
+		query_bvh_.Overlap(sphere, [this, &snapshot, &nodes](uint32_t item)
+			{
+				if (this->QueryVisible(item))
+				{
+					nodes.push_back(snapshot.nodes[query_node_indices_[item]]);
+				}
+			});
+	}
+
+	void SceneManager::UpdateQueryBvh()
+	{
+		auto const & snapshot = this->FrontSnapshot();
+		if (query_snapshot_serial_ == snapshot.serial)
+		{
+			return;
+		}
+		query_snapshot_serial_ = snapshot.serial;
+
+		bool const topology_changed = (query_topology_version_ != snapshot.topology_version);
+		if (topology_changed)
+		{
+			query_topology_version_ = snapshot.topology_version;
+
+			query_node_indices_.clear();
+			for (uint32_t i = 1; i < snapshot.nodes.size(); ++ i)
+			{
+				uint32_t const attr = snapshot.attribs[i];
+				if (!(attr & SceneNode::SOA_Overlay) && (attr & (SceneNode::SOA_Cullable | SceneNode::SOA_Moveable))
+					&& (snapshot.flags[i] & SceneSnapshot::SF_HasRenderables))
+				{
+					query_node_indices_.push_back(i);
+				}
+			}
+			query_bounds_.resize(query_node_indices_.size());
+		}
+
+		for (size_t i = 0; i < query_node_indices_.size(); ++ i)
+		{
+			uint32_t const index = query_node_indices_[i];
+			query_bounds_[i] = AABBox(float3(snapshot.bounds[0][index], snapshot.bounds[1][index], snapshot.bounds[2][index]),
+				float3(snapshot.bounds[3][index], snapshot.bounds[4][index], snapshot.bounds[5][index]));
+		}
+
+		if (topology_changed || !query_bvh_.Refit(query_bounds_))
+		{
+			query_bvh_.Build(query_bounds_);
+		}
+	}
+
+	std::optional<SceneManager::QueryHit> SceneManager::DoRayCast(
+		float3 const & orig, float3 const & dir, float radius, float max_dist, bool per_triangle) const
+	{
+		auto const & snapshot = this->FrontSnapshot();
+
+		float dist = max_dist;
+		uint32_t const item = query_bvh_.RayCast(orig, dir, radius, dist,
+			[this, &snapshot, &orig, &dir, per_triangle](uint32_t item, float box_dist)
+			{
+				if (!this->QueryVisible(item))
+				{
+					return -1.0f;
+				}
+				if (!per_triangle)
+				{
+					return box_dist;
+				}
+
+				// Everything comes from the snapshot, the live nodes belong to the update thread.
+				// The triangles are in model space. The direction is left unnormalized, so the distance there is the same.
+				uint32_t const index = query_node_indices_[item];
+				auto const & collision_renderables = snapshot.collision_renderables[index];
+				if (collision_renderables.empty())
+				{
+					return box_dist;
+				}
+
+				float4x4 const & inv_world = snapshot.inv_xforms[index];
+				float3 const orig_ms = MathLib::transform_coord(orig, inv_world);
+				float3 const dir_ms = MathLib::transform_normal(dir, inv_world);
+
+				float ret = -1;
+				for (auto const & renderable : collision_renderables)
+				{
+					float tri_dist = std::numeric_limits<float>::max();
+					if (renderable->IntersectRay(orig_ms, dir_ms, tri_dist) && ((ret < 0) || (tri_dist < ret)))
+					{
+						ret = tri_dist;
+					}
+				}
+				return ret;
+			});
+		if (item == BoundingVolumeHierarchy::InvalidIndex)
+		{
+			return std::nullopt;
+		}
+		return QueryHit{snapshot.nodes[query_node_indices_[item]], dist};
+	}
+
+	bool SceneManager::QueryVisible(uint32_t item) const
+	{
+		auto const & snapshot = this->FrontSnapshot();
+		uint32_t const index = query_node_indices_[item];
+		return (snapshot.flags[index] & SceneSnapshot::SF_Reachable) && !(snapshot.attribs[index] & SceneNode::SOA_Invisible);
+	}
+
+	void SceneManager::UpdateFrustumOverlaps(uint32_t num_cameras)
+	{
+		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto const& viewport = *re.CurFrameBuffer()->Viewport();
+
+		auto const & bounds = this->FrontSnapshot().bounds;
+		uint32_t const num_nodes = static_cast<uint32_t>(all_scene_nodes_.size());
+		frustum_overlaps_.resize(num_cameras * num_nodes);
+
+		// Tests are independent from the hierarchy, so every node is tested. The nodes culled by their parents are simply ignored.
+		Context::Instance().ThreadPoolInstance().ParallelFor(0, num_nodes, 512,
+			[this, &viewport, &bounds, num_cameras, num_nodes](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = 0; i < num_cameras; ++ i)
+				{
+					if (!viewport.Camera(i)->OmniDirectionalMode())
+					{
+						SIMDMathLib::IntersectAABBsFrustum(&frustum_overlaps_[i * num_nodes + begin], &bounds[0][begin], &bounds[1][begin],
+							&bounds[2][begin], &bounds[3][begin], &bounds[4][begin], &bounds[5][begin], end - begin, *camera_frustums_[i]);
+
+						// The zeroed bounds of the nodes without ones are not to cull them
+						for (uint32_t n = begin; n < end; ++ n)
+						{
+							if (!all_scene_nodes_[n]->HasPosBound())
+							{
+								frustum_overlaps_[i * num_nodes + n] = BoundOverlap::Yes;
+							}
+						}
+					}
+				}
+			});
+	}
+
 	BoundOverlap SceneManager::VisibleTestFromParent(SceneNode const & node, uint32_t camera_index)
 	{
 		BoundOverlap visible;
@@ -807,7 +1278,7 @@ namespace KlayGE
 			else
 			{
 				uint32_t const attr = node.Attrib();
-				if (attr & SceneNode::SOA_Cullable)
+				if ((attr & SceneNode::SOA_Cullable) && node.HasPosBound())
 				{
 					if (small_obj_threshold_ > 0)
 					{
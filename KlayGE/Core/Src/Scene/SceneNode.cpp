@@ -32,13 +32,29 @@
 #include <KlayGE/SceneManager.hpp>
 #include <KlayGE/Context.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/Thread.hpp>
 
+#include <atomic>
 #include <string_view>
 
 #include <boost/assert.hpp>
 
 #include <KlayGE/SceneNode.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	void StoreMatrix(float4x4& mat, SIMDMatrixF4 const & v)
+	{
+		for (uint32_t i = 0; i < 4; ++ i)
+		{
+			SIMDMathLib::StoreVector4(*reinterpret_cast<float4*>(&mat(i, 0)), v.Row(i));
+		}
+	}
+}
+
 namespace KlayGE
 {
 	SceneNode::SceneNode(uint32_t attrib)
@@ -162,6 +178,7 @@ namespace KlayGE
 		parent_ = so;
 
 		pos_aabb_dirty_ = true;
+		xform_dirty_ = true;
 		updated_ = false;
 	}
 
@@ -178,6 +195,10 @@ namespace KlayGE
 			pos_aabb_dirty_ = true;
 			node->Parent(this);
 			children_.push_back(node);
+
+			this->TopologyChanged();
+
+			this->EmitSubTreeChanged(*node, true);
 		}
 	}
 
@@ -191,10 +212,15 @@ namespace KlayGE
 		auto iter = std::find_if(children_.begin(), children_.end(), [node](SceneNodePtr const& child) { return child.get() == node; });
 		if (iter != children_.end())
 		{
+			// Before the node could be destroyed by erasing
+			this->EmitSubTreeChanged(*node, false);
+
 			pos_aabb_dirty_ = true;
 			node->Parent(nullptr);
 			children_.erase(iter);
 
+			this->TopologyChanged();
+
 			this->EmitSceneChanged();
 		}
 	}
@@ -203,12 +229,15 @@ namespace KlayGE
 	{
 		for (auto const& child : children_)
 		{
+			this->EmitSubTreeChanged(*child, false);
 			child->Parent(nullptr);
 		}
 
 		pos_aabb_dirty_ = true;
 		children_.clear();
 
+		this->TopologyChanged();
+
 		this->EmitSceneChanged();
 	}
 
@@ -223,6 +252,21 @@ namespace KlayGE
 		}
 	}
 
+	uint32_t SceneNode::TopologyVersion() const
+	{
+		return topology_version_.load();
+	}
+
+	void SceneNode::TopologyChanged()
+	{
+		auto* node = this;
+		while (node->parent_ != nullptr)
+		{
+			node = node->parent_;
+		}
+		++ node->topology_version_;
+	}
+
 	uint32_t SceneNode::NumComponents() const
 	{
 		return static_cast<uint32_t>(components_.size());
@@ -261,6 +305,8 @@ namespace KlayGE
 		components_.push_back(component);
 		component->BindSceneNode(this);
 		pos_aabb_dirty_ = true;
+
+		this->TopologyChanged();
 	}
 
 	void SceneNode::RemoveComponent(SceneComponentPtr const& component)
@@ -277,6 +323,8 @@ namespace KlayGE
 			components_.erase(iter);
 			component->BindSceneNode(nullptr);
 			pos_aabb_dirty_ = true;
+
+			this->TopologyChanged();
 		}
 	}
 
@@ -284,6 +332,8 @@ namespace KlayGE
 	{
 		components_.clear();
 		pos_aabb_dirty_ = true;
+
+		this->TopologyChanged();
 	}
 
 	void SceneNode::ReplaceComponent(uint32_t index, SceneComponentPtr const& component)
@@ -306,6 +356,8 @@ namespace KlayGE
 			component->BindSceneNode(this);
 			components_[index] = component;
 			pos_aabb_dirty_ = true;
+
+			this->TopologyChanged();
 		}
 	}
 
@@ -325,6 +377,7 @@ namespace KlayGE
 		xform_to_parent_ = mat;
 		inv_xform_to_parent_ = MathLib::inverse(mat);
 		pos_aabb_dirty_ = true;
+		xform_dirty_ = true;
 	}
 
 	void SceneNode::TransformToWorld(float4x4 const& mat)
@@ -340,6 +393,7 @@ namespace KlayGE
 		inv_xform_to_parent_ = MathLib::inverse(mat);
 
 		pos_aabb_dirty_ = true;
+		xform_dirty_ = true;
 	}
 
 	float4x4 const& SceneNode::TransformToParent() const
@@ -407,20 +461,60 @@ namespace KlayGE
 		return *pos_aabb_ws_;
 	}
 
-	void SceneNode::UpdateTransforms()
+	bool SceneNode::HasPosBound() const noexcept
 	{
-		prev_xform_to_world_ = xform_to_world_;
-		if (parent_)
+		return pos_aabb_ws_ != nullptr;
+	}
+
+	bool SceneNode::DynamicContent() const
+	{
+		if (!sub_thread_update_event_.Empty() || !main_thread_update_event_.Empty())
 		{
-			xform_to_world_ = xform_to_parent_ * parent_->TransformToWorld();
+			return true;
 		}
-		else
+
+		for (auto const& component : components_)
 		{
-			xform_to_world_ = xform_to_parent_;
+			if (!component->OnSubThreadUpdate().Empty() || !component->OnMainThreadUpdate().Empty())
+			{
+				return true;
+			}
+
+			auto const* renderable_comp = boost::typeindex::runtime_cast<RenderableComponent*>(component.get());
+			if ((renderable_comp != nullptr) && renderable_comp->BoundRenderable().DynamicContent())
+			{
+				return true;
+			}
 		}
-		inv_xform_to_world_ = MathLib::inverse(xform_to_world_);
+		return false;
+	}
 
-		pos_aabb_dirty_ = true;
+	void SceneNode::UpdateTransforms()
+	{
+		local_xform_changed_ = xform_dirty_;
+		world_xform_changed_ = xform_dirty_ || ((parent_ != nullptr) && parent_->world_xform_changed_);
+		xform_dirty_ = false;
+
+		if (world_xform_changed_)
+		{
+			prev_xform_to_world_ = xform_to_world_;
+
+			SIMDMatrixF4 world(xform_to_parent_.data());
+			if (parent_)
+			{
+				world = SIMDMathLib::Multiply(world, SIMDMatrixF4(parent_->xform_to_world_.data()));
+			}
+			StoreMatrix(xform_to_world_, world);
+			StoreMatrix(inv_xform_to_world_, SIMDMathLib::Inverse(world));
+
+			prev_xform_dirty_ = true;
+		}
+		else if (prev_xform_dirty_)
+		{
+			// Stopped moving, the previous transform catches up once
+			prev_xform_to_world_ = xform_to_world_;
+			prev_xform_dirty_ = false;
+		}
 	}
 
 	bool SceneNode::Updated() const
@@ -666,9 +760,32 @@ namespace KlayGE
 			child->UpdatePosBoundSubtree();
 		}
 
-		if (pos_aabb_dirty_)
+		this->UpdatePosBound();
+	}
+
+	void SceneNode::UpdatePosBound()
+	{
+		bool children_changed = false;
+		for (auto const & child : children_)
+		{
+			children_changed |= child->pos_aabb_os_changed_ || child->local_xform_changed_ || child->xform_dirty_;
+		}
+
+		// Renderables like particles and text set their bounds every frame, without telling the node
+		bool content_changed = pos_aabb_dirty_;
+		for (auto const& component : components_)
+		{
+			auto* renderable_comp = boost::typeindex::runtime_cast<RenderableComponent*>(component.get());
+			if (renderable_comp != nullptr)
+			{
+				content_changed |= renderable_comp->PosBoundChanged();
+			}
+		}
+
+		pos_aabb_os_changed_ = content_changed || children_changed;
+		if (pos_aabb_os_)
 		{
-			if (pos_aabb_os_)
+			if (pos_aabb_os_changed_)
 			{
 				pos_aabb_os_->Min() = float3(+1e10f, +1e10f, +1e10f);
 				pos_aabb_os_->Max() = float3(-1e10f, -1e10f, -1e10f);
@@ -694,12 +811,15 @@ namespace KlayGE
 						}
 					}
 				}
+			}
 
+			if (pos_aabb_os_changed_ || world_xform_changed_)
+			{
 				*pos_aabb_ws_ = MathLib::transform_aabb(*pos_aabb_os_, xform_to_world_);
 			}
-
-			pos_aabb_dirty_ = false;
 		}
+
+		pos_aabb_dirty_ = false;
 	}
 
 	void SceneNode::EmitSceneChanged()
@@ -720,4 +840,96 @@ namespace KlayGE
 			}
 		}
 	}
+
+	void SceneNode::EmitSubTreeChanged(SceneNode& sub_tree, bool added)
+	{
+		auto& context = Context::Instance();
+		if (context.SceneManagerValid())
+		{
+			auto* node = this;
+			while (node->Parent() != nullptr)
+			{
+				node = node->Parent();
+			}
+
+			auto& scene_mgr = context.SceneManagerInstance();
+			if (node == &scene_mgr.SceneRootNode())
+			{
+				sub_tree.Traverse([&scene_mgr, added](SceneNode& sub_tree_node) {
+					if (added)
+					{
+						scene_mgr.OnNodeAdded(sub_tree_node);
+					}
+					else
+					{
+						scene_mgr.OnNodeRemoved(sub_tree_node);
+					}
+					return true;
+				});
+			}
+		}
+	}
+
+	SceneHierarchy::SceneHierarchy(SceneNode& root)
+		: root_(root)
+	{
+		this->Rebuild();
+	}
+
+	void SceneHierarchy::Update()
+	{
+		if (topology_version_ != root_.TopologyVersion())
+		{
+			this->Rebuild();
+		}
+
+		uint32_t const GRAIN_SIZE = 1024;
+
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
+		uint32_t const num_levels = this->NumLevels();
+		for (uint32_t l = 0; l < num_levels; ++ l)
+		{
+			thread_pool.ParallelFor(level_offsets_[l], level_offsets_[l + 1], GRAIN_SIZE, [this](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; ++ i)
+					{
+						nodes_[i]->UpdateTransforms();
+					}
+				});
+		}
+		for (uint32_t l = num_levels; l > 0; -- l)
+		{
+			thread_pool.ParallelFor(level_offsets_[l - 1], level_offsets_[l], GRAIN_SIZE, [this](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; ++ i)
+					{
+						nodes_[i]->UpdatePosBound();
+					}
+				});
+		}
+	}
+
+	void SceneHierarchy::Rebuild()
+	{
+		topology_version_ = root_.TopologyVersion();
+
+		nodes_.assign(1, &root_);
+		parent_indices_.assign(1, static_cast<uint32_t>(-1));
+		level_offsets_.assign(1, 0);
+		uint32_t level_begin = 0;
+		while (level_begin < nodes_.size())
+		{
+			uint32_t const level_end = static_cast<uint32_t>(nodes_.size());
+			level_offsets_.push_back(level_end);
+			for (uint32_t i = level_begin; i < level_end; ++ i)
+			{
+				for (auto const & child : nodes_[i]->Children())
+				{
+					nodes_.push_back(child.get());
+					parent_indices_.push_back(i);
+				}
+			}
+			level_begin = level_end;
+		}
+	}
 }
@@ -24,6 +24,7 @@
 #include <KlayGE/RenderEffect.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/FrameBuffer.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
 #include <KlayGE/InputFactory.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
@@ -31,11 +32,11 @@
 #include <KlayGE/SceneNode.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/Font.hpp>
-#include <KlayGE/TransientBuffer.hpp>
 #include <KFL/Hash.hpp>
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Window.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iterator>
@@ -74,6 +75,8 @@ namespace KlayGE
 	std::unique_ptr<UIManager> UIManager::ui_mgr_instance_;
 
 
+	// Quads of one texture, drawn in one call. The vertex stream is retained on GPU, every frame only the dialogs
+	//  whose quads changed are uploaded again.
 	class UIRectRenderable : public Renderable
 	{
 	public:
@@ -83,26 +86,8 @@ namespace KlayGE
 		{
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 
-			restart_ = rf.RenderEngineInstance().DeviceCaps().primitive_restart_support;
-
 			rls_[0] = rf.MakeRenderLayout();
-			if (restart_)
-			{
-				rls_[0]->TopologyType(RenderLayout::TT_TriangleStrip);
-			}
-			else
-			{
-				rls_[0]->TopologyType(RenderLayout::TT_TriangleList);
-			}
-
-			uint32_t const INDEX_PER_QUAD = restart_ ? 5 : 6;
-			uint32_t const INIT_NUM_QUAD = 1024;
-			tb_vb_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_QUAD * 4 * sizeof(UIManager::VertexFormat)), TransientBuffer::BF_Vertex);
-			tb_ib_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_QUAD * INDEX_PER_QUAD * sizeof(uint16_t)), TransientBuffer::BF_Index);
-
-			rls_[0]->BindVertexStream(tb_vb_->GetBuffer(), MakeSpan({VertexElement(VEU_Position, 0, EF_BGR32F),
-				VertexElement(VEU_Diffuse, 0, EF_ABGR32F), VertexElement(VEU_TextureCoord, 0, EF_GR32F)}));
-			rls_[0]->BindIndexStream(tb_ib_->GetBuffer(), EF_R16UI);
+			rls_[0]->TopologyType(RenderLayout::TT_TriangleList);
 
 			effect_ = effect;
 			if (texture)
@@ -121,117 +106,166 @@ namespace KlayGE
 
 		bool Empty() const
 		{
-			return tb_ib_sub_allocs_.empty();
+			return vertices_.empty();
 		}
 
-		void OnRenderBegin()
+		uint32_t NumQuads() const
 		{
-			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			return static_cast<uint32_t>(vertices_.size() / 4);
+		}
 
+		void BeginFrame()
+		{
+			vertices_.clear();
+			segment_ends_.clear();
+		}
+
+		// Closes the quads of one dialog, they are compared with last upload as a whole
+		void EndSegment()
+		{
+			uint32_t const end = static_cast<uint32_t>(vertices_.size());
+			if (segment_ends_.empty() ? (end > 0) : (segment_ends_.back() != end))
+			{
+				segment_ends_.push_back(end);
+			}
+		}
+
+		void AddQuad(UIManager::VertexFormat const * vertices)
+		{
+			vertices_.insert(vertices_.end(), vertices, vertices + 4);
+		}
+
+		void OnRenderBegin()
+		{
 			*ui_tex_ep_ = texture_;
 
-			RenderEngine& re = rf.RenderEngineInstance();
+			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 			float const half_width = re.CurFrameBuffer()->Width() / 2.0f;
 			float const half_height = re.CurFrameBuffer()->Height() / 2.0f;
 
 			*half_width_height_ep_ = float2(half_width, half_height);
 			*dpi_scale_ep_ = Context::Instance().AppInstance().MainWnd()->DPIScale();
 
-			tb_vb_->EnsureDataReady();
-			tb_ib_->EnsureDataReady();
-
-			rls_[0]->SetVertexStream(0, tb_vb_->GetBuffer());
-			rls_[0]->BindIndexStream(tb_ib_->GetBuffer(), EF_R16UI);
-		}
-		
-		void OnRenderEnd()
-		{
-			tb_vb_->OnPresent();
-			tb_ib_->OnPresent();
-
-			tb_vb_sub_allocs_.clear();
-			tb_ib_sub_allocs_.clear();
+			this->UploadVertices();
 		}
 
 		void Render()
 		{
+			if (vertices_.empty())
+			{
+				return;
+			}
+
 			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
 			this->OnRenderBegin();
 
-			BOOST_ASSERT(tb_vb_sub_allocs_.size() == tb_ib_sub_allocs_.size());
+			rls_[0]->NumVertices(static_cast<uint32_t>(vertices_.size()));
+			rls_[0]->StartIndexLocation(0);
+			rls_[0]->NumIndices(this->NumQuads() * 6);
+			re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rls_[0]);
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
+			this->OnRenderEnd();
+		}
+
+	private:
+		template <typename T>
+		GraphicsBufferPtr MakeQuadIndexBuffer(uint32_t num_quads)
+		{
+			std::vector<T> indices(num_quads * 6);
+			for (uint32_t i = 0; i < num_quads; ++ i)
 			{
-				uint32_t vert_length = tb_vb_sub_allocs_[i].length_;
-				uint32_t const ind_offset = tb_ib_sub_allocs_[i].offset_;
-				uint32_t ind_length = tb_ib_sub_allocs_[i].length_;
+				T const base = static_cast<T>(i * 4);
+				indices[i * 6 + 0] = base + 0;
+				indices[i * 6 + 1] = base + 1;
+				indices[i * 6 + 2] = base + 2;
+				indices[i * 6 + 3] = base + 2;
+				indices[i * 6 + 4] = base + 3;
+				indices[i * 6 + 5] = base + 0;
+			}
 
-				while ((i + 1 < tb_vb_sub_allocs_.size())
-					&& (tb_vb_sub_allocs_[i].offset_ + tb_vb_sub_allocs_[i].length_ == tb_vb_sub_allocs_[i + 1].offset_)
-					&& (tb_ib_sub_allocs_[i].offset_ + tb_ib_sub_allocs_[i].length_ == tb_ib_sub_allocs_[i + 1].offset_))
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			return rf.MakeIndexBuffer(BU_Static, EAH_GPU_Read | EAH_Immutable,
+				static_cast<uint32_t>(indices.size() * sizeof(indices[0])), indices.data());
+		}
+
+		void UploadVertices()
+		{
+			uint32_t const num_vertices = static_cast<uint32_t>(vertices_.size());
+			if (num_vertices > vertex_capacity_)
+			{
+				// Index pattern is the same for all quads, it's only rebuilt when the buffers grow
+				uint32_t const INIT_NUM_QUAD = 1024;
+				vertex_capacity_ = std::max({num_vertices, vertex_capacity_ * 2, INIT_NUM_QUAD * 4});
+
+				RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+				vb_ = rf.MakeVertexBuffer(BU_Static, EAH_GPU_Read, vertex_capacity_ * sizeof(UIManager::VertexFormat), nullptr);
+				rls_[0]->BindVertexStream(vb_, MakeSpan({VertexElement(VEU_Position, 0, EF_BGR32F),
+					VertexElement(VEU_Diffuse, 0, EF_ABGR32F), VertexElement(VEU_TextureCoord, 0, EF_GR32F)}));
+				if (vertex_capacity_ <= 0x10000)
 				{
-					vert_length += tb_vb_sub_allocs_[i + 1].length_;
-					ind_length += tb_ib_sub_allocs_[i + 1].length_;
-					++ i;
+					rls_[0]->BindIndexStream(this->MakeQuadIndexBuffer<uint16_t>(vertex_capacity_ / 4), EF_R16UI);
+				}
+				else
+				{
+					rls_[0]->BindIndexStream(this->MakeQuadIndexBuffer<uint32_t>(vertex_capacity_ / 4), EF_R32UI);
 				}
 
-				rls_[0]->NumVertices(vert_length / sizeof(UIManager::VertexFormat));
-				rls_[0]->StartIndexLocation(ind_offset / sizeof(uint16_t));
-				rls_[0]->NumIndices(ind_length / sizeof(uint16_t));
-
-				re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rls_[0]);
+				uploaded_.clear();
 			}
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				tb_vb_->Dealloc(tb_vb_sub_allocs_[i]);
-				tb_ib_->Dealloc(tb_ib_sub_allocs_[i]);
-			}
+			// Quads not closed by a dialog are one more segment
+			this->EndSegment();
 
-			this->OnRenderEnd();
-		}
+			uint32_t const old_num_vertices = static_cast<uint32_t>(uploaded_.size());
+			uploaded_.resize(num_vertices);
 
-		void AddQuad(std::vector<UIManager::VertexFormat> const & vertices)
-		{
-			tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
-			
-			uint16_t const last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(UIManager::VertexFormat));
-			std::vector<uint16_t> indices;
-			indices.resize(restart_ ? 5 : 6);
-			indices[0] = last_index + 0;
-			indices[1] = last_index + 1;
-			if (restart_)
+			uint32_t dirty_begin = 0;
+			bool dirty = false;
+			uint32_t begin = 0;
+			for (uint32_t const end : segment_ends_)
 			{
-				indices[2] = last_index + 3;
-				indices[3] = last_index + 2;
-				indices[4] = 0xFFFF;
+				bool const changed = (end > old_num_vertices)
+					|| (memcmp(&vertices_[begin], &uploaded_[begin], (end - begin) * sizeof(vertices_[0])) != 0);
+				if (changed && !dirty)
+				{
+					dirty_begin = begin;
+					dirty = true;
+				}
+				else if (!changed && dirty)
+				{
+					this->UpdateRange(dirty_begin, begin);
+					dirty = false;
+				}
+				begin = end;
 			}
-			else
+			if (dirty)
 			{
-				indices[2] = last_index + 2;
-				indices[3] = last_index + 2;
-				indices[4] = last_index + 3;
-				indices[5] = last_index + 0;
+				this->UpdateRange(dirty_begin, begin);
 			}
-			BOOST_ASSERT(last_index + 3 <= 0xFFFF);
+		}
 
-			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+		void UpdateRange(uint32_t begin, uint32_t end)
+		{
+			uint32_t const vert_size = sizeof(vertices_[0]);
+			vb_->UpdateSubresource(begin * vert_size, (end - begin) * vert_size, &vertices_[begin]);
+			std::copy(vertices_.begin() + begin, vertices_.begin() + end, uploaded_.begin() + begin);
 		}
 
 	private:
-		bool restart_;
-
 		RenderEffectParameter* dpi_scale_ep_;
 		RenderEffectParameter* ui_tex_ep_;
 		RenderEffectParameter* half_width_height_ep_;
 
 		TexturePtr texture_;
 
-		std::unique_ptr<TransientBuffer> tb_vb_;
-		std::unique_ptr<TransientBuffer> tb_ib_;
-		std::vector<SubAlloc> tb_vb_sub_allocs_;
-		std::vector<SubAlloc> tb_ib_sub_allocs_;
+		std::vector<UIManager::VertexFormat> vertices_;
+		std::vector<uint32_t> segment_ends_;
+
+		// What the GPU vertex buffer holds
+		GraphicsBufferPtr vb_;
+		uint32_t vertex_capacity_ = 0;
+		std::vector<UIManager::VertexFormat> uploaded_;
 	};
 
 
@@ -884,32 +918,55 @@ namespace KlayGE
 	{
 		for (auto& str : strings_)
 		{
-			str.second.clear();
+			str.num_strings = 0;
+		}
+		for (auto const & rect : rects_)
+		{
+			checked_cast<UIRectRenderable&>(*rect.second.first).BeginFrame();
 		}
 
 		for (auto const & dialog : dialogs_)
 		{
 			dialog->Render();
+
+			for (auto const & rect : rects_)
+			{
+				checked_cast<UIRectRenderable&>(*rect.second.first).EndSegment();
+			}
 		}
 
+		auto& overlay_root = Context::Instance().SceneManagerInstance().OverlayRootNode();
 		for (auto const & rect : rects_)
 		{
-			if (!checked_pointer_cast<UIRectRenderable>(rect.second)->Empty())
+			auto const & node = rect.second.second;
+			if (!checked_cast<UIRectRenderable&>(*rect.second.first).Empty() && (node->Parent() == nullptr))
 			{
-				auto ui_rect_obj = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(rect.second), SceneNode::SOA_Overlay);
-				Context::Instance().SceneManagerInstance().OverlayRootNode().AddChild(ui_rect_obj);
+				overlay_root.AddChild(node);
 			}
 		}
-		for (auto const & str : strings_)
+		for (size_t i = 0; i < strings_.size(); ++ i)
 		{
-			auto const & font = font_cache_[str.first];
-			for (auto const & s : str.second)
+			auto const & font = font_cache_[i];
+			for (size_t j = 0; j < strings_[i].num_strings; ++ j)
 			{
+				auto const & s = strings_[i].strings[j];
 				font.first->RenderText(s.rc, s.depth, 1, 1, s.clr, s.text, font.second, s.align);
 			}
 		}
 	}
 
+	UIRectRenderable& UIManager::RectBatch(TexturePtr const & texture)
+	{
+		auto iter = rects_.find(texture);
+		if (iter == rects_.end())
+		{
+			auto renderable = MakeSharedPtr<UIRectRenderable>(texture, effect_);
+			auto node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(renderable), SceneNode::SOA_Overlay);
+			iter = rects_.emplace(texture, std::make_pair(renderable, node)).first;
+		}
+		return checked_cast<UIRectRenderable&>(*iter->second.first);
+	}
+
 	void UIManager::DrawRect(float3 const & pos, float width, float height, Color const * clrs,
 				IRect const & rcTexture, TexturePtr const & texture)
 	{
@@ -926,19 +983,7 @@ namespace KlayGE
 			texcoord = Rect(0, 0, 0, 0);
 		}
 
-		std::shared_ptr<UIRectRenderable> renderable;
-		if (rects_.find(texture) == rects_.end())
-		{
-			renderable = MakeSharedPtr<UIRectRenderable>(texture, effect_);
-			rects_[texture] = renderable;
-		}
-		else
-		{
-			renderable = checked_pointer_cast<UIRectRenderable>(rects_[texture]);
-		}
-		BOOST_ASSERT(renderable);
-
-		std::vector<VertexFormat> vertices(4);
+		VertexFormat vertices[4];
 		vertices[0] = VertexFormat(pos + float3(0, 0, 0),
 			clrs[0], float2(texcoord.left(), texcoord.top()));
 		vertices[1] = VertexFormat(pos + float3(width, 0, 0),
@@ -948,24 +993,12 @@ namespace KlayGE
 		vertices[3] = VertexFormat(pos + float3(0, height, 0),
 			clrs[3], float2(texcoord.left(), texcoord.bottom()));
 
-		renderable->AddQuad(vertices);
+		this->RectBatch(texture).AddQuad(vertices);
 	}
 
 	void UIManager::DrawQuad(float3 const & offset, VertexFormat const * vertices, TexturePtr const & texture)
 	{
-		std::shared_ptr<UIRectRenderable> renderable;
-		if (rects_.find(texture) == rects_.end())
-		{
-			renderable = MakeSharedPtr<UIRectRenderable>(texture, effect_);
-			rects_[texture] = renderable;
-		}
-		else
-		{
-			renderable = checked_pointer_cast<UIRectRenderable>(rects_[texture]);
-		}
-		BOOST_ASSERT(renderable);
-
-		std::vector<VertexFormat> verts(4);
+		VertexFormat verts[4];
 		verts[0] = VertexFormat(offset + vertices[0].pos,
 			vertices[0].clr, vertices[0].tex);
 		verts[1] = VertexFormat(offset + vertices[1].pos,
@@ -975,13 +1008,23 @@ namespace KlayGE
 		verts[3] = VertexFormat(offset + vertices[3].pos,
 			vertices[3].clr, vertices[3].tex);
 
-		renderable->AddQuad(verts);
+		this->RectBatch(texture).AddQuad(verts);
 	}
 
 	void UIManager::DrawString(std::wstring const & strText, uint32_t font_index,
 		IRect const & rc, float depth, Color const & clr, uint32_t align)
 	{
-		auto& sc = strings_[font_index].emplace_back();
+		if (font_index >= strings_.size())
+		{
+			strings_.resize(font_index + 1);
+		}
+		auto& batch = strings_[font_index];
+		if (batch.num_strings == batch.strings.size())
+		{
+			batch.strings.emplace_back();
+		}
+		auto& sc = batch.strings[batch.num_strings];
+		++ batch.num_strings;
 		sc.rc = rc;
 		sc.depth = depth;
 		sc.clr = clr;
@@ -29,10 +29,30 @@
 #include <KlayGE/SceneManager.hpp>
 #include <KFL/AABBox.hpp>
 
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace KlayGE
 {
+	struct OCTreeStats
+	{
+		uint32_t num_objects = 0;
+		uint32_t num_outside_objects = 0;
+		// Added to the scene, but waiting for their first update to have bounds
+		uint32_t num_pending_objects = 0;
+		uint32_t num_tree_nodes = 0;
+
+		// Counted since the beginning of current frame
+		uint32_t num_inserted = 0;
+		uint32_t num_removed = 0;
+		uint32_t num_moved = 0;
+		uint32_t num_rebuilds = 0;
+	};
+
+	// A loose octree. Every tree node's bound is twice as large as its cell, so an object is stored in the deepest cell that
+	// contains its center and is not smaller than the object. Objects are inserted and removed as the scene manager reports
+	// nodes added and removed, and only the ones the snapshot reports moved are checked for leaving their cells.
 	class OCTree final : public SceneManager
 	{
 	public:
@@ -41,6 +61,11 @@ namespace KlayGE
 		void MaxTreeDepth(uint32_t max_tree_depth);
 		uint32_t MaxTreeDepth() const;
 
+		OCTreeStats const & FrameStats() const
+		{
+			return stats_;
+		}
+
 		void ClipScene() override;
 
 		BoundOverlap AABBVisible(AABBox const & aabb) const override;
@@ -51,14 +76,27 @@ namespace KlayGE
 		void ClearObject() override;
 
 		void OnSceneChanged() override;
+		void OnNodeAdded(SceneNode& node) override;
+		void OnNodeRemoved(SceneNode& node) override;
 
 	private:
 		void DoSuspend() override;
 		void DoResume() override;
 
-		void DivideNode(size_t index, uint32_t curr_depth);
+		void ProcessNodeEvents();
+		void InsertPendingObjects();
+		void RefitMovedObjects();
+		void RefitObject(uint32_t obj_index);
+		void Rebuild();
+
+		void InsertObject(uint32_t obj_index);
+		void RemoveObject(uint32_t obj_index);
+		bool ObjectFits(uint32_t obj_index) const;
+		void DivideNode(size_t index);
+
 		void NodeVisible(size_t index);
 		void MarkNodeObjs(size_t index, bool force);
+		void MarkObj(SceneNode& node, bool moveable, uint32_t num_cameras);
 
 		BoundOverlap BoundVisible(size_t index, AABBox const & aabb) const;
 		BoundOverlap BoundVisible(size_t index, OBBox const & obb) const;
@@ -73,17 +111,60 @@ namespace KlayGE
 		struct octree_node_t
 		{
 			AABBox bb;
+			AABBox loose_bb;
+			int parent_index;
 			int first_child_index;
+			uint32_t depth;
 			BoundOverlap visible;
 
-			std::vector<SceneNode*> node_ptrs;
+			uint32_t num_subtree_objs;
+			uint32_t clip_stamp;
+
+			std::vector<uint32_t> obj_indices;
+		};
+
+		static int constexpr OUTSIDE_TREE_NODE_INDEX = -1;
+		static int constexpr PENDING_TREE_NODE_INDEX = -2;
+
+		struct octree_obj_t
+		{
+			SceneNode* node;
+			int tree_node_index;		// Or OUTSIDE_TREE_NODE_INDEX, PENDING_TREE_NODE_INDEX
+			uint32_t slot;				// Index in the tree node's obj_indices, or in outside_objs_, pending_objs_
+			uint32_t moving_slot;		// Index in moving_objs_ for moveable objects
+			bool moveable;
+		};
+
+		struct node_event_t
+		{
+			SceneNode* node;
+			uint32_t attrib;
+			bool added;
 		};
 
 		std::vector<octree_node_t> octree_;
 
+		std::vector<octree_obj_t> objs_;
+		std::vector<uint32_t> free_objs_;
+		std::unordered_map<SceneNode*, uint32_t> obj_map_;
+		std::vector<uint32_t> moving_objs_;
+		std::vector<uint32_t> outside_objs_;
+		std::vector<uint32_t> pending_objs_;
+
+		// Nodes can be added and removed on the update thread. The events are handled in order in ClipScene.
+		std::mutex node_events_mutex_;
+		std::vector<node_event_t> node_events_;
+		std::vector<node_event_t> processing_node_events_;
+
 		uint32_t max_tree_depth_;
 
 		bool rebuild_tree_;
+		bool scene_changed_;
+		uint64_t refit_snapshot_serial_;
+		uint32_t clip_stamp_;
+		uint32_t last_update_frame_;
+
+		OCTreeStats stats_;
 
 #ifdef KLAYGE_DRAW_NODES
 		RenderablePtr node_renderable_;
@@ -31,6 +31,7 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/AudioDataSource.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 
 #include <KlayGE/OpenAL/OALAudio.hpp>
 
@@ -67,6 +68,8 @@ namespace KlayGE
 
 	void OALMusicBuffer::LoopUpdateBuffer()
 	{
+		PerfProfiler::Instance().ThreadName("Audio streaming");
+
 		std::unique_lock<std::mutex> lock(play_mutex_);
 		while (!played_)
 		{
@@ -80,6 +83,7 @@ namespace KlayGE
 			alGetSourcei(source_, AL_BUFFERS_PROCESSED, &processed);
 			if (processed > 0)
 			{
+				PerfScope perf_scope("OALMusicBuffer::FillBuffers");
 				while (processed > 0)
 				{
 					-- processed;
@@ -35,6 +35,7 @@
 #include <KlayGE/Context.hpp>
 #include <KlayGE/AudioFactory.hpp>
 #include <KlayGE/AudioDataSource.hpp>
+#include <KlayGE/PerfProfiler.hpp>
 
 #include <functional>
 #include <limits>
@@ -131,6 +132,8 @@ namespace KlayGE
 
 	void XAMusicBuffer::LoopUpdateBuffer()
 	{
+		PerfProfiler::Instance().ThreadName("Audio streaming");
+
 		std::unique_lock<std::mutex> lock(play_mutex_);
 		while (!played_)
 		{
@@ -152,7 +155,12 @@ namespace KlayGE
 				::WaitForSingleObjectEx(checked_cast<MusicVoiceContext&>(*voice_call_back_).GetBufferEndEvent(), INFINITE, FALSE);
 			}
 
-			if (this->FillData(buffer_size_))
+			bool finished;
+			{
+				PerfScope perf_scope("XAMusicBuffer::FillData");
+				finished = this->FillData(buffer_size_);
+			}
+			if (finished)
 			{
 				if (loop_)
 				{
@@ -32,14 +32,15 @@
 
 #include <KFL/CXX17/filesystem.hpp>
 #include <KFL/CXX20/span.hpp>
-#include <KFL/CpuInfo.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/TexCompression.hpp>
 #include <KlayGE/TexCompressionBC.hpp>
 #include <KlayGE/TexCompressionETC.hpp>
 #include <KlayGE/Texture.hpp>
 
+#include <algorithm>
 #include <vector>
 
 #include <FreeImage.h>
@@ -51,16 +52,107 @@ namespace
 {
 	using namespace KlayGE;
 
-	void CreateDDM(std::vector<float2>& ddm, std::vector<float3> const & normal_map, float min_z)
+	// Rows go to the thread pool in tiles of about 16K texels, big enough to amortize the scheduling
+	template <typename Func>
+	void ParallelForRows(uint32_t width, uint32_t height, Func const & func)
+	{
+		uint32_t const rows_per_tile = std::max(1U, 16384 / std::max(width, 1U));
+		Context::Instance().ThreadPoolInstance().ParallelFor(0, height, rows_per_tile, func);
+	}
+
+	// Calls func(x, y, clr) on every texel of the first level of tex, and writes clr back. Rows are converted in batches.
+	template <typename Func>
+	void TransformTexels(Texture& tex, Func const & func)
+	{
+		uint32_t const width = tex.Width(0);
+		uint32_t const height = tex.Height(0);
+		ElementFormat const format = tex.Format();
+
+		Texture::Mapper mapper(tex, 0, 0, TMA_Read_Write, 0, 0, width, height);
+		uint8_t* ptr = mapper.Pointer<uint8_t>();
+		uint32_t const row_pitch = mapper.RowPitch();
+
+		ParallelForRows(width, height, [ptr, row_pitch, width, format, &func](uint32_t y_begin, uint32_t y_end)
+			{
+				std::vector<Color> line_32f(width);
+				for (uint32_t y = y_begin; y < y_end; ++ y)
+				{
+					uint8_t* row = ptr + y * row_pitch;
+					ConvertToABGR32F(format, row, width, line_32f.data());
+					for (uint32_t x = 0; x < width; ++ x)
+					{
+						func(x, y, line_32f[x]);
+					}
+					ConvertFromABGR32F(format, line_32f.data(), width, row);
+				}
+			});
+	}
+
+	// Calls func(x, y, clr) on every texel of the first level of tex, read only
+	template <typename Func>
+	void ReadTexels(Texture& tex, Func const & func)
+	{
+		uint32_t const width = tex.Width(0);
+		uint32_t const height = tex.Height(0);
+		ElementFormat const format = tex.Format();
+
+		Texture::Mapper mapper(tex, 0, 0, TMA_Read_Only, 0, 0, width, height);
+		uint8_t const * ptr = mapper.Pointer<uint8_t>();
+		uint32_t const row_pitch = mapper.RowPitch();
+
+		ParallelForRows(width, height, [ptr, row_pitch, width, format, &func](uint32_t y_begin, uint32_t y_end)
+			{
+				std::vector<Color> line_32f(width);
+				for (uint32_t y = y_begin; y < y_end; ++ y)
+				{
+					ConvertToABGR32F(format, ptr + y * row_pitch, width, line_32f.data());
+					for (uint32_t x = 0; x < width; ++ x)
+					{
+						func(x, y, line_32f[x]);
+					}
+				}
+			});
+	}
+
+	// Fills every texel of the first level of tex with func(x, y), rows are converted in batches
+	template <typename Func>
+	void WriteTexels(Texture& tex, Func const & func)
+	{
+		uint32_t const width = tex.Width(0);
+		uint32_t const height = tex.Height(0);
+		ElementFormat const format = tex.Format();
+
+		Texture::Mapper mapper(tex, 0, 0, TMA_Write_Only, 0, 0, width, height);
+		uint8_t* ptr = mapper.Pointer<uint8_t>();
+		uint32_t const row_pitch = mapper.RowPitch();
+
+		ParallelForRows(width, height, [ptr, row_pitch, width, format, &func](uint32_t y_begin, uint32_t y_end)
+			{
+				std::vector<Color> line_32f(width);
+				for (uint32_t y = y_begin; y < y_end; ++ y)
+				{
+					for (uint32_t x = 0; x < width; ++ x)
+					{
+						line_32f[x] = func(x, y);
+					}
+					ConvertFromABGR32F(format, line_32f.data(), width, ptr + y * row_pitch);
+				}
+			});
+	}
+
+	void CreateDDM(std::vector<float2>& ddm, std::vector<float3> const & normal_map, uint32_t width, uint32_t height, float min_z)
 	{
 		ddm.resize(normal_map.size());
-		for (size_t i = 0; i < normal_map.size(); ++ i)
-		{
-			float3 n = normal_map[i];
-			n.z() = std::max(n.z(), min_z);
-			ddm[i].x() = n.x() / n.z();
-			ddm[i].y() = n.y() / n.z();
-		}
+		ParallelForRows(width, height, [&ddm, &normal_map, width, min_z](uint32_t y_begin, uint32_t y_end)
+			{
+				for (size_t i = y_begin * width; i < y_end * width; ++ i)
+				{
+					float3 n = normal_map[i];
+					n.z() = std::max(n.z(), min_z);
+					ddm[i].x() = n.x() / n.z();
+					ddm[i].y() = n.y() / n.z();
+				}
+			});
 	}
 
 	void AccumulateDDM(std::vector<float>& height_map, std::vector<float2> const & ddm, uint32_t width, uint32_t height,
@@ -79,38 +171,45 @@ namespace
 		int active = 0;
 		for (int i = 1; i < rings; ++ i)
 		{
-			for (size_t j = 0; j < ddm.size(); ++ j)
-			{
-				int y = static_cast<int>(j / width);
-				int x = static_cast<int>(j - y * width);
-
-				for (int k = 0; k < directions; ++ k)
+			// Every ring only reads the previous one, so rows are independent
+			std::vector<float2> const & src_hm = tmp_hm[active];
+			std::vector<float2>& dst_hm = tmp_hm[!active];
+			ParallelForRows(width, height, [&src_hm, &dst_hm, &ddm, &dxdy, width, height, directions, i](uint32_t y_begin, uint32_t y_end)
 				{
-					float2 delta = dxdy[k] * static_cast<float>(i);
-					float sample_x = x + delta.x();
-					float sample_y = y + delta.y();
-					int sample_x0 = static_cast<int>(floor(sample_x));
-					int sample_y0 = static_cast<int>(floor(sample_y));
-					int sample_x1 = sample_x0 + 1;
-					int sample_y1 = sample_y0 + 1;
-					float weight_x = sample_x - sample_x0;
-					float weight_y = sample_y - sample_y0;
-
-					sample_x0 %= width;
-					sample_y0 %= height;
-					sample_x1 %= width;
-					sample_y1 %= height;
-
-					float2 hl0 = MathLib::lerp(tmp_hm[active][sample_y0 * width + sample_x0], tmp_hm[active][sample_y0 * width + sample_x1], weight_x);
-					float2 hl1 = MathLib::lerp(tmp_hm[active][sample_y1 * width + sample_x0], tmp_hm[active][sample_y1 * width + sample_x1], weight_x);
-					float2 h = MathLib::lerp(hl0, hl1, weight_y);
-					float2 ddl0 = MathLib::lerp(ddm[sample_y0 * width + sample_x0], ddm[sample_y0 * width + sample_x1], weight_x);
-					float2 ddl1 = MathLib::lerp(ddm[sample_y1 * width + sample_x0], ddm[sample_y1 * width + sample_x1], weight_x);
-					float2 dd = MathLib::lerp(ddl0, ddl1, weight_y);
-
-					tmp_hm[!active][j] += h + dd * delta;
-				}
-			}
+					for (uint32_t y = y_begin; y < y_end; ++ y)
+					{
+						for (uint32_t x = 0; x < width; ++ x)
+						{
+							size_t const j = y * width + x;
+							for (int k = 0; k < directions; ++ k)
+							{
+								float2 delta = dxdy[k] * static_cast<float>(i);
+								float sample_x = x + delta.x();
+								float sample_y = y + delta.y();
+								int sample_x0 = static_cast<int>(floor(sample_x));
+								int sample_y0 = static_cast<int>(floor(sample_y));
+								int sample_x1 = sample_x0 + 1;
+								int sample_y1 = sample_y0 + 1;
+								float weight_x = sample_x - sample_x0;
+								float weight_y = sample_y - sample_y0;
+
+								sample_x0 %= width;
+								sample_y0 %= height;
+								sample_x1 %= width;
+								sample_y1 %= height;
+
+								float2 hl0 = MathLib::lerp(src_hm[sample_y0 * width + sample_x0], src_hm[sample_y0 * width + sample_x1], weight_x);
+								float2 hl1 = MathLib::lerp(src_hm[sample_y1 * width + sample_x0], src_hm[sample_y1 * width + sample_x1], weight_x);
+								float2 h = MathLib::lerp(hl0, hl1, weight_y);
+								float2 ddl0 = MathLib::lerp(ddm[sample_y0 * width + sample_x0], ddm[sample_y0 * width + sample_x1], weight_x);
+								float2 ddl1 = MathLib::lerp(ddm[sample_y1 * width + sample_x0], ddm[sample_y1 * width + sample_x1], weight_x);
+								float2 dd = MathLib::lerp(ddl0, ddl1, weight_y);
+
+								dst_hm[j] += h + dd * delta;
+							}
+						}
+					}
+				});
 
 			active = !active;
 		}
@@ -428,41 +527,28 @@ namespace KlayGE
 		{
 			compressed_tex_.reset();
 
-			uint32_t const width = uncompressed_tex_->Width(0);
-			uint32_t const height = uncompressed_tex_->Height(0);
-			ElementFormat const format = uncompressed_tex_->Format();
-
-			Texture::Mapper mapper(*uncompressed_tex_, 0, 0, TMA_Read_Write, 0, 0,
-				uncompressed_tex_->Width(0), uncompressed_tex_->Height(0));
-			uint8_t* ptr = mapper.Pointer<uint8_t>();
-			std::vector<Color> line_32f(width);
-			for (uint32_t y = 0; y < height; ++ y)
-			{
-				ConvertToABGR32F(format, ptr, width, line_32f.data());
-
-				Color original_clr;
-				Color swizzled_clr(0, 0, 0, 0);
-				for (uint32_t x = 0; x < width; ++ x)
+			TransformTexels(*uncompressed_tex_, [num_channels, &channel_mapping](uint32_t x, uint32_t y, Color& clr)
 				{
-					original_clr = line_32f[x];
+					KFL_UNUSED(x);
+					KFL_UNUSED(y);
+
+					Color const original_clr = clr;
 					for (uint32_t ch = 0; ch < num_channels; ++ ch)
 					{
 						if (channel_mapping[ch] >= 0)
 						{
-							swizzled_clr[ch] = original_clr[channel_mapping[ch]];
+							clr[ch] = original_clr[channel_mapping[ch]];
 						}
 						else
 						{
-							swizzled_clr[ch] = 0;
+							clr[ch] = 0;
 						}
 					}
-					line_32f[x] = swizzled_clr;
-				}
-
-				ConvertFromABGR32F(format, line_32f.data(), width, ptr);
-
-				ptr += mapper.RowPitch();
-			}
+					for (uint32_t ch = num_channels; ch < 4; ++ ch)
+					{
+						clr[ch] = 0;
+					}
+				});
 		}
 
 		auto const preferred_fmt = metadata.PreferedFormat();
@@ -490,21 +576,10 @@ namespace KlayGE
 	{
 		compressed_tex_.reset();
 
-		uint32_t const width = uncompressed_tex_->Width(0);
-		uint32_t const height = uncompressed_tex_->Height(0);
-		ElementFormat const format = uncompressed_tex_->Format();
-		uint32_t const elem_size = NumFormatBytes(format);
-
-		Texture::Mapper mapper(*uncompressed_tex_, 0, 0, TMA_Read_Write, 0, 0,
-			uncompressed_tex_->Width(0), uncompressed_tex_->Height(0));
-		uint8_t* ptr = mapper.Pointer<uint8_t>();
-
-		for (uint32_t y = 0; y < height; ++ y)
-		{
-			for (uint32_t x = 0; x < width; ++ x)
+		TransformTexels(*uncompressed_tex_, [normal_compression_format](uint32_t x, uint32_t y, Color& color_32f)
 			{
-				Color color_32f;
-				ConvertToABGR32F(format, ptr + x * elem_size, 1, &color_32f);
+				KFL_UNUSED(x);
+				KFL_UNUSED(y);
 
 				switch (normal_compression_format)
 				{
@@ -523,71 +598,35 @@ namespace KlayGE
 				default:
 					KFL_UNREACHABLE("Invalid normal compression format.");
 				}
-
-				ConvertFromABGR32F(format, &color_32f, 1, ptr + x * elem_size);
-			}
-
-			ptr += mapper.RowPitch();
-		}
+			});
 	}
 
 	void ImagePlane::RgbToLum()
 	{
 		compressed_tex_.reset();
 
-		uint32_t const width = uncompressed_tex_->Width(0);
-		uint32_t const height = uncompressed_tex_->Height(0);
-		ElementFormat const format = uncompressed_tex_->Format();
-		uint32_t const elem_size = NumFormatBytes(format);
-
-		Texture::Mapper mapper(*uncompressed_tex_, 0, 0, TMA_Read_Write, 0, 0,
-			uncompressed_tex_->Width(0), uncompressed_tex_->Height(0));
-		uint8_t* ptr = mapper.Pointer<uint8_t>();
-
-		for (uint32_t y = 0; y < height; ++y)
-		{
-			for (uint32_t x = 0; x < width; ++x)
+		TransformTexels(*uncompressed_tex_, [this](uint32_t x, uint32_t y, Color& color_32f)
 			{
-				Color color_32f;
-				ConvertToABGR32F(format, ptr + x * elem_size, 1, &color_32f);
+				KFL_UNUSED(x);
+				KFL_UNUSED(y);
 
 				float const lum = this->RgbToLum(color_32f);
-
-				Color const color_f32(lum, lum, lum, 1);
-				ConvertFromABGR32F(format, &color_f32, 1, ptr + x * elem_size);
-			}
-
-			ptr += mapper.RowPitch();
-		}
+				color_32f = Color(lum, lum, lum, 1);
+			});
 	}
 
 	void ImagePlane::AlphaToLum()
 	{
 		compressed_tex_.reset();
 
-		uint32_t const width = uncompressed_tex_->Width(0);
-		uint32_t const height = uncompressed_tex_->Height(0);
-		ElementFormat const format = uncompressed_tex_->Format();
-		uint32_t const elem_size = NumFormatBytes(format);
-
-		Texture::Mapper mapper(*uncompressed_tex_, 0, 0, TMA_Read_Write, 0, 0, uncompressed_tex_->Width(0), uncompressed_tex_->Height(0));
-		uint8_t* ptr = mapper.Pointer<uint8_t>();
-
-		for (uint32_t y = 0; y < height; ++y)
-		{
-			for (uint32_t x = 0; x < width; ++x)
+		TransformTexels(*uncompressed_tex_, [](uint32_t x, uint32_t y, Color& color_32f)
 			{
-				Color color_32f;
-				ConvertToABGR32F(format, ptr + x * elem_size, 1, &color_32f);
+				KFL_UNUSED(x);
+				KFL_UNUSED(y);
 
 				float const lum = color_32f.a();
-
-				Color const color_f32(lum, lum, lum, 1);
-				ConvertFromABGR32F(format, &color_f32, 1, ptr + x * elem_size);
-			}
-
-			ptr += mapper.RowPitch();
-		}
+				color_32f = Color(lum, lum, lum, 1);
+			});
 	}
 
 	void ImagePlane::BumpToNormal(float scale, float amplitude)
@@ -596,22 +635,11 @@ namespace KlayGE
 
 		uint32_t const width = uncompressed_tex_->Width(0);
 		uint32_t const height = uncompressed_tex_->Height(0);
-		ElementFormat const format = uncompressed_tex_->Format();
-		uint32_t const elem_size = NumFormatBytes(format);
-		uint32_t const num_comp = NumComponents(format);
-
-		Texture::Mapper mapper(*uncompressed_tex_, 0, 0, TMA_Read_Write, 0, 0,
-			uncompressed_tex_->Width(0), uncompressed_tex_->Height(0));
-		uint8_t* ptr = mapper.Pointer<uint8_t>();
+		uint32_t const num_comp = NumComponents(uncompressed_tex_->Format());
 
 		std::vector<float> height_map(width * height);
-		for (uint32_t y = 0; y < height; ++ y)
-		{
-			for (uint32_t x = 0; x < width; ++ x)
+		ReadTexels(*uncompressed_tex_, [this, &height_map, width, num_comp](uint32_t x, uint32_t y, Color const & color_32f)
 			{
-				Color color_32f;
-				ConvertToABGR32F(format, ptr + x * elem_size, 1, &color_32f);
-
 				float h;
 				if (num_comp == 1)
 				{
@@ -622,15 +650,9 @@ namespace KlayGE
 					h = this->RgbToLum(color_32f);
 				}
 				height_map[y * width + x] = h;
-			}
-
-			ptr += mapper.RowPitch();
-		}
+			});
 
-		ptr = mapper.Pointer<uint8_t>();
-		for (uint32_t y = 0; y < height; ++ y)
-		{
-			for (uint32_t x = 0; x < width; ++ x)
+		WriteTexels(*uncompressed_tex_, [&height_map, width, height, scale, amplitude](uint32_t x, uint32_t y)
 			{
 				uint32_t const x0 = x;
 				uint32_t const x1 = (x0 + 1) % width;
@@ -673,12 +695,8 @@ namespace KlayGE
 					}
 				}
 
-				Color const color_f32(normal.x(), normal.y(), normal.z(), occlusion);
-				ConvertFromABGR32F(format, &color_f32, 1, ptr + x * elem_size);
-			}
-
-			ptr += mapper.RowPitch();
-		}
+				return Color(normal.x(), normal.y(), normal.z(), occlusion);
+			});
 	}
 
 	void ImagePlane::NormalToHeight(float min_z)
@@ -689,20 +707,10 @@ namespace KlayGE
 		uint32_t const width = uncompressed_tex_->Width(0);
 		uint32_t const height = uncompressed_tex_->Height(0);
 		ElementFormat const format = uncompressed_tex_->Format();
-		uint32_t const elem_size = NumFormatBytes(format);
-
-		Texture::Mapper mapper(*uncompressed_tex_, 0, 0, TMA_Read_Write, 0, 0,
-			uncompressed_tex_->Width(0), uncompressed_tex_->Height(0));
-		uint8_t* ptr = mapper.Pointer<uint8_t>();
 
 		std::vector<float3> normal_map(width * height);
-		for (uint32_t y = 0; y < height; ++ y)
-		{
-			for (uint32_t x = 0; x < width; ++ x)
+		ReadTexels(*uncompressed_tex_, [&normal_map, width, com_format, format](uint32_t x, uint32_t y, Color const & color_32f)
 			{
-				Color color_32f;
-				ConvertToABGR32F(format, ptr + x * elem_size, 1, &color_32f);
-
 				float3 normal;
 				if ((com_format == EF_BC5) || (com_format == EF_BC3) || (format == EF_GR8))
 				{
@@ -723,13 +731,10 @@ namespace KlayGE
 				}
 
 				normal_map[y * width + x] = normal;
-			}
-
-			ptr += mapper.RowPitch();
-		}
+			});
 
 		std::vector<float2> ddm;
-		CreateDDM(ddm, normal_map, min_z);
+		CreateDDM(ddm, normal_map, width, height, min_z);
 
 		std::vector<float> height_map(width * height);
 		AccumulateDDM(height_map, ddm, width, height, 4, 9);
@@ -749,19 +754,11 @@ namespace KlayGE
 			}
 		}
 
-		ptr = mapper.Pointer<uint8_t>();
-		for (uint32_t y = 0; y < height; ++ y)
-		{
-			for (uint32_t x = 0; x < width; ++ x)
+		WriteTexels(*uncompressed_tex_, [&height_map, width](uint32_t x, uint32_t y)
 			{
 				float const h = height_map[y * width + x] * 0.5f + 0.5f;
-
-				Color const color_f32(h, h, h, 1);
-				ConvertFromABGR32F(format, &color_f32, 1, ptr + x * elem_size);
-			}
-
-			ptr += mapper.RowPitch();
-		}
+				return Color(h, h, h, 1);
+			});
 	}
 
 	void ImagePlane::FormatConversion(ElementFormat format)
@@ -778,24 +775,21 @@ namespace KlayGE
 
 		std::vector<uint8_t> new_tex_data(slice_pitch);
 
-		CpuInfo cpu;
-		uint32_t const num_threads = cpu.NumHWThreads();
-		ThreadPool tp(1, num_threads);
-		std::vector<std::future<void>> joiners(num_threads);
-
-		uint32_t const tex_region_height = ((tex_height + num_threads - 1) / num_threads + block_height - 1) & ~(block_height - 1);
-		std::vector<TexturePtr> new_tex_regions(num_threads);
-		for (uint32_t i = 0; i < num_threads; ++ i)
-		{
-			joiners[i] = tp.QueueThread(
-				[block_height, tex_width, tex_height, tex_region_height, i, format, row_pitch,
-					&new_tex_data, &new_tex_regions, this]
+		// Regions of whole block rows are converted on the shared thread pool, instead of spawning threads for every plane
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
+		uint32_t const num_regions = thread_pool.Scheduler().NumWorkers();
+		uint32_t const tex_region_height = ((tex_height + num_regions - 1) / num_regions + block_height - 1) & ~(block_height - 1);
+		thread_pool.ParallelFor(0, num_regions, 1,
+			[block_height, tex_width, tex_height, tex_region_height, format, row_pitch, &new_tex_data, this](
+				uint32_t region_begin, uint32_t region_end)
+			{
+				for (uint32_t i = region_begin; i < region_end; ++ i)
 				{
 					uint32_t const this_tex_region_height = MathLib::clamp(static_cast<int>(tex_height - i * tex_region_height),
 						0, static_cast<int>(tex_region_height));
 					if (this_tex_region_height > 0)
 					{
-						new_tex_regions[i] = MakeSharedPtr<SoftwareTexture>(Texture::TT_2D, tex_width, this_tex_region_height,
+						auto new_tex_region = MakeSharedPtr<SoftwareTexture>(Texture::TT_2D, tex_width, this_tex_region_height,
 							1, 1, 1, format, true);
 
 						ElementInitData init_data;
@@ -803,13 +797,13 @@ namespace KlayGE
 						init_data.row_pitch = row_pitch;
 						init_data.slice_pitch = (this_tex_region_height + block_height - 1) / block_height * row_pitch;
 
-						new_tex_regions[i]->CreateHWResource(MakeSpan<1>(init_data), nullptr);
+						new_tex_region->CreateHWResource(MakeSpan<1>(init_data), nullptr);
 
-						uncompressed_tex_->CopyToSubTexture2D(*new_tex_regions[i], 0, 0, 0, 0, tex_width, this_tex_region_height,
+						uncompressed_tex_->CopyToSubTexture2D(*new_tex_region, 0, 0, 0, 0, tex_width, this_tex_region_height,
 							0, 0, 0, i * tex_region_height, tex_width, this_tex_region_height, TextureFilter::Point);
 					}
-				});
-		}
+				}
+			});
 
 		TexturePtr new_tex = MakeSharedPtr<SoftwareTexture>(Texture::TT_2D, uncompressed_tex_->Width(0), uncompressed_tex_->Height(0),
 			1, 1, 1, format, false);
@@ -818,11 +812,6 @@ namespace KlayGE
 		init_data.row_pitch = row_pitch;
 		init_data.slice_pitch = slice_pitch;
 
-		for (uint32_t i = 0; i < num_threads; ++ i)
-		{
-			joiners[i].wait();
-		}
-
 		new_tex->CreateHWResource(MakeSpan<1>(init_data), nullptr);
 
 		if (IsCompressedFormat(format))
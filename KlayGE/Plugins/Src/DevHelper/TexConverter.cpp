@@ -30,6 +30,8 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/TexCompression.hpp>
 
@@ -61,6 +63,11 @@ namespace
 		bool Load();
 		TexturePtr StoreToTexture();
 
+		// Runs func(arr) for every array slice concurrently, and records the time under stage_name
+		template <typename Func>
+		void RunStage(char const * stage_name, Func const & func);
+		void ReportStageTimes() const;
+
 	private:
 		TexMetadata metadata_;
 
@@ -70,8 +77,35 @@ namespace
 		uint32_t array_size_;
 		uint32_t num_mipmaps_;
 		ElementFormat format_;
+
+		std::vector<std::pair<char const *, double>> stage_times_;
 	};
 
+	template <typename Func>
+	void TexLoader::RunStage(char const * stage_name, Func const & func)
+	{
+		Timer timer;
+		Context::Instance().ThreadPoolInstance().ParallelFor(0, array_size_, 1, [&func](uint32_t arr_begin, uint32_t arr_end)
+			{
+				for (uint32_t arr = arr_begin; arr < arr_end; ++ arr)
+				{
+					func(arr);
+				}
+			});
+		stage_times_.emplace_back(stage_name, timer.elapsed());
+	}
+
+	void TexLoader::ReportStageTimes() const
+	{
+		auto& log = LogInfo();
+		log << "Converting " << metadata_.PlaneFileName(0, 0) << ':';
+		for (auto const & stage : stage_times_)
+		{
+			log << ' ' << stage.first << ' ' << stage.second * 1000 << " ms,";
+		}
+		log << ' ' << array_size_ << " slices, " << num_mipmaps_ << " mipmaps." << std::endl;
+	}
+
 	TexturePtr TexLoader::Load(TexMetadata const & metadata)
 	{
 		TexturePtr ret;
@@ -87,7 +121,11 @@ namespace
 
 		if (this->Load())
 		{
+			Timer timer;
 			ret = this->StoreToTexture();
+			stage_times_.emplace_back("store", timer.elapsed());
+
+			this->ReportStageTimes();
 		}
 
 		if (!in_path)
@@ -211,15 +249,21 @@ namespace
 	bool TexLoader::Load()
 	{
 		array_size_ = metadata_.ArraySize();
+		stage_times_.clear();
 
 		planes_.resize(array_size_);
-		for (uint32_t arr = 0; arr < array_size_; ++arr)
+		std::vector<char> loaded(array_size_, false);
+		this->RunStage("load", [this, &loaded](uint32_t arr)
+			{
+				std::string_view const plane_file_name = metadata_.PlaneFileName(arr, 0);
+				auto& image = planes_[arr].emplace_back(MakeSharedPtr<ImagePlane>());
+				loaded[arr] = image->Load(plane_file_name, metadata_);
+			});
+		for (uint32_t arr = 0; arr < array_size_; ++ arr)
 		{
-			std::string_view const plane_file_name = metadata_.PlaneFileName(arr, 0);
-			auto& image = planes_[arr].emplace_back(MakeSharedPtr<ImagePlane>());
-			if (!image->Load(plane_file_name, metadata_))
+			if (!loaded[arr])
 			{
-				LogError() << "Could NOT load " << plane_file_name << '.' << std::endl;
+				LogError() << "Could NOT load " << metadata_.PlaneFileName(arr, 0) << '.' << std::endl;
 				return false;
 			}
 		}
@@ -282,94 +326,92 @@ namespace
 		}
 		else
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				planes_[arr].resize(num_mipmaps_);
-
-				for (uint32_t m = 1; m < num_mipmaps_; ++ m)
+			std::vector<char> mips_loaded(array_size_, true);
+			this->RunStage("load mipmaps", [this, &mips_loaded](uint32_t arr)
 				{
-					std::string_view const plane_file_name = metadata_.PlaneFileName(arr, m);
-					planes_[arr][m] = MakeSharedPtr<ImagePlane>();
-					if (plane_file_name.empty())
+					planes_[arr].resize(num_mipmaps_);
+
+					for (uint32_t m = 1; m < num_mipmaps_; ++ m)
 					{
-						if (m == 0)
-						{
-							*planes_[arr][m] = planes_[0][0]->ResizeTo(width_, height_, false);
-						}
-						else
+						std::string_view const plane_file_name = metadata_.PlaneFileName(arr, m);
+						planes_[arr][m] = MakeSharedPtr<ImagePlane>();
+						if (plane_file_name.empty())
 						{
 							*planes_[arr][m] = planes_[arr][0]->ResizeTo(
 								std::max(1U, width_ >> m), std::max(1U, height_ >> m), metadata_.LinearMipmap());
 						}
-					}
-					else
-					{
-						if (!planes_[arr][m]->Load(plane_file_name, metadata_))
+						else
 						{
-							LogError() << "Could NOT load " << plane_file_name << '.' << std::endl;
-							return false;
+							if (!planes_[arr][m]->Load(plane_file_name, metadata_))
+							{
+								LogError() << "Could NOT load " << plane_file_name << '.' << std::endl;
+								mips_loaded[arr] = false;
+								break;
+							}
 						}
 					}
-				}
+				});
+			if (std::find(mips_loaded.begin(), mips_loaded.end(), false) != mips_loaded.end())
+			{
+				return false;
 			}
 		}
 
+		uint32_t const num_source_mipmaps = need_gen_mipmaps ? 1 : num_mipmaps_;
+
 		if (metadata_.RgbToLum())
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t const num = need_gen_mipmaps ? 1 : num_mipmaps_;
-				for (uint32_t m = 0; m < num; ++ m)
+			this->RunStage("rgb to lum", [this, num_source_mipmaps](uint32_t arr)
 				{
-					planes_[arr][m]->RgbToLum();
-				}
-			}
+					for (uint32_t m = 0; m < num_source_mipmaps; ++ m)
+					{
+						planes_[arr][m]->RgbToLum();
+					}
+				});
 		}
 
 		if (((metadata_.Slot() == RenderMaterial::TS_Normal) || (metadata_.Slot() == RenderMaterial::TS_Occlusion)) &&
 			(metadata_.BumpToNormal() || metadata_.BumpToOcclusion()))
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t const num = need_gen_mipmaps ? 1 : num_mipmaps_;
-				for (uint32_t m = 0; m < num; ++ m)
+			this->RunStage("bump", [this, num_source_mipmaps](uint32_t arr)
 				{
-					planes_[arr][m]->BumpToNormal(metadata_.BumpScale(), metadata_.BumpToOcclusion() ? metadata_.OcclusionAmplitude() : 0);
-
-					if (metadata_.Slot() == RenderMaterial::TS_Occlusion)
+					for (uint32_t m = 0; m < num_source_mipmaps; ++ m)
 					{
-						planes_[arr][m]->AlphaToLum();
+						planes_[arr][m]->BumpToNormal(metadata_.BumpScale(), metadata_.BumpToOcclusion() ? metadata_.OcclusionAmplitude() : 0);
+
+						if (metadata_.Slot() == RenderMaterial::TS_Occlusion)
+						{
+							planes_[arr][m]->AlphaToLum();
+						}
 					}
-				}
-			}
+				});
 		}
 
 		if ((metadata_.Slot() == RenderMaterial::TS_Height) && metadata_.NormalToHeight())
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t const num = need_gen_mipmaps ? 1 : num_mipmaps_;
-				for (uint32_t m = 0; m < num; ++ m)
+			this->RunStage("normal to height", [this, num_source_mipmaps](uint32_t arr)
 				{
-					planes_[arr][m]->NormalToHeight(metadata_.HeightMinZ());
-				}
-			}
+					for (uint32_t m = 0; m < num_source_mipmaps; ++ m)
+					{
+						planes_[arr][m]->NormalToHeight(metadata_.HeightMinZ());
+					}
+				});
 		}
 
 		if (need_gen_mipmaps)
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				uint32_t w = width_;
-				uint32_t h = height_;
-				for (uint32_t m = 0; m < num_mipmaps_ - 1; ++ m)
+			this->RunStage("gen mipmaps", [this](uint32_t arr)
 				{
-					w = std::max<uint32_t>(1U, w / 2);
-					h = std::max<uint32_t>(1U, h / 2);
+					uint32_t w = width_;
+					uint32_t h = height_;
+					for (uint32_t m = 0; m < num_mipmaps_ - 1; ++ m)
+					{
+						w = std::max<uint32_t>(1U, w / 2);
+						h = std::max<uint32_t>(1U, h / 2);
 
-					*planes_[arr][m + 1] = planes_[arr][m]->ResizeTo(w, h, metadata_.LinearMipmap());
-				}
-			}
+						*planes_[arr][m + 1] = planes_[arr][m]->ResizeTo(w, h, metadata_.LinearMipmap());
+					}
+				});
 
 			format_ = planes_[0][0]->UncompressedTex()->Format();
 		}
@@ -391,24 +433,24 @@ namespace
 		}
 		if (need_normal_compression)
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				for (uint32_t m = 0; m < num_mipmaps_; ++ m)
+			this->RunStage("normal compression", [this](uint32_t arr)
 				{
-					planes_[arr][m]->PrepareNormalCompression(metadata_.PreferedFormat());
-				}
-			}
+					for (uint32_t m = 0; m < num_mipmaps_; ++ m)
+					{
+						planes_[arr][m]->PrepareNormalCompression(metadata_.PreferedFormat());
+					}
+				});
 		}
 
 		if (format_ != metadata_.PreferedFormat())
 		{
-			for (uint32_t arr = 0; arr < array_size_; ++ arr)
-			{
-				for (uint32_t m = 0; m < num_mipmaps_; ++ m)
+			this->RunStage("format conversion", [this](uint32_t arr)
 				{
-					planes_[arr][m]->FormatConversion(metadata_.PreferedFormat());
-				}
-			}
+					for (uint32_t m = 0; m < num_mipmaps_; ++ m)
+					{
+						planes_[arr][m]->FormatConversion(metadata_.PreferedFormat());
+					}
+				});
 
 			format_ = metadata_.PreferedFormat();
 		}
@@ -69,12 +69,13 @@ namespace
 
 			float4x4 const & view_proj = app.ActiveCamera().ViewProjMatrix();
 
-			*(technique_->Effect().ParameterByName("color")) = float4(1, 1, 1, 1);
+			*(effect_->ParameterByName(EFFECT_HANDLE("color"))) = float4(1, 1, 1, 1);
+			auto& mvp_param = *effect_->ParameterByName(EFFECT_HANDLE("matViewProj"));
 			for (uint32_t i = 0; i < instances_.size(); ++ i)
 			{
-				*(technique_->Effect().ParameterByName("matViewProj")) = instances_[i] * view_proj;
+				mvp_param = instances_[i] * view_proj;
 
-				re.Render(*technique_, *rl_);
+				re.Render(*effect_, *technique_, *rl_);
 			}
 
 			this->OnRenderEnd();
@@ -99,13 +100,15 @@ namespace
 namespace KlayGE
 {
 	OCTree::OCTree()
-		: max_tree_depth_(4), rebuild_tree_(false)
+		: max_tree_depth_(4), rebuild_tree_(false), scene_changed_(false),
+			refit_snapshot_serial_(0), clip_stamp_(0), last_update_frame_(0xFFFFFFFFU)
 	{
 	}
 
 	void OCTree::MaxTreeDepth(uint32_t max_tree_depth)
 	{
 		max_tree_depth_ = std::min<uint32_t>(max_tree_depth, 16UL);
+		rebuild_tree_ = true;
 	}
 
 	uint32_t OCTree::MaxTreeDepth() const
@@ -115,32 +118,35 @@ namespace KlayGE
 
 	void OCTree::ClipScene()
 	{
-		if (rebuild_tree_)
+		uint32_t const frame = Context::Instance().AppInstance().TotalNumFrames();
+		bool const new_frame = (frame != last_update_frame_);
+		if (new_frame)
 		{
-			octree_.resize(1);
-			AABBox bb_root(float3(0, 0, 0), float3(0, 0, 0));
-			octree_[0].first_child_index = -1;
-			octree_[0].visible = BoundOverlap::No;
-			for (auto* sn : all_scene_nodes_)
-			{
-				auto const & node = *sn;
-				uint32_t const attr = node.Attrib();
-				if (node.Updated() && (attr & SceneNode::SOA_Cullable) && !(attr & SceneNode::SOA_Moveable))
-				{
-					bb_root |= node.PosBoundWS();
-					octree_[0].node_ptrs.push_back(sn);
-				}
-			}
-			float3 const & center = bb_root.Center();
-			float3 const & extent = bb_root.HalfSize();
-			float longest_dim = std::max(std::max(extent.x(), extent.y()), extent.z());
-			float3 new_extent(longest_dim, longest_dim, longest_dim);
-			octree_[0].bb = AABBox(center - new_extent, center + new_extent);
+			last_update_frame_ = frame;
 
-			this->DivideNode(0, 1);
+			stats_.num_inserted = 0;
+			stats_.num_removed = 0;
+			stats_.num_moved = 0;
+			stats_.num_rebuilds = 0;
+		}
 
-			rebuild_tree_ = false;
+		this->ProcessNodeEvents();
+		if (scene_changed_)
+		{
+			this->InsertPendingObjects();
 		}
+		this->RefitMovedObjects();
+		if (rebuild_tree_)
+		{
+			this->Rebuild();
+		}
+
+		stats_.num_objects = static_cast<uint32_t>(obj_map_.size() - pending_objs_.size());
+		stats_.num_outside_objects = static_cast<uint32_t>(outside_objs_.size());
+		stats_.num_pending_objects = static_cast<uint32_t>(pending_objs_.size());
+		stats_.num_tree_nodes = static_cast<uint32_t>(octree_.size());
+
+		++ clip_stamp_;
 
 #ifdef KLAYGE_DRAW_NODES
 		if (!node_renderable_)
@@ -232,21 +238,24 @@ namespace KlayGE
 				this->MarkNodeObjs(0, false);
 			}
 
-			for (auto* sn : all_scene_nodes_)
+			// Moving objects in tree nodes out of the frustums are still marked partial visible by SceneManager::Flush
+			for (auto const obj_index : moving_objs_)
 			{
-				auto& node = *sn;
-				uint32_t const attr = node.Attrib();
-				if (node.Visible() && (attr & SceneNode::SOA_Cullable) && (attr & SceneNode::SOA_Moveable))
+				auto const & obj = objs_[obj_index];
+				if ((obj.tree_node_index >= 0) && (octree_[obj.tree_node_index].clip_stamp != clip_stamp_))
 				{
 					for (uint32_t i = 0; i < num_cameras; ++i)
 					{
-						if (node.VisibleMark(i) == BoundOverlap::Partial)
-						{
-							node.VisibleMark(i, camera_frustums_[i]->Intersect(node.PosBoundWS()));
-						}
+						obj.node->VisibleMark(i, BoundOverlap::No);
 					}
 				}
 			}
+
+			for (auto const obj_index : outside_objs_)
+			{
+				auto const & obj = objs_[obj_index];
+				this->MarkObj(*obj.node, obj.moveable, num_cameras);
+			}
 		}
 
 #ifdef KLAYGE_DRAW_NODES
@@ -259,12 +268,35 @@ namespace KlayGE
 		SceneManager::ClearObject();
 
 		octree_.clear();
-		rebuild_tree_ = true;
+		objs_.clear();
+		free_objs_.clear();
+		obj_map_.clear();
+		moving_objs_.clear();
+		outside_objs_.clear();
+		pending_objs_.clear();
+		{
+			std::lock_guard<std::mutex> lock(node_events_mutex_);
+			node_events_.clear();
+		}
+		rebuild_tree_ = false;
+		scene_changed_ = false;
 	}
 
 	void OCTree::OnSceneChanged()
 	{
-		rebuild_tree_ = true;
+		scene_changed_ = true;
+	}
+
+	void OCTree::OnNodeAdded(SceneNode& node)
+	{
+		std::lock_guard<std::mutex> lock(node_events_mutex_);
+		node_events_.push_back({ &node, node.Attrib(), true });
+	}
+
+	void OCTree::OnNodeRemoved(SceneNode& node)
+	{
+		std::lock_guard<std::mutex> lock(node_events_mutex_);
+		node_events_.push_back({ &node, 0, false });
 	}
 
 	void OCTree::DoSuspend()
@@ -277,57 +309,335 @@ namespace KlayGE
 		// TODO
 	}
 
-	void OCTree::DivideNode(size_t index, uint32_t curr_depth)
+	void OCTree::ProcessNodeEvents()
 	{
-		if (octree_[index].node_ptrs.size() > 1)
-		{
-			size_t const this_size = octree_.size();
-			AABBox const parent_bb = octree_[index].bb;
-			float3 const parent_center = parent_bb.Center();
-			octree_[index].first_child_index = static_cast<int>(this_size);
-			octree_[index].visible = BoundOverlap::No;
-
-			octree_.resize(this_size + 8);
-			for (auto* node : octree_[index].node_ptrs)
-			{
-				AABBox const & aabb = node->PosBoundWS();
-				int mark[6];
-				mark[0] = aabb.Min().x() >= parent_center.x() ? 1 : 0;
-				mark[1] = aabb.Min().y() >= parent_center.y() ? 2 : 0;
-				mark[2] = aabb.Min().z() >= parent_center.z() ? 4 : 0;
-				mark[3] = aabb.Max().x() >= parent_center.x() ? 1 : 0;
-				mark[4] = aabb.Max().y() >= parent_center.y() ? 2 : 0;
-				mark[5] = aabb.Max().z() >= parent_center.z() ? 4 : 0;
-				for (int j = 0; j < 8; ++ j)
+		{
+			std::lock_guard<std::mutex> lock(node_events_mutex_);
+			node_events_.swap(processing_node_events_);
+		}
+		if (processing_node_events_.empty())
+		{
+			return;
+		}
+
+		// A removed node could be destroyed already, and another one could be allocated at the same address. Nodes are not
+		//  touched here, and the events are handled in order.
+		for (auto const & event : processing_node_events_)
+		{
+			if (event.added)
+			{
+				if (!(event.attrib & SceneNode::SOA_Cullable) || (obj_map_.find(event.node) != obj_map_.end()))
 				{
-					if (j == ((j & 1) ? mark[3] : mark[0])
-						+ ((j & 2) ? mark[4] : mark[1])
-						+ ((j & 4) ? mark[5] : mark[2]))
-					{
-						octree_[this_size + j].node_ptrs.push_back(node);
-					}
+					continue;
+				}
+
+				uint32_t obj_index;
+				if (free_objs_.empty())
+				{
+					obj_index = static_cast<uint32_t>(objs_.size());
+					objs_.emplace_back();
+				}
+				else
+				{
+					obj_index = free_objs_.back();
+					free_objs_.pop_back();
+				}
+
+				auto& obj = objs_[obj_index];
+				obj.node = event.node;
+				obj.moveable = (event.attrib & SceneNode::SOA_Moveable) != 0;
+				obj.tree_node_index = PENDING_TREE_NODE_INDEX;
+				obj.slot = static_cast<uint32_t>(pending_objs_.size());
+				pending_objs_.push_back(obj_index);
+				if (obj.moveable)
+				{
+					obj.moving_slot = static_cast<uint32_t>(moving_objs_.size());
+					moving_objs_.push_back(obj_index);
+				}
+				obj_map_.emplace(event.node, obj_index);
+			}
+			else
+			{
+				auto iter = obj_map_.find(event.node);
+				if (iter == obj_map_.end())
+				{
+					continue;
+				}
+
+				uint32_t const obj_index = iter->second;
+				auto& obj = objs_[obj_index];
+				if (obj.tree_node_index != PENDING_TREE_NODE_INDEX)
+				{
+					++ stats_.num_removed;
 				}
+				this->RemoveObject(obj_index);
+				if (obj.moveable)
+				{
+					uint32_t const last = moving_objs_.back();
+					moving_objs_[obj.moving_slot] = last;
+					objs_[last].moving_slot = obj.moving_slot;
+					moving_objs_.pop_back();
+				}
+
+				obj.node = nullptr;
+				free_objs_.push_back(obj_index);
+				obj_map_.erase(iter);
 			}
+		}
+		processing_node_events_.clear();
+
+		scene_changed_ = true;
+	}
 
-			for (size_t j = 0; j < 8; ++ j)
+	void OCTree::InsertPendingObjects()
+	{
+		scene_changed_ = false;
+
+		// The ones still waiting will report their first updates through OnSceneChanged
+		for (size_t i = 0; i < pending_objs_.size();)
+		{
+			uint32_t const obj_index = pending_objs_[i];
+			if (objs_[obj_index].node->Updated())
+			{
+				this->RemoveObject(obj_index);
+				this->InsertObject(obj_index);
+				++ stats_.num_inserted;
+			}
+			else
 			{
-				octree_node_t& new_node = octree_[this_size + j];
-				new_node.first_child_index = -1;
-				new_node.bb = AABBox(float3((j & 1) ? parent_center.x() : parent_bb.Min().x(),
-						(j & 2) ? parent_center.y() : parent_bb.Min().y(),
-						(j & 4) ? parent_center.z() : parent_bb.Min().z()),
-					float3((j & 1) ? parent_bb.Max().x() : parent_center.x(),
-						(j & 2) ? parent_bb.Max().y() : parent_center.y(),
-						(j & 4) ? parent_bb.Max().z() : parent_center.z()));
+				++ i;
+			}
+		}
+	}
+
+	void OCTree::RefitMovedObjects()
+	{
+		auto const & snapshot = this->FrontSnapshot();
+		if (snapshot.serial == refit_snapshot_serial_)
+		{
+			return;
+		}
 
-				if (curr_depth < max_tree_depth_)
+		bool const missed_snapshots = (snapshot.serial != refit_snapshot_serial_ + 1);
+		refit_snapshot_serial_ = snapshot.serial;
+
+		if (missed_snapshots)
+		{
+			// Scene updated without rendering in between, what moved in the skipped snapshots is unknown
+			for (uint32_t i = 0; i < objs_.size(); ++ i)
+			{
+				if (objs_[i].node != nullptr)
 				{
-					this->DivideNode(this_size + j, curr_depth + 1);
+					this->RefitObject(i);
 				}
 			}
+		}
+		else
+		{
+			for (auto const node_index : snapshot.moved_node_indices)
+			{
+				auto iter = obj_map_.find(snapshot.nodes[node_index]);
+				if (iter != obj_map_.end())
+				{
+					this->RefitObject(iter->second);
+				}
+			}
+		}
+	}
+
+	void OCTree::RefitObject(uint32_t obj_index)
+	{
+		if ((objs_[obj_index].tree_node_index != PENDING_TREE_NODE_INDEX) && !this->ObjectFits(obj_index))
+		{
+			this->RemoveObject(obj_index);
+			this->InsertObject(obj_index);
+			++ stats_.num_moved;
+		}
+	}
+
+	void OCTree::Rebuild()
+	{
+		rebuild_tree_ = false;
+
+		octree_.clear();
+		outside_objs_.clear();
+
+		bool first = true;
+		AABBox bb_root(float3(0, 0, 0), float3(0, 0, 0));
+		for (auto const & obj : objs_)
+		{
+			if ((obj.node != nullptr) && (obj.tree_node_index != PENDING_TREE_NODE_INDEX))
+			{
+				if (first)
+				{
+					bb_root = obj.node->PosBoundWS();
+					first = false;
+				}
+				else
+				{
+					bb_root |= obj.node->PosBoundWS();
+				}
+			}
+		}
+		if (first)
+		{
+			return;
+		}
+
+		++ stats_.num_rebuilds;
+
+		// Leave some room for objects moving out of current bound
+		float3 const & center = bb_root.Center();
+		float3 const & extent = bb_root.HalfSize();
+		float longest_dim = std::max(std::max(std::max(extent.x(), extent.y()), extent.z()) * 1.25f, 1e-3f);
+		float3 new_extent(longest_dim, longest_dim, longest_dim);
+
+		octree_.resize(1);
+		auto& root = octree_[0];
+		root.bb = AABBox(center - new_extent, center + new_extent);
+		root.loose_bb = AABBox(center - new_extent * 2.0f, center + new_extent * 2.0f);
+		root.parent_index = -1;
+		root.first_child_index = -1;
+		root.depth = 0;
+		root.visible = BoundOverlap::No;
+		root.num_subtree_objs = 0;
+		root.clip_stamp = 0;
+
+		for (uint32_t i = 0; i < objs_.size(); ++ i)
+		{
+			if ((objs_[i].node != nullptr) && (objs_[i].tree_node_index != PENDING_TREE_NODE_INDEX))
+			{
+				this->InsertObject(i);
+			}
+		}
+	}
+
+	void OCTree::InsertObject(uint32_t obj_index)
+	{
+		auto& obj = objs_[obj_index];
+		AABBox const & aabb = obj.node->PosBoundWS();
+		float3 const center = aabb.Center();
+		float3 const extent = aabb.HalfSize();
+		float const size = std::max(std::max(extent.x(), extent.y()), extent.z());
+
+		if (octree_.empty() || !octree_[0].bb.VecInBound(center) || (size > octree_[0].bb.HalfSize().x()))
+		{
+			obj.tree_node_index = OUTSIDE_TREE_NODE_INDEX;
+			obj.slot = static_cast<uint32_t>(outside_objs_.size());
+			outside_objs_.push_back(obj_index);
+
+			// Too many objects out of the root, the tree needs to be enlarged
+			if (octree_.empty() || (outside_objs_.size() > std::max<size_t>(16, obj_map_.size() / 8)))
+			{
+				rebuild_tree_ = true;
+			}
+			return;
+		}
+
+		size_t index = 0;
+		float half_size = octree_[0].bb.HalfSize().x();
+		while ((octree_[index].depth < max_tree_depth_) && (size <= half_size * 0.5f))
+		{
+			if (-1 == octree_[index].first_child_index)
+			{
+				this->DivideNode(index);
+			}
+
+			float3 const node_center = octree_[index].bb.Center();
+			int const child = (center.x() >= node_center.x() ? 1 : 0)
+				+ (center.y() >= node_center.y() ? 2 : 0)
+				+ (center.z() >= node_center.z() ? 4 : 0);
+			index = octree_[index].first_child_index + child;
+			half_size *= 0.5f;
+		}
 
-			octree_[index].node_ptrs.clear();
-			octree_[index].node_ptrs.shrink_to_fit();
+		auto& octree_node = octree_[index];
+		obj.tree_node_index = static_cast<int>(index);
+		obj.slot = static_cast<uint32_t>(octree_node.obj_indices.size());
+		octree_node.obj_indices.push_back(obj_index);
+		for (int i = static_cast<int>(index); i >= 0; i = octree_[i].parent_index)
+		{
+			++ octree_[i].num_subtree_objs;
+		}
+	}
+
+	void OCTree::RemoveObject(uint32_t obj_index)
+	{
+		auto const & obj = objs_[obj_index];
+		std::vector<uint32_t>* indices_ptr;
+		if (obj.tree_node_index >= 0)
+		{
+			indices_ptr = &octree_[obj.tree_node_index].obj_indices;
+		}
+		else if (obj.tree_node_index == OUTSIDE_TREE_NODE_INDEX)
+		{
+			indices_ptr = &outside_objs_;
+		}
+		else
+		{
+			indices_ptr = &pending_objs_;
+		}
+		auto& indices = *indices_ptr;
+		BOOST_ASSERT(indices[obj.slot] == obj_index);
+
+		uint32_t const last = indices.back();
+		indices[obj.slot] = last;
+		objs_[last].slot = obj.slot;
+		indices.pop_back();
+
+		for (int i = obj.tree_node_index; i >= 0; i = octree_[i].parent_index)
+		{
+			-- octree_[i].num_subtree_objs;
+		}
+	}
+
+	bool OCTree::ObjectFits(uint32_t obj_index) const
+	{
+		auto const & obj = objs_[obj_index];
+		AABBox const & aabb = obj.node->PosBoundWS();
+		float3 const center = aabb.Center();
+		float3 const extent = aabb.HalfSize();
+		float const size = std::max(std::max(extent.x(), extent.y()), extent.z());
+
+		if (obj.tree_node_index == OUTSIDE_TREE_NODE_INDEX)
+		{
+			return octree_.empty() || !octree_[0].bb.VecInBound(center) || (size > octree_[0].bb.HalfSize().x());
+		}
+		else
+		{
+			// Objects are allowed to stay in a node larger than necessary, so that they don't go up and down frequently
+			auto const & octree_node = octree_[obj.tree_node_index];
+			return octree_node.bb.VecInBound(center) && (size <= octree_node.bb.HalfSize().x());
+		}
+	}
+
+	void OCTree::DivideNode(size_t index)
+	{
+		size_t const this_size = octree_.size();
+		AABBox const parent_bb = octree_[index].bb;
+		float3 const parent_center = parent_bb.Center();
+		uint32_t const depth = octree_[index].depth + 1;
+		octree_[index].first_child_index = static_cast<int>(this_size);
+
+		octree_.resize(this_size + 8);
+		for (size_t j = 0; j < 8; ++ j)
+		{
+			octree_node_t& new_node = octree_[this_size + j];
+			new_node.bb = AABBox(float3((j & 1) ? parent_center.x() : parent_bb.Min().x(),
+					(j & 2) ? parent_center.y() : parent_bb.Min().y(),
+					(j & 4) ? parent_center.z() : parent_bb.Min().z()),
+				float3((j & 1) ? parent_bb.Max().x() : parent_center.x(),
+					(j & 2) ? parent_bb.Max().y() : parent_center.y(),
+					(j & 4) ? parent_bb.Max().z() : parent_center.z()));
+			float3 const center = new_node.bb.Center();
+			float3 const loose_extent = new_node.bb.HalfSize() * 2.0f;
+			new_node.loose_bb = AABBox(center - loose_extent, center + loose_extent);
+			new_node.parent_index = static_cast<int>(index);
+			new_node.first_child_index = -1;
+			new_node.depth = depth;
+			new_node.visible = BoundOverlap::No;
+			new_node.num_subtree_objs = 0;
+			new_node.clip_stamp = 0;
 		}
 	}
 
@@ -352,8 +662,8 @@ namespace KlayGE
 			{
 				auto const& camera = *viewport.Camera(i);
 				float4x4 const& view_proj = camera_view_projs_[i];
-				if (((MathLib::ortho_area(camera.ForwardVec(), octree_node.bb) > small_obj_threshold_)
-					&& (MathLib::perspective_area(camera.EyePos(), view_proj, octree_node.bb) > small_obj_threshold_)))
+				if (((MathLib::ortho_area(camera.ForwardVec(), octree_node.loose_bb) > small_obj_threshold_)
+					&& (MathLib::perspective_area(camera.EyePos(), view_proj, octree_node.loose_bb) > small_obj_threshold_)))
 				{
 					large_enough = true;
 					break;
@@ -363,7 +673,7 @@ namespace KlayGE
 
 		if (large_enough)
 		{
-			octree_node.visible = SceneManager::AABBVisible(octree_node.bb);
+			octree_node.visible = SceneManager::AABBVisible(octree_node.loose_bb);
 			if (BoundOverlap::Partial == octree_node.visible)
 			{
 				if (octree_node.first_child_index != -1)
@@ -397,74 +707,89 @@ namespace KlayGE
 		auto const& viewport = *re.CurFrameBuffer()->Viewport();
 		uint32_t const num_cameras = viewport.NumCameras();
 
-		auto const & octree_node = octree_[index];
-		if ((octree_node.visible != BoundOverlap::No) || force)
+		auto& octree_node = octree_[index];
+		if (((octree_node.visible != BoundOverlap::No) || force) && (octree_node.num_subtree_objs > 0))
 		{
-			for (auto* node : octree_node.node_ptrs)
+			octree_node.clip_stamp = clip_stamp_;
+
+			for (auto const obj_index : octree_node.obj_indices)
+			{
+				auto const & obj = objs_[obj_index];
+				this->MarkObj(*obj.node, obj.moveable, num_cameras);
+			}
+
+			if (octree_node.first_child_index != -1)
 			{
-				if (node->Visible())
+				for (int i = 0; i < 8; ++ i)
 				{
-					if (node->Updated())
-					{
-						for (uint32_t i = 0; i < num_cameras; ++i)
-						{
-							if (node->VisibleMark(i) == BoundOverlap::No)
-							{
-								auto visible = this->VisibleTestFromParent(*node, i);
-								if (BoundOverlap::Partial == visible)
-								{
-									if (node->Parent())
-									{
-										visible = camera_frustums_[i]->Intersect(node->PosBoundWS());
-									}
-									else
-									{
-										visible = BoundOverlap::No;
-									}
-								}
+					this->MarkNodeObjs(octree_node.first_child_index + i, (BoundOverlap::Yes == octree_node.visible) || force);
+				}
+			}
+		}
+	}
 
-								node->VisibleMark(i, visible);
-							}
-						}
-					}
-					else
+	void OCTree::MarkObj(SceneNode& node, bool moveable, uint32_t num_cameras)
+	{
+		if (node.Visible())
+		{
+			if (node.Updated())
+			{
+				for (uint32_t i = 0; i < num_cameras; ++i)
+				{
+					if (moveable)
 					{
-						for (uint32_t i = 0; i < num_cameras; ++i)
+						if (node.VisibleMark(i) == BoundOverlap::Partial)
 						{
-							node->VisibleMark(i, BoundOverlap::Yes);
+							node.VisibleMark(i, camera_frustums_[i]->Intersect(node.PosBoundWS()));
 						}
 					}
-
-					for (uint32_t i = 0; i < num_cameras; ++i)
+					else if (node.VisibleMark(i) == BoundOverlap::No)
 					{
-						if (node->VisibleMark(i) != BoundOverlap::No)
+						auto visible = this->VisibleTestFromParent(node, i);
+						if (BoundOverlap::Partial == visible)
 						{
-							auto* override_node = node->Parent();
-							while ((override_node != nullptr) && (override_node->VisibleMark(i) == BoundOverlap::No))
+							if (node.Parent())
 							{
-								override_node->VisibleMark(i, BoundOverlap::Partial);
-								override_node = override_node->Parent();
+								visible = camera_frustums_[i]->Intersect(node.PosBoundWS());
+							}
+							else
+							{
+								visible = BoundOverlap::No;
 							}
 						}
+
+						node.VisibleMark(i, visible);
 					}
 				}
-				else
+			}
+			else
+			{
+				for (uint32_t i = 0; i < num_cameras; ++i)
 				{
-					for (uint32_t i = 0; i < num_cameras; ++i)
-					{
-						node->VisibleMark(i, BoundOverlap::No);
-					}
+					node.VisibleMark(i, BoundOverlap::Yes);
 				}
 			}
 
-			if (octree_node.first_child_index != -1)
+			for (uint32_t i = 0; i < num_cameras; ++i)
 			{
-				for (int i = 0; i < 8; ++ i)
+				if (node.VisibleMark(i) != BoundOverlap::No)
 				{
-					this->MarkNodeObjs(octree_node.first_child_index + i, (BoundOverlap::Yes == octree_node.visible) || force);
+					auto* override_node = node.Parent();
+					while ((override_node != nullptr) && (override_node->VisibleMark(i) == BoundOverlap::No))
+					{
+						override_node->VisibleMark(i, BoundOverlap::Partial);
+						override_node = override_node->Parent();
+					}
 				}
 			}
 		}
+		else
+		{
+			for (uint32_t i = 0; i < num_cameras; ++i)
+			{
+				node.VisibleMark(i, BoundOverlap::No);
+			}
+		}
 	}
 
 	BoundOverlap OCTree::AABBVisible(AABBox const & aabb) const
@@ -473,7 +798,7 @@ namespace KlayGE
 		BoundOverlap visible = BoundOverlap::Yes;
 		if (!octree_.empty())
 		{
-			if (MathLib::intersect_aabb_aabb(octree_[0].bb, aabb))
+			if (MathLib::intersect_aabb_aabb(octree_[0].loose_bb, aabb))
 			{
 				visible = this->BoundVisible(0, aabb);
 			}
@@ -497,7 +822,7 @@ namespace KlayGE
 		BoundOverlap visible = BoundOverlap::Yes;
 		if (!octree_.empty())
 		{
-			if (MathLib::intersect_aabb_obb(octree_[0].bb, obb))
+			if (MathLib::intersect_aabb_obb(octree_[0].loose_bb, obb))
 			{
 				visible = this->BoundVisible(0, obb);
 			}
@@ -521,7 +846,7 @@ namespace KlayGE
 		BoundOverlap visible = BoundOverlap::Yes;
 		if (!octree_.empty())
 		{
-			if (MathLib::intersect_aabb_sphere(octree_[0].bb, sphere))
+			if (MathLib::intersect_aabb_sphere(octree_[0].loose_bb, sphere))
 			{
 				visible = this->BoundVisible(0, sphere);
 			}
@@ -545,7 +870,7 @@ namespace KlayGE
 		BoundOverlap visible = BoundOverlap::Yes;
 		if (!octree_.empty())
 		{
-			if (MathLib::intersect_aabb_frustum(octree_[0].bb, frustum) != BoundOverlap::No)
+			if (MathLib::intersect_aabb_frustum(octree_[0].loose_bb, frustum) != BoundOverlap::No)
 			{
 				visible = this->BoundVisible(0, frustum);
 			}
@@ -568,7 +893,7 @@ namespace KlayGE
 		BOOST_ASSERT(index < octree_.size());
 
 		octree_node_t const & node = octree_[index];
-		if ((node.visible != BoundOverlap::No) && MathLib::intersect_aabb_aabb(node.bb, aabb))
+		if ((node.visible != BoundOverlap::No) && MathLib::intersect_aabb_aabb(node.loose_bb, aabb))
 		{
 			if (BoundOverlap::Yes == node.visible)
 			{
@@ -580,25 +905,12 @@ namespace KlayGE
 
 				if (node.first_child_index != -1)
 				{
-					float3 const center = node.bb.Center();
-					int mark[6];
-					mark[0] = aabb.Min().x() >= center.x() ? 1 : 0;
-					mark[1] = aabb.Min().y() >= center.y() ? 2 : 0;
-					mark[2] = aabb.Min().z() >= center.z() ? 4 : 0;
-					mark[3] = aabb.Max().x() >= center.x() ? 1 : 0;
-					mark[4] = aabb.Max().y() >= center.y() ? 2 : 0;
-					mark[5] = aabb.Max().z() >= center.z() ? 4 : 0;
-					for (int j = 0; j < 8; ++ j)
+					for (int i = 0; i < 8; ++ i)
 					{
-						if (j == ((j & 1) ? mark[3] : mark[0])
-							+ ((j & 2) ? mark[4] : mark[1])
-							+ ((j & 4) ? mark[5] : mark[2]))
+						BoundOverlap const bo = this->BoundVisible(node.first_child_index + i, aabb);
+						if (bo != BoundOverlap::No)
 						{
-							BoundOverlap const bo = this->BoundVisible(node.first_child_index + j, aabb);
-							if (bo != BoundOverlap::No)
-							{
-								return bo;
-							}
+							return bo;
 						}
 					}
 
@@ -621,7 +933,7 @@ namespace KlayGE
 		BOOST_ASSERT(index < octree_.size());
 
 		octree_node_t const & node = octree_[index];
-		if ((node.visible != BoundOverlap::No) && MathLib::intersect_aabb_obb(node.bb, obb))
+		if ((node.visible != BoundOverlap::No) && MathLib::intersect_aabb_obb(node.loose_bb, obb))
 		{
 			if (BoundOverlap::Yes == node.visible)
 			{
@@ -661,7 +973,7 @@ namespace KlayGE
 		BOOST_ASSERT(index < octree_.size());
 
 		octree_node_t const & node = octree_[index];
-		if ((node.visible != BoundOverlap::No) && MathLib::intersect_aabb_sphere(node.bb, sphere))
+		if ((node.visible != BoundOverlap::No) && MathLib::intersect_aabb_sphere(node.loose_bb, sphere))
 		{
 			if (BoundOverlap::Yes == node.visible)
 			{
@@ -701,7 +1013,7 @@ namespace KlayGE
 		BOOST_ASSERT(index < octree_.size());
 
 		octree_node_t const & node = octree_[index];
-		if ((node.visible != BoundOverlap::No) && (MathLib::intersect_aabb_frustum(node.bb, frustum) != BoundOverlap::No))
+		if ((node.visible != BoundOverlap::No) && (MathLib::intersect_aabb_frustum(node.loose_bb, frustum) != BoundOverlap::No))
 		{
 			if (BoundOverlap::Yes == node.visible)
 			{
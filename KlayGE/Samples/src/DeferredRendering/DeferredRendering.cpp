@@ -590,7 +590,8 @@ void DeferredRenderingApp::DoUpdateOverlay()
 
 	stream.str(L"");
 	stream << scene_mgr.NumDrawCalls() << " Draws/frame "
-		<< scene_mgr.NumDispatchCalls() << " Dispatches/frame";
+		<< scene_mgr.NumDispatchCalls() << " Dispatches/frame "
+		<< scene_mgr.NumRedundantBinds() << " Redundant binds/frame";
 	font_->RenderText(0, 90, Color(1, 1, 1, 1), stream.str(), 16);
 
 	uint32_t const num_loading_res = ResLoader::Instance().NumLoadingResources();
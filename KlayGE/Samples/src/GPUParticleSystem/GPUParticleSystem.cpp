@@ -444,16 +444,19 @@ namespace
 					}
 					else
 					{
-						pos.resize(tex_width_ * tex_height_ * sizeof(half) * 4);
-						half* p = reinterpret_cast<half*>(&pos[0]);
+						std::vector<float> pos_f32(tex_width_ * tex_height_ * 4);
 						for (int i = 0; i < tex_width_ * tex_height_; ++ i)
 						{
-							p[i * 4 + 0] = half(0.0f);
-							p[i * 4 + 1] = half(0.0f);
-							p[i * 4 + 2] = half(0.0f);
-							p[i * 4 + 3] = half(-1.0f);
+							pos_f32[i * 4 + 0] = 0.0f;
+							pos_f32[i * 4 + 1] = 0.0f;
+							pos_f32[i * 4 + 2] = 0.0f;
+							pos_f32[i * 4 + 3] = -1.0f;
 						}
 
+						pos.resize(tex_width_ * tex_height_ * sizeof(half) * 4);
+						half* p = reinterpret_cast<half*>(&pos[0]);
+						FloatToHalf(pos_f32, MakeSpan(p, pos_f32.size()));
+
 						pos_init.data = &p[0];
 						pos_init.row_pitch = tex_width_ * sizeof(half) * 4;
 						pos_init.slice_pitch = 0;
@@ -503,17 +506,19 @@ namespace
 				}
 
 				{
-					std::vector<half> p(tex_width_ * tex_height_ * 4);
-					for (size_t i = 0; i < p.size(); i += 4)
+					std::vector<float> p_f32(tex_width_ * tex_height_ * 4);
+					for (size_t i = 0; i < p_f32.size(); i += 4)
 					{
 						float const angel = this->RandomGen() / 0.05f * PI;
 						float const r = this->RandomGen() * 3;
 
-						p[i + 0] = half(r * cos(angel));
-						p[i + 1] = half(0.2f + abs(this->RandomGen()) * 3);
-						p[i + 2] = half(r * sin(angel));
-						p[i + 3] = half(0.0f);
+						p_f32[i + 0] = r * cos(angel);
+						p_f32[i + 1] = 0.2f + abs(this->RandomGen()) * 3;
+						p_f32[i + 2] = r * sin(angel);
+						p_f32[i + 3] = 0.0f;
 					}
+					std::vector<half> p(p_f32.size());
+					FloatToHalf(p_f32, p);
 					ElementInitData vel_init;
 					vel_init.data = &p[0];
 					vel_init.row_pitch = tex_width_ * sizeof(half) * 4;
@@ -548,12 +553,14 @@ namespace
 
 			float time = 0;
 
-			std::vector<half> time_v(tex_width_ * tex_height_);
-			for (size_t i = 0; i < time_v.size(); ++ i)
+			std::vector<float> time_f32(tex_width_ * tex_height_);
+			for (size_t i = 0; i < time_f32.size(); ++ i)
 			{
-				time_v[i] = half(time);
+				time_f32[i] = time;
 				time += inv_emit_freq_;
 			}
+			std::vector<half> time_v(time_f32.size());
+			FloatToHalf(time_f32, time_v);
 
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 			if (use_so || use_cs)
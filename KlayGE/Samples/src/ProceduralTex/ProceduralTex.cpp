@@ -235,7 +235,7 @@ uint32_t ProceduralTexApp::DoUpdate(uint32_t /*pass*/)
 			polygon_model_ = SyncLoadModel("teapot.glb", EAH_GPU_Read | EAH_Immutable,
 				SceneNode::SOA_Cullable, AddToSceneRootHelper,
 				CreateModelFactory<RenderModel>, CreateMeshFactory<RenderPolygon>);
-			polygon_model_->RootNode()->OnSubThreadUpdate().Connect([this](SceneNode& node, float app_time, float elapsed_time)
+			polygon_model_->RootNode()->OnMainThreadUpdate().Connect([this](SceneNode& node, float app_time, float elapsed_time)
 				{
 					KFL_UNUSED(node);
 					KFL_UNUSED(elapsed_time);
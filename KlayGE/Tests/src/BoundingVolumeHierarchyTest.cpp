@@ -0,0 +1,335 @@
+/**
+ * @file BoundingVolumeHierarchyTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/BoundingVolumeHierarchy.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	std::vector<AABBox> RandomBoxes(uint32_t num, float world_size, float max_box_size, std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> pos_dis(-world_size, world_size);
+		std::uniform_real_distribution<float> size_dis(0.01f, max_box_size);
+
+		std::vector<AABBox> ret;
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			float3 const min(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+			ret.emplace_back(min, min + float3(size_dis(gen), size_dis(gen), size_dis(gen)));
+		}
+		return ret;
+	}
+
+	float3 RandomDir(std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> dis(-1, 1);
+		float3 dir;
+		do
+		{
+			dir = float3(dis(gen), dis(gen), dis(gen));
+		} while (MathLib::length_sq(dir) < 1e-4f);
+		return MathLib::normalize(dir);
+	}
+
+	// Entry distance of the ray, or a negative number for a miss
+	float RayBoxDist(float3 const & orig, float3 const & dir, AABBox const & aabb, float radius)
+	{
+		float t0 = 0;
+		float t1 = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < 3; ++ i)
+		{
+			float const min = aabb.Min()[i] - radius;
+			float const max = aabb.Max()[i] + radius;
+			if (dir[i] == 0)
+			{
+				if ((orig[i] < min) || (orig[i] > max))
+				{
+					return -1;
+				}
+			}
+			else
+			{
+				float near_t = (min - orig[i]) / dir[i];
+				float far_t = (max - orig[i]) / dir[i];
+				if (near_t > far_t)
+				{
+					std::swap(near_t, far_t);
+				}
+				t0 = std::max(t0, near_t);
+				t1 = std::min(t1, far_t);
+			}
+		}
+		return (t0 <= t1) ? t0 : -1;
+	}
+
+	float BruteForceRayCast(std::vector<AABBox> const & boxes, float3 const & orig, float3 const & dir, float radius, float max_dist)
+	{
+		float ret = -1;
+		for (auto const & aabb : boxes)
+		{
+			float const dist = RayBoxDist(orig, dir, aabb, radius);
+			if ((dist >= 0) && (dist <= max_dist) && ((ret < 0) || (dist < ret)))
+			{
+				ret = dist;
+			}
+		}
+		return ret;
+	}
+
+	void ExpectRayCastsMatch(BoundingVolumeHierarchy const & bvh, std::vector<AABBox> const & boxes, float radius,
+		std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> pos_dis(-120, 120);
+		for (uint32_t i = 0; i < 500; ++ i)
+		{
+			float3 const orig(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+			float3 const dir = RandomDir(gen);
+			float const max_dist = 150;
+
+			float const expected = BruteForceRayCast(boxes, orig, dir, radius, max_dist);
+
+			float dist = max_dist;
+			uint32_t const item = bvh.RayCast(orig, dir, radius, dist);
+			if (expected < 0)
+			{
+				EXPECT_EQ(BoundingVolumeHierarchy::InvalidIndex, item);
+			}
+			else
+			{
+				ASSERT_NE(BoundingVolumeHierarchy::InvalidIndex, item);
+				EXPECT_NEAR(expected, dist, 1e-3f);
+				EXPECT_NEAR(expected, RayBoxDist(orig, dir, boxes[item], radius), 1e-3f);
+			}
+		}
+	}
+
+	void ExpectOverlapsMatch(BoundingVolumeHierarchy const & bvh, std::vector<AABBox> const & boxes, std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> pos_dis(-100, 100);
+		std::uniform_real_distribution<float> size_dis(0, 20);
+		for (uint32_t i = 0; i < 100; ++ i)
+		{
+			float3 const min(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+			AABBox const query(min, min + float3(size_dis(gen), size_dis(gen), size_dis(gen)));
+			Sphere const sphere(query.Center(), size_dis(gen));
+
+			std::vector<uint32_t> expected_aabb;
+			std::vector<uint32_t> expected_sphere;
+			for (uint32_t j = 0; j < boxes.size(); ++ j)
+			{
+				if (MathLib::intersect_aabb_aabb(query, boxes[j]))
+				{
+					expected_aabb.push_back(j);
+				}
+				if (MathLib::intersect_aabb_sphere(boxes[j], sphere))
+				{
+					expected_sphere.push_back(j);
+				}
+			}
+
+			std::vector<uint32_t> items;
+			bvh.Overlap(query, [&items](uint32_t item) { items.push_back(item); });
+			std::sort(items.begin(), items.end());
+			EXPECT_EQ(expected_aabb, items);
+
+			items.clear();
+			bvh.Overlap(sphere, [&items](uint32_t item) { items.push_back(item); });
+			std::sort(items.begin(), items.end());
+			EXPECT_EQ(expected_sphere, items);
+		}
+	}
+}
+
+TEST(BoundingVolumeHierarchyTest, RayCastMatchesBruteForce)
+{
+	std::ranlux24_base gen;
+	auto const boxes = RandomBoxes(3000, 100, 5, gen);
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes);
+	EXPECT_EQ(3000U, bvh.NumItems());
+	EXPECT_LT(bvh.NumNodes(), 3000U * 2);
+
+	ExpectRayCastsMatch(bvh, boxes, 0, gen);
+}
+
+TEST(BoundingVolumeHierarchyTest, SweepSphere)
+{
+	std::ranlux24_base gen;
+	auto const boxes = RandomBoxes(3000, 100, 5, gen);
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes);
+	ExpectRayCastsMatch(bvh, boxes, 2.5f, gen);
+
+	// Starting inside an inflated box hits at 0
+	BoundingVolumeHierarchy single;
+	AABBox const box(float3(0, 0, 0), float3(1, 1, 1));
+	single.Build(MakeSpan(&box, 1));
+	float dist = 10;
+	EXPECT_EQ(0U, single.RayCast(float3(-0.5f, 0.5f, 0.5f), float3(1, 0, 0), 1, dist));
+	EXPECT_EQ(0.0f, dist);
+}
+
+TEST(BoundingVolumeHierarchyTest, OverlapMatchesBruteForce)
+{
+	std::ranlux24_base gen;
+	auto const boxes = RandomBoxes(3000, 100, 5, gen);
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes);
+	ExpectOverlapsMatch(bvh, boxes, gen);
+}
+
+TEST(BoundingVolumeHierarchyTest, HitTest)
+{
+	// A row of boxes along x. Rejecting the even ones leaves the second box as the closest.
+	std::vector<AABBox> boxes;
+	for (uint32_t i = 0; i < 100; ++ i)
+	{
+		boxes.emplace_back(float3(i * 2.0f, 0, 0), float3(i * 2.0f + 1, 1, 1));
+	}
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes);
+
+	float dist = 1000;
+	uint32_t const item = bvh.RayCast(float3(-5, 0.5f, 0.5f), float3(1, 0, 0), 0, dist,
+		[](uint32_t item, float box_dist) { return (item & 1) ? box_dist + 0.25f : -1; });
+	EXPECT_EQ(1U, item);
+	EXPECT_FLOAT_EQ(7.25f, dist);
+
+	dist = 6;
+	EXPECT_EQ(BoundingVolumeHierarchy::InvalidIndex, bvh.RayCast(float3(-5, 0.5f, 0.5f), float3(1, 0, 0), 0, dist,
+		[](uint32_t item, float box_dist) { return (item & 1) ? box_dist : -1; }));
+}
+
+TEST(BoundingVolumeHierarchyTest, Refit)
+{
+	std::ranlux24_base gen;
+	auto boxes = RandomBoxes(3000, 100, 5, gen);
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes);
+
+	std::uniform_real_distribution<float> move_dis(-2, 2);
+	for (auto& aabb : boxes)
+	{
+		float3 const offset(move_dis(gen), move_dis(gen), move_dis(gen));
+		aabb = AABBox(aabb.Min() + offset, aabb.Max() + offset);
+	}
+	EXPECT_TRUE(bvh.Refit(boxes));
+	ExpectRayCastsMatch(bvh, boxes, 0, gen);
+	ExpectOverlapsMatch(bvh, boxes, gen);
+
+	// Shuffled all over the place, the old tree is not worth keeping
+	auto const shuffled = RandomBoxes(3000, 100, 5, gen);
+	bool const refit = bvh.Refit(shuffled);
+	EXPECT_FALSE(refit);
+	ExpectRayCastsMatch(bvh, shuffled, 0, gen);
+
+	bvh.Build(shuffled);
+	EXPECT_TRUE(bvh.Refit(shuffled));
+
+	bvh.Clear();
+	float dist = 1000;
+	EXPECT_EQ(BoundingVolumeHierarchy::InvalidIndex, bvh.RayCast(float3(0, 0, 0), float3(1, 0, 0), 0, dist));
+}
+
+TEST(BoundingVolumeHierarchyTest, RayCastPerformance)
+{
+	// Objects spread over a 2000x2000 ground, like a city
+	std::ranlux24_base gen;
+	std::vector<AABBox> boxes;
+	{
+		std::uniform_real_distribution<float> ground_dis(-1000, 1000);
+		std::uniform_real_distribution<float> height_dis(0, 20);
+		std::uniform_real_distribution<float> size_dis(1, 8);
+		for (uint32_t i = 0; i < 100000; ++ i)
+		{
+			float3 const min(ground_dis(gen), height_dis(gen), ground_dis(gen));
+			boxes.emplace_back(min, min + float3(size_dis(gen), size_dis(gen), size_dis(gen)));
+		}
+	}
+
+	Timer timer;
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes);
+	double const build_time = timer.elapsed();
+
+	timer.restart();
+	bvh.Refit(boxes);
+	double const refit_time = timer.elapsed();
+
+	LogInfo() << boxes.size() << " boxes: " << build_time * 1000 << " ms to build, " << refit_time * 1000 << " ms to refit"
+			  << std::endl;
+
+	uint32_t const num_rays = 100000;
+	std::vector<float3> origs(num_rays);
+	std::vector<float3> dirs(num_rays);
+	std::uniform_real_distribution<float> pos_dis(-200, 200);
+	std::uniform_int_distribution<uint32_t> box_dis(0, static_cast<uint32_t>(boxes.size() - 1));
+
+	// Picking-like rays from a camera above the scene aimed at an object, and rays in random directions from the same area
+	for (bool const aimed : {true, false})
+	{
+		for (uint32_t i = 0; i < num_rays; ++ i)
+		{
+			origs[i] = float3(pos_dis(gen), 300, pos_dis(gen) - 1200);
+			dirs[i] = aimed ? MathLib::normalize(boxes[box_dis(gen)].Center() - origs[i]) : RandomDir(gen);
+		}
+
+		uint32_t num_hits = 0;
+		timer.restart();
+		for (uint32_t i = 0; i < num_rays; ++ i)
+		{
+			float dist = 4000;
+			num_hits += (bvh.RayCast(origs[i], dirs[i], 0, dist) != BoundingVolumeHierarchy::InvalidIndex);
+		}
+		double const ray_time = timer.elapsed();
+		EXPECT_GT(num_hits, 0U);
+
+		LogInfo() << (aimed ? "Aimed" : "Random") << " rays: " << ray_time / num_rays * 1e9 << " ns per ray, " << num_hits << " of "
+				  << num_rays << " hit" << std::endl;
+	}
+}
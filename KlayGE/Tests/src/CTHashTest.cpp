@@ -14,3 +14,26 @@ TEST(CTHashTest, Basic)
 	EXPECT_EQ(CT_HASH("Test"), RT_HASH("Test"));
 	EXPECT_EQ(CT_HASH("min_linear_mag_point_mip_linear"), RT_HASH("min_linear_mag_point_mip_linear"));
 }
+
+TEST(CTHashTest, Sha256)
+{
+	auto sha256 = [](std::string_view str) {
+		Sha256 hasher;
+		hasher.Update(str);
+		return Sha256::ToString(hasher.Final());
+	};
+
+	EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", sha256(""));
+	EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha256("abc"));
+	EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+		sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+
+	// Fed in pieces that don't line up with the blocks
+	std::string const million_a(1000000, 'a');
+	Sha256 hasher;
+	for (size_t i = 0; i < million_a.size(); i += 997)
+	{
+		hasher.Update(std::string_view(million_a).substr(i, 997));
+	}
+	EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", Sha256::ToString(hasher.Final()));
+}
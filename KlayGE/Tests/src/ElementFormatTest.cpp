@@ -0,0 +1,201 @@
+/**
+ * @file ElementFormatTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/ElementFormat.hpp>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// Not a multiple of any vector width, so every kernel has a remainder to convert too
+	uint32_t const NUM_ELEMS = 1037;
+
+	std::vector<uint8_t> RandomBytes(uint32_t size)
+	{
+		std::ranlux24_base gen;
+		std::uniform_int_distribution<int> dis(0, 255);
+
+		std::vector<uint8_t> ret(size);
+		for (auto& b : ret)
+		{
+			b = static_cast<uint8_t>(dis(gen));
+		}
+		return ret;
+	}
+}
+
+TEST(ElementFormatTest, UNorm8RoundTrip)
+{
+	ElementFormat const formats[] = {EF_ARGB8, EF_ABGR8, EF_ARGB8_SRGB, EF_ABGR8_SRGB};
+	auto const src = RandomBytes(NUM_ELEMS * 4);
+	for (auto fmt : formats)
+	{
+		std::vector<Color> colors(NUM_ELEMS);
+		ConvertToABGR32F(fmt, src.data(), NUM_ELEMS, colors.data());
+
+		int const r = ((fmt == EF_ARGB8) || (fmt == EF_ARGB8_SRGB)) ? 2 : 0;
+		for (uint32_t i = 0; i < NUM_ELEMS; ++ i)
+		{
+			float const expected = IsSRGB(fmt) ? MathLib::srgb_to_linear(src[i * 4 + r] / 255.0f) : src[i * 4 + r] / 255.0f;
+			EXPECT_EQ(expected, colors[i].r());
+		}
+
+		std::vector<uint8_t> dst(src.size());
+		ConvertFromABGR32F(fmt, colors.data(), NUM_ELEMS, dst.data());
+		EXPECT_EQ(src, dst);
+	}
+}
+
+TEST(ElementFormatTest, A2BGR10RoundTrip)
+{
+	auto const src = RandomBytes(NUM_ELEMS * 4);
+	std::vector<Color> colors(NUM_ELEMS);
+	ConvertToABGR32F(EF_A2BGR10, src.data(), NUM_ELEMS, colors.data());
+
+	std::vector<uint8_t> dst(src.size());
+	ConvertFromABGR32F(EF_A2BGR10, colors.data(), NUM_ELEMS, dst.data());
+	EXPECT_EQ(src, dst);
+
+	Color const out_of_range(-1, 2, std::numeric_limits<float>::quiet_NaN(), 0.5f);
+	uint32_t packed;
+	ConvertFromABGR32F(EF_A2BGR10, &out_of_range, 1, &packed);
+	EXPECT_EQ((1023U << 10) | (2U << 30), packed);
+}
+
+TEST(ElementFormatTest, HalfRoundTrip)
+{
+	ElementFormat const formats[] = {EF_R16F, EF_ABGR16F};
+	for (auto fmt : formats)
+	{
+		uint32_t const num_channels = NumComponents(fmt);
+		auto src = RandomBytes(NUM_ELEMS * num_channels * 2);
+		uint16_t* src_halves = reinterpret_cast<uint16_t*>(src.data());
+		for (uint32_t i = 0; i < NUM_ELEMS * num_channels; ++ i)
+		{
+			// Keeps away from NaNs, their payloads don't have to survive
+			if ((src_halves[i] & 0x7C00) == 0x7C00)
+			{
+				src_halves[i] &= 0xFC00;
+			}
+		}
+		src_halves[0] = 0x0000;
+		src_halves[1] = 0x8001;
+
+		std::vector<Color> colors(NUM_ELEMS);
+		ConvertToABGR32F(fmt, src.data(), NUM_ELEMS, colors.data());
+		EXPECT_EQ(0.0f, colors[0].r());
+
+		std::vector<uint8_t> dst(src.size());
+		ConvertFromABGR32F(fmt, colors.data(), NUM_ELEMS, dst.data());
+		EXPECT_EQ(src, dst);
+	}
+}
+
+TEST(ElementFormatTest, B10G11R11FDecode)
+{
+	uint32_t const packed[] = {
+		(0x0FU << 6) | ((0x0FU << 6) << 11) | ((0x0FU << 5) << 22), // 1, 1, 1
+		0x01 | (0x3FU << 11) | (0x1FU << 22), // Denormals
+		(0x1FU << 6) | (((0x1FU << 6) | 1) << 11) | ((0x1EU << 5) << 22), // Inf, NaN, 32768
+	};
+	Color colors[std::size(packed)];
+	ConvertToABGR32F(EF_B10G11R11F, packed, static_cast<uint32_t>(std::size(packed)), colors);
+
+	EXPECT_EQ(Color(1, 1, 1, 1), colors[0]);
+	EXPECT_EQ(std::ldexp(1.0f, -20), colors[1].r());
+	EXPECT_EQ(std::ldexp(63.0f, -20), colors[1].g());
+	EXPECT_EQ(std::ldexp(31.0f, -19), colors[1].b());
+	EXPECT_TRUE(std::isinf(colors[2].r()));
+	EXPECT_TRUE(std::isnan(colors[2].g()));
+	EXPECT_EQ(32768.0f, colors[2].b());
+}
+
+TEST(ElementFormatTest, ConvertFormat)
+{
+	ElementFormat const formats[] = {EF_ARGB8, EF_ABGR8, EF_ARGB8_SRGB, EF_ABGR8_SRGB, EF_A2BGR10, EF_ABGR16F};
+	auto const src = RandomBytes(NUM_ELEMS * 8);
+	for (auto src_fmt : formats)
+	{
+		for (auto dst_fmt : formats)
+		{
+			uint32_t const dst_size = NUM_ELEMS * NumFormatBytes(dst_fmt);
+
+			std::vector<uint8_t> expected(dst_size);
+			if (src_fmt == dst_fmt)
+			{
+				expected.assign(src.begin(), src.begin() + dst_size);
+			}
+			else
+			{
+				std::vector<Color> colors(NUM_ELEMS);
+				ConvertToABGR32F(src_fmt, src.data(), NUM_ELEMS, colors.data());
+				ConvertFromABGR32F(dst_fmt, colors.data(), NUM_ELEMS, expected.data());
+			}
+
+			std::vector<uint8_t> dst(dst_size);
+			ConvertFormat(src_fmt, src.data(), NUM_ELEMS, dst_fmt, dst.data());
+			EXPECT_EQ(expected, dst);
+		}
+	}
+}
+
+TEST(ElementFormatTest, ConvertFormatInPlace)
+{
+	ElementFormat const formats[] = {EF_ARGB8, EF_ABGR8, EF_ARGB8_SRGB, EF_ABGR8_SRGB, EF_A2BGR10, EF_ABGR16F, EF_R16F};
+	auto const src = RandomBytes(NUM_ELEMS * 8);
+	for (auto src_fmt : formats)
+	{
+		for (auto dst_fmt : formats)
+		{
+			if (NumFormatBytes(dst_fmt) > NumFormatBytes(src_fmt))
+			{
+				continue;
+			}
+
+			std::vector<uint8_t> expected(NUM_ELEMS * NumFormatBytes(dst_fmt));
+			ConvertFormat(src_fmt, src.data(), NUM_ELEMS, dst_fmt, expected.data());
+
+			std::vector<uint8_t> buffer(src.begin(), src.begin() + NUM_ELEMS * NumFormatBytes(src_fmt));
+			ConvertFormat(src_fmt, buffer.data(), NUM_ELEMS, dst_fmt, buffer.data());
+			buffer.resize(expected.size());
+			EXPECT_EQ(expected, buffer);
+		}
+	}
+}
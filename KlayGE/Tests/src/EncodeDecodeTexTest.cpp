@@ -5,8 +5,10 @@
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/Half.hpp>
+#include <KFL/Timer.hpp>
 
 #include <vector>
+#include <random>
 #include <string>
 #include <iostream>
 
@@ -293,3 +295,219 @@ TEST(EncodeDecodeTexTest, EncodeDecodeETC1)
 {
 	TestEncodeDecodeTex("Lenna.dds", "", EF_ETC1, 4.8f);
 }
+
+namespace
+{
+	std::unique_ptr<TexCompression> CreateEncoder(ElementFormat bc_fmt)
+	{
+		switch (bc_fmt)
+		{
+		case EF_BC1:
+			return MakeUniquePtr<TexCompressionBC1>();
+
+		case EF_BC3:
+			return MakeUniquePtr<TexCompressionBC3>();
+
+		case EF_BC4:
+			return MakeUniquePtr<TexCompressionBC4>();
+
+		case EF_BC5:
+			return MakeUniquePtr<TexCompressionBC5>();
+
+		case EF_BC7:
+			return MakeUniquePtr<TexCompressionBC7>();
+
+		case EF_ETC1:
+			return MakeUniquePtr<TexCompressionETC1>();
+
+		default:
+			KFL_UNREACHABLE("Unsupported compression format");
+		}
+	}
+
+	// Smooth gradients with some noise, so that blocks are neither constant nor random
+	std::vector<uint8_t> GenerateTestImage(uint32_t width, uint32_t height, uint32_t pixel_size)
+	{
+		std::vector<uint8_t> pixels(width * height * pixel_size);
+		std::mt19937 gen(0x1234);
+		std::uniform_int_distribution<int> noise(-12, 12);
+		for (uint32_t y = 0; y < height; ++ y)
+		{
+			for (uint32_t x = 0; x < width; ++ x)
+			{
+				for (uint32_t c = 0; c < pixel_size; ++ c)
+				{
+					int const base = static_cast<int>((x * (c + 1) + y * (pixel_size - c)) * 255 / (width + height)) & 0xFF;
+					pixels[(y * width + x) * pixel_size + c] = static_cast<uint8_t>(std::clamp(base + noise(gen), 0, 255));
+				}
+			}
+		}
+		return pixels;
+	}
+
+	void TestParallelEncode(ElementFormat bc_fmt, TexCompressionMethod method)
+	{
+		// Not a multiple of block size, to cover the edge blocks
+		uint32_t const width = 250;
+		uint32_t const height = 126;
+
+		uint32_t const pixel_size = NumFormatBytes(DecodedFormat(bc_fmt));
+		uint32_t const block_width = BlockWidth(bc_fmt);
+		uint32_t const block_height = BlockHeight(bc_fmt);
+		uint32_t const block_bytes = BlockBytes(bc_fmt);
+		uint32_t const blocks_x = (width + block_width - 1) / block_width;
+		uint32_t const blocks_y = (height + block_height - 1) / block_height;
+
+		auto const input = GenerateTestImage(width, height, pixel_size);
+
+		std::vector<uint8_t> serial(blocks_x * blocks_y * block_bytes);
+		{
+			auto codec = CreateEncoder(bc_fmt);
+			std::vector<uint8_t> uncompressed(block_width * block_height * pixel_size);
+			for (uint32_t by = 0; by < blocks_y; ++ by)
+			{
+				for (uint32_t bx = 0; bx < blocks_x; ++ bx)
+				{
+					for (uint32_t y = 0; y < block_height; ++ y)
+					{
+						for (uint32_t x = 0; x < block_width; ++ x)
+						{
+							uint32_t const sx = bx * block_width + x;
+							uint32_t const sy = by * block_height + y;
+							if ((sx < width) && (sy < height))
+							{
+								memcpy(&uncompressed[(y * block_width + x) * pixel_size], &input[(sy * width + sx) * pixel_size],
+									pixel_size);
+							}
+							else
+							{
+								memset(&uncompressed[(y * block_width + x) * pixel_size], 0, pixel_size);
+							}
+						}
+					}
+
+					codec->EncodeBlock(&serial[(by * blocks_x + bx) * block_bytes], &uncompressed[0], method);
+				}
+			}
+		}
+
+		std::vector<uint8_t> parallel(serial.size());
+		{
+			auto codec = CreateEncoder(bc_fmt);
+			codec->EncodeMem(width, height, &parallel[0], blocks_x * block_bytes, static_cast<uint32_t>(parallel.size()),
+				&input[0], width * pixel_size, width * height * pixel_size, method);
+		}
+
+		EXPECT_TRUE(serial == parallel);
+	}
+
+	void TestBatchedEncode(ElementFormat bc_fmt)
+	{
+		uint32_t const pixel_size = NumFormatBytes(DecodedFormat(bc_fmt));
+		uint32_t const uncompressed_block_bytes = BlockWidth(bc_fmt) * BlockHeight(bc_fmt) * pixel_size;
+		uint32_t const block_bytes = BlockBytes(bc_fmt);
+
+		// Odd counts cover the tails of every batch width, and the constant blocks the zero distance case
+		uint32_t const num_blocks = 11;
+		auto input = GenerateTestImage(num_blocks * 16, 1, pixel_size);
+		memset(&input[3 * uncompressed_block_bytes], 0x80, uncompressed_block_bytes);
+		memset(&input[4 * uncompressed_block_bytes], 0xFF, uncompressed_block_bytes);
+
+		auto codec = CreateEncoder(bc_fmt);
+		for (uint32_t count = 1; count <= num_blocks; ++ count)
+		{
+			std::vector<uint8_t> serial(count * block_bytes);
+			for (uint32_t i = 0; i < count; ++ i)
+			{
+				codec->EncodeBlock(&serial[i * block_bytes], &input[i * uncompressed_block_bytes], TCM_Balanced);
+			}
+
+			std::vector<uint8_t> batched(serial.size());
+			codec->EncodeBlocks(&batched[0], &input[0], count, TCM_Balanced);
+
+			EXPECT_TRUE(serial == batched) << "count " << count;
+		}
+	}
+
+	void BenchmarkEncode(ElementFormat bc_fmt, char const * fmt_name)
+	{
+		uint32_t const width = 1024;
+		uint32_t const height = 1024;
+
+		uint32_t const pixel_size = NumFormatBytes(DecodedFormat(bc_fmt));
+		uint32_t const blocks_x = (width + BlockWidth(bc_fmt) - 1) / BlockWidth(bc_fmt);
+		uint32_t const blocks_y = (height + BlockHeight(bc_fmt) - 1) / BlockHeight(bc_fmt);
+
+		auto const input = GenerateTestImage(width, height, pixel_size);
+		std::vector<uint8_t> output(blocks_x * blocks_y * BlockBytes(bc_fmt));
+
+		static char const * method_names[] = { "Speed", "Balanced", "Quality" };
+		for (int method = TCM_Speed; method <= TCM_Quality; ++ method)
+		{
+			auto codec = CreateEncoder(bc_fmt);
+
+			Timer timer;
+			codec->EncodeMem(width, height, &output[0], blocks_x * BlockBytes(bc_fmt), static_cast<uint32_t>(output.size()),
+				&input[0], width * pixel_size, width * height * pixel_size, static_cast<TexCompressionMethod>(method));
+			double const elapsed = timer.elapsed();
+
+			LogInfo() << fmt_name << " " << method_names[method] << ": "
+				<< width * height / 1e6 / std::max(elapsed, 1e-6) << " Mpix/s" << std::endl;
+		}
+	}
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeBC1)
+{
+	TestParallelEncode(EF_BC1, TCM_Quality);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeBC3)
+{
+	TestParallelEncode(EF_BC3, TCM_Balanced);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeBC4)
+{
+	TestParallelEncode(EF_BC4, TCM_Balanced);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeBC5)
+{
+	TestParallelEncode(EF_BC5, TCM_Balanced);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeBC7)
+{
+	TestParallelEncode(EF_BC7, TCM_Speed);
+}
+
+TEST(EncodeDecodeTexTest, ParallelEncodeETC1)
+{
+	TestParallelEncode(EF_ETC1, TCM_Balanced);
+}
+
+TEST(EncodeDecodeTexTest, BatchedEncodeBC3)
+{
+	TestBatchedEncode(EF_BC3);
+}
+
+TEST(EncodeDecodeTexTest, BatchedEncodeBC4)
+{
+	TestBatchedEncode(EF_BC4);
+}
+
+TEST(EncodeDecodeTexTest, BatchedEncodeBC5)
+{
+	TestBatchedEncode(EF_BC5);
+}
+
+TEST(EncodeDecodeTexTest, EncodeThroughput)
+{
+	BenchmarkEncode(EF_BC1, "BC1");
+	BenchmarkEncode(EF_BC3, "BC3");
+	BenchmarkEncode(EF_BC4, "BC4");
+	BenchmarkEncode(EF_BC5, "BC5");
+	BenchmarkEncode(EF_BC7, "BC7");
+	BenchmarkEncode(EF_ETC1, "ETC1");
+}
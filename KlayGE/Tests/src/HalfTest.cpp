@@ -0,0 +1,181 @@
+/**
+ * @file HalfTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX20/bit.hpp>
+#include <KFL/Half.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint16_t HalfBits(half h)
+	{
+		uint16_t bits;
+		std::memcpy(&bits, &h, sizeof(bits));
+		return bits;
+	}
+
+	half HalfFromBits(uint16_t bits)
+	{
+		half h;
+		std::memcpy(static_cast<void*>(&h), &bits, sizeof(h));
+		return h;
+	}
+}
+
+TEST(HalfTest, ScalarConversion)
+{
+	EXPECT_EQ(0.0f, static_cast<float>(half(0.0f)));
+	EXPECT_EQ(0x8000, HalfBits(half(-0.0f)));
+	EXPECT_EQ(-2.5f, static_cast<float>(-half(2.5f)));
+	EXPECT_EQ(HALF_MIN, static_cast<float>(HalfFromBits(0x0001)));
+	EXPECT_EQ(HALF_MAX, static_cast<float>(half(HALF_MAX)));
+
+	// Ties go to even, overflows go to infinity
+	EXPECT_EQ(0x3C00, HalfBits(half(1 + 1 / 2048.0f)));
+	EXPECT_EQ(0x3C02, HalfBits(half(1 + 3 / 2048.0f)));
+	EXPECT_EQ(0x7BFF, HalfBits(half(65519.0f)));
+	EXPECT_EQ(0x7C00, HalfBits(half(65520.0f)));
+	EXPECT_EQ(0xFC00, HalfBits(half(-1e10f)));
+	EXPECT_TRUE(std::isnan(static_cast<float>(half(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST(HalfTest, BulkMatchesScalar)
+{
+	std::vector<half> halves(65536);
+	for (uint32_t i = 0; i < halves.size(); ++ i)
+	{
+		halves[i] = HalfFromBits(static_cast<uint16_t>(i));
+	}
+
+	std::vector<float> floats(halves.size());
+	HalfToFloat(halves, floats);
+	for (uint32_t i = 0; i < halves.size(); ++ i)
+	{
+		float const expected = static_cast<float>(halves[i]);
+		if (std::isnan(expected))
+		{
+			// Hardware conversions may quiet signaling NaNs
+			EXPECT_TRUE(std::isnan(floats[i]));
+		}
+		else
+		{
+			EXPECT_EQ(std::bit_cast<uint32_t>(expected), std::bit_cast<uint32_t>(floats[i]));
+		}
+	}
+
+	// Odd sizes run both the SIMD loops and the scalar tails
+	std::ranlux24_base gen;
+	std::uniform_int_distribution<uint32_t> dis;
+	floats.resize(100003);
+	for (auto& f : floats)
+	{
+		do
+		{
+			f = std::bit_cast<float>(dis(gen));
+		} while (std::isnan(f));
+	}
+	floats[0] = 65520.0f;
+	floats[1] = 1 + 1 / 2048.0f;
+
+	halves.resize(floats.size());
+	FloatToHalf(floats, halves);
+	for (uint32_t i = 0; i < floats.size(); ++ i)
+	{
+		EXPECT_EQ(HalfBits(half(floats[i])), HalfBits(halves[i]));
+	}
+}
+
+TEST(HalfTest, BulkThroughput)
+{
+	uint32_t const num = 4 * 1024 * 1024;
+	uint32_t const num_iters = 16;
+
+	std::vector<float> floats(num);
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		floats[i] = std::sin(i * 0.001f) * 1000;
+	}
+	std::vector<half> halves(num);
+
+	Timer timer;
+	for (uint32_t iter = 0; iter < num_iters; ++ iter)
+	{
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			halves[i] = half(floats[i]);
+		}
+	}
+	double const scalar_to_half_time = timer.elapsed();
+
+	timer.restart();
+	for (uint32_t iter = 0; iter < num_iters; ++ iter)
+	{
+		FloatToHalf(floats, halves);
+	}
+	double const bulk_to_half_time = timer.elapsed();
+
+	timer.restart();
+	for (uint32_t iter = 0; iter < num_iters; ++ iter)
+	{
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			floats[i] = static_cast<float>(halves[i]);
+		}
+	}
+	double const scalar_to_float_time = timer.elapsed();
+
+	timer.restart();
+	for (uint32_t iter = 0; iter < num_iters; ++ iter)
+	{
+		HalfToFloat(halves, floats);
+	}
+	double const bulk_to_float_time = timer.elapsed();
+
+	EXPECT_EQ(HalfBits(half(floats[12345])), HalfBits(halves[12345]));
+
+	// Throughput in GB/s of float data
+	double const gb = static_cast<double>(num) * num_iters * sizeof(float) / 1e9;
+	LogInfo() << "float to half: scalar " << gb / scalar_to_half_time << " GB/s, bulk " << gb / bulk_to_half_time << " GB/s" << std::endl;
+	LogInfo() << "half to float: scalar " << gb / scalar_to_float_time << " GB/s, bulk " << gb / bulk_to_float_time << " GB/s"
+			  << std::endl;
+}
@@ -8,6 +8,11 @@
 
 using namespace testing;
 
+namespace
+{
+	uint32_t test_app_update_result = KlayGE::App3DFramework::URV_Finished;
+}
+
 namespace KlayGE
 {
 	class KlayGETestsApp : public App3DFramework
@@ -26,7 +31,7 @@ namespace KlayGE
 		virtual uint32_t DoUpdate(uint32_t pass) override
 		{
 			KFL_UNUSED(pass);
-			return URV_Finished;
+			return test_app_update_result;
 		}
 	};
 
@@ -58,6 +63,11 @@ namespace KlayGE
 		std::unique_ptr<App3DFramework> app_;
 	};
 
+	void TestAppUpdateResult(uint32_t urv)
+	{
+		test_app_update_result = urv;
+	}
+
 	bool CompareBuffer(GraphicsBuffer& buff0, uint32_t buff0_offset,
 		GraphicsBuffer& buff1, uint32_t buff1_offset,
 		uint32_t num_elems, float tolerance)
@@ -23,6 +23,10 @@ namespace KlayGE
 	bool Compare2D(Texture& tex0, uint32_t tex0_array_index, uint32_t tex0_level, uint32_t tex0_x_offset, uint32_t tex0_y_offset,
 		Texture& tex1, uint32_t tex1_array_index, uint32_t tex1_level, uint32_t tex1_x_offset, uint32_t tex1_y_offset,
 		uint32_t width, uint32_t height, float tolerance);
+
+	// What DoUpdate of the test app returns, App3DFramework::URV_Finished by default. Set URV_NeedFlush too to render the scene
+	//  in SceneManager::Update, and set it back when done.
+	void TestAppUpdateResult(uint32_t urv);
 }
 
 #endif	// KLAYGE_TESTS_HPP
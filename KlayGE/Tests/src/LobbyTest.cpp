@@ -0,0 +1,238 @@
+/**
+ * @file LobbyTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Lobby.hpp>
+#include <KlayGE/NetMsg.hpp>
+#include <KlayGE/Socket.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t constexpr NUM_PLAYERS = 1000;
+	// Requests in flight at once, to stay under the receive buffer of the lobby
+	uint32_t constexpr WINDOW_SIZE = 100;
+
+	char constexpr MSG_CHAT = MSG_NOP + 1;
+	uint32_t constexpr CHAT_SIZE = 16;
+
+	// Relays every chat message to all the players
+	class RelayProcessor : public Processor
+	{
+	public:
+		explicit RelayProcessor(Lobby& lobby)
+			: lobby_(lobby)
+		{
+		}
+
+		void OnDefault(void* revBuf, int maxSize, void* sendBuf, int& numSend, sockaddr_in& from) const override
+		{
+			KFL_UNUSED(maxSize);
+			KFL_UNUSED(sendBuf);
+			KFL_UNUSED(numSend);
+			KFL_UNUSED(from);
+
+			if (MSG_CHAT == static_cast<char*>(revBuf)[0])
+			{
+				lobby_.Broadcast(revBuf, CHAT_SIZE);
+			}
+		}
+
+	private:
+		Lobby& lobby_;
+	};
+
+	// Counts the messages of a type arriving at the players, until there are expected ones or nothing comes for a while
+	uint32_t ReceiveAll(SocketPoller& poller, std::vector<Socket>& players, char type, uint32_t expected,
+		std::vector<uint32_t>* player_ids = nullptr)
+	{
+		uint32_t ret = 0;
+		uint32_t ready_ids[64];
+		while (ret < expected)
+		{
+			uint32_t const num_ready = poller.Wait(ready_ids, 500);
+			if (num_ready == 0)
+			{
+				break;
+			}
+
+			for (uint32_t i = 0; i < num_ready; ++ i)
+			{
+				char buf[Max_Buffer];
+				int const size = players[ready_ids[i]].Receive(buf, sizeof(buf));
+				if ((size > 0) && (buf[0] == type))
+				{
+					if (player_ids != nullptr)
+					{
+						std::memcpy(&(*player_ids)[ready_ids[i]], &buf[1], sizeof(uint32_t));
+					}
+					++ ret;
+				}
+			}
+		}
+		return ret;
+	}
+}
+
+TEST(LobbyTest, MessagesPerSecond)
+{
+	Lobby lobby;
+	RelayProcessor const processor(lobby);
+	// On a port the system picks, so the test doesn't clash with anything else running
+	std::thread server([&lobby, &processor] { lobby.Create("Benchmark", NUM_PLAYERS, 0, processor); });
+	while (lobby.Port() == 0)
+	{
+		std::this_thread::yield();
+	}
+	uint16_t const port = lobby.Port();
+
+	SocketPoller poller;
+	std::vector<Socket> players(NUM_PLAYERS);
+	for (uint32_t i = 0; i < NUM_PLAYERS; ++ i)
+	{
+		players[i].Create(SOCK_DGRAM);
+		players[i].Connect(TransAddr("127.0.0.1", port));
+		poller.Add(players[i], i);
+	}
+
+	// Messages dropped by a full receive buffer are sent again
+	std::vector<uint32_t> player_ids(NUM_PLAYERS, 0);
+	for (uint32_t retry = 0; retry < 10; ++ retry)
+	{
+		uint32_t num_joining = 0;
+		for (uint32_t i = 0; i < NUM_PLAYERS; ++ i)
+		{
+			if (player_ids[i] == 0)
+			{
+				char buf[1 + 16] = {MSG_JOIN};
+				std::string const name = "Player" + std::to_string(i);
+				name.copy(&buf[1], name.size());
+				players[i].Send(buf, sizeof(buf));
+				++ num_joining;
+
+				if (num_joining % WINDOW_SIZE == 0)
+				{
+					ReceiveAll(poller, players, MSG_JOIN, WINDOW_SIZE, &player_ids);
+				}
+			}
+		}
+		if (num_joining == 0)
+		{
+			break;
+		}
+		ReceiveAll(poller, players, MSG_JOIN, num_joining % WINDOW_SIZE, &player_ids);
+	}
+	// Counted by the replies, the lobby belongs to the server thread
+	auto const num_joined = std::count_if(player_ids.begin(), player_ids.end(), [](uint32_t id) { return id != 0; });
+	EXPECT_EQ(NUM_PLAYERS, static_cast<uint32_t>(num_joined));
+
+	// Request and reply
+	uint32_t constexpr NUM_ROUNDS = 10;
+	uint32_t num_replies = 0;
+	Timer timer;
+	for (uint32_t round = 0; round < NUM_ROUNDS; ++ round)
+	{
+		for (uint32_t i = 0; i < NUM_PLAYERS; i += WINDOW_SIZE)
+		{
+			for (uint32_t j = i; j < i + WINDOW_SIZE; ++ j)
+			{
+				char const msg = MSG_GETLOBBYINFO;
+				players[j].Send(&msg, sizeof(msg));
+			}
+			num_replies += ReceiveAll(poller, players, MSG_GETLOBBYINFO, WINDOW_SIZE);
+		}
+	}
+	double const reply_time = timer.elapsed();
+	EXPECT_GT(num_replies, 0U);
+
+	// Every chat message goes to all the players
+	uint32_t constexpr NUM_CHATS_PER_ROUND = 10;
+	uint32_t num_deliveries = 0;
+	timer.restart();
+	for (uint32_t round = 0; round < NUM_ROUNDS; ++ round)
+	{
+		for (uint32_t i = 0; i < NUM_CHATS_PER_ROUND; ++ i)
+		{
+			char msg[CHAT_SIZE] = {MSG_CHAT};
+			players[round * NUM_CHATS_PER_ROUND + i].Send(msg, sizeof(msg));
+		}
+		num_deliveries += ReceiveAll(poller, players, MSG_CHAT, NUM_CHATS_PER_ROUND * NUM_PLAYERS);
+	}
+	double const broadcast_time = timer.elapsed();
+	EXPECT_GT(num_deliveries, 0U);
+
+	lobby.Close();
+	server.join();
+
+	LogInfo() << NUM_PLAYERS << " players: " << num_replies << " of " << NUM_ROUNDS * NUM_PLAYERS << " replies, "
+			  << num_replies / reply_time << " replies per second; " << num_deliveries << " of "
+			  << NUM_ROUNDS * NUM_CHATS_PER_ROUND * NUM_PLAYERS << " broadcast messages, " << num_deliveries / broadcast_time
+			  << " per second" << std::endl;
+}
+
+TEST(LobbyTest, OversizedMessages)
+{
+	char buf[Max_Buffer + 1] = {MSG_CHAT};
+
+	NetMsgBufferPool pool;
+	EXPECT_EQ(nullptr, pool.Allocate(buf, Max_Buffer + 1));
+	NetMsgBuffer* msg = pool.Allocate(buf, Max_Buffer);
+	ASSERT_NE(nullptr, msg);
+	EXPECT_EQ(Max_Buffer, msg->size);
+	pool.Release(msg);
+
+	Lobby lobby;
+	EXPECT_FALSE(lobby.Broadcast(buf, Max_Buffer + 1));
+	EXPECT_FALSE(lobby.Broadcast(buf, -1));
+	EXPECT_TRUE(lobby.Broadcast(buf, Max_Buffer));
+}
+
+// Close can come before the server thread gets to Create, the loop must not start then
+TEST(LobbyTest, CloseBeforeCreate)
+{
+	Lobby lobby;
+	RelayProcessor const processor(lobby);
+	lobby.Close();
+	std::thread server([&lobby, &processor] { lobby.Create("Closed", 1, 0, processor); });
+	server.join();
+	EXPECT_EQ(0, lobby.Port());
+}
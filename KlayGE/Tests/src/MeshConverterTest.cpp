@@ -32,8 +32,10 @@
 #include <KlayGE/Context.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/ResLoader.hpp>
+#include <KlayGE/SceneNode.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Timer.hpp>
 #include <KlayGE/Mesh.hpp>
 #include <KlayGE/DevHelper/MeshConverter.hpp>
 #include <KlayGE/DevHelper/MeshMetadata.hpp>
@@ -761,6 +763,70 @@ public:
 			EXPECT_EQ(skinned_model.FrameRate(), sanity_skinned_model.FrameRate());
 		}
 	}
+
+	void RunLoadTimeTest(std::string_view metadata_name, std::string_view output_name)
+	{
+		MeshMetadata metadata(metadata_name);
+
+		MeshConverter mc;
+		auto model = mc.Load(metadata);
+		ASSERT_TRUE(model);
+
+		std::string const legacy_name = std::string(output_name) + "_v19.model_bin";
+		std::string const chunked_name = std::string(output_name) + "_v20.model_bin";
+		SaveLegacyModel(*model, legacy_name);
+		SaveModel(*model, chunked_name);
+
+		uint32_t const num_iterations = 20;
+		auto measure = [num_iterations](std::string const& name) {
+			double min_time = 1e10;
+			for (uint32_t i = 0; i < num_iterations; ++ i)
+			{
+				Timer timer;
+				auto loaded = LoadSoftwareModel(name);
+				min_time = std::min(min_time, timer.elapsed());
+				EXPECT_TRUE(loaded);
+			}
+			return min_time;
+		};
+
+		double const legacy_time = measure(legacy_name);
+		double const chunked_time = measure(chunked_name);
+		LogInfo() << output_name << ": v19 " << legacy_time * 1000 << " ms, v20 " << chunked_time * 1000 << " ms" << std::endl;
+
+		auto legacy_model = LoadSoftwareModel(legacy_name);
+		auto chunked_model = LoadSoftwareModel(chunked_name);
+		EXPECT_EQ(chunked_model->NumMeshes(), legacy_model->NumMeshes());
+		for (uint32_t i = 0; i < legacy_model->NumMeshes(); ++ i)
+		{
+			auto const& legacy_mesh = checked_cast<StaticMesh&>(*legacy_model->Mesh(i));
+			auto const& chunked_mesh = checked_cast<StaticMesh&>(*chunked_model->Mesh(i));
+			EXPECT_EQ(chunked_mesh.NumLods(), legacy_mesh.NumLods());
+
+			auto const& legacy_rl = legacy_mesh.GetRenderLayout();
+			auto const& chunked_rl = chunked_mesh.GetRenderLayout();
+			EXPECT_EQ(chunked_rl.NumVertexStreams(), legacy_rl.NumVertexStreams());
+			for (uint32_t j = 0; j < legacy_rl.NumVertexStreams(); ++ j)
+			{
+				auto& legacy_vb = *legacy_rl.GetVertexStream(j);
+				auto& chunked_vb = *chunked_rl.GetVertexStream(j);
+				ASSERT_EQ(chunked_vb.Size(), legacy_vb.Size());
+
+				GraphicsBuffer::Mapper legacy_mapper(legacy_vb, BA_Read_Only);
+				GraphicsBuffer::Mapper chunked_mapper(chunked_vb, BA_Read_Only);
+				EXPECT_EQ(std::memcmp(chunked_mapper.Pointer<uint8_t>(), legacy_mapper.Pointer<uint8_t>(), legacy_vb.Size()), 0);
+			}
+		}
+
+		if (legacy_model->IsSkinned())
+		{
+			auto const& legacy_skinned_model = checked_cast<SkinnedModel&>(*legacy_model);
+			auto const& chunked_skinned_model = checked_cast<SkinnedModel&>(*chunked_model);
+			EXPECT_EQ(chunked_skinned_model.NumFrames(), legacy_skinned_model.NumFrames());
+			EXPECT_EQ(chunked_skinned_model.NumAnimations(), legacy_skinned_model.NumAnimations());
+			EXPECT_EQ(chunked_skinned_model.GetKeyFrameSets()->size(), legacy_skinned_model.GetKeyFrameSets()->size());
+		}
+	}
 };
 
 TEST_F(MeshConverterTest, StaticNoLod)
@@ -797,3 +863,36 @@ TEST_F(MeshConverterTest, StaticMeshML)
 {
 	RunTest("tree2a.lod.meshml", "", "tree2a.lod.meshml");
 }
+
+TEST_F(MeshConverterTest, StaticLoadTime)
+{
+	RunLoadTimeTest("tree2a.lod.kmeta", "tree2a_lod");
+}
+
+TEST_F(MeshConverterTest, AnimationLoadTime)
+{
+	RunLoadTimeTest("anim.fbx.kmeta", "anim");
+}
+
+TEST_F(MeshConverterTest, LegacyModelSyncLoad)
+{
+	MeshMetadata metadata("tree2a.lod.kmeta");
+
+	MeshConverter mc;
+	auto model = mc.Load(metadata);
+	ASSERT_TRUE(model);
+
+	// No source file next to it, so the v19 runtime file has to be taken as is
+	SaveLegacyModel(*model, "tree2a_lod_legacy.model_bin");
+	auto legacy_model = SyncLoadModel("tree2a_lod_legacy", EAH_GPU_Read | EAH_Immutable, SceneNode::SOA_Cullable);
+	ASSERT_TRUE(legacy_model);
+
+	EXPECT_EQ(legacy_model->NumMeshes(), model->NumMeshes());
+	for (uint32_t i = 0; i < model->NumMeshes(); ++ i)
+	{
+		auto const& mesh = checked_cast<StaticMesh&>(*model->Mesh(i));
+		auto const& legacy_mesh = checked_cast<StaticMesh&>(*legacy_model->Mesh(i));
+		EXPECT_EQ(legacy_mesh.NumLods(), mesh.NumLods());
+		EXPECT_EQ(legacy_mesh.Name(), mesh.Name());
+	}
+}
@@ -0,0 +1,201 @@
+/**
+ * @file OCTreeTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/App3D.hpp>
+#include <KlayGE/Camera.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/Renderable.hpp>
+#include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
+#include <KlayGE/OCTree/OCTree.hpp>
+
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	SceneNodePtr AddBox(SceneNode& parent, float3 const & pos, float size, uint32_t attrib)
+	{
+		auto renderable = MakeSharedPtr<Renderable>(L"Box");
+		renderable->PosBound(AABBox(float3(0, 0, 0), float3(size, size, size)));
+		auto node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(renderable), attrib);
+		node->TransformToParent(MathLib::translation(pos));
+		parent.AddChild(node);
+		return node;
+	}
+
+	// Only the inline members can be used, the class lives in the plugin
+	OCTree const * SceneOCTree()
+	{
+		auto& context = Context::Instance();
+		if (context.Config().scene_manager_name == "OCTree")
+		{
+			return &static_cast<OCTree const &>(context.SceneManagerInstance());
+		}
+		return nullptr;
+	}
+
+	// A whole frame, so the nodes get their first updates and the scene is clipped by the active camera
+	void RenderFrame()
+	{
+		TestAppUpdateResult(App3DFramework::URV_NeedFlush | App3DFramework::URV_Finished);
+		Context::Instance().SceneManagerInstance().Update();
+		TestAppUpdateResult(App3DFramework::URV_Finished);
+	}
+
+	void CheckAgainstBruteForce(std::vector<SceneNodePtr> const & nodes)
+	{
+		auto const & frustum = Context::Instance().AppInstance().ActiveCamera().ViewFrustum();
+
+		size_t num_visible = 0;
+		for (auto const & node : nodes)
+		{
+			bool const visible = (frustum.Intersect(node->PosBoundWS()) != BoundOverlap::No);
+			EXPECT_EQ(visible, node->VisibleMark(0) != BoundOverlap::No);
+			if (visible)
+			{
+				++ num_visible;
+			}
+		}
+
+		// Both sides of the frustum are covered
+		EXPECT_GT(num_visible, 0U);
+		EXPECT_LT(num_visible, nodes.size());
+	}
+}
+
+TEST(OCTreeTest, MatchesBruteForce)
+{
+	OCTree const * octree = SceneOCTree();
+	if (octree == nullptr)
+	{
+		return;
+	}
+
+	auto& root = Context::Instance().SceneManagerInstance().SceneRootNode();
+
+	auto& camera = Context::Instance().AppInstance().ActiveCamera();
+	camera.BoundSceneNode()->TransformToWorld(
+		MathLib::inverse(MathLib::look_at_lh(float3(0, 0, -150), float3(0, 0, 0), float3(0, 1, 0))));
+	camera.ProjParams(PI / 4, 1, 1, 400);
+
+	// What other tests left in the scene gets its first update
+	RenderFrame();
+
+	std::ranlux24_base gen;
+	std::uniform_real_distribution<float> pos_dis(-100, 100);
+	std::uniform_real_distribution<float> size_dis(0.5f, 4);
+
+	// Every 4th box is moveable
+	uint32_t const num_boxes = 500;
+	std::vector<SceneNodePtr> nodes;
+	std::vector<float3> positions;
+	for (uint32_t i = 0; i < num_boxes; ++ i)
+	{
+		float3 const pos(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+		nodes.push_back(AddBox(root, pos, size_dis(gen), SceneNode::SOA_Cullable | ((i % 4 == 0) ? SceneNode::SOA_Moveable : 0)));
+		positions.push_back(pos);
+	}
+
+	RenderFrame();
+	EXPECT_EQ(num_boxes, octree->FrameStats().num_inserted);
+	EXPECT_EQ(0U, octree->FrameStats().num_removed);
+	EXPECT_EQ(0U, octree->FrameStats().num_pending_objects);
+	CheckAgainstBruteForce(nodes);
+
+	// Nothing changes, nothing is touched
+	RenderFrame();
+	EXPECT_EQ(0U, octree->FrameStats().num_inserted);
+	EXPECT_EQ(0U, octree->FrameStats().num_removed);
+	EXPECT_EQ(0U, octree->FrameStats().num_moved);
+	EXPECT_EQ(0U, octree->FrameStats().num_rebuilds);
+	CheckAgainstBruteForce(nodes);
+
+	// Static and moveable boxes jumping to the other side leave their cells
+	uint32_t const num_moved = 40;
+	for (uint32_t i = 0; i < num_moved; ++ i)
+	{
+		positions[i] = -positions[i];
+		nodes[i]->TransformToParent(MathLib::translation(positions[i]));
+	}
+	RenderFrame();
+	EXPECT_GT(octree->FrameStats().num_moved, 0U);
+	EXPECT_LE(octree->FrameStats().num_moved, num_moved);
+	EXPECT_EQ(0U, octree->FrameStats().num_inserted);
+	EXPECT_EQ(0U, octree->FrameStats().num_removed);
+	CheckAgainstBruteForce(nodes);
+
+	// Removed ones, and the ones removed and added back in the same frame
+	uint32_t const num_removed = 100;
+	for (uint32_t i = num_boxes - num_removed; i < num_boxes; ++ i)
+	{
+		root.RemoveChild(nodes[i]);
+	}
+	nodes.resize(num_boxes - num_removed);
+	for (uint32_t i = 100; i < 110; ++ i)
+	{
+		root.RemoveChild(nodes[i]);
+		root.AddChild(nodes[i]);
+	}
+	RenderFrame();
+	EXPECT_EQ(num_removed + 10, octree->FrameStats().num_removed);
+	EXPECT_EQ(10U, octree->FrameStats().num_inserted);
+	CheckAgainstBruteForce(nodes);
+
+	// A sub-tree comes and goes as a whole
+	auto parent = MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable);
+	std::vector<SceneNodePtr> children;
+	for (uint32_t i = 0; i < 20; ++ i)
+	{
+		children.push_back(AddBox(*parent, float3(pos_dis(gen), pos_dis(gen), pos_dis(gen)), size_dis(gen), SceneNode::SOA_Cullable));
+	}
+	root.AddChild(parent);
+	RenderFrame();
+	EXPECT_EQ(21U, octree->FrameStats().num_inserted);
+	EXPECT_EQ(0U, octree->FrameStats().num_pending_objects);
+
+	root.RemoveChild(parent);
+	RenderFrame();
+	EXPECT_EQ(21U, octree->FrameStats().num_removed);
+
+	for (auto const & node : nodes)
+	{
+		root.RemoveChild(node);
+	}
+	RenderFrame();
+	EXPECT_EQ(0U, octree->FrameStats().num_pending_objects);
+}
@@ -0,0 +1,225 @@
+/**
+ * @file ParticleSystemTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Camera.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/FrameBuffer.hpp>
+#include <KlayGE/ParticleSystem.hpp>
+#include <KlayGE/RenderEngine.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/SceneNode.hpp>
+
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	ParticleSystemPtr MakeTestParticleSystem(uint32_t max_num_particles, bool sort_particles)
+	{
+		auto ps = MakeSharedPtr<ParticleSystem>(max_num_particles, sort_particles);
+		ps->MediaDensity(0.5f);
+		ps->Force(float3(1, 0, 0.5f));
+
+		auto updater = checked_pointer_cast<PolylineParticleUpdater>(ps->MakeUpdater("polyline"));
+		updater->SizeOverLife({float2(0, 1), float2(0.5f, 2), float2(1, 0.5f)});
+		updater->MassOverLife({float2(0, 1), float2(1, 3)});
+		updater->OpacityOverLife({float2(0, 1), float2(0.8f, 0.5f), float2(1, 0)});
+		ps->AddUpdater(updater);
+
+		return ps;
+	}
+
+	void AddTestEmitter(ParticleSystem& ps, float freq)
+	{
+		auto emitter = ps.MakeEmitter("point");
+		emitter->Frequency(freq);
+		emitter->EmitAngle(PI / 3);
+		emitter->MinPosition(float3(-10, -10, -10));
+		emitter->MaxPosition(float3(+10, +10, +10));
+		emitter->MinVelocity(1);
+		emitter->MaxVelocity(2);
+		emitter->MinLife(5);
+		emitter->MaxLife(10);
+		emitter->MinSize(0.1f);
+		emitter->MaxSize(0.2f);
+		ps.AddEmitter(emitter);
+	}
+
+	float DepthES(Particle const & par)
+	{
+		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		float4x4 const & view_mat = re.DefaultFrameBuffer()->Viewport()->Camera()->ViewMatrix();
+		float4 const pos4(par.pos.x(), par.pos.y(), par.pos.z(), 1);
+		return MathLib::dot(pos4, view_mat.Col(2)) / MathLib::dot(pos4, view_mat.Col(3));
+	}
+}
+
+TEST(ParticleSystemTest, UpdaterMatchesScalar)
+{
+	auto ps = MakeTestParticleSystem(16, false);
+	auto& updater = *ps->Updater(0);
+	updater.SnapParams();
+
+	// Not a multiple of 8, to cover the scalar tail. Some particles are dead and have to stay untouched.
+	uint32_t const num = 1003;
+	ParticleStore batched;
+	batched.Resize(num);
+
+	std::mt19937 gen;
+	std::uniform_real_distribution<float> pos_dist(-10, 10);
+	std::uniform_real_distribution<float> life_dist(1, 10);
+	std::uniform_real_distribution<float> age_dist(-0.2f, 1);
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		Particle par;
+		par.pos = float3(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+		par.vel = float3(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+		par.init_life = life_dist(gen);
+		par.life = par.init_life * age_dist(gen);
+		par.spin = pos_dist(gen);
+		par.size = 1;
+		par.alpha = 1;
+		batched.Set(i, par);
+	}
+
+	// Spans of 1 particle only run the scalar path
+	ParticleStore single = batched;
+	updater.Update(batched.Span(0, num), 0.1f);
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		updater.Update(single.Span(i, 1), 0.1f);
+	}
+
+	auto expect_near = [](float lhs, float rhs) { EXPECT_NEAR(lhs, rhs, 1e-5f * (1 + MathLib::abs(rhs))); };
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		Particle const lhs = batched.Get(i);
+		Particle const rhs = single.Get(i);
+		for (uint32_t j = 0; j < 3; ++ j)
+		{
+			expect_near(lhs.pos[j], rhs.pos[j]);
+			expect_near(lhs.vel[j], rhs.vel[j]);
+		}
+		EXPECT_EQ(lhs.life, rhs.life);
+		EXPECT_EQ(lhs.spin, rhs.spin);
+		expect_near(lhs.size, rhs.size);
+		expect_near(lhs.alpha, rhs.alpha);
+	}
+}
+
+TEST(ParticleSystemTest, Emission)
+{
+	auto ps = MakeTestParticleSystem(64, false);
+	AddTestEmitter(*ps, 100);
+
+	ps->RootNode()->SubThreadUpdate(0, 0.1f);
+	ASSERT_EQ(10U, ps->NumActiveParticles());
+	for (uint32_t i = 0; i < ps->NumActiveParticles(); ++ i)
+	{
+		Particle const par = ps->GetParticle(ps->GetActiveParticleIndex(i));
+		EXPECT_GE(par.life, 5);
+		EXPECT_LE(par.life, 10);
+		EXPECT_EQ(par.init_life, par.life);
+		for (uint32_t j = 0; j < 3; ++ j)
+		{
+			EXPECT_GE(par.pos[j], -10);
+			EXPECT_LE(par.pos[j], +10);
+		}
+
+		// Initialized by the updater at the beginning of the life
+		EXPECT_FLOAT_EQ(1, par.size);
+		EXPECT_FLOAT_EQ(1, par.alpha);
+	}
+
+	// More than the free slots
+	ps->RootNode()->SubThreadUpdate(0, 1);
+	EXPECT_EQ(64U, ps->NumActiveParticles());
+}
+
+TEST(ParticleSystemTest, SortBackToFront)
+{
+	// More than one update chunk
+	auto ps = MakeTestParticleSystem(5000, true);
+	AddTestEmitter(*ps, 50000);
+
+	ps->RootNode()->SubThreadUpdate(0, 0.1f);
+	ASSERT_EQ(5000U, ps->NumActiveParticles());
+
+	float last_depth = DepthES(ps->GetParticle(ps->GetActiveParticleIndex(0)));
+	for (uint32_t i = 1; i < ps->NumActiveParticles(); ++ i)
+	{
+		float const depth = DepthES(ps->GetParticle(ps->GetActiveParticleIndex(i)));
+		EXPECT_LE(depth, last_depth);
+		last_depth = depth;
+	}
+}
+
+// A benchmark rather than a test, run it with --gtest_also_run_disabled_tests
+TEST(ParticleSystemTest, DISABLED_MillionParticles)
+{
+	uint32_t const num = 1U << 20;
+	auto ps = MakeTestParticleSystem(num, true);
+
+	std::mt19937 gen;
+	std::uniform_real_distribution<float> pos_dist(-100, 100);
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		Particle par;
+		par.pos = float3(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+		par.vel = float3(0, 1, 0);
+		par.init_life = 2e6f;
+		par.life = 1e6f;
+		par.spin = 0;
+		par.size = 1;
+		par.alpha = 1;
+		ps->SetParticle(i, par);
+	}
+
+	ps->RootNode()->SubThreadUpdate(0, 0.01f);
+	EXPECT_EQ(num, ps->NumActiveParticles());
+
+	uint32_t const num_frames = 10;
+	Timer timer;
+	for (uint32_t i = 0; i < num_frames; ++ i)
+	{
+		ps->RootNode()->SubThreadUpdate(0, 0.01f);
+	}
+	double const update_time = timer.elapsed() / num_frames;
+
+	LogInfo() << num << " particles: " << update_time * 1000 << " ms to update and sort" << std::endl;
+}
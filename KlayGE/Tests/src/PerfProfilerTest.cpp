@@ -0,0 +1,226 @@
+/**
+ * @file PerfProfilerTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/PerfProfiler.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	class PerfProfilerEnabler
+	{
+	public:
+		PerfProfilerEnabler()
+		{
+			auto cfg = Context::Instance().Config();
+			old_enabled_ = cfg.perf_profiler;
+			cfg.perf_profiler = true;
+			Context::Instance().Config(cfg);
+		}
+
+		~PerfProfilerEnabler()
+		{
+			auto cfg = Context::Instance().Config();
+			cfg.perf_profiler = old_enabled_;
+			Context::Instance().Config(cfg);
+		}
+
+	private:
+		bool old_enabled_;
+	};
+}
+
+TEST(PerfProfilerTest, NestedScopes)
+{
+	PerfProfilerEnabler enabler;
+
+	auto* track = PerfProfiler::Instance().CurrentThreadTrack();
+	uint64_t const since = PerfProfiler::Now();
+	{
+		PerfScope outer("Outer");
+		EXPECT_EQ(1U, track->Depth());
+		{
+			PerfScope inner("Inner");
+			EXPECT_EQ(2U, track->Depth());
+		}
+	}
+	EXPECT_EQ(0U, track->Depth());
+
+	std::vector<PerfZoneEvent> events;
+	track->Snapshot(events, since);
+	ASSERT_EQ(2U, events.size());
+	EXPECT_STREQ("Inner", events[0].name);
+	EXPECT_EQ(1U, events[0].depth);
+	EXPECT_STREQ("Outer", events[1].name);
+	EXPECT_EQ(0U, events[1].depth);
+	EXPECT_LE(events[1].begin_ns, events[0].begin_ns);
+	EXPECT_GE(events[1].end_ns, events[0].end_ns);
+}
+
+TEST(PerfProfilerTest, RingIsBounded)
+{
+	PerfProfilerEnabler enabler;
+
+	auto* track = PerfProfiler::Instance().CurrentThreadTrack();
+	for (uint32_t i = 0; i < PerfThreadTrack::RING_SIZE * 2; ++ i)
+	{
+		PerfScope scope("Repeated");
+	}
+
+	std::vector<PerfZoneEvent> events;
+	track->Snapshot(events, 0);
+	EXPECT_LT(events.size(), PerfThreadTrack::RING_SIZE);
+	EXPECT_GT(events.size(), PerfThreadTrack::RING_SIZE / 2);
+}
+
+TEST(PerfProfilerTest, ExportChromeTrace)
+{
+	PerfProfilerEnabler enabler;
+
+	auto& profiler = PerfProfiler::Instance();
+	profiler.CollectData();
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 2; ++ i)
+	{
+		threads.emplace_back([&profiler, i]
+			{
+				profiler.ThreadName("Worker " + std::to_string(i));
+				PerfScope scope("WorkerZone");
+			});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	{
+		PerfScope scope("MainZone");
+	}
+
+	profiler.CollectData();
+	auto const trace_path = FILESYSTEM_NS::temp_directory_path() / "KlayGE_perf_trace.json";
+	profiler.ExportToChromeTrace(trace_path.string());
+
+	std::string trace;
+	{
+		std::ifstream ifs(trace_path);
+		std::stringstream ss;
+		ss << ifs.rdbuf();
+		trace = ss.str();
+	}
+	FILESYSTEM_NS::remove(trace_path);
+
+	EXPECT_EQ(0U, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	EXPECT_NE(std::string::npos, trace.find("\"name\":\"Worker 0\""));
+	EXPECT_NE(std::string::npos, trace.find("\"name\":\"Worker 1\""));
+	EXPECT_NE(std::string::npos, trace.find("\"name\":\"WorkerZone\""));
+	EXPECT_NE(std::string::npos, trace.find("\"name\":\"MainZone\""));
+	EXPECT_NE(std::string::npos, trace.find("\"name\":\"GPU\""));
+	EXPECT_EQ(trace.size() - 4, trace.rfind("\n]}\n"));
+}
+
+TEST(PerfProfilerTest, SnapshotWhilePushing)
+{
+	PerfProfilerEnabler enabler;
+
+	std::atomic<bool> done{false};
+	std::atomic<PerfThreadTrack*> writer_track{nullptr};
+	std::thread writer([&done, &writer_track]
+		{
+			writer_track = PerfProfiler::Instance().CurrentThreadTrack();
+			while (!done)
+			{
+				PerfScope scope("Writer");
+			}
+		});
+	while (writer_track == nullptr)
+	{
+		std::this_thread::yield();
+	}
+
+	bool consistent = true;
+	std::vector<PerfZoneEvent> events;
+	for (uint32_t i = 0; i < 1000; ++ i)
+	{
+		events.clear();
+		writer_track.load()->Snapshot(events, 0);
+		for (size_t j = 0; j < events.size(); ++ j)
+		{
+			consistent &= (events[j].begin_ns <= events[j].end_ns);
+			consistent &= ((j == 0) || (events[j - 1].end_ns <= events[j].begin_ns));
+		}
+	}
+	done = true;
+	writer.join();
+
+	EXPECT_TRUE(consistent);
+}
+
+TEST(PerfProfilerTest, Overhead)
+{
+	uint32_t constexpr NUM_SCOPES = 100000;
+
+	auto measure = [] {
+		Timer timer;
+		for (uint32_t i = 0; i < NUM_SCOPES; ++ i)
+		{
+			PerfScope scope("Overhead");
+		}
+		return timer.elapsed() / NUM_SCOPES;
+	};
+
+	double const disabled_time = measure();
+	double enabled_time;
+	{
+		PerfProfilerEnabler enabler;
+		PerfProfiler::Instance().CurrentThreadTrack();
+		enabled_time = measure();
+	}
+
+	// Generous bound, only to catch a lock or an allocation sneaking into the hot path
+	EXPECT_LT(enabled_time, 2e-6);
+
+	LogInfo() << "PerfScope: " << disabled_time * 1e9 << " ns disabled, " << enabled_time * 1e9 << " ns enabled" << std::endl;
+}
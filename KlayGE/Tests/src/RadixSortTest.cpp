@@ -0,0 +1,115 @@
+/**
+ * @file RadixSortTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/RadixSort.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// The second member records the original position, to check the stability
+	std::vector<std::pair<uint64_t, uint32_t>> RandomItems(uint32_t num_items, uint64_t key_mask)
+	{
+		std::mt19937_64 gen;
+		std::vector<std::pair<uint64_t, uint32_t>> ret(num_items);
+		for (uint32_t i = 0; i < num_items; ++ i)
+		{
+			ret[i] = std::make_pair(gen() & key_mask, i);
+		}
+		return ret;
+	}
+
+	void CheckRadixSort(uint32_t num_items, uint64_t key_mask, TaskScheduler* scheduler)
+	{
+		auto items = RandomItems(num_items, key_mask);
+		auto expected = items;
+		std::stable_sort(expected.begin(), expected.end(),
+			[](std::pair<uint64_t, uint32_t> const& lhs, std::pair<uint64_t, uint32_t> const& rhs) { return lhs.first < rhs.first; });
+
+		std::vector<std::pair<uint64_t, uint32_t>> scratch(items.size());
+		RadixSort(std::span(items), std::span(scratch), [](std::pair<uint64_t, uint32_t> const& item) { return item.first; }, scheduler);
+		EXPECT_EQ(expected, items);
+	}
+}
+
+TEST(RadixSortTest, Sequential)
+{
+	CheckRadixSort(0, ~0ULL, nullptr);
+	CheckRadixSort(1, ~0ULL, nullptr);
+	CheckRadixSort(1000, ~0ULL, nullptr);
+	// Lots of equal keys, and passes to skip
+	CheckRadixSort(1000, 0xF0000000000000F0ULL, nullptr);
+	CheckRadixSort(1000, 0, nullptr);
+}
+
+TEST(RadixSortTest, Parallel)
+{
+	TaskScheduler ts(4);
+
+	CheckRadixSort(100000, ~0ULL, &ts);
+	CheckRadixSort(100000, 0xFFFF00000000FFFFULL, &ts);
+	CheckRadixSort(16385, 0xFFULL, &ts);
+}
+
+// A benchmark rather than a test, run it with --gtest_also_run_disabled_tests
+TEST(RadixSortTest, DISABLED_Throughput)
+{
+	uint32_t const num_items = 1000000;
+	TaskScheduler ts(4);
+
+	auto items = RandomItems(num_items, ~0ULL);
+	auto std_items = items;
+	std::vector<std::pair<uint64_t, uint32_t>> scratch(items.size());
+
+	Timer timer;
+	std::sort(std_items.begin(), std_items.end());
+	double const std_time = timer.elapsed();
+
+	timer.restart();
+	RadixSort(std::span(items), std::span(scratch), [](std::pair<uint64_t, uint32_t> const& item) { return item.first; }, &ts);
+	double const radix_time = timer.elapsed();
+
+	EXPECT_EQ(std_items, items);
+
+	LogInfo() << "Sorting " << num_items << " 64-bit keys: " << std_time * 1000 << " ms by std::sort, " << radix_time * 1000
+			  << " ms by RadixSort" << std::endl;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file RenderEffectTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/RenderEffect.hpp>
+
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+TEST(RenderEffectTest, HandleMatchesName)
+{
+	static_assert(EFFECT_HANDLE("depth_near_far_invfar").NameHash() == CT_HASH("depth_near_far_invfar"));
+	EXPECT_EQ(EFFECT_HANDLE("depth_near_far_invfar"), RenderEffectHandle("depth_near_far_invfar"));
+}
+
+TEST(RenderEffectTest, ParameterAndTechniqueLookup)
+{
+	auto effect = SyncLoadRenderEffect("DeferredRendering.fxml");
+
+	for (uint32_t i = 0; i < effect->NumParameters(); ++ i)
+	{
+		auto* param = effect->ParameterByIndex(i);
+		EXPECT_EQ(param, effect->ParameterByName(param->Name()));
+		EXPECT_EQ(param, effect->ParameterByName(RenderEffectHandle(param->Name())));
+	}
+	for (uint32_t i = 0; i < effect->NumTechniques(); ++ i)
+	{
+		auto* tech = effect->TechniqueByIndex(i);
+		EXPECT_EQ(tech, effect->TechniqueByName(tech->Name()));
+		EXPECT_EQ(tech, effect->TechniqueByName(RenderEffectHandle(tech->Name())));
+	}
+
+	EXPECT_EQ(nullptr, effect->ParameterByName("no_such_param"));
+	EXPECT_EQ(nullptr, effect->ParameterByName(EFFECT_HANDLE("no_such_param")));
+	EXPECT_EQ(nullptr, effect->TechniqueByName(EFFECT_HANDLE("NoSuchTech")));
+
+	auto cloned = effect->Clone();
+	for (uint32_t i = 0; i < cloned->NumParameters(); ++ i)
+	{
+		auto* param = cloned->ParameterByIndex(i);
+		EXPECT_EQ(param, cloned->ParameterByName(RenderEffectHandle(param->Name())));
+	}
+}
+
+TEST(RenderEffectTest, BindingCostPerDraw)
+{
+	auto effect = SyncLoadRenderEffect("DeferredRendering.fxml");
+
+	std::vector<std::string> names;
+	std::vector<RenderEffectHandle> handles;
+	for (uint32_t i = 0; i < effect->NumParameters(); ++ i)
+	{
+		auto const& name = effect->ParameterByIndex(i)->Name();
+		names.push_back(name);
+		handles.emplace_back(name);
+	}
+	ASSERT_FALSE(names.empty());
+
+	// Every draw looks up a handful of parameters, the same way a renderable binds its per-draw data
+	uint32_t const num_draws = 100000;
+	uint32_t const params_per_draw = 8;
+
+	size_t string_hits = 0;
+	Timer timer;
+	for (uint32_t draw = 0; draw < num_draws; ++ draw)
+	{
+		for (uint32_t p = 0; p < params_per_draw; ++ p)
+		{
+			string_hits += (effect->ParameterByName(names[(draw + p) % names.size()]) != nullptr);
+		}
+	}
+	double const string_time = timer.elapsed();
+
+	size_t handle_hits = 0;
+	timer.restart();
+	for (uint32_t draw = 0; draw < num_draws; ++ draw)
+	{
+		for (uint32_t p = 0; p < params_per_draw; ++ p)
+		{
+			handle_hits += (effect->ParameterByName(handles[(draw + p) % handles.size()]) != nullptr);
+		}
+	}
+	double const handle_time = timer.elapsed();
+
+	EXPECT_EQ(num_draws * params_per_draw, string_hits);
+	EXPECT_EQ(num_draws * params_per_draw, handle_hits);
+
+	LogInfo() << "Binding " << params_per_draw << " parameters per draw, " << effect->NumParameters() << " parameters in effect: "
+			  << string_time / num_draws * 1e9 << " ns by name, " << handle_time / num_draws * 1e9 << " ns by handle" << std::endl;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file RenderGraphTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/RenderGraph.hpp>
+#include <KlayGE/Texture.hpp>
+
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	RenderGraph::TextureDesc MakeDesc(uint32_t width, uint32_t height, ElementFormat format)
+	{
+		return {width, height, 1, 1, format, 1, 0, EAH_GPU_Read | EAH_GPU_Write};
+	}
+}
+
+TEST(RenderGraphTest, UntouchedTextures)
+{
+	RenderGraph graph;
+	uint32_t const output = graph.ImportTexture("output", TexturePtr());
+	uint32_t const a = graph.AddTexture("a", MakeDesc(256, 256, EF_ABGR8));
+	uint32_t const never_read = graph.AddTexture("never_read", MakeDesc(256, 256, EF_ABGR8));
+	uint32_t const untouched = graph.AddTexture("untouched", MakeDesc(256, 256, EF_ABGR8));
+
+	graph.AddPass("WriteA", {}, MakeSpan(&a, 1));
+	graph.AddPass("WriteNeverRead", MakeSpan(&a, 1), MakeSpan(&never_read, 1));
+	graph.AddPass("Present", MakeSpan(&a, 1), MakeSpan(&output, 1));
+	graph.Compile();
+
+	// A texture that is written but never read still lives while its pass runs, and overlaps a
+	EXPECT_NE(RenderGraph::InvalidIndex, graph.PhysicalIndex(never_read));
+	EXPECT_NE(graph.PhysicalIndex(a), graph.PhysicalIndex(never_read));
+
+	EXPECT_EQ(RenderGraph::InvalidIndex, graph.PhysicalIndex(untouched));
+	EXPECT_EQ(RenderGraph::InvalidIndex, graph.PhysicalIndex(output));
+	EXPECT_EQ(2U, graph.Report().num_transient_textures);
+}
+
+TEST(RenderGraphTest, AliasDisjointLifetimes)
+{
+	RenderGraph graph;
+	uint32_t const output = graph.ImportTexture("output", TexturePtr());
+	uint32_t const a = graph.AddTexture("a", MakeDesc(256, 256, EF_ABGR8));
+	uint32_t const b = graph.AddTexture("b", MakeDesc(256, 256, EF_ABGR8));
+	uint32_t const c = graph.AddTexture("c", MakeDesc(256, 256, EF_ABGR8));
+	uint32_t const half = graph.AddTexture("half", MakeDesc(128, 128, EF_ABGR8));
+
+	// a -> b -> c. a is dead once b is written, c can take its place. half never shares with anything.
+	graph.AddPass("A", {}, MakeSpan(&a, 1));
+	graph.AddPass("B", MakeSpan(&a, 1), MakeSpan(&b, 1));
+	graph.AddPass("C", MakeSpan(&b, 1), MakeSpan(&c, 1));
+	graph.AddPass("Half", MakeSpan(&c, 1), MakeSpan(&half, 1));
+	graph.AddPass("Present", MakeSpan(&half, 1), MakeSpan(&output, 1));
+	graph.Compile();
+
+	EXPECT_NE(graph.PhysicalIndex(a), graph.PhysicalIndex(b));
+	EXPECT_NE(graph.PhysicalIndex(b), graph.PhysicalIndex(c));
+	EXPECT_EQ(graph.PhysicalIndex(a), graph.PhysicalIndex(c));
+	EXPECT_NE(graph.PhysicalIndex(c), graph.PhysicalIndex(half));
+
+	auto const& report = graph.Report();
+	EXPECT_EQ(4U, report.num_transient_textures);
+	EXPECT_EQ(3U, report.num_physical_textures);
+	EXPECT_EQ((256 * 256 * 3 + 128 * 128) * 4U, report.requested_bytes);
+	EXPECT_EQ(256 * 256 * 4U, report.SavedBytes());
+}
+
+TEST(RenderGraphTest, PostProcessTargetsPerViewport)
+{
+	struct ViewportConfig
+	{
+		uint32_t num_viewports;
+		uint32_t width;
+		uint32_t height;
+		uint32_t attrib;
+		uint32_t expected_transient;
+		uint32_t expected_physical;
+	};
+	ViewportConfig const configs[] = {
+		{1, 1280, 720, VPAM_Enabled, 3, 2},
+		{2, 640, 720, VPAM_Enabled, 6, 2},
+		{4, 640, 360, VPAM_Enabled, 12, 2},
+		{2, 640, 720, VPAM_Enabled | VPAM_NoSSR, 4, 2},
+		{2, 640, 720, VPAM_Enabled | VPAM_NoSSR | VPAM_NoMotionBlur, 2, 1},
+	};
+
+	for (auto const& config : configs)
+	{
+		RenderGraph graph;
+		auto const desc = MakeDesc(config.width, config.height, EF_B10G11R11F);
+		for (uint32_t i = 0; i < config.num_viewports; ++ i)
+		{
+			auto const targets = DeferredRenderingLayer::DeclarePostProcessTargets(graph, config.attrib, desc);
+			EXPECT_NE(RenderGraph::InvalidIndex, targets[DeferredRenderingLayer::PPT_DoF]);
+			EXPECT_EQ(!(config.attrib & VPAM_NoMotionBlur), targets[DeferredRenderingLayer::PPT_MotionBlur] != RenderGraph::InvalidIndex);
+			EXPECT_EQ(!(config.attrib & VPAM_NoSSR), targets[DeferredRenderingLayer::PPT_BeforeSSR] != RenderGraph::InvalidIndex);
+		}
+		graph.Compile();
+
+		auto const& report = graph.Report();
+		EXPECT_EQ(config.expected_transient, report.num_transient_textures);
+		EXPECT_EQ(config.expected_physical, report.num_physical_textures);
+		EXPECT_EQ(desc.NumBytes() * config.expected_transient, report.requested_bytes);
+		EXPECT_EQ(desc.NumBytes() * config.expected_physical, report.allocated_bytes);
+
+		LogInfo() << config.num_viewports << " viewport(s) of " << config.width << 'x' << config.height << ": "
+				  << report.requested_bytes / 1024 << " KB requested, " << report.allocated_bytes / 1024 << " KB allocated, "
+				  << report.SavedBytes() / 1024 << " KB saved" << std::endl;
+	}
+}
+
+TEST(RenderGraphTest, Recompile)
+{
+	RenderGraph graph;
+	uint32_t const output = graph.ImportTexture("output", TexturePtr());
+	uint32_t const a = graph.AddTexture("a", MakeDesc(64, 64, EF_R16F));
+	graph.AddPass("A", {}, MakeSpan(&a, 1));
+	graph.AddPass("Present", MakeSpan(&a, 1), MakeSpan(&output, 1));
+	graph.Compile();
+	EXPECT_TRUE(graph.Compiled());
+	EXPECT_EQ(0U, graph.PhysicalIndex(a));
+
+	graph.Clear();
+	EXPECT_FALSE(graph.Compiled());
+	EXPECT_EQ(0U, graph.NumPasses());
+
+	uint32_t const output2 = graph.ImportTexture("output", TexturePtr());
+	uint32_t const b = graph.AddTexture("b", MakeDesc(32, 32, EF_R16F));
+	graph.AddPass("B", {}, MakeSpan(&b, 1));
+	graph.AddPass("Present", MakeSpan(&b, 1), MakeSpan(&output2, 1));
+	graph.Compile();
+
+	// The 64x64 texture doesn't fit any more, and is dropped
+	EXPECT_EQ(0U, graph.PhysicalIndex(b));
+	EXPECT_EQ(1U, graph.Report().num_physical_textures);
+	EXPECT_EQ(32 * 32 * 2U, graph.Report().allocated_bytes);
+}
@@ -1,6 +1,17 @@
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/Hash.hpp>
+#include <KlayGE/Package.hpp>
 #include <KlayGE/ResLoader.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "KlayGETests.hpp"
 
 using namespace KlayGE;
@@ -17,6 +28,194 @@ std::string ReadWholeFile(ResIdentifierPtr const & res)
 	return str;
 }
 
+namespace
+{
+	// Lets the test decide when the loading threads may leave SubThreadStage, one at a time if needed
+	class LoadingGate
+	{
+	public:
+		void Enter(std::string const & name)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			entered_.push_back(name);
+			cv_.notify_all();
+			cv_.wait(lock, [this] { return open_ || (permits_ > 0); });
+			if (!open_)
+			{
+				-- permits_;
+			}
+		}
+
+		// Lets one thread through, and waits until some thread has entered again or the queue seems to be drained
+		void Step()
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			size_t const num_entered = entered_.size();
+			++ permits_;
+			cv_.notify_all();
+			cv_.wait_for(lock, std::chrono::milliseconds(200), [this, num_entered] { return entered_.size() > num_entered; });
+		}
+
+		void Open()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				open_ = true;
+			}
+			cv_.notify_all();
+		}
+
+		bool WaitForEntered(size_t count)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			return cv_.wait_for(lock, std::chrono::seconds(10), [this, count] { return entered_.size() >= count; });
+		}
+
+		std::vector<std::string> Entered()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return entered_;
+		}
+
+	private:
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::vector<std::string> entered_;
+		uint32_t permits_ = 0;
+		bool open_ = false;
+	};
+
+	struct TestResource
+	{
+		std::string name;
+		std::atomic<uint32_t> num_loads{0};
+		bool main_thread_stage_done = false;
+	};
+
+	class TestLoadingDesc : public ResLoadingDesc
+	{
+	public:
+		TestLoadingDesc(std::string_view name, uint64_t hash, LoadingGate& gate)
+			: name_(name), hash_(hash), gate_(gate)
+		{
+		}
+
+		uint64_t Type() const override
+		{
+			static uint64_t const type = CT_HASH("TestLoadingDesc");
+			return type;
+		}
+
+		bool StateLess() const override
+		{
+			return true;
+		}
+
+		std::shared_ptr<void> CreateResource() override
+		{
+			res_ = MakeSharedPtr<TestResource>();
+			res_->name = name_;
+			return res_;
+		}
+
+		void SubThreadStage() override
+		{
+			++ res_->num_loads;
+			gate_.Enter(name_);
+		}
+
+		void MainThreadStage() override
+		{
+			res_->main_thread_stage_done = true;
+		}
+
+		bool HasSubThreadStage() const override
+		{
+			return true;
+		}
+
+		bool Match(ResLoadingDesc const & rhs) const override
+		{
+			return (this->Type() == rhs.Type()) && (name_ == static_cast<TestLoadingDesc const &>(rhs).name_);
+		}
+
+		uint64_t Hash() const override
+		{
+			return hash_;
+		}
+
+		void CopyDataFrom(ResLoadingDesc const & rhs) override
+		{
+			res_ = static_cast<TestLoadingDesc const &>(rhs).res_;
+		}
+
+		std::shared_ptr<void> CloneResourceFrom(std::shared_ptr<void> const & resource) override
+		{
+			return resource;
+		}
+
+		std::shared_ptr<void> Resource() const override
+		{
+			return res_;
+		}
+
+	private:
+		std::string name_;
+		uint64_t hash_;
+		LoadingGate& gate_;
+		std::shared_ptr<TestResource> res_;
+	};
+
+	std::shared_ptr<TestResource> ASyncQueryTest(std::string_view name, LoadingGate& gate, int32_t priority = 0)
+	{
+		return ResLoader::Instance().ASyncQueryT<TestResource>(
+			MakeSharedPtr<TestLoadingDesc>(name, CT_HASH("TestLoadingDesc") + name.size(), gate), priority);
+	}
+
+	// Occupies every loading thread, so the requests after it pile up in the queue. There are at most 4 loading threads.
+	std::vector<std::shared_ptr<TestResource>> BlockLoadingThreads(std::string_view test_name, LoadingGate& gate)
+	{
+		std::vector<std::shared_ptr<TestResource>> blockers;
+		for (uint32_t i = 0; i < 4; ++ i)
+		{
+			blockers.push_back(ASyncQueryTest(
+				std::string(test_name) + "_blocker" + std::to_string(i), gate, std::numeric_limits<int32_t>::max()));
+		}
+		gate.WaitForEntered(1);
+		return blockers;
+	}
+
+	// Single steps the loading threads and returns the non-blocker requests in the order they were loaded
+	std::vector<std::string> DrainInOrder(LoadingGate& gate, size_t num_requests)
+	{
+		std::vector<std::string> order;
+		for (uint32_t i = 0; (i < 64) && (order.size() < num_requests); ++ i)
+		{
+			gate.Step();
+
+			order.clear();
+			for (auto const & name : gate.Entered())
+			{
+				if (name.find("_blocker") == std::string::npos)
+				{
+					order.push_back(name);
+				}
+			}
+		}
+		gate.Open();
+		return order;
+	}
+
+	void FinishLoading()
+	{
+		while (ResLoader::Instance().NumLoadingResources() > 0)
+		{
+			ResLoader::Instance().Update();
+			std::this_thread::yield();
+		}
+	}
+}
+
 TEST(ResLoaderTest, AddDelPath)
 {
 	EXPECT_TRUE(ResLoader::Instance().Locate("Test.txt").empty());
@@ -95,3 +294,167 @@ TEST(ResLoaderTest, MountUnmountInsideEncrypt7zPath)
 	ResLoader::Instance().Unmount("ResLoaderTestData", "../../Tests/media/ResLoader/TestPassword.7z|1234/ResLoader");
 	EXPECT_TRUE(ResLoader::Instance().Locate("ResLoaderTestData/Test.txt").empty());
 }
+
+TEST(ResLoaderTest, PackagePathIndex)
+{
+	ResLoader::Instance().AddPath("../../Tests/media/ResLoader");
+	Package package(ResLoader::Instance().Open("Test.7z"));
+	ResLoader::Instance().DelPath("../../Tests/media/ResLoader");
+
+	EXPECT_TRUE(package.Locate("ResLoader/Test.txt"));
+	EXPECT_FALSE(package.Locate("ResLoader/Missing.txt"));
+	EXPECT_FALSE(package.Locate("Test.txt"));
+	// Folders aren't extractable
+	EXPECT_FALSE(package.Locate("ResLoader"));
+	EXPECT_FALSE(package.Extract("ResLoader/Missing.txt", "Missing.txt"));
+
+	auto res = package.Extract("ResLoader/Test.txt", "Test.txt");
+	ASSERT_TRUE(res);
+	EXPECT_EQ(res->ResName(), "Test.txt");
+	EXPECT_EQ(ReadWholeFile(res), sanity_string);
+}
+
+TEST(ResLoaderTest, PackageCaseInsensitiveLookup)
+{
+	ResLoader::Instance().AddPath("../../Tests/media/ResLoader");
+	Package package(ResLoader::Instance().Open("Test.7z"));
+	ResLoader::Instance().DelPath("../../Tests/media/ResLoader");
+
+	for (auto const * path : {"resloader/test.txt", "RESLOADER/TEST.TXT", "ResLoader\\Test.txt", "resLoader\\test.TXT"})
+	{
+		EXPECT_TRUE(package.Locate(path)) << path;
+		auto res = package.Extract(path, "Test.txt");
+		ASSERT_TRUE(res) << path;
+		EXPECT_EQ(ReadWholeFile(res), sanity_string) << path;
+	}
+}
+
+TEST(ResLoaderTest, PackageBlockCache)
+{
+	ResLoader::Instance().AddPath("../../Tests/media/ResLoader");
+	Package package(ResLoader::Instance().Open("TestPassword.7z"), "1234");
+	ResLoader::Instance().DelPath("../../Tests/media/ResLoader");
+
+	// Every extraction gets its own stream, even when the decoded data come from the cache
+	auto first = package.Extract("ResLoader/Test.txt", "Test.txt");
+	auto second = package.Extract("ResLoader/Test.txt", "Test.txt");
+	ASSERT_TRUE(first);
+	ASSERT_TRUE(second);
+	EXPECT_NE(first, second);
+	EXPECT_EQ(ReadWholeFile(first), sanity_string);
+	EXPECT_EQ(ReadWholeFile(second), sanity_string);
+
+	// Cache hits and decodes from several loading threads at once
+	std::vector<std::thread> threads;
+	std::atomic<uint32_t> num_matches{0};
+	for (uint32_t t = 0; t < 4; ++ t)
+	{
+		threads.emplace_back([&package, &num_matches] {
+			for (uint32_t i = 0; i < 32; ++ i)
+			{
+				auto res = package.Extract("ResLoader/Test.txt", "Test.txt");
+				if (res && (ReadWholeFile(res) == sanity_string))
+				{
+					++ num_matches;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	EXPECT_EQ(num_matches.load(), 4U * 32U);
+}
+
+TEST(ResLoaderTest, PriorityOrder)
+{
+	LoadingGate gate;
+	auto blockers = BlockLoadingThreads("PriorityOrder", gate);
+
+	auto low = ASyncQueryTest("low", gate, 1);
+	auto high = ASyncQueryTest("high", gate, 3);
+	auto mid_first = ASyncQueryTest("mid_first", gate, 2);
+	auto mid_second = ASyncQueryTest("mid_second", gate, 2);
+
+	auto const order = DrainInOrder(gate, 4);
+	EXPECT_EQ(order, (std::vector<std::string>{"high", "mid_first", "mid_second", "low"}));
+
+	FinishLoading();
+}
+
+TEST(ResLoaderTest, Reprioritize)
+{
+	LoadingGate gate;
+	auto blockers = BlockLoadingThreads("Reprioritize", gate);
+
+	auto first = ASyncQueryTest("first", gate, 2);
+	auto second = ASyncQueryTest("second", gate, 1);
+	auto third = ASyncQueryTest("third", gate, 0);
+	ResLoader::Instance().Reprioritize(third, 3);
+
+	auto const order = DrainInOrder(gate, 3);
+	EXPECT_EQ(order, (std::vector<std::string>{"third", "first", "second"}));
+
+	FinishLoading();
+}
+
+TEST(ResLoaderTest, CancelWithSecondRequester)
+{
+	LoadingGate gate;
+	auto blockers = BlockLoadingThreads("CancelWithSecondRequester", gate);
+
+	auto shared = ASyncQueryTest("shared", gate);
+	auto shared_again = ASyncQueryTest("shared", gate);
+	EXPECT_EQ(shared_again, shared);
+	auto dropped = ASyncQueryTest("dropped", gate);
+	auto dropped_again = ASyncQueryTest("dropped", gate);
+
+	// The second requester still wants "shared", both gave up on "dropped"
+	ResLoader::Instance().Cancel(shared);
+	ResLoader::Instance().Cancel(dropped);
+	ResLoader::Instance().Cancel(dropped_again);
+
+	auto const order = DrainInOrder(gate, 1);
+	EXPECT_EQ(order, (std::vector<std::string>{"shared"}));
+
+	FinishLoading();
+
+	EXPECT_EQ(shared->num_loads, 1U);
+	EXPECT_TRUE(shared->main_thread_stage_done);
+	EXPECT_EQ(dropped->num_loads, 0U);
+	EXPECT_FALSE(dropped->main_thread_stage_done);
+}
+
+TEST(ResLoaderTest, HashDedupAcrossWorkers)
+{
+	LoadingGate gate;
+	gate.Open();
+
+	// Names of the same length share a hash bucket, so Match has to tell them apart
+	std::vector<std::string> const names = {"aa", "bb", "cc", "ddd", "eee", "ffff"};
+	uint32_t const num_requests_per_name = 8;
+
+	std::vector<std::vector<std::shared_ptr<TestResource>>> results(names.size());
+	for (uint32_t i = 0; i < num_requests_per_name; ++ i)
+	{
+		for (size_t j = 0; j < names.size(); ++ j)
+		{
+			results[j].push_back(ASyncQueryTest(names[j], gate));
+		}
+	}
+
+	FinishLoading();
+
+	for (size_t j = 0; j < names.size(); ++ j)
+	{
+		auto const & res = results[j][0];
+		EXPECT_EQ(res->name, names[j]);
+		EXPECT_EQ(res->num_loads, 1U);
+		EXPECT_TRUE(res->main_thread_stage_done);
+		for (auto const & other : results[j])
+		{
+			EXPECT_EQ(other, res);
+		}
+	}
+}
@@ -1,10 +1,13 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Math.hpp>
 #include <KFL/SIMDMath.hpp>
+#include <KFL/AABBox.hpp>
+#include <KFL/Frustum.hpp>
 
 #include "KlayGETests.hpp"
 
 #include <vector>
+#include <random>
 #include <string>
 #include <iostream>
 
@@ -31,3 +34,96 @@ TEST(SIMDMathTest, NormalizeVector4)
 	v = SIMDMathLib::NormalizeVector4(v);
 	EXPECT_LT(MathLib::abs(SIMDMathLib::GetX(SIMDMathLib::LengthVector4(v)) - 1.0f), 1e-3f);
 }
+
+TEST(SIMDMathTest, IntersectAABBsFrustum)
+{
+	float4x4 const view = MathLib::look_at_lh(float3(0, 0, -10), float3(0, 0, 0), float3(0, 1, 0));
+	float4x4 const proj = MathLib::perspective_fov_lh(PI / 4, 1.0f, 1.0f, 100.0f);
+	float4x4 const view_proj = view * proj;
+	Frustum frustum;
+	frustum.ClipMatrix(view_proj, MathLib::inverse(view_proj));
+
+	// Not a multiple of 8, to cover the scalar tail
+	uint32_t const num = 1003;
+	std::vector<float> bounds[6];
+	for (auto& bound : bounds)
+	{
+		bound.resize(num);
+	}
+	std::vector<AABBox> aabbs(num);
+
+	std::mt19937 gen;
+	std::uniform_real_distribution<float> pos_dist(-60, 60);
+	std::uniform_real_distribution<float> size_dist(0.1f, 8);
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		float3 const center(pos_dist(gen), pos_dist(gen), pos_dist(gen) + 40);
+		float3 const extent(size_dist(gen), size_dist(gen), size_dist(gen));
+		aabbs[i] = AABBox(center - extent, center + extent);
+		for (uint32_t j = 0; j < 3; ++ j)
+		{
+			bounds[j][i] = aabbs[i].Min()[j];
+			bounds[j + 3][i] = aabbs[i].Max()[j];
+		}
+	}
+
+	std::vector<BoundOverlap> results(num);
+	SIMDMathLib::IntersectAABBsFrustum(results.data(), bounds[0].data(), bounds[1].data(), bounds[2].data(),
+		bounds[3].data(), bounds[4].data(), bounds[5].data(), num, frustum);
+
+	uint32_t num_visible = 0;
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		EXPECT_EQ(MathLib::intersect_aabb_frustum(aabbs[i], frustum), results[i]);
+		if (results[i] != BoundOverlap::No)
+		{
+			++ num_visible;
+		}
+	}
+	EXPECT_GT(num_visible, 0U);
+	EXPECT_LT(num_visible, num);
+}
+
+TEST(SIMDMathTest, SclerpDualQuaternions)
+{
+	// Not a multiple of 4, to cover the scalar tail
+	uint32_t const num = 203;
+	std::vector<float> lhs(num * 8);
+	std::vector<float> rhs(num * 8);
+	std::vector<float> factors(num);
+	std::vector<std::pair<Quaternion, Quaternion>> expected(num);
+
+	std::mt19937 gen;
+	std::uniform_real_distribution<float> dist(-1, 1);
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		Quaternion const lhs_real = MathLib::normalize(Quaternion(dist(gen), dist(gen), dist(gen), dist(gen)));
+		// Covers the pure translation branch of the screw conversion
+		Quaternion const rhs_real = (i % 5 == 0) ? lhs_real : MathLib::normalize(Quaternion(dist(gen), dist(gen), dist(gen), dist(gen)));
+		Quaternion const lhs_dual = MathLib::quat_trans_to_udq(lhs_real, float3(dist(gen), dist(gen), dist(gen)) * 10);
+		Quaternion const rhs_dual = MathLib::quat_trans_to_udq(rhs_real, float3(dist(gen), dist(gen), dist(gen)) * 10);
+		factors[i] = (dist(gen) + 1) / 2;
+
+		for (uint32_t j = 0; j < 4; ++ j)
+		{
+			lhs[j * num + i] = lhs_real[j];
+			lhs[(j + 4) * num + i] = lhs_dual[j];
+			rhs[j * num + i] = rhs_real[j];
+			rhs[(j + 4) * num + i] = rhs_dual[j];
+		}
+
+		expected[i] = MathLib::sclerp(lhs_real, lhs_dual, rhs_real, rhs_dual, factors[i]);
+	}
+
+	std::vector<float> results(num * 8);
+	SIMDMathLib::SclerpDualQuaternions(results.data(), lhs.data(), rhs.data(), factors.data(), num, num);
+
+	for (uint32_t i = 0; i < num; ++ i)
+	{
+		for (uint32_t j = 0; j < 4; ++ j)
+		{
+			EXPECT_FLOAT_EQ(expected[i].first[j], results[j * num + i]);
+			EXPECT_FLOAT_EQ(expected[i].second[j], results[(j + 4) * num + i]);
+		}
+	}
+}
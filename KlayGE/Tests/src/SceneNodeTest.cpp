@@ -0,0 +1,241 @@
+/**
+ * @file SceneNodeTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Renderable.hpp>
+#include <KlayGE/SceneNode.hpp>
+
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// Every node hangs under a random earlier one, so the tree is a few levels deep and has subtrees of all sizes
+	std::vector<SceneNodePtr> BuildRandomTree(SceneNode& root, uint32_t num_nodes)
+	{
+		std::ranlux24_base gen;
+		std::uniform_real_distribution<float> dis(-10, 10);
+
+		std::vector<SceneNodePtr> nodes;
+		nodes.reserve(num_nodes);
+		for (uint32_t i = 0; i < num_nodes; ++ i)
+		{
+			auto node = MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable | SceneNode::SOA_Moveable);
+			node->TransformToParent(MathLib::rotation_y(dis(gen)) * MathLib::translation(dis(gen), dis(gen), dis(gen)));
+
+			SceneNode& parent = (i == 0) ? root : *nodes[std::uniform_int_distribution<uint32_t>(0, i - 1)(gen)];
+			parent.AddChild(node);
+			nodes.push_back(node);
+		}
+		return nodes;
+	}
+
+	float4x4 ExpectedTransformToWorld(SceneNode const & node)
+	{
+		float4x4 ret = node.TransformToParent();
+		for (auto* parent = node.Parent(); parent != nullptr; parent = parent->Parent())
+		{
+			ret *= parent->TransformToParent();
+		}
+		return ret;
+	}
+
+	bool MatrixNear(float4x4 const & lhs, float4x4 const & rhs)
+	{
+		for (uint32_t i = 0; i < 16; ++ i)
+		{
+			if (MathLib::abs(lhs[i] - rhs[i]) > 1e-3f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool BoundNear(AABBox const & lhs, AABBox const & rhs)
+	{
+		for (uint32_t i = 0; i < 3; ++ i)
+		{
+			if ((MathLib::abs(lhs.Min()[i] - rhs.Min()[i]) > 1e-3f) || (MathLib::abs(lhs.Max()[i] - rhs.Max()[i]) > 1e-3f))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+// Transforms that the update didn't touch this time show up as the previous world transform. So after an update without any
+//  movement, it has to match the world transform recomputed from the whole parent chain.
+TEST(SceneNodeTest, HierarchyUpdate)
+{
+	SceneNode root(SceneNode::SOA_Cullable);
+	auto nodes = BuildRandomTree(root, 1000);
+
+	SceneHierarchy hierarchy(root);
+	hierarchy.Update();
+	hierarchy.Update();
+	EXPECT_EQ(1001U, hierarchy.NumNodes());
+	for (auto const & node : nodes)
+	{
+		EXPECT_TRUE(MatrixNear(ExpectedTransformToWorld(*node), node->PrevTransformToWorld()));
+	}
+	for (uint32_t i = 1; i < hierarchy.NumNodes(); ++ i)
+	{
+		uint32_t const parent_index = hierarchy.ParentIndices()[i];
+		EXPECT_LT(parent_index, i);
+		EXPECT_EQ(hierarchy.Nodes()[parent_index], hierarchy.Nodes()[i]->Parent());
+	}
+
+	std::vector<float4x4> old_xforms;
+	for (auto const & node : nodes)
+	{
+		old_xforms.push_back(ExpectedTransformToWorld(*node));
+	}
+
+	SceneNode* moved = nodes[1].get();
+	moved->TransformToParent(MathLib::translation(1.0f, 2.0f, 3.0f));
+	hierarchy.Update();
+	for (size_t i = 0; i < nodes.size(); ++ i)
+	{
+		// Moved nodes remember where they were, the rest have been settled since the last update
+		EXPECT_TRUE(MatrixNear(moved->IsNodeInSubTree(nodes[i].get()) ? old_xforms[i] : ExpectedTransformToWorld(*nodes[i]),
+			nodes[i]->PrevTransformToWorld()));
+	}
+	hierarchy.Update();
+	for (auto const & node : nodes)
+	{
+		EXPECT_TRUE(MatrixNear(ExpectedTransformToWorld(*node), node->PrevTransformToWorld()));
+	}
+
+	// Reparenting a subtree rebuilds the flattened hierarchy
+	auto reparented = nodes.back();
+	reparented->Parent()->RemoveChild(reparented);
+	nodes[2]->AddChild(reparented);
+	hierarchy.Update();
+	hierarchy.Update();
+	EXPECT_EQ(1001U, hierarchy.NumNodes());
+	for (auto const & node : nodes)
+	{
+		EXPECT_TRUE(MatrixNear(ExpectedTransformToWorld(*node), node->PrevTransformToWorld()));
+	}
+}
+
+// Renderables like particles set their bounds every frame. The nodes holding them, and all the ancestors, have to follow.
+TEST(SceneNodeTest, BoundPropagation)
+{
+	SceneNode root(SceneNode::SOA_Cullable);
+	auto parent = MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable);
+	parent->TransformToParent(MathLib::translation(10.0f, 0.0f, 0.0f));
+	root.AddChild(parent);
+
+	auto renderable = MakeSharedPtr<Renderable>(L"Bound");
+	renderable->PosBound(AABBox(float3(-1, -1, -1), float3(1, 1, 1)));
+	auto child = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(renderable), SceneNode::SOA_Cullable);
+	child->TransformToParent(MathLib::translation(0.0f, 5.0f, 0.0f));
+	parent->AddChild(child);
+
+	SceneHierarchy hierarchy(root);
+	hierarchy.Update();
+	EXPECT_TRUE(BoundNear(AABBox(float3(-1, 4, -1), float3(1, 6, 1)), parent->PosBoundOS()));
+	EXPECT_TRUE(BoundNear(AABBox(float3(9, 4, -1), float3(11, 6, 1)), root.PosBoundWS()));
+
+	renderable->PosBound(AABBox(float3(-2, 0, 0), float3(2, 3, 1)));
+	hierarchy.Update();
+	EXPECT_TRUE(BoundNear(AABBox(float3(-2, 0, 0), float3(2, 3, 1)), child->PosBoundOS()));
+	EXPECT_TRUE(BoundNear(AABBox(float3(8, 5, 0), float3(12, 8, 1)), child->PosBoundWS()));
+	EXPECT_TRUE(BoundNear(AABBox(float3(8, 5, 0), float3(12, 8, 1)), root.PosBoundWS()));
+
+	// Nodes cloned with the same renderable follow it as well
+	auto clone = MakeSharedPtr<SceneNode>(child->FirstComponent()->Clone(), SceneNode::SOA_Cullable);
+	root.AddChild(clone);
+	hierarchy.Update();
+	renderable->PosBound(AABBox(float3(0, 0, 0), float3(1, 1, 1)));
+	hierarchy.Update();
+	EXPECT_TRUE(BoundNear(AABBox(float3(0, 0, 0), float3(1, 1, 1)), clone->PosBoundWS()));
+	EXPECT_TRUE(BoundNear(AABBox(float3(10, 5, 0), float3(11, 6, 1)), child->PosBoundWS()));
+	EXPECT_TRUE(BoundNear(AABBox(float3(0, 0, 0), float3(11, 6, 1)), root.PosBoundWS()));
+}
+
+// The topology version belongs to the root, changes in another tree don't rebuild this one
+TEST(SceneNodeTest, TopologyVersionPerTree)
+{
+	SceneNode root(SceneNode::SOA_Cullable);
+	SceneNode other_root(SceneNode::SOA_Cullable | SceneNode::SOA_Overlay);
+	auto node = MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable);
+	root.AddChild(node);
+
+	uint32_t const version = root.TopologyVersion();
+	other_root.AddChild(MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable));
+	other_root.ClearChildren();
+	EXPECT_EQ(version, root.TopologyVersion());
+
+	// Changes deep in the tree count for the root
+	node->AddChild(MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable));
+	EXPECT_NE(version, root.TopologyVersion());
+}
+
+TEST(SceneNodeTest, HierarchyUpdateCost)
+{
+	uint32_t const num_nodes = 100000;
+
+	SceneNode root(SceneNode::SOA_Cullable);
+	auto nodes = BuildRandomTree(root, num_nodes);
+	SceneHierarchy hierarchy(root);
+
+	Timer timer;
+	hierarchy.Update();
+	double const full_time = timer.elapsed();
+
+	hierarchy.Update();
+	timer.restart();
+	hierarchy.Update();
+	double const static_time = timer.elapsed();
+
+	// 1% of the nodes move, as leaves, so the cost is dominated by the walk rather than by the recomputation
+	for (uint32_t i = 0; i < num_nodes; i += 100)
+	{
+		nodes[num_nodes - 1 - i]->TransformToParent(MathLib::translation(1.0f, 0.0f, 0.0f));
+	}
+	timer.restart();
+	hierarchy.Update();
+	double const partial_time = timer.elapsed();
+
+	LogInfo() << "Updating " << num_nodes << " nodes in " << hierarchy.NumLevels() << " levels: " << full_time * 1000 << " ms all dirty, "
+			  << partial_time * 1000 << " ms 1% moved, " << static_time * 1000 << " ms nothing moved" << std::endl;
+}
@@ -0,0 +1,390 @@
+/**
+ * @file SceneQueryTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/RenderLayout.hpp>
+#include <KlayGE/Renderable.hpp>
+#include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	float3 RandomDir(std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> dis(-1, 1);
+		float3 dir;
+		do
+		{
+			dir = float3(dis(gen), dis(gen), dis(gen));
+		} while (MathLib::length_sq(dir) < 1e-4f);
+		return MathLib::normalize(dir);
+	}
+
+	// Entry distance of the ray, or a negative number for a miss
+	float RayBoxDist(float3 const & orig, float3 const & dir, AABBox const & aabb, float radius)
+	{
+		float t0 = 0;
+		float t1 = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < 3; ++ i)
+		{
+			float const min = aabb.Min()[i] - radius;
+			float const max = aabb.Max()[i] + radius;
+			if (dir[i] == 0)
+			{
+				if ((orig[i] < min) || (orig[i] > max))
+				{
+					return -1;
+				}
+			}
+			else
+			{
+				float near_t = (min - orig[i]) / dir[i];
+				float far_t = (max - orig[i]) / dir[i];
+				if (near_t > far_t)
+				{
+					std::swap(near_t, far_t);
+				}
+				t0 = std::max(t0, near_t);
+				t1 = std::min(t1, far_t);
+			}
+		}
+		return (t0 <= t1) ? t0 : -1;
+	}
+
+	// Moller-Trumbore, the same as the collision meshes
+	float RayTriangleDist(float3 const & orig, float3 const & dir, float3 const & v0, float3 const & v1, float3 const & v2)
+	{
+		float3 const e1 = v1 - v0;
+		float3 const e2 = v2 - v0;
+		float3 const p = MathLib::cross(dir, e2);
+		float const det = MathLib::dot(e1, p);
+		if (std::abs(det) < 1e-12f)
+		{
+			return -1;
+		}
+
+		float const inv_det = 1 / det;
+		float3 const s = orig - v0;
+		float const u = MathLib::dot(s, p) * inv_det;
+		if ((u < 0) || (u > 1))
+		{
+			return -1;
+		}
+
+		float3 const q = MathLib::cross(s, e1);
+		float const v = MathLib::dot(dir, q) * inv_det;
+		if ((v < 0) || (u + v > 1))
+		{
+			return -1;
+		}
+
+		return MathLib::dot(e2, q) * inv_det;
+	}
+
+	// Positions have to be in [-1, 1], the bound the mesh decodes them with
+	std::shared_ptr<StaticMesh> MakeCollisionMesh(std::vector<float4> const & positions, std::vector<uint32_t> const & indices)
+	{
+		auto mesh = MakeSharedPtr<StaticMesh>(L"Collision");
+		mesh->NumLods(1);
+		mesh->GetRenderLayout().TopologyType(RenderLayout::TT_TriangleList);
+		mesh->AddVertexStream(0, positions.data(), static_cast<uint32_t>(positions.size() * sizeof(positions[0])),
+			VertexElement(VEU_Position, 0, EF_ABGR32F), EAH_GPU_Read | EAH_Immutable);
+		mesh->AddIndexStream(0, indices.data(), static_cast<uint32_t>(indices.size() * sizeof(indices[0])), EF_R32UI,
+			EAH_GPU_Read | EAH_Immutable);
+		mesh->PosBound(AABBox(float3(-1, -1, -1), float3(1, 1, 1)));
+		mesh->BuildCollisionMesh();
+		return mesh;
+	}
+
+	SceneNodePtr AddBox(SceneNode& parent, AABBox const & aabb, uint32_t attrib)
+	{
+		auto renderable = MakeSharedPtr<Renderable>(L"Box");
+		renderable->PosBound(AABBox(float3(0, 0, 0), aabb.Max() - aabb.Min()));
+		auto node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(renderable), attrib);
+		node->TransformToParent(MathLib::translation(aabb.Min()));
+		parent.AddChild(node);
+		return node;
+	}
+}
+
+TEST(SceneQueryTest, CollisionMeshMatchesBruteForce)
+{
+	std::ranlux24_base gen;
+	std::uniform_real_distribution<float> pos_dis(-1, 1);
+
+	uint32_t const num_triangles = 300;
+	std::vector<float4> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < num_triangles; ++ i)
+	{
+		float3 const center(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+		for (uint32_t j = 0; j < 3; ++ j)
+		{
+			float3 const v = MathLib::maximize(
+				MathLib::minimize(center + float3(pos_dis(gen), pos_dis(gen), pos_dis(gen)) * 0.2f, float3(1, 1, 1)), float3(-1, -1, -1));
+			indices.push_back(static_cast<uint32_t>(positions.size()));
+			positions.emplace_back(v.x(), v.y(), v.z(), 1.0f);
+		}
+	}
+
+	auto mesh = MakeCollisionMesh(positions, indices);
+	ASSERT_TRUE(mesh->HasCollisionMesh());
+
+	std::uniform_real_distribution<float> orig_dis(-2, 2);
+	uint32_t num_hits = 0;
+	for (uint32_t i = 0; i < 1000; ++ i)
+	{
+		float3 const orig(orig_dis(gen), orig_dis(gen), orig_dis(gen));
+		float3 const dir = RandomDir(gen);
+		float const max_dist = 3;
+
+		float expected = -1;
+		for (uint32_t tri = 0; tri < num_triangles; ++ tri)
+		{
+			float3 const v0(positions[tri * 3 + 0].x(), positions[tri * 3 + 0].y(), positions[tri * 3 + 0].z());
+			float3 const v1(positions[tri * 3 + 1].x(), positions[tri * 3 + 1].y(), positions[tri * 3 + 1].z());
+			float3 const v2(positions[tri * 3 + 2].x(), positions[tri * 3 + 2].y(), positions[tri * 3 + 2].z());
+			float const dist = RayTriangleDist(orig, dir, v0, v1, v2);
+			if ((dist >= 0) && (dist <= max_dist) && ((expected < 0) || (dist < expected)))
+			{
+				expected = dist;
+			}
+		}
+
+		float dist = max_dist;
+		bool const hit = mesh->IntersectRay(orig, dir, dist);
+		EXPECT_EQ(expected >= 0, hit);
+		if (hit && (expected >= 0))
+		{
+			EXPECT_NEAR(expected, dist, 1e-4f);
+			++ num_hits;
+		}
+	}
+	EXPECT_GT(num_hits, 0U);
+}
+
+TEST(SceneQueryTest, MatchesBruteForce)
+{
+	auto& scene_mgr = Context::Instance().SceneManagerInstance();
+	auto& root = scene_mgr.SceneRootNode();
+
+	std::ranlux24_base gen;
+	std::uniform_real_distribution<float> pos_dis(-50, 50);
+	std::uniform_real_distribution<float> size_dis(0.5f, 5);
+
+	// Every 10th box is hidden, and so is everything under the hidden parent
+	auto hidden_parent = MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable | SceneNode::SOA_Invisible);
+	root.AddChild(hidden_parent);
+	std::vector<SceneNodePtr> nodes;
+	std::vector<AABBox> visible_boxes;
+	std::vector<SceneNode*> visible_nodes;
+	for (uint32_t i = 0; i < 300; ++ i)
+	{
+		float3 const min(pos_dis(gen), pos_dis(gen), pos_dis(gen));
+		AABBox const aabb(min, min + float3(size_dis(gen), size_dis(gen), size_dis(gen)));
+		bool const hidden = (i % 10 == 0);
+		bool const under_hidden_parent = (i % 10 == 5);
+		auto node = AddBox(under_hidden_parent ? *hidden_parent : root, aabb,
+			SceneNode::SOA_Cullable | (hidden ? SceneNode::SOA_Invisible : 0));
+		if (!hidden && !under_hidden_parent)
+		{
+			visible_boxes.push_back(aabb);
+			visible_nodes.push_back(node.get());
+		}
+		nodes.push_back(node);
+	}
+	scene_mgr.UpdateScene();
+
+	auto brute_force_ray_cast = [&visible_boxes](float3 const & orig, float3 const & dir, float radius, float max_dist) {
+		float ret = -1;
+		for (auto const & aabb : visible_boxes)
+		{
+			float const dist = RayBoxDist(orig, dir, aabb, radius);
+			if ((dist >= 0) && (dist <= max_dist) && ((ret < 0) || (dist < ret)))
+			{
+				ret = dist;
+			}
+		}
+		return ret;
+	};
+
+	uint32_t const num_rays = 500;
+	float const max_dist = 150;
+	std::vector<float3> origs(num_rays);
+	std::vector<float3> dirs(num_rays);
+	std::uniform_real_distribution<float> orig_dis(-70, 70);
+	for (uint32_t i = 0; i < num_rays; ++ i)
+	{
+		origs[i] = float3(orig_dis(gen), orig_dis(gen), orig_dis(gen));
+		dirs[i] = RandomDir(gen);
+	}
+
+	std::vector<std::optional<SceneManager::QueryHit>> hits(num_rays);
+	scene_mgr.RayCast(origs, dirs, max_dist, true, hits);
+	uint32_t num_hits = 0;
+	for (uint32_t i = 0; i < num_rays; ++ i)
+	{
+		float const expected = brute_force_ray_cast(origs[i], dirs[i], 0, max_dist);
+		auto const hit = scene_mgr.RayCast(origs[i], dirs[i], max_dist);
+		ASSERT_EQ(expected >= 0, hit.has_value());
+		ASSERT_EQ(hit.has_value(), hits[i].has_value());
+		if (hit)
+		{
+			EXPECT_NEAR(expected, hit->dist, 1e-3f);
+			EXPECT_EQ(hit->node, hits[i]->node);
+			EXPECT_EQ(hit->dist, hits[i]->dist);
+			EXPECT_NE(visible_nodes.end(), std::find(visible_nodes.begin(), visible_nodes.end(), hit->node));
+			++ num_hits;
+		}
+
+		float const radius = 2;
+		float const expected_sweep = brute_force_ray_cast(origs[i], dirs[i], radius, max_dist);
+		auto const sweep_hit = scene_mgr.SweepSphere(Sphere(origs[i], radius), dirs[i], max_dist);
+		ASSERT_EQ(expected_sweep >= 0, sweep_hit.has_value());
+		if (sweep_hit)
+		{
+			EXPECT_NEAR(expected_sweep, sweep_hit->dist, 1e-3f);
+		}
+	}
+	EXPECT_GT(num_hits, 0U);
+
+	std::uniform_real_distribution<float> extent_dis(1, 20);
+	for (uint32_t i = 0; i < 100; ++ i)
+	{
+		float3 const center(orig_dis(gen), orig_dis(gen), orig_dis(gen));
+		float3 const extent(extent_dis(gen), extent_dis(gen), extent_dis(gen));
+		AABBox const aabb(center - extent, center + extent);
+		Sphere const sphere(center, extent.x());
+
+		std::vector<SceneNode*> expected_aabb;
+		std::vector<SceneNode*> expected_sphere;
+		for (size_t j = 0; j < visible_boxes.size(); ++ j)
+		{
+			if (MathLib::intersect_aabb_aabb(aabb, visible_boxes[j]))
+			{
+				expected_aabb.push_back(visible_nodes[j]);
+			}
+			if (MathLib::intersect_aabb_sphere(visible_boxes[j], sphere))
+			{
+				expected_sphere.push_back(visible_nodes[j]);
+			}
+		}
+
+		std::vector<SceneNode*> overlapped;
+		scene_mgr.OverlapAABB(aabb, overlapped);
+		std::sort(expected_aabb.begin(), expected_aabb.end());
+		std::sort(overlapped.begin(), overlapped.end());
+		EXPECT_EQ(expected_aabb, overlapped);
+
+		overlapped.clear();
+		scene_mgr.OverlapSphere(sphere, overlapped);
+		std::sort(expected_sphere.begin(), expected_sphere.end());
+		std::sort(overlapped.begin(), overlapped.end());
+		EXPECT_EQ(expected_sphere, overlapped);
+	}
+
+	for (auto const & node : nodes)
+	{
+		node->Parent()->RemoveChild(node);
+	}
+	root.RemoveChild(hidden_parent);
+	scene_mgr.UpdateScene();
+}
+
+// Per-triangle tests go through the transforms of the snapshot, not the live ones the update thread can be changing
+TEST(SceneQueryTest, PerTriangle)
+{
+	auto& scene_mgr = Context::Instance().SceneManagerInstance();
+	auto& root = scene_mgr.SceneRootNode();
+
+	// The lower left half of a square facing z
+	auto mesh = MakeCollisionMesh({float4(-1, -1, 0, 1), float4(1, -1, 0, 1), float4(-1, 1, 0, 1)}, {0, 1, 2});
+	auto node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(mesh), SceneNode::SOA_Cullable);
+	node->TransformToParent(MathLib::scaling(2.0f, 2.0f, 2.0f) * MathLib::translation(100.0f, 0.0f, 0.0f));
+	root.AddChild(node);
+	scene_mgr.UpdateScene();
+
+	float3 const dir(0, 0, 1);
+	float const max_dist = 100;
+
+	// Through the triangle, the bounds are hit 2 units earlier
+	auto hit = scene_mgr.RayCast(float3(99, -1, -10), dir, max_dist, true);
+	ASSERT_TRUE(hit.has_value());
+	EXPECT_EQ(node.get(), hit->node);
+	EXPECT_NEAR(10, hit->dist, 1e-4f);
+	hit = scene_mgr.RayCast(float3(99, -1, -10), dir, max_dist, false);
+	ASSERT_TRUE(hit.has_value());
+	EXPECT_NEAR(8, hit->dist, 1e-4f);
+
+	// Through the other half of the square, only the bounds are hit
+	EXPECT_FALSE(scene_mgr.RayCast(float3(101, 1, -10), dir, max_dist, true).has_value());
+	EXPECT_TRUE(scene_mgr.RayCast(float3(101, 1, -10), dir, max_dist, false).has_value());
+
+	// Until the next snapshot, the node is still where it was
+	node->TransformToParent(MathLib::scaling(2.0f, 2.0f, 2.0f) * MathLib::translation(200.0f, 0.0f, 0.0f));
+	hit = scene_mgr.RayCast(float3(99, -1, -10), dir, max_dist, true);
+	ASSERT_TRUE(hit.has_value());
+	EXPECT_NEAR(10, hit->dist, 1e-4f);
+
+	scene_mgr.UpdateScene();
+	EXPECT_FALSE(scene_mgr.RayCast(float3(99, -1, -10), dir, max_dist, true).has_value());
+	hit = scene_mgr.RayCast(float3(199, -1, -10), dir, max_dist, true);
+	ASSERT_TRUE(hit.has_value());
+	EXPECT_NEAR(10, hit->dist, 1e-4f);
+
+	// The snapshots are double buffered, the one filled before the move catches up without the node moving again
+	for (uint32_t i = 0; i < 2; ++ i)
+	{
+		scene_mgr.UpdateScene();
+		EXPECT_FALSE(scene_mgr.RayCast(float3(99, -1, -10), dir, max_dist, true).has_value());
+		hit = scene_mgr.RayCast(float3(199, -1, -10), dir, max_dist, true);
+		ASSERT_TRUE(hit.has_value());
+		EXPECT_NEAR(10, hit->dist, 1e-4f);
+	}
+
+	root.RemoveChild(node);
+	scene_mgr.UpdateScene();
+}
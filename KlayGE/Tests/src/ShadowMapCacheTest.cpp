@@ -0,0 +1,182 @@
+/**
+ * @file ShadowMapCacheTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/Light.hpp>
+#include <KlayGE/Renderable.hpp>
+#include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	SceneNodePtr AddCaster(SceneNode& parent, float3 const & pos, uint32_t attrib)
+	{
+		auto renderable = MakeSharedPtr<Renderable>(L"Caster");
+		renderable->PosBound(AABBox(float3(0, 0, 0), float3(1, 1, 1)));
+		auto node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(renderable), attrib);
+		node->TransformToParent(MathLib::translation(pos));
+		parent.AddChild(node);
+		return node;
+	}
+
+	AABBox VolumeAround(float3 const & pos)
+	{
+		return AABBox(pos - float3(0.5f, 0.5f, 0.5f), pos + float3(1.5f, 1.5f, 1.5f));
+	}
+}
+
+TEST(ShadowMapCacheTest, CastersChanged)
+{
+	auto& scene_mgr = Context::Instance().SceneManagerInstance();
+	auto& root = scene_mgr.SceneRootNode();
+
+	float3 const static_pos(0, 0, 0);
+	float3 const moved_pos(10, 0, 0);
+	float3 const moveable_pos(20, 0, 0);
+	float3 const skinned_pos(30, 0, 0);
+	float3 const updated_pos(40, 0, 0);
+
+	auto static_caster = AddCaster(root, static_pos, SceneNode::SOA_Cullable);
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(moved_pos), true));
+
+	scene_mgr.UpdateScene();
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(static_pos), false));
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(static_pos), true));
+
+	// A static caster moving changes where it was and where it is, and nothing else
+	static_caster->TransformToParent(MathLib::translation(moved_pos));
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(static_pos), true));
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(moved_pos), true));
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(moveable_pos), false));
+	scene_mgr.UpdateScene();
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(moved_pos), false));
+
+	// Under a moveable node, it changes every frame for everyone but the static casters
+	auto moveable_parent = MakeSharedPtr<SceneNode>(SceneNode::SOA_Cullable | SceneNode::SOA_Moveable);
+	root.AddChild(moveable_parent);
+	AddCaster(*moveable_parent, moveable_pos, SceneNode::SOA_Cullable);
+	scene_mgr.UpdateScene();
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(moveable_pos), false));
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(moveable_pos), true));
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(moved_pos), false));
+
+	// Skinned meshes under a static node animate without moving. Turning dynamic drops it from the static casters.
+	auto skinned_caster = AddCaster(root, skinned_pos, SceneNode::SOA_Cullable);
+	scene_mgr.UpdateScene();
+	scene_mgr.UpdateScene();
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(skinned_pos), false));
+	skinned_caster->FirstComponentOfType<RenderableComponent>()->BoundRenderable().IsSkinned(true);
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(skinned_pos), true));
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(skinned_pos), false));
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(skinned_pos), true));
+
+	// So do the ones changed by an update event
+	auto updated_caster = AddCaster(root, updated_pos, SceneNode::SOA_Cullable);
+	updated_caster->OnSubThreadUpdate().Connect([](SceneNode& node, float app_time, float elapsed_time) {
+		KFL_UNUSED(node);
+		KFL_UNUSED(app_time);
+		KFL_UNUSED(elapsed_time);
+	});
+	scene_mgr.UpdateScene();
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(updated_pos), false));
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(updated_pos), true));
+
+	// Removing casters changes everything, there is no telling where the removed ones were
+	root.RemoveChild(static_caster);
+	root.RemoveChild(moveable_parent);
+	root.RemoveChild(skinned_caster);
+	root.RemoveChild(updated_caster);
+	scene_mgr.UpdateScene();
+	EXPECT_TRUE(scene_mgr.CastersChanged(VolumeAround(static_pos), true));
+	scene_mgr.UpdateScene();
+	EXPECT_FALSE(scene_mgr.CastersChanged(VolumeAround(moved_pos), false));
+}
+
+TEST(ShadowMapCacheTest, UpdateMode)
+{
+	using SMU = DeferredRenderingLayer::ShadowMapUpdate;
+
+	auto light = MakeSharedPtr<SpotLightSource>();
+	DeferredRenderingLayer::CachedShadowMap key;
+	key.light = light.get();
+	key.view_proj = MathLib::translation(1.0f, 2.0f, 3.0f);
+	key.range = 10;
+
+	DeferredRenderingLayer::CachedShadowMap cache;
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, key, false));
+	EXPECT_TRUE(cache.valid);
+	EXPECT_EQ(SMU::SMU_Skip, DeferredRenderingLayer::UpdateShadowMapCache(cache, key, false));
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, key, true));
+	EXPECT_EQ(SMU::SMU_Skip, DeferredRenderingLayer::UpdateShadowMapCache(cache, key, false));
+
+	// Anything about the light changing draws it again
+	auto moved = key;
+	moved.view_proj = MathLib::translation(1.0f, 2.0f, 4.0f);
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, moved, false));
+	auto farther = moved;
+	farther.range = 20;
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, farther, false));
+	auto translucent = farther;
+	translucent.translucency = true;
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, translucent, false));
+	EXPECT_EQ(SMU::SMU_Skip, DeferredRenderingLayer::UpdateShadowMapCache(cache, translucent, false));
+	auto other_light_source = MakeSharedPtr<PointLightSource>();
+	auto other_light = translucent;
+	other_light.light = other_light_source.get();
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, other_light, false));
+
+	// With split, the dynamic casters are always drawn over the cached static ones
+	auto split = key;
+	split.split = true;
+	EXPECT_EQ(SMU::SMU_StaticAndDynamic, DeferredRenderingLayer::UpdateShadowMapCache(cache, split, false));
+	EXPECT_EQ(SMU::SMU_DynamicOnly, DeferredRenderingLayer::UpdateShadowMapCache(cache, split, false));
+	EXPECT_EQ(SMU::SMU_StaticAndDynamic, DeferredRenderingLayer::UpdateShadowMapCache(cache, split, true));
+	EXPECT_EQ(SMU::SMU_DynamicOnly, DeferredRenderingLayer::UpdateShadowMapCache(cache, split, false));
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, key, false));
+
+	// An invalidated cache starts over
+	cache.valid = false;
+	EXPECT_EQ(SMU::SMU_Full, DeferredRenderingLayer::UpdateShadowMapCache(cache, key, false));
+}
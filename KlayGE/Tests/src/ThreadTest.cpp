@@ -0,0 +1,202 @@
+/**
+ * @file ThreadTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+
+#include <atomic>
+#include <future>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+TEST(ThreadTest, ParallelFor)
+{
+	TaskScheduler ts(4);
+
+	std::vector<uint32_t> data(100000, 0);
+	ts.ParallelFor(0, static_cast<uint32_t>(data.size()), 1000, [&data](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++ i)
+		{
+			data[i] = i * 2;
+		}
+	});
+
+	for (uint32_t i = 0; i < data.size(); ++ i)
+	{
+		EXPECT_EQ(data[i], i * 2);
+	}
+}
+
+TEST(ThreadTest, NestedTaskGroup)
+{
+	TaskScheduler ts(4);
+
+	std::atomic<uint32_t> counter{0};
+	{
+		TaskGroup outer(ts);
+		for (uint32_t i = 0; i < 100; ++ i)
+		{
+			outer.Run([&ts, &counter] {
+				TaskGroup inner(ts);
+				for (uint32_t j = 0; j < 100; ++ j)
+				{
+					inner.Run([&counter] { ++ counter; });
+				}
+				inner.Wait();
+			});
+		}
+		outer.Wait();
+	}
+
+	EXPECT_EQ(counter.load(), 100U * 100U);
+}
+
+TEST(ThreadTest, Continuation)
+{
+	TaskScheduler ts(4);
+
+	std::atomic<uint32_t> counter{0};
+	std::promise<uint32_t> result;
+
+	TaskGroup group(ts);
+	for (uint32_t i = 0; i < 1000; ++ i)
+	{
+		group.Run([&counter] { ++ counter; });
+	}
+	group.Then([&counter, &result] { result.set_value(counter.load()); });
+
+	EXPECT_EQ(result.get_future().get(), 1000U);
+
+	EXPECT_EQ(ts.Submit([] { return 42; }).get(), 42);
+}
+
+TEST(ThreadTest, TaskException)
+{
+	TaskScheduler ts(4);
+
+	std::atomic<uint32_t> counter{0};
+	TaskGroup group(ts);
+	for (uint32_t i = 0; i < 100; ++ i)
+	{
+		group.Run([&counter, i] {
+			if (i % 10 == 3)
+			{
+				throw std::runtime_error("task failed");
+			}
+			++ counter;
+		});
+	}
+
+	// Every task still finishes, and the failure surfaces on the waiting thread
+	EXPECT_THROW(group.Wait(), std::runtime_error);
+	EXPECT_EQ(counter.load(), 90U);
+
+	// The exception is reported once, the group stays usable
+	group.Run([&counter] { ++ counter; });
+	EXPECT_NO_THROW(group.Wait());
+	EXPECT_EQ(counter.load(), 91U);
+
+	EXPECT_THROW(ts.ParallelFor(0, 1000, 10,
+					 [](uint32_t begin, uint32_t end) {
+						 if ((begin <= 500) && (500 < end))
+						 {
+							 throw std::runtime_error("chunk failed");
+						 }
+					 }),
+		std::runtime_error);
+}
+
+// A benchmark rather than a test, run it with --gtest_also_run_disabled_tests
+TEST(ThreadTest, DISABLED_TaskThroughput)
+{
+	uint32_t const num_tasks = 100000;
+
+	auto tiny_job = [](std::atomic<uint32_t>& counter) {
+		uint32_t v = 0;
+		for (uint32_t i = 0; i < 64; ++ i)
+		{
+			v = v * 1664525U + 1013904223U;
+		}
+		counter.fetch_add((v & 1) | 1, std::memory_order_relaxed);
+	};
+
+	for (uint32_t num_threads = 1; num_threads <= 64; num_threads *= 2)
+	{
+		double thread_pool_time;
+		{
+			ThreadPool tp(num_threads, num_threads);
+			std::atomic<uint32_t> counter{0};
+			std::vector<std::future<void>> joiners;
+			joiners.reserve(num_tasks);
+
+			Timer timer;
+			for (uint32_t i = 0; i < num_tasks; ++ i)
+			{
+				joiners.push_back(tp.QueueThread([&counter, &tiny_job] { tiny_job(counter); }));
+			}
+			for (auto& joiner : joiners)
+			{
+				joiner.wait();
+			}
+			thread_pool_time = timer.elapsed();
+
+			EXPECT_EQ(counter.load(), num_tasks);
+		}
+
+		double scheduler_time;
+		{
+			TaskScheduler ts(num_threads);
+			std::atomic<uint32_t> counter{0};
+
+			Timer timer;
+			TaskGroup group(ts);
+			for (uint32_t i = 0; i < num_tasks; ++ i)
+			{
+				group.Run([&counter, &tiny_job] { tiny_job(counter); });
+			}
+			group.Wait();
+			scheduler_time = timer.elapsed();
+
+			EXPECT_EQ(counter.load(), num_tasks);
+		}
+
+		LogInfo() << std::setw(2) << num_threads << " threads: ThreadPool " << static_cast<uint32_t>(num_tasks / thread_pool_time)
+				  << " tasks/s, TaskScheduler " << static_cast<uint32_t>(num_tasks / scheduler_time) << " tasks/s" << std::endl;
+	}
+}
@@ -0,0 +1,349 @@
+/**
+ * @file TransientBufferTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Fence.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderEngine.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/TransientBuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	std::vector<uint8_t> MakePattern(uint32_t size, uint8_t seed)
+	{
+		std::vector<uint8_t> ret(size);
+		for (uint32_t i = 0; i < size; ++ i)
+		{
+			ret[i] = static_cast<uint8_t>(seed + i * 7);
+		}
+		return ret;
+	}
+
+	SubAlloc AllocPattern(TransientBuffer& tb, std::vector<uint8_t> const & pattern)
+	{
+		return tb.Alloc(static_cast<uint32_t>(pattern.size()), pattern.data());
+	}
+
+	std::vector<uint8_t> ReadBack(GraphicsBuffer& buffer)
+	{
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+		auto buffer_cpu = rf.MakeVertexBuffer(BU_Static, EAH_CPU_Read, buffer.Size(), nullptr);
+		buffer.CopyToBuffer(*buffer_cpu);
+
+		GraphicsBuffer::Mapper mapper(*buffer_cpu, BA_Read_Only);
+		uint8_t const * p = mapper.Pointer<uint8_t>();
+		return std::vector<uint8_t>(p, p + buffer.Size());
+	}
+
+	bool ContentEqual(std::vector<uint8_t> const & uploaded, SubAlloc const & alloc, std::vector<uint8_t> const & pattern)
+	{
+		return (alloc.offset_ + alloc.length_ <= uploaded.size())
+			&& std::equal(pattern.begin(), pattern.end(), uploaded.begin() + alloc.offset_);
+	}
+
+	// Blocks until the GPU has passed everything submitted so far, so the next OnPresent retires all the frames before it
+	void WaitForGpu()
+	{
+		auto fence = Context::Instance().RenderFactoryInstance().MakeFence();
+		fence->Wait(fence->Signal(Fence::FT_Render));
+	}
+
+	bool NoOverwriteSupport()
+	{
+		return Context::Instance().RenderFactoryInstance().RenderEngineInstance().DeviceCaps().no_overwrite_support;
+	}
+}
+
+TEST(TransientBufferTest, FrameIsContiguous)
+{
+	TransientBuffer tb(1024, TransientBuffer::BF_Vertex);
+
+	uint8_t const data[64] = {};
+	for (uint32_t i = 0; i < 8; ++ i)
+	{
+		SubAlloc const alloc = tb.Alloc(sizeof(data), data);
+		EXPECT_EQ(i * sizeof(data), alloc.offset_);
+		EXPECT_EQ(sizeof(data), alloc.length_);
+	}
+	tb.EnsureDataReady();
+	tb.OnPresent();
+}
+
+TEST(TransientBufferTest, GrowKeepsOffsets)
+{
+	TransientBuffer tb(256, TransientBuffer::BF_Index);
+
+	std::vector<std::vector<uint8_t>> patterns;
+	std::vector<SubAlloc> allocs;
+	for (uint32_t i = 0; i < 3; ++ i)
+	{
+		patterns.push_back(MakePattern(128, static_cast<uint8_t>(i + 1)));
+		allocs.push_back(AllocPattern(tb, patterns.back()));
+		EXPECT_EQ(i * 128U, allocs.back().offset_);
+	}
+	EXPECT_GE(tb.GetBuffer()->Size(), 3 * 128U);
+	tb.EnsureDataReady();
+
+	// The allocations made before growing have to be in the larger buffer too
+	auto const uploaded = ReadBack(*tb.GetBuffer());
+	for (size_t i = 0; i < allocs.size(); ++ i)
+	{
+		EXPECT_TRUE(ContentEqual(uploaded, allocs[i], patterns[i]));
+	}
+
+	tb.OnPresent();
+}
+
+TEST(TransientBufferTest, WrapAround)
+{
+	if (!NoOverwriteSupport())
+	{
+		// Every upload discards the buffer, frames always start over from 0
+		return;
+	}
+
+	TransientBuffer tb(1024, TransientBuffer::BF_Vertex);
+	GraphicsBuffer const * const buffer = tb.GetBuffer().get();
+
+	auto const frame_a = MakePattern(512, 1);
+	EXPECT_EQ(0U, AllocPattern(tb, frame_a).offset_);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+	WaitForGpu();
+
+	// Frame A retires here, B stays in flight
+	auto const frame_b = MakePattern(256, 2);
+	SubAlloc const alloc_b = AllocPattern(tb, frame_b);
+	EXPECT_EQ(512U, alloc_b.offset_);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+
+	// Fills up to the end, then continues from 0 in the space frame A left
+	auto const frame_c0 = MakePattern(256, 3);
+	auto const frame_c1 = MakePattern(256, 4);
+	SubAlloc const alloc_c0 = AllocPattern(tb, frame_c0);
+	SubAlloc const alloc_c1 = AllocPattern(tb, frame_c1);
+	EXPECT_EQ(768U, alloc_c0.offset_);
+	EXPECT_EQ(0U, alloc_c1.offset_);
+	EXPECT_EQ(buffer, tb.GetBuffer().get());
+	tb.EnsureDataReady();
+
+	auto const uploaded = ReadBack(*tb.GetBuffer());
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_b, frame_b));
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_c0, frame_c0));
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_c1, frame_c1));
+
+	tb.OnPresent();
+}
+
+TEST(TransientBufferTest, GrowWhileWrapped)
+{
+	if (!NoOverwriteSupport())
+	{
+		return;
+	}
+
+	TransientBuffer tb(1024, TransientBuffer::BF_Vertex);
+
+	auto const frame_a = MakePattern(512, 1);
+	AllocPattern(tb, frame_a);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+	WaitForGpu();
+
+	auto const frame_b = MakePattern(256, 2);
+	AllocPattern(tb, frame_b);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+
+	auto const frame_c0 = MakePattern(256, 3);
+	auto const frame_c1 = MakePattern(256, 4);
+	auto const frame_c2 = MakePattern(512, 5);
+	SubAlloc const alloc_c0 = AllocPattern(tb, frame_c0);
+	SubAlloc const alloc_c1 = AllocPattern(tb, frame_c1);
+	ASSERT_EQ(0U, alloc_c1.offset_);
+
+	// Doesn't fit before frame B. The frame has wrapped, so the larger buffer continues after the old end.
+	SubAlloc const alloc_c2 = AllocPattern(tb, frame_c2);
+	EXPECT_EQ(1024U, alloc_c2.offset_);
+	EXPECT_EQ(2048U, tb.GetBuffer()->Size());
+	tb.EnsureDataReady();
+
+	// Everything of the current frame, on both sides of the wrap, is uploaded to the new buffer
+	auto const uploaded = ReadBack(*tb.GetBuffer());
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_c0, frame_c0));
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_c1, frame_c1));
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_c2, frame_c2));
+
+	tb.OnPresent();
+}
+
+TEST(TransientBufferTest, RetireUnwraps)
+{
+	if (!NoOverwriteSupport())
+	{
+		return;
+	}
+
+	TransientBuffer tb(1024, TransientBuffer::BF_Vertex);
+	GraphicsBuffer const * const buffer = tb.GetBuffer().get();
+
+	auto const frame_a = MakePattern(512, 1);
+	AllocPattern(tb, frame_a);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+	WaitForGpu();
+
+	auto const frame_b = MakePattern(256, 2);
+	AllocPattern(tb, frame_b);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+
+	auto const frame_c0 = MakePattern(256, 3);
+	auto const frame_c1 = MakePattern(256, 4);
+	AllocPattern(tb, frame_c0);
+	ASSERT_EQ(0U, AllocPattern(tb, frame_c1).offset_);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+	WaitForGpu();
+
+	// Frames B and C retire here. The tail moves to the end of C, and the ring is no longer wrapped.
+	auto const frame_d = MakePattern(128, 5);
+	EXPECT_EQ(256U, AllocPattern(tb, frame_d).offset_);
+	tb.EnsureDataReady();
+	tb.OnPresent();
+
+	// With the wrap still in place, the limit would be the old tail and this would grow the buffer
+	auto const frame_e = MakePattern(512, 6);
+	SubAlloc const alloc_e = AllocPattern(tb, frame_e);
+	EXPECT_EQ(384U, alloc_e.offset_);
+	EXPECT_EQ(buffer, tb.GetBuffer().get());
+	tb.EnsureDataReady();
+
+	auto const uploaded = ReadBack(*tb.GetBuffer());
+	EXPECT_TRUE(ContentEqual(uploaded, alloc_e, frame_e));
+
+	tb.OnPresent();
+}
+
+TEST(TransientBufferTest, ConcurrentAlloc)
+{
+	uint32_t const num_threads = 4;
+	uint32_t const allocs_per_thread = 2000;
+	uint32_t const alloc_size = 16;
+
+	// Starts small, so the threads also race with growing
+	TransientBuffer tb(1024, TransientBuffer::BF_Vertex);
+
+	std::vector<std::vector<uint32_t>> offsets(num_threads);
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < num_threads; ++ t)
+	{
+		threads.emplace_back([&, t] {
+			uint8_t data[alloc_size];
+			memset(data, static_cast<int>(t), sizeof(data));
+			for (uint32_t i = 0; i < allocs_per_thread; ++ i)
+			{
+				offsets[t].push_back(tb.Alloc(alloc_size, data).offset_);
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<uint32_t> all_offsets;
+	for (auto const & thread_offsets : offsets)
+	{
+		all_offsets.insert(all_offsets.end(), thread_offsets.begin(), thread_offsets.end());
+	}
+	std::sort(all_offsets.begin(), all_offsets.end());
+	for (size_t i = 1; i < all_offsets.size(); ++ i)
+	{
+		EXPECT_LE(all_offsets[i - 1] + alloc_size, all_offsets[i]);
+	}
+	EXPECT_GE(tb.GetBuffer()->Size(), all_offsets.back() + alloc_size);
+
+	tb.EnsureDataReady();
+	tb.OnPresent();
+}
+
+TEST(TransientBufferTest, AllocRate)
+{
+	uint32_t const num_frames = 100;
+	uint32_t const allocs_per_frame = 1000;
+	uint8_t const data[64] = {};
+
+	// What the allocator did before, mapping the whole buffer for every allocation
+	RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+	auto const map_mode = rf.RenderEngineInstance().DeviceCaps().no_overwrite_support ? BA_Write_No_Overwrite : BA_Write_Only;
+	auto buffer = rf.MakeVertexBuffer(BU_Dynamic, EAH_CPU_Write | EAH_GPU_Read, allocs_per_frame * sizeof(data), nullptr);
+	Timer timer;
+	for (uint32_t frame = 0; frame < num_frames; ++ frame)
+	{
+		for (uint32_t i = 0; i < allocs_per_frame; ++ i)
+		{
+			GraphicsBuffer::Mapper mapper(*buffer, map_mode);
+			memcpy(mapper.Pointer<uint8_t>() + i * sizeof(data), data, sizeof(data));
+		}
+	}
+	double const map_per_alloc_time = timer.elapsed();
+
+	TransientBuffer tb(allocs_per_frame * sizeof(data), TransientBuffer::BF_Vertex);
+	timer.restart();
+	for (uint32_t frame = 0; frame < num_frames; ++ frame)
+	{
+		for (uint32_t i = 0; i < allocs_per_frame; ++ i)
+		{
+			tb.Alloc(sizeof(data), data);
+		}
+		tb.EnsureDataReady();
+		tb.OnPresent();
+	}
+	double const ring_time = timer.elapsed();
+
+	uint32_t const num_allocs = num_frames * allocs_per_frame;
+	LogInfo() << "Transient allocations of " << sizeof(data) << " bytes: " << map_per_alloc_time / num_allocs * 1e9
+			  << " ns with a map per allocation, " << ring_time / num_allocs * 1e9 << " ns with the ring" << std::endl;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file UITest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Log.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
+#include <KlayGE/UI.hpp>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+TEST(UITest, RetainedBatches)
+{
+	uint32_t const num_controls = 500;
+	uint32_t const num_frames = 20;
+
+	auto& ui = UIManager::Instance();
+	auto dialog = ui.MakeDialog();
+	for (uint32_t i = 0; i < num_controls; ++ i)
+	{
+		dialog->AddControl(MakeSharedPtr<UIButton>(dialog, static_cast<int>(i), L"Button",
+			int4((i % 25) * 40, (i / 25) * 24, 38, 22)));
+	}
+
+	auto& overlay_root = Context::Instance().SceneManagerInstance().OverlayRootNode();
+	overlay_root.ClearChildren();
+	ui.Render();
+	size_t const num_overlay_nodes = overlay_root.Children().size();
+	EXPECT_GT(num_overlay_nodes, 0U);
+
+	// Same as a frame, without touching GPU. Batches and their nodes are reused.
+	Timer timer;
+	for (uint32_t frame = 0; frame < num_frames; ++ frame)
+	{
+		overlay_root.ClearChildren();
+		ui.Render();
+		EXPECT_EQ(num_overlay_nodes, overlay_root.Children().size());
+	}
+	double const frame_time = timer.elapsed() / num_frames;
+
+	LogInfo() << "Building UI of " << num_controls << " buttons: " << frame_time * 1e3 << " ms per frame, "
+			  << num_overlay_nodes << " overlay nodes" << std::endl;
+
+	overlay_root.ClearChildren();
+	ui.UnregisterDialog(dialog);
+}
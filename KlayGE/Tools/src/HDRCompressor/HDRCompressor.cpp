@@ -77,8 +77,7 @@ namespace
 		}
 		else
 		{
-			half* y_dst = reinterpret_cast<half*>(&y_data_block[0]);
-
+			std::vector<float> y_f32(width * height);
 			for (uint32_t y = 0; y < height; ++ y)
 			{
 				for (uint32_t x = 0; x < width; ++ x)
@@ -90,9 +89,11 @@ namespace
 
 					float log_y = log(Y) / log2 + 16;
 
-					y_dst[y * width + x] = half(log_y * 2048 / 65535);
+					y_f32[y * width + x] = log_y * 2048 / 65535;
 				}
 			}
+
+			FloatToHalf(y_f32, MakeSpan(reinterpret_cast<half*>(&y_data_block[0]), y_f32.size()));
 		}
 
 		uint32_t c_width = std::max(width / 2, 1U);
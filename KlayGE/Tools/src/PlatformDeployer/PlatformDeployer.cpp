@@ -32,14 +32,22 @@
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Hash.hpp>
 #include <KFL/StringUtil.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 #include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/JudaTexture.hpp>
 #include <KlayGE/RenderDeviceCaps.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/CXX17/filesystem.hpp>
+#include <KFL/CXX20/format.hpp>
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <vector>
 #include <regex>
 
@@ -60,6 +68,147 @@
 using namespace std;
 using namespace KlayGE;
 
+namespace
+{
+	// Part of the build cache key, bump it when the converters change their output
+	char const TOOL_VERSION[] = "2.1.0";
+
+	std::mutex cout_mutex;
+
+	void HashString(Sha256& hasher, std::string_view str)
+	{
+		hasher.Update(str);
+		hasher.Update(std::string_view("", 1));
+	}
+
+	// Hashes a resource by content if it can be found, by name otherwise. Every file goes in as its own digest, so the
+	//  boundaries between the inputs are part of the key.
+	void HashResource(Sha256& hasher, std::string_view name)
+	{
+		std::string const full_name = ResLoader::Instance().Locate(name);
+		if (full_name.empty())
+		{
+			hasher.Update(std::string_view("N"));
+			HashString(hasher, name);
+		}
+		else
+		{
+			Sha256 file_hasher;
+			std::ifstream ifs(full_name, std::ios_base::binary);
+			std::vector<char> buff(64 * 1024);
+			while (ifs)
+			{
+				ifs.read(buff.data(), buff.size());
+				file_hasher.Update(std::span(reinterpret_cast<uint8_t const*>(buff.data()), static_cast<size_t>(ifs.gcount())));
+			}
+
+			hasher.Update(std::string_view("F"));
+			hasher.Update(file_hasher.Final());
+		}
+	}
+
+	// Remembers which inputs every output was built from, as one stamp file per output under <local folder>/DeployCache.
+	//  The key is a SHA-256 of the source bytes, the .kmeta, the tool version and the target platform, so an output is
+	//  rebuilt only if one of them changed or the output is gone.
+	class DeployCache final
+	{
+	public:
+		explicit DeployCache(bool enabled)
+			: enabled_(enabled), cache_dir_(ResLoader::Instance().LocalFolder() + "DeployCache/")
+		{
+			std::error_code ec;
+			FILESYSTEM_NS::create_directories(cache_dir_, ec);
+		}
+
+		bool UpToDate(std::string const & output_name, Sha256::Digest const & key) const
+		{
+			if (!enabled_ || !FILESYSTEM_NS::exists(output_name))
+			{
+				return false;
+			}
+
+			std::ifstream ifs(this->StampName(output_name));
+			std::string stamp;
+			ifs >> stamp;
+			return stamp == Sha256::ToString(key);
+		}
+
+		void Update(std::string const & output_name, Sha256::Digest const & key)
+		{
+			std::ofstream ofs(this->StampName(output_name));
+			ofs << Sha256::ToString(key) << std::endl;
+		}
+
+	private:
+		std::string StampName(std::string const & output_name) const
+		{
+			std::error_code ec;
+			auto const abs_path = FILESYSTEM_NS::absolute(output_name, ec);
+
+			Sha256 hasher;
+			hasher.Update(abs_path.string());
+			return std::format("{}{}.stamp", cache_dir_, Sha256::ToString(hasher.Final()));
+		}
+
+	private:
+		bool enabled_;
+		std::string cache_dir_;
+	};
+
+	struct DeployStats
+	{
+		std::atomic<uint32_t> num_converted{0};
+		std::atomic<uint32_t> num_cached{0};
+		std::atomic<uint32_t> num_failed{0};
+	};
+
+	// Converts one asset unless its cached output is up to date, and reports the time it took. The report is buffered and
+	//  written at once, so the reports of concurrent assets don't interleave.
+	template <typename KeyFunc, typename ConvertFunc>
+	void DeployAsset(DeployCache& cache, DeployStats& stats, std::string const & res_name, std::string_view res_type,
+		std::string const & output_name, Sha256 const & base_hasher, KeyFunc const & key_func, ConvertFunc const & convert_func)
+	{
+		Timer timer;
+
+		Sha256 hasher = base_hasher;
+		HashResource(hasher, res_name);
+		HashResource(hasher, res_name + ".kmeta");
+		key_func(hasher);
+		Sha256::Digest const key = hasher.Final();
+
+		std::ostringstream report;
+		if (cache.UpToDate(output_name, key))
+		{
+			++ stats.num_cached;
+			report << res_name << " is up to date" << std::endl;
+		}
+		else if (convert_func())
+		{
+			cache.Update(output_name, key);
+			++ stats.num_converted;
+			report << "Converted " << res_name << " to " << res_type << " in " << timer.elapsed() * 1000 << " ms" << std::endl;
+		}
+		else
+		{
+			++ stats.num_failed;
+			report << "Failed to convert " << res_name << " to " << res_type << std::endl;
+		}
+
+		std::lock_guard<std::mutex> lock(cout_mutex);
+		std::cout << report.str() << std::flush;
+	}
+
+	std::string OutputName(std::string const & res_name, std::string_view dest_folder, std::string_view ext)
+	{
+		FILESYSTEM_NS::path res_path(res_name);
+		if (!dest_folder.empty())
+		{
+			res_path = FILESYSTEM_NS::path(dest_folder.begin(), dest_folder.end()) / res_path.filename();
+		}
+		return res_path.string() + std::string(ext);
+	}
+}
+
 TexMetadata DefaultTextureMetadata(size_t res_type_hash, RenderDeviceCaps const & caps)
 {
 	TexMetadata default_metadata;
@@ -128,85 +277,151 @@ MeshMetadata LoadMeshMetadata(std::string const & res_name, MeshMetadata const &
 }
 
 void Deploy(std::vector<std::string> const& res_names, std::string_view res_type, RenderDeviceCaps const& caps, std::string_view platform,
-	std::string_view dest_folder)
+	std::string_view dest_folder, bool use_cache)
 {
 	size_t const res_type_hash = HashValue(std::move(res_type));
 
-	if ((CT_HASH("albedo") == res_type_hash)
+	bool const is_texture = (CT_HASH("albedo") == res_type_hash)
 		|| (CT_HASH("emissive") == res_type_hash)
 		|| (CT_HASH("glossiness") == res_type_hash)
 		|| (CT_HASH("metalness") == res_type_hash)
 		|| (CT_HASH("normal") == res_type_hash)
 		|| (CT_HASH("bump") == res_type_hash)
-		|| (CT_HASH("height") == res_type_hash))
+		|| (CT_HASH("height") == res_type_hash);
+	if (is_texture || (CT_HASH("model") == res_type_hash))
 	{
-		TexMetadata const default_metadata = DefaultTextureMetadata(res_type_hash, caps);
-
-		TexConverter tc;
-		for (size_t i = 0; i < res_names.size(); ++ i)
+		// The converters add and remove the folder of their input from the search paths. Adding them up front keeps
+		//  concurrent conversions from removing each other's folders.
+		std::set<std::string> added_folders;
+		for (auto const & res_name : res_names)
 		{
-			std::string_view real_res_type;
-			auto metadata = LoadTextureMetadata(res_names[i], default_metadata);
-			switch (metadata.Slot())
+			auto const folder = FILESYSTEM_NS::path(ResLoader::Instance().Locate(res_name)).parent_path().string();
+			if (!folder.empty() && !ResLoader::Instance().IsInPath(folder) && added_folders.insert(folder).second)
+			{
+				ResLoader::Instance().AddPath(folder);
+			}
+		}
+		auto on_exit = nonstd::make_scope_exit([&added_folders] {
+			for (auto const & folder : added_folders)
 			{
-			case RenderMaterial::TS_Albedo:
-				real_res_type = "albedo";
-				break;
-			case RenderMaterial::TS_MetalnessGlossiness:
-				real_res_type = "metalness & glossiness";
-				break;
-			case RenderMaterial::TS_Emissive:
-				real_res_type = "emissive";
-				break;
-			case RenderMaterial::TS_Normal:
-				real_res_type = "normal";
-				break;
-			case RenderMaterial::TS_Height:
-				real_res_type = "height";
-				break;
-			case RenderMaterial::TS_Occlusion:
-				real_res_type = "occlusion";
-				break;
-
-			default:
-				KFL_UNREACHABLE("Invalid texture slot");
+				ResLoader::Instance().DelPath(folder);
 			}
+		});
 
-			std::cout << "Converting " << res_names[i] << " to " << real_res_type << std::endl;
+		// The platform definition fully describes the target RenderDeviceCaps
+		Sha256 base_hasher;
+		HashString(base_hasher, TOOL_VERSION);
+		HashString(base_hasher, platform);
+		HashString(base_hasher, res_type);
+		HashResource(base_hasher, std::string(platform) + ".plat");
 
-			auto output_tex = tc.Load(metadata);
-			if (output_tex)
-			{
-				FILESYSTEM_NS::path res_path(res_names[i]);
-				if (!dest_folder.empty())
+		DeployCache cache(use_cache);
+		DeployStats stats;
+		Timer timer;
+
+		auto& thread_pool = Context::Instance().ThreadPoolInstance();
+		if (is_texture)
+		{
+			TexMetadata const default_metadata = DefaultTextureMetadata(res_type_hash, caps);
+
+			thread_pool.ParallelFor(0, static_cast<uint32_t>(res_names.size()), 1, [&](uint32_t begin, uint32_t end)
 				{
-					res_path = FILESYSTEM_NS::path(dest_folder.begin(), dest_folder.end()) / res_path.filename();
-				}
-				SaveTexture(output_tex, res_path.string() + ".dds");
-			}
-		}
-	}
-	else if (CT_HASH("model") == res_type_hash)
-	{
-		MeshMetadata const default_metadata;
+					for (uint32_t i = begin; i < end; ++ i)
+					{
+						std::string_view real_res_type;
+						auto metadata = LoadTextureMetadata(res_names[i], default_metadata);
+						switch (metadata.Slot())
+						{
+						case RenderMaterial::TS_Albedo:
+							real_res_type = "albedo";
+							break;
+						case RenderMaterial::TS_MetalnessGlossiness:
+							real_res_type = "metalness & glossiness";
+							break;
+						case RenderMaterial::TS_Emissive:
+							real_res_type = "emissive";
+							break;
+						case RenderMaterial::TS_Normal:
+							real_res_type = "normal";
+							break;
+						case RenderMaterial::TS_Height:
+							real_res_type = "height";
+							break;
+						case RenderMaterial::TS_Occlusion:
+							real_res_type = "occlusion";
+							break;
+
+						default:
+							KFL_UNREACHABLE("Invalid texture slot");
+						}
 
-		MeshConverter mc;
-		for (size_t i = 0; i < res_names.size(); ++ i)
+						std::string const output_name = OutputName(res_names[i], dest_folder, ".dds");
+						DeployAsset(cache, stats, res_names[i], real_res_type, output_name, base_hasher,
+							[&metadata](Sha256& hasher)
+							{
+								for (uint32_t arr = 0; arr < metadata.ArraySize(); ++ arr)
+								{
+									for (uint32_t m = 0;; ++ m)
+									{
+										std::string_view const plane_name = metadata.PlaneFileName(arr, m);
+										if (plane_name.empty())
+										{
+											break;
+										}
+										HashResource(hasher, plane_name);
+									}
+								}
+							},
+							[&metadata, &output_name]()
+							{
+								TexConverter tc;
+								auto output_tex = tc.Load(metadata);
+								if (output_tex)
+								{
+									SaveTexture(output_tex, output_name);
+								}
+								return !!output_tex;
+							});
+					}
+				});
+		}
+		else
 		{
-			std::cout << "Converting " << res_names[i] << " to " << res_type << std::endl;
+			MeshMetadata const default_metadata;
 
-			auto metadata = LoadMeshMetadata(res_names[i], default_metadata);
-			auto output_model = mc.Load(metadata);
-			if (output_model)
-			{
-				FILESYSTEM_NS::path res_path(res_names[i]);
-				if (!dest_folder.empty())
+			thread_pool.ParallelFor(0, static_cast<uint32_t>(res_names.size()), 1, [&](uint32_t begin, uint32_t end)
 				{
-					res_path = FILESYSTEM_NS::path(dest_folder.begin(), dest_folder.end()) / res_path.filename();
-				}
-				SaveModel(*output_model, res_path.string() + ".model_bin");
-			}
+					for (uint32_t i = begin; i < end; ++ i)
+					{
+						auto metadata = LoadMeshMetadata(res_names[i], default_metadata);
+
+						std::string const output_name = OutputName(res_names[i], dest_folder, ".model_bin");
+						DeployAsset(cache, stats, res_names[i], res_type, output_name, base_hasher,
+							[&metadata](Sha256& hasher)
+							{
+								for (uint32_t lod = 0; lod < metadata.NumLods(); ++ lod)
+								{
+									HashResource(hasher, metadata.LodFileName(lod));
+								}
+							},
+							[&metadata, &output_name]()
+							{
+								MeshConverter mc;
+								auto output_model = mc.Load(metadata);
+								if (output_model)
+								{
+									SaveModel(*output_model, output_name);
+								}
+								return !!output_model;
+							});
+					}
+				});
 		}
+
+		uint32_t const num_assets = static_cast<uint32_t>(res_names.size());
+		std::cout << "Deployed " << num_assets << " assets in " << timer.elapsed() << " s: " << stats.num_converted << " converted, "
+				  << stats.num_cached << " up to date (" << (num_assets > 0 ? stats.num_cached * 100.0f / num_assets : 0.0f)
+				  << "% cache hit rate), " << stats.num_failed << " failed." << std::endl;
 	}
 	else
 	{
@@ -297,6 +512,7 @@ int main(int argc, char* argv[])
 		("T,type", "Resource type (auto by default).", cxxopts::value<std::string>())
 		("P,platform", "Platform name.", cxxopts::value<std::string>())
 		("D,dest-folder", "Destination folder.", cxxopts::value<std::string>())
+		("F,force", "Convert every resource, even if the build cache says it's up to date.")
 		("v,version", "Version.");
 	// clang-format on
 
@@ -310,7 +526,7 @@ int main(int argc, char* argv[])
 	}
 	if (vm.count("version") > 0)
 	{
-		cout << "KlayGE PlatformDeployer, Version 2.0.0" << endl;
+		cout << "KlayGE PlatformDeployer, Version " << TOOL_VERSION << endl;
 		return 1;
 	}
 	if (vm.count("dest-folder") > 0)
@@ -491,7 +707,7 @@ int main(int argc, char* argv[])
 	}
 
 	PlatformDefinition platform_def(platform + ".plat");
-	Deploy(res_names, res_type, platform_def.device_caps, platform, dest_folder);
+	Deploy(res_names, res_type, platform_def.device_caps, platform, dest_folder, vm.count("force") == 0);
 
 	return 0;
 }